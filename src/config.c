@@ -140,6 +140,19 @@ configEnum rocksdb_compression_enum[] = {
     {NULL, 0}
 };
 
+configEnum rocksdb_block_cache_type_enum[] = {
+    {"separate", ROCKSDB_BLOCK_CACHE_SEPARATE},
+    {"shared", ROCKSDB_BLOCK_CACHE_SHARED},
+    {"hyper-clock", ROCKSDB_BLOCK_CACHE_HYPER_CLOCK},
+    {NULL, 0}
+};
+
+configEnum swap_key_format_enum[] = {
+    {"legacy", SWAP_KEY_FORMAT_LEGACY},
+    {"compact", SWAP_KEY_FORMAT_COMPACT},
+    {NULL, 0}
+};
+
 configEnum cuckoo_filter_bit_type_enum[] = {
     {"8", CUCKOO_FILTER_BITS_PER_TAG_8},
     {"12", CUCKOO_FILTER_BITS_PER_TAG_12},
@@ -2460,6 +2473,15 @@ static int updateMaxmemory(long long val, long long prev, const char **err) {
     return 1;
 }
 
+static int updateSwapReplWorkers(long long val, long long prev, const char **err) {
+    UNUSED(val);
+    UNUSED(prev);
+    UNUSED(err);
+    /* repl worker clients not created untill swapInit. */
+    if (server.repl_worker_clients_free) replWorkerClientsTrim();
+    return 1;
+}
+
 static int updateSwapAbsentCacheCapacity(long long val, long long prev, const char **err) {
     UNUSED(prev);
     UNUSED(err);
@@ -2534,6 +2556,32 @@ static int updateRocksdbMetaMinBlobSize(long long val, long long prev, const cha
     return updateRocksdbCFOptionNumber(META_CF, "min_blob_size", val, err);
 }
 
+static int updateRocksdbCFCompressionOpts(int cf, int max_dict_bytes,
+        unsigned long long max_dict_buffer_bytes, const char **err) {
+    char val_str[128];
+    snprintf(val_str, sizeof(val_str),
+            "{max_dict_bytes=%d;max_dict_buffer_bytes=%llu}",
+            max_dict_bytes, max_dict_buffer_bytes);
+    return updateRocksdbCFOption(cf, "compression_opts", val_str, err);
+}
+
+static int updateRocksdbDataCompressionOpts(long long val, long long prev, const char **err) {
+    UNUSED(val), UNUSED(prev);
+    return updateRocksdbCFCompressionOpts(DATA_CF,
+                server.rocksdb_data_compression_max_dict_bytes,
+                server.rocksdb_data_compression_max_dict_buffer_bytes, err) &&
+           updateRocksdbCFCompressionOpts(SCORE_CF,
+                server.rocksdb_data_compression_max_dict_bytes,
+                server.rocksdb_data_compression_max_dict_buffer_bytes, err);
+}
+
+static int updateRocksdbMetaCompressionOpts(long long val, long long prev, const char **err) {
+    UNUSED(val), UNUSED(prev);
+    return updateRocksdbCFCompressionOpts(META_CF,
+                server.rocksdb_meta_compression_max_dict_bytes,
+                server.rocksdb_meta_compression_max_dict_buffer_bytes, err);
+}
+
 static int updateRocksdbDataBlobFileSize(long long val, long long prev, const char **err) {
     UNUSED(prev);
     return updateRocksdbCFOptionNumber(DATA_CF, "blob_file_size", val, err) &&
@@ -2888,17 +2936,26 @@ standardConfig configs[] = {
     createBoolConfig("slave-repl-all", NULL, MODIFIABLE_CONFIG, server.repl_slave_repl_all, 0, NULL, NULL),
     createBoolConfig("swap-debug-trace-latency", NULL, MODIFIABLE_CONFIG, server.swap_debug_trace_latency, 0, NULL, NULL),
     createBoolConfig("swap-cuckoo-filter-enabled", NULL, MODIFIABLE_CONFIG, server.swap_cuckoo_filter_enabled, 1, NULL, updateSwapCuckooFilterEnabled),
+    createBoolConfig("swap-cuckoo-filter-snapshot-enabled", NULL, MODIFIABLE_CONFIG, server.swap_cuckoo_filter_snapshot_enabled, 1, NULL, NULL),
     createBoolConfig("swap-absent-cache-enabled", NULL, MODIFIABLE_CONFIG, server.swap_absent_cache_enabled, 1, NULL, updateSwapAbsentCacheEnabled),
     createBoolConfig("swap-absent-cache-include-subkey", NULL, MODIFIABLE_CONFIG, server.swap_absent_cache_include_subkey, 1, NULL, NULL),
+    createBoolConfig("swap-evict-cost-aware", NULL, MODIFIABLE_CONFIG, server.swap_evict_cost_aware, 0, NULL, NULL),
+    createBoolConfig("swap-evict-track-subkey-access", NULL, MODIFIABLE_CONFIG, server.swap_evict_track_subkey_access, 1, NULL, NULL),
     createBoolConfig("swap-bgsave-fix-metalen-mismatch", NULL, MODIFIABLE_CONFIG, server.swap_bgsave_fix_metalen_mismatch, 0, NULL, NULL),
+    createBoolConfig("swap-repl-rocks-checkpoint-sync", NULL, MODIFIABLE_CONFIG, server.swap_repl_rocks_checkpoint_sync, 0, NULL, NULL),
+    createBoolConfig("swap-repl-apply-out-of-order", NULL, MODIFIABLE_CONFIG, server.swap_repl_apply_out_of_order, 0, NULL, NULL),
+    createBoolConfig("swap-rdb-load-ingest-enabled", NULL, MODIFIABLE_CONFIG, server.swap_rdb_load_ingest_enabled, 0, NULL, NULL),
+    createBoolConfig("swap-scan-expire-index", NULL, MODIFIABLE_CONFIG, server.swap_scan_expire_index, 1, NULL, NULL),
     createBoolConfig("swap-dirty-subkeys-enabled", NULL, MODIFIABLE_CONFIG, server.swap_dirty_subkeys_enabled, 0, NULL, NULL),
     createBoolConfig("swap-persist-enabled", NULL, IMMUTABLE_CONFIG, server.swap_persist_enabled, 0, NULL, NULL),
+    createBoolConfig("swap-key-format-migrate", NULL, IMMUTABLE_CONFIG, server.swap_key_format_migrate, 0, NULL, NULL),
     createBoolConfig("rocksdb.data.cache_index_and_filter_blocks", "rocksdb.cache_index_and_filter_blocks", IMMUTABLE_CONFIG, server.rocksdb_data_cache_index_and_filter_blocks, 0, NULL, NULL),
     createBoolConfig("rocksdb.meta.cache_index_and_filter_blocks", NULL, IMMUTABLE_CONFIG, server.rocksdb_meta_cache_index_and_filter_blocks, 0, NULL, NULL),
     createBoolConfig("rocksdb.enable_pipelined_write", NULL, IMMUTABLE_CONFIG, server.rocksdb_enable_pipelined_write, 0, NULL, NULL),
     createBoolConfig("rocksdb.data.disable_auto_compactions", "rocksdb.disable_auto_compactions", MODIFIABLE_CONFIG, server.rocksdb_data_disable_auto_compactions, 0, NULL, updateRocksdbDataDisableAutoCompactions),
     createBoolConfig("rocksdb.meta.disable_auto_compactions", NULL, MODIFIABLE_CONFIG, server.rocksdb_meta_disable_auto_compactions, 0, NULL, updateRocksdbMetaDisableAutoCompactions),
     createBoolConfig("rocksdb.data.compaction_dynamic_level_bytes", "rocksdb.compaction_dynamic_level_bytes", IMMUTABLE_CONFIG, server.rocksdb_data_compaction_dynamic_level_bytes, 0, NULL, NULL),
+    createBoolConfig("rocksdb.data.prefix_bloom", NULL, IMMUTABLE_CONFIG, server.rocksdb_data_prefix_bloom, 1, NULL, NULL),
     createBoolConfig("rocksdb.meta.compaction_dynamic_level_bytes", NULL, IMMUTABLE_CONFIG, server.rocksdb_meta_compaction_dynamic_level_bytes, 0, NULL, NULL),
     createBoolConfig("rocksdb.data.enable_blob_files", "rocksdb.enable_blob_files", MODIFIABLE_CONFIG, server.rocksdb_data_enable_blob_files, 0, NULL, updateRocksdbDataEnableBlobFiles),
     createBoolConfig("rocksdb.meta.enable_blob_files", NULL, MODIFIABLE_CONFIG, server.rocksdb_meta_enable_blob_files, 0, NULL, updateRocksdbMetaEnableBlobFiles),
@@ -2940,6 +2997,8 @@ standardConfig configs[] = {
     createEnumConfig("swap-mode", NULL, IMMUTABLE_CONFIG, swap_mode_enum, server.swap_mode, SWAP_MODE_MEMORY, isValidSwapMode, NULL),
     createEnumConfig("rocksdb.data.compression","rocksdb.compression", MODIFIABLE_CONFIG, rocksdb_compression_enum, server.rocksdb_data_compression, rocksdb_snappy_compression, NULL, updateRocksdbDataCompression),
     createEnumConfig("rocksdb.meta.compression", NULL, MODIFIABLE_CONFIG, rocksdb_compression_enum, server.rocksdb_meta_compression, rocksdb_snappy_compression, NULL, updateRocksdbMetaCompression),
+    createEnumConfig("swap-key-format", NULL, IMMUTABLE_CONFIG, swap_key_format_enum, server.swap_key_format, SWAP_KEY_FORMAT_COMPACT, NULL, NULL),
+    createEnumConfig("rocksdb.block_cache_type", NULL, IMMUTABLE_CONFIG, rocksdb_block_cache_type_enum, server.rocksdb_block_cache_type, ROCKSDB_BLOCK_CACHE_SEPARATE, NULL, NULL),
     createEnumConfig("swap-cuckoo-filter-bit-per-key", NULL, IMMUTABLE_CONFIG, cuckoo_filter_bit_type_enum, server.swap_cuckoo_filter_bit_type, CUCKOO_FILTER_BITS_PER_TAG_8, NULL, NULL),
     createEnumConfig("swap-ratelimit-policy", NULL, MODIFIABLE_CONFIG, swap_ratelimit_policy_enum, server.swap_ratelimit_policy, SWAP_RATELIMIT_POLICY_PAUSE, NULL, NULL),
 
@@ -2980,9 +3039,17 @@ standardConfig configs[] = {
     createIntConfig("min-replicas-max-lag", "min-slaves-max-lag", MODIFIABLE_CONFIG, 0, INT_MAX, server.repl_min_slaves_max_lag, 10, INTEGER_CONFIG, NULL, updateGoodSlaves),
     createIntConfig("swap-debug-evict-keys", NULL, MODIFIABLE_CONFIG, -1, INT_MAX, server.swap_debug_evict_keys, 0, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("ps-parallism-rdb", NULL, MODIFIABLE_CONFIG, 4, 16384, server.ps_parallism_rdb, 32, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-rdb-save-threads", NULL, MODIFIABLE_CONFIG, 1, SWAP_RDB_SAVE_THREADS_MAX, server.swap_rdb_save_threads, 1, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-rdb-load-ingest-threads", NULL, MODIFIABLE_CONFIG, 1, RDB_LOAD_INGEST_THREADS_MAX, server.swap_rdb_load_ingest_threads, 4, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-evict-step-max-subkeys", NULL, MODIFIABLE_CONFIG, 0, 65536, server.swap_evict_step_max_subkeys, 1024, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-repl-workers", NULL, MODIFIABLE_CONFIG, 1, 65536, server.repl_workers, 256, INTEGER_CONFIG, NULL, updateSwapReplWorkers),
+    createIntConfig("swap-stream-chunk-subkeys", NULL, MODIFIABLE_CONFIG, 0, 65536, server.swap_stream_chunk_subkeys, 1024, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-pipeline-prefetch-depth", NULL, MODIFIABLE_CONFIG, 0, 1024, server.swap_pipeline_prefetch_depth, 16, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-debug-rio-delay-micro", NULL, MODIFIABLE_CONFIG, -1, INT_MAX, server.swap_debug_rio_delay_micro, 0, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-threads", NULL, IMMUTABLE_CONFIG, 4, 64, server.swap_threads_num, 4, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-priority-expire-share", NULL, MODIFIABLE_CONFIG, 1, 100, server.swap_priority_expire_share, 10, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-priority-evict-share", NULL, MODIFIABLE_CONFIG, 1, 100, server.swap_priority_evict_share, 20, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-priority-persist-share", NULL, MODIFIABLE_CONFIG, 1, 100, server.swap_priority_persist_share, 10, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("jemalloc-max-bg-threads", NULL, IMMUTABLE_CONFIG, 4, 16, server.jemalloc_max_bg_threads, 4, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-debug-swapout-notify-delay-micro", NULL, MODIFIABLE_CONFIG, -1, INT_MAX, server.swap_debug_swapout_notify_delay_micro, 0, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-debug-before-exec-swap-delay-micro", NULL, MODIFIABLE_CONFIG, 0, INT_MAX, server.swap_debug_before_exec_swap_delay_micro, 0, INTEGER_CONFIG, NULL, NULL),
@@ -3004,6 +3071,8 @@ standardConfig configs[] = {
     createIntConfig("swap-persist-lag-millis", NULL, MODIFIABLE_CONFIG, 0, INT_MAX, server.swap_persist_lag_millis, 0, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-persist-inprogress-growth-rate", NULL, MODIFIABLE_CONFIG, 1, INT_MAX, server.swap_persist_inprogress_growth_rate, 500, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-flush-meta-deletes-percentage", NULL, MODIFIABLE_CONFIG, 0, 100, server.swap_flush_meta_deletes_percentage, 40, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("rocksdb.data.compression_max_dict_bytes", NULL, MODIFIABLE_CONFIG, 0, INT_MAX, server.rocksdb_data_compression_max_dict_bytes, 0, MEMORY_CONFIG, NULL, updateRocksdbDataCompressionOpts),
+    createIntConfig("rocksdb.meta.compression_max_dict_bytes", NULL, MODIFIABLE_CONFIG, 0, INT_MAX, server.rocksdb_meta_compression_max_dict_bytes, 0, MEMORY_CONFIG, NULL, updateRocksdbMetaCompressionOpts),
     createIntConfig("rocksdb.max_open_files", NULL, IMMUTABLE_CONFIG, -1, INT_MAX, server.rocksdb_max_open_files, -1, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("rocksdb.data.max_write_buffer_number", "rocksdb.max_write_buffer_number", MODIFIABLE_CONFIG, 1, 256, server.rocksdb_data_max_write_buffer_number, 3, INTEGER_CONFIG, NULL, updateRocksdbDataMaxWriteBufferNumber),
     createIntConfig("rocksdb.meta.max_write_buffer_number", NULL, MODIFIABLE_CONFIG, 1, 256, server.rocksdb_meta_max_write_buffer_number, 3, INTEGER_CONFIG, NULL, updateRocksdbMetaMaxWriteBufferNumber),
@@ -3047,8 +3116,11 @@ standardConfig configs[] = {
     createULongLongConfig("maxmemory", NULL, MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.maxmemory, 0, MEMORY_CONFIG, NULL, updateMaxmemory),
     createULongLongConfig("maxmemory-scaledown-rate", NULL, MODIFIABLE_CONFIG, 1, ULLONG_MAX, server.maxmemory_scaledown_rate, 1024*1024, MEMORY_CONFIG, NULL, NULL),
     createULongLongConfig("swap-max-db-size", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_max_db_size, 0, MEMORY_CONFIG, NULL, NULL),
+    createULongLongConfig("swap-string-chunk-threshold", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_string_chunk_threshold, 0, MEMORY_CONFIG, NULL, NULL), /* Default: disabled */
+    createULongLongConfig("swap-stream-reply-buffer-limit", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_stream_reply_buffer_limit, 1*1024*1024, MEMORY_CONFIG, NULL, NULL), /* Default: 1mb */
     createULongLongConfig("swap-evict-step-max-memory", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_evict_step_max_memory, 1*1024*1024, MEMORY_CONFIG, NULL, NULL), /* Default: 1mb */
     createULongLongConfig("swap-repl-max-rocksdb-read-bps", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_repl_max_rocksdb_read_bps, 0, MEMORY_CONFIG, NULL, NULL), /* Default: unlimited */
+    createULongLongConfig("swap-rdb-load-ingest-buffer-size", NULL, MODIFIABLE_CONFIG, 1024*1024, LLONG_MAX, server.swap_rdb_load_ingest_buffer_size, 256*1024*1024, MEMORY_CONFIG, NULL, NULL), /* Default: 256mb */
     createULongLongConfig("swap-cuckoo-filter-estimated-keys", NULL, IMMUTABLE_CONFIG, 1, LLONG_MAX, server.swap_cuckoo_filter_estimated_keys, 32000000, INTEGER_CONFIG, NULL, NULL), /* Default: 32M */
     createULongLongConfig("swap-absent-cache-capacity", NULL, MODIFIABLE_CONFIG, 1, LLONG_MAX, server.swap_absent_cache_capacity, 64*1024, INTEGER_CONFIG, NULL, updateSwapAbsentCacheCapacity), /* Default: 64k */
     createULongLongConfig("swap-compaction-filter-disable-until", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_compaction_filter_disable_until, 0, INTEGER_CONFIG, NULL, NULL),
@@ -3076,6 +3148,8 @@ standardConfig configs[] = {
     createULongLongConfig("rocksdb.data.min_blob_size", "rocksdb.min_blob_size", MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_data_min_blob_size, 4096, MEMORY_CONFIG, NULL, updateRocksdbDataMinBlobSize),
     createULongLongConfig("rocksdb.meta.min_blob_size", NULL, MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_meta_min_blob_size, 4096, MEMORY_CONFIG, NULL, updateRocksdbMetaMinBlobSize),
     createULongLongConfig("rocksdb.data.blob_file_size", "rocksdb.blob_file_size", MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_data_blob_file_size, 256*1024*1024, MEMORY_CONFIG, NULL, updateRocksdbDataBlobFileSize),
+    createULongLongConfig("rocksdb.data.compression_max_dict_buffer_bytes", NULL, MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_data_compression_max_dict_buffer_bytes, 4*1024*1024, MEMORY_CONFIG, NULL, updateRocksdbDataCompressionOpts),
+    createULongLongConfig("rocksdb.meta.compression_max_dict_buffer_bytes", NULL, MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_meta_compression_max_dict_buffer_bytes, 4*1024*1024, MEMORY_CONFIG, NULL, updateRocksdbMetaCompressionOpts),
     createULongLongConfig("rocksdb.meta.blob_file_size", NULL, MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_meta_blob_file_size, 256*1024*1024, MEMORY_CONFIG, NULL, updateRocksdbMetaBlobFileSize),
 
 
@@ -28,212 +28,243 @@
 
 #include "ctrip_swap.h"
 
-absentKeyMapEntry *absentKeyMapEntryNew(listNode *ln, dict *subkeys) {
-    absentKeyMapEntry *entry = zmalloc(sizeof(absentKeyMapEntry));
-    entry->ln = ln;
-    entry->subkeys = subkeys;
-    return entry;
+/* Absent cache holds most recently accessed keys & subkeys that definitely
+ * not exists in rocksdb. Keys and subkeys are cached as 64 bit fingerprints
+ * in a flat linear probing table (no key stored, no per-entry allocation),
+ * evicted by CLOCK (second chance) when capacity reached.
+ *
+ * Subkeys cached are invalidated all at once when key deleted by bumping
+ * generation of the key: subkey slot with generation other than current
+ * generation of its key is stale. Keys sharing a generation also get their
+ * subkeys invalidated, which is safe for a cache of absent subkeys. Memory
+ * overhead is 16 bytes per slot plus 4 bytes per generation, and table
+ * grows with load factor kept between 3/8 and 3/4. */
+
+#define ABSENT_CACHE_INIT_SLOTS 16
+#define ABSENT_CACHE_MIN_GENS 1024
+#define ABSENT_CACHE_GEN_MASK ((1U<<30)-1)
+
+static inline uint64_t absentMix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline uint64_t absentKeyHash(sds key) {
+    return dictGenHashFunction(key,sdslen(key));
+}
+
+static inline uint64_t absentKeyFingerprint(uint64_t keyhash) {
+    return keyhash ? keyhash : 1;
+}
+
+static inline uint64_t absentSubkeyFingerprint(uint64_t keyhash, sds subkey) {
+    uint64_t subhash = dictGenHashFunction(subkey,sdslen(subkey));
+    uint64_t fp = absentMix64(keyhash ^ absentMix64(subhash+0x9e3779b97f4a7c15ULL));
+    return fp ? fp : 1;
+}
+
+static inline uint32_t absentKeyTag(uint64_t keyhash) {
+    return (uint32_t)(keyhash >> 32);
+}
+
+static inline uint32_t *absentCacheKeyGen(absentCache *absent, uint32_t keytag) {
+    return absent->gens + (keytag & (absent->ngens-1));
+}
+
+static inline int absentSlotIsStale(absentCache *absent, absentSlot *slot) {
+    return slot->subkey && slot->gen != *absentCacheKeyGen(absent,slot->keytag);
+}
+
+static absentSlot *absentCacheFind(absentCache *absent, uint64_t fp,
+        int subkey) {
+    size_t mask = absent->nslots-1, i = fp & mask;
+    while (absent->slots[i].fp) {
+        absentSlot *slot = absent->slots+i;
+        if (slot->fp == fp && slot->subkey == subkey) return slot;
+        i = (i+1) & mask;
+    }
+    return NULL;
 }
 
-void absentKeyMapEntryFree(absentKeyMapEntry *entry) {
-    if (entry == NULL) return;
-    if (entry->subkeys) {
-        dictRelease(entry->subkeys);
-        entry->subkeys = NULL;
+/* Backward shift deletion, so that no tombstone needed. */
+static void absentCacheRemoveSlot(absentCache *absent, size_t i) {
+    size_t mask = absent->nslots-1, j = i, k;
+
+    while (1) {
+        j = (j+1) & mask;
+        if (absent->slots[j].fp == 0) break;
+        k = absent->slots[j].fp & mask;
+        /* slot j stays if its home k lies cyclically in (i,j]. */
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+        absent->slots[i] = absent->slots[j];
+        i = j;
     }
-    zfree(entry);
+    memset(absent->slots+i,0,sizeof(absentSlot));
+    absent->count--;
 }
 
-absentListEntry *absentListEntryNew(sds key, sds subkey) {
-    absentListEntry *entry = zmalloc(sizeof(absentListEntry));
-    entry->key = key;
-    entry->subkey = subkey;
-    return entry;
+static void absentCacheInsertSlot(absentCache *absent, absentSlot *slot) {
+    size_t mask = absent->nslots-1, i = slot->fp & mask;
+    while (absent->slots[i].fp) i = (i+1) & mask;
+    absent->slots[i] = *slot;
+    absent->count++;
 }
 
-void absentListEntryFree(absentKeyMapEntry *entry) {
-    if (entry == NULL) return;
-    zfree(entry);
+/* Rebuild table with nslots, stale subkeys dropped and generations reset. */
+static inline size_t absentCacheGensFor(size_t nslots) {
+    return nslots < ABSENT_CACHE_MIN_GENS ? ABSENT_CACHE_MIN_GENS : nslots;
 }
 
-void dictAbsentKeyMapEntryFree(void *privdata, void *val) {
-    DICT_NOTUSED(privdata);
-    absentKeyMapEntryFree(val);
+static void absentCacheResize(absentCache *absent, size_t nslots) {
+    absentSlot *slots = absent->slots;
+    uint32_t *gens = absent->gens;
+    size_t old_nslots = absent->nslots, old_ngens = absent->ngens;
+
+    absent->slots = zcalloc(nslots*sizeof(absentSlot));
+    absent->ngens = absentCacheGensFor(nslots);
+    absent->gens = zcalloc(absent->ngens*sizeof(uint32_t));
+    absent->nslots = nslots;
+    absent->count = 0;
+    absent->hand = 0;
+
+    for (size_t i = 0; i < old_nslots; i++) {
+        absentSlot slot = slots[i];
+        if (slot.fp == 0) continue;
+        if (slot.subkey) {
+            if (slot.gen != gens[slot.keytag & (old_ngens-1)]) continue;
+            slot.gen = 0;
+        }
+        absentCacheInsertSlot(absent,&slot);
+    }
+
+    zfree(slots);
+    zfree(gens);
 }
 
-/* holds most recently accessed keys & subkeys that definitely not exists
- * in rocksdb. */
-dictType absentKeyDictType = {
-    dictSdsHash,               /* hash function */
-    NULL,                      /* key dup */
-    NULL,                      /* val dup */
-    dictSdsKeyCompare,         /* key compare */
-    dictSdsDestructor,         /* key destructor */
-    dictAbsentKeyMapEntryFree, /* val destructor */
-    NULL                       /* allow to expand */
-};
-
-dictType absentSubkeyDictType = {
-    dictSdsHash,               /* hash function */
-    NULL,                      /* key dup */
-    NULL,                      /* val dup */
-    dictSdsKeyCompare,         /* key compare */
-    dictSdsDestructor,         /* key destructor */
-    NULL,                      /* val destructor */
-    NULL                       /* allow to expand */
-};
+/* Evict one slot: stale subkey first, then slot not referenced since hand
+ * passed by last time. */
+static void absentCacheEvictOne(absentCache *absent) {
+    size_t mask = absent->nslots-1;
+    serverAssert(absent->count > 0);
+    while (1) {
+        absentSlot *slot = absent->slots+absent->hand;
+        if (slot->fp == 0) {
+            absent->hand = (absent->hand+1) & mask;
+        } else if (slot->ref && !absentSlotIsStale(absent,slot)) {
+            slot->ref = 0;
+            absent->hand = (absent->hand+1) & mask;
+        } else {
+            /* slot shifted into hand will be checked next. */
+            absentCacheRemoveSlot(absent,absent->hand);
+            return;
+        }
+    }
+}
+
+static void absentCacheTrim(absentCache *absent) {
+    while (absent->count > absent->capacity)
+        absentCacheEvictOne(absent);
+}
+
+/* Make room for one more slot, keeps load factor under 3/4. */
+static void absentCacheMakeRoom(absentCache *absent) {
+    while (absent->count && absent->count >= absent->capacity)
+        absentCacheEvictOne(absent);
+    if ((absent->count+1)*4 > absent->nslots*3)
+        absentCacheResize(absent,absent->nslots*2);
+}
+
+static void absentCacheAdd(absentCache *absent, uint64_t fp, uint32_t keytag,
+        int subkey) {
+    absentSlot slot = {0};
+    absentCacheMakeRoom(absent);
+    slot.fp = fp;
+    slot.keytag = keytag;
+    slot.subkey = subkey;
+    if (subkey) slot.gen = *absentCacheKeyGen(absent,keytag);
+    absentCacheInsertSlot(absent,&slot);
+}
 
 absentCache *absentCacheNew(size_t capacity) {
     absentCache *absent = zmalloc(sizeof(absentCache));
     absent->capacity = capacity;
-    absent->map = dictCreate(&absentKeyDictType,NULL);
-    absent->list = listCreate();
-    listSetFreeMethod(absent->list,(void(*)(void*))absentListEntryFree);
+    absent->count = 0;
+    absent->nslots = ABSENT_CACHE_INIT_SLOTS;
+    absent->hand = 0;
+    absent->slots = zcalloc(absent->nslots*sizeof(absentSlot));
+    absent->ngens = absentCacheGensFor(absent->nslots);
+    absent->gens = zcalloc(absent->ngens*sizeof(uint32_t));
     return absent;
 }
 
 void absentCacheFree(absentCache *absent) {
     if (absent == NULL) return;
-    if (absent->list) {
-        listRelease(absent->list);
-        absent->list = NULL;
-    }
-    if (absent->map) {
-        dictRelease(absent->map);
-        absent->map = NULL;
-    }
+    zfree(absent->slots);
+    zfree(absent->gens);
     zfree(absent);
 }
 
 /* Delete both cached absent key & subkeys */
 int absentCacheDelete(absentCache *absent, sds key) {
-    dictEntry *de;
-
-    if ((de = dictUnlink(absent->map,key))) {
-        absentKeyMapEntry *me = dictGetVal(de);
-        /* delete cached absent subkeys */
-        if (me->subkeys) {
-            dictEntry *sde;
-            dictIterator *di = dictGetIterator(me->subkeys);
-            while ((sde = dictNext(di)) != NULL) {
-                listNode *ln = dictGetVal(sde);
-                listDelNode(absent->list,ln);
-            }
-            dictReleaseIterator(di);
-            dictRelease(me->subkeys);
-            me->subkeys = NULL;
-        }
-        /* delete cached absent key */
-        if (me->ln) {
-            listDelNode(absent->list,me->ln);
-            me->ln = NULL;
-        }
-        dictFreeUnlinkedEntry(absent->map,de);
+    uint64_t keyhash = absentKeyHash(key);
+    uint32_t *gen = absentCacheKeyGen(absent,absentKeyTag(keyhash));
+    absentSlot *slot;
+
+    /* invalidate cached absent subkeys */
+    *gen = (*gen+1) & ABSENT_CACHE_GEN_MASK;
+
+    if ((slot = absentCacheFind(absent,absentKeyFingerprint(keyhash),0))) {
+        absentCacheRemoveSlot(absent,slot-absent->slots);
         return 1;
     } else {
         return 0;
     }
 }
 
-static void absentCacheTrim(absentCache *absent) {
-    while (listLength(absent->list) > absent->capacity) {
-        listNode *ln = listLast(absent->list);
-        absentListEntry *le = listNodeValue(ln);
-        absentKeyMapEntry *me = dictFetchValue(absent->map,le->key);
-        if (le->subkey == NULL) {
-            serverAssert(me->ln == ln);
-            if (me->subkeys == NULL) {
-                dictDelete(absent->map,le->key);
-            } else {
-                me->ln = NULL;
-            }
-        } else {
-            serverAssert(dictDelete(me->subkeys,le->subkey) == DICT_OK);
-            if (dictSize(me->subkeys) == 0) {
-                dictRelease(me->subkeys);
-                me->subkeys = NULL;
-
-                if (me->ln == NULL) {
-                    dictDelete(absent->map,le->key);
-                }
-            }
-        }
-        listDelNode(absent->list,ln);
-    }
-}
+int absentCachePutKey(absentCache *absent, sds key) {
+    uint64_t keyhash, fp;
+    absentSlot *slot;
 
-int absentCachePutKey(absentCache *absent, sds key_) {
-    dictEntry *de;
-    absentKeyMapEntry *me;
-    absentListEntry *le;
-    sds key;
-
-    serverAssert(key_);
-    if (!(de = dictFind(absent->map,key_))) {
-        key = sdsdup(key_);
-        me = absentKeyMapEntryNew(NULL,NULL);
-        dictAdd(absent->map,key,me);
-    } else {
-        key = dictGetKey(de);
-        me = dictGetVal(de);
-        if (me->ln != NULL) {
-            listUnlink(absent->list,me->ln);
-            listLinkHead(absent->list,me->ln);
-            return 0;
-        }
+    serverAssert(key);
+    keyhash = absentKeyHash(key);
+    fp = absentKeyFingerprint(keyhash);
+    if ((slot = absentCacheFind(absent,fp,0))) {
+        slot->ref = 1;
+        return 0;
     }
 
-    le = absentListEntryNew(key,NULL);
-    listAddNodeHead(absent->list,le);
-    me->ln = listFirst(absent->list);
-    absentCacheTrim(absent);
+    absentCacheAdd(absent,fp,absentKeyTag(keyhash),0);
     return 1;
 }
 
-int absentCachePutSubkey(absentCache *absent, sds key_, sds subkey_) {
-    dictEntry *de, *sde;
-    absentKeyMapEntry *me;
-    absentListEntry *le;
-    dict *subkeys;
-    sds key, subkey;
-
-    serverAssert(key_ && subkey_);
-
-    if (!(de = dictFind(absent->map,key_))) {
-        key = sdsdup(key_);
-        subkey = sdsdup(subkey_);
-        subkeys = dictCreate(&absentSubkeyDictType,NULL);
-        me = absentKeyMapEntryNew(NULL,subkeys);
-        dictAdd(absent->map,key,me);
-    } else {
-        me = dictGetVal(de);
-        key = dictGetKey(de);
-        if (me->subkeys == NULL)
-            me->subkeys = dictCreate(&absentSubkeyDictType,NULL);
-        subkeys = me->subkeys;
-        if (!(sde = dictFind(subkeys,subkey_))) {
-            subkey = sdsdup(subkey_);
-        } else {
-            listNode *ln = dictGetVal(sde);
-            listUnlink(absent->list,ln);
-            listLinkHead(absent->list,ln);
+int absentCachePutSubkey(absentCache *absent, sds key, sds subkey) {
+    uint64_t keyhash, fp;
+    absentSlot *slot;
+
+    serverAssert(key && subkey);
+    keyhash = absentKeyHash(key);
+    fp = absentSubkeyFingerprint(keyhash,subkey);
+    if ((slot = absentCacheFind(absent,fp,1))) {
+        if (!absentSlotIsStale(absent,slot)) {
+            slot->ref = 1;
             return 0;
         }
+        absentCacheRemoveSlot(absent,slot-absent->slots);
     }
 
-    le = absentListEntryNew(key,subkey);
-    listAddNodeHead(absent->list,le);
-    dictAdd(subkeys,subkey,listFirst(absent->list));
-    absentCacheTrim(absent);
-
+    absentCacheAdd(absent,fp,absentKeyTag(keyhash),1);
     return 1;
 }
 
 int absentCacheGetKey(absentCache *absent, sds key) {
-    absentKeyMapEntry *me = dictFetchValue(absent->map,key);
-    if (me && me->ln != NULL) {
-        listUnlink(absent->list,me->ln);
-        listLinkHead(absent->list,me->ln);
+    uint64_t fp = absentKeyFingerprint(absentKeyHash(key));
+    absentSlot *slot = absentCacheFind(absent,fp,0);
+    if (slot) {
+        slot->ref = 1;
         return 1;
     } else {
         return 0;
@@ -241,30 +272,50 @@ int absentCacheGetKey(absentCache *absent, sds key) {
 }
 
 int absentCacheGetSubkey(absentCache *absent, sds key, sds subkey) {
-    listNode *ln;
-    absentKeyMapEntry *me;
-    me = dictFetchValue(absent->map,key);
-    if (me == NULL || me->subkeys == NULL) return 0;
-    if ((ln = dictFetchValue(me->subkeys,subkey)) == NULL) return 0;
-    listUnlink(absent->list,ln);
-    listLinkHead(absent->list,ln);
+    uint64_t fp = absentSubkeyFingerprint(absentKeyHash(key),subkey);
+    absentSlot *slot = absentCacheFind(absent,fp,1);
+    if (slot == NULL) return 0;
+    if (absentSlotIsStale(absent,slot)) {
+        absentCacheRemoveSlot(absent,slot-absent->slots);
+        return 0;
+    }
+    slot->ref = 1;
     return 1;
 }
 
 void absentCacheSetCapacity(absentCache *absent, size_t capacity) {
+    size_t nslots = absent->nslots;
     absent->capacity = capacity;
     absentCacheTrim(absent);
+    /* shrink if table mostly empty */
+    while (nslots > ABSENT_CACHE_INIT_SLOTS && absent->count*8 < nslots)
+        nslots /= 2;
+    if (nslots != absent->nslots) absentCacheResize(absent,nslots);
 }
 
 #ifdef REDIS_TEST
 
 static int absentCacheExistsKey(absentCache *absent, sds key) {
-    return dictFind(absent->map,key) != NULL;
+    uint64_t fp = absentKeyFingerprint(absentKeyHash(key));
+    return absentCacheFind(absent,fp,0) != NULL;
 }
 
 static int absentCacheExistsSubkey(absentCache *absent, sds key, sds subkey) {
-    absentKeyMapEntry *me = dictFetchValue(absent->map,key);
-    return me && me->subkeys && dictFetchValue(me->subkeys, subkey);
+    uint64_t fp = absentSubkeyFingerprint(absentKeyHash(key),subkey);
+    absentSlot *slot = absentCacheFind(absent,fp,1);
+    return slot && !absentSlotIsStale(absent,slot);
+}
+
+/* Key of which generation differs from that of key, so that deleting one
+ * won't invalidate subkeys of the other. */
+static sds absentCacheTestOtherKey(absentCache *absent, sds key) {
+    uint32_t *gen = absentCacheKeyGen(absent,absentKeyTag(absentKeyHash(key)));
+    for (int i = 0; ; i++) {
+        sds other = sdscatprintf(sdsempty(),"key-%d",i);
+        if (absentCacheKeyGen(absent,absentKeyTag(absentKeyHash(other))) != gen)
+            return other;
+        sdsfree(other);
+    }
 }
 
 int swapAbsentTest(int argc, char *argv[], int accurate) {
@@ -280,54 +331,58 @@ int swapAbsentTest(int argc, char *argv[], int accurate) {
 
         absent = absentCacheNew(1);
         test_assert(!absentCacheExistsKey(absent,first));
-        absentCachePutKey(absent,first);
+        test_assert(absentCachePutKey(absent,first));
+        test_assert(!absentCachePutKey(absent,first));
         test_assert(absentCacheExistsKey(absent,first));
         absentCachePutKey(absent,second);
         test_assert(!absentCacheExistsKey(absent,first));
+        test_assert(absent->count == 1);
         absentCacheFree(absent);
 
         absent = absentCacheNew(3);
         absentCachePutKey(absent,first);
         absentCachePutKey(absent,second);
         absentCachePutKey(absent,third);
+        /* referenced keys get second chance */
+        test_assert(absentCacheGetKey(absent,second) == 1);
+        test_assert(absentCacheGetKey(absent,third) == 1);
         absentCachePutKey(absent,fourth);
+        test_assert(absent->count == 3);
         test_assert(!absentCacheExistsKey(absent,first));
         test_assert(absentCacheExistsKey(absent,second));
         test_assert(absentCacheExistsKey(absent,third));
         test_assert(absentCacheExistsKey(absent,fourth));
-        absentCachePutKey(absent,first);
-        test_assert(absentCacheExistsKey(absent,first));
-        test_assert(!absentCacheExistsKey(absent,second));
-        test_assert(absentCacheExistsKey(absent,third));
-        test_assert(absentCacheExistsKey(absent,fourth));
 
-        absentCacheDelete(absent,second);
+        test_assert(absentCacheDelete(absent,second) == 1);
+        test_assert(absentCacheDelete(absent,second) == 0);
         test_assert(!absentCacheExistsKey(absent,second));
 
         test_assert(absentCacheGetKey(absent,second) == 0);
         test_assert(absentCacheGetKey(absent,third) == 1);
-        test_assert(absentCacheGetKey(absent,first) == 1);
-
-        sdsfree(first), sdsfree(second), sdsfree(third), sdsfree(fourth);
-        sds first2 = sdsnew("1"), fourth2 = sdsnew("4");
+        test_assert(absentCacheGetKey(absent,fourth) == 1);
 
         absentCacheSetCapacity(absent, 1);
         test_assert(absent->capacity == 1);
-        test_assert(absentCacheExistsKey(absent,first2));
-        test_assert(!absentCacheExistsKey(absent,fourth2));
+        test_assert(absent->count == 1);
+        test_assert(absentCacheExistsKey(absent,third) ||
+                absentCacheExistsKey(absent,fourth));
         absentCacheFree(absent);
-        sdsfree(first2), sdsfree(fourth2);
+        sdsfree(first), sdsfree(second), sdsfree(third), sdsfree(fourth);
     }
 
     TEST("absent: subkey") {
-        sds key1 = sdsnew("key1"), key2 = sdsnew("key2");
+        sds key1 = sdsnew("key1"), key2;
         sds first = sdsnew("1"), second = sdsnew("2");
         absentCache *absent;
 
         absent = absentCacheNew(1);
+        key2 = absentCacheTestOtherKey(absent,key1);
         test_assert(!absentCacheExistsSubkey(absent,key1,first));
         absentCachePutSubkey(absent,key1,first);
         test_assert(absentCacheExistsSubkey(absent,key1,first));
+        test_assert(!absentCacheExistsSubkey(absent,key1,second));
+        test_assert(!absentCacheExistsSubkey(absent,key2,first));
+        test_assert(!absentCacheExistsKey(absent,key1));
         absentCachePutSubkey(absent,key2,first);
         test_assert(!absentCacheExistsSubkey(absent,key1,first));
         test_assert(absentCacheExistsSubkey(absent,key2,first));
@@ -339,23 +394,29 @@ int swapAbsentTest(int argc, char *argv[], int accurate) {
         absentCachePutSubkey(absent,key1,first);
         absentCachePutSubkey(absent,key1,second);
         absentCachePutSubkey(absent,key2,first);
+        test_assert(absentCacheGetSubkey(absent,key1,second));
+        test_assert(absentCacheGetSubkey(absent,key2,first));
         absentCachePutSubkey(absent,key2,second);
         test_assert(!absentCacheExistsSubkey(absent,key1,first));
         test_assert(absentCacheExistsSubkey(absent,key1,second));
         test_assert(absentCacheExistsSubkey(absent,key2,first));
         test_assert(absentCacheExistsSubkey(absent,key2,second));
 
+        /* delete key invalidates all of its subkeys */
         absentCacheDelete(absent,key2);
         test_assert(!absentCacheExistsSubkey(absent,key2,first));
         test_assert(!absentCacheExistsSubkey(absent,key2,second));
+        test_assert(!absentCacheGetSubkey(absent,key2,first));
 
-        absentCachePutSubkey(absent,key2,first);
-        absentCachePutSubkey(absent,key2,second);
-        test_assert(absentCacheGetSubkey(absent,key1,second));
-        test_assert(!absentCacheGetSubkey(absent,key1,first));
-
+        /* stale subkeys evicted first */
         absentCachePutSubkey(absent,key1,first);
-        test_assert(!absentCacheGetSubkey(absent,key2,first));
+        test_assert(absentCacheGetSubkey(absent,key1,first));
+        test_assert(absentCacheGetSubkey(absent,key1,second));
+        test_assert(absentCachePutSubkey(absent,key2,first));
+        test_assert(absent->count == 3);
+        test_assert(absentCacheGetSubkey(absent,key2,first));
+        test_assert(absentCacheExistsSubkey(absent,key1,first));
+        test_assert(absentCacheExistsSubkey(absent,key1,second));
         absentCacheFree(absent);
 
         sdsfree(first), sdsfree(second);
@@ -363,11 +424,12 @@ int swapAbsentTest(int argc, char *argv[], int accurate) {
     }
 
     TEST("absent: mixed key & subkey") {
-        sds key1 = sdsnew("key1"), key2 = sdsnew("key2");
+        sds key1 = sdsnew("key1"), key2;
         sds first = sdsnew("1"), second = sdsnew("2");
         absentCache *absent;
 
         absent = absentCacheNew(4);
+        key2 = absentCacheTestOtherKey(absent,key1);
         test_assert(absentCachePutKey(absent,key1));
         test_assert(absentCachePutSubkey(absent,key1,first));
         test_assert(absentCachePutSubkey(absent,key2,first));
@@ -376,40 +438,65 @@ int swapAbsentTest(int argc, char *argv[], int accurate) {
         test_assert(absentCacheGetKey(absent,key1));
         test_assert(absentCacheGetSubkey(absent,key1,first));
         test_assert(absentCacheGetSubkey(absent,key2,first));
-        test_assert(absentCacheGetKey(absent,key2));
+        test_assert(!absentCacheGetSubkey(absent,key2,second));
 
+        /* key2 is the only one not referenced */
+        test_assert(absentCachePutSubkey(absent,key1,second));
+        test_assert(!absentCacheGetKey(absent,key2));
         test_assert(absentCacheGetKey(absent,key1));
-        test_assert(absentCacheGetSubkey(absent,key1,first));
+
+        test_assert(absentCacheDelete(absent,key1));
+        test_assert(!absentCacheGetKey(absent,key1));
+        test_assert(!absentCacheGetSubkey(absent,key1,first));
+        test_assert(!absentCacheGetSubkey(absent,key1,second));
         test_assert(absentCacheGetSubkey(absent,key2,first));
-        test_assert(absentCacheGetKey(absent,key2));
 
-        test_assert(absentCachePutSubkey(absent,key1,second));
-        test_assert(!absentCacheGetKey(absent,key1)); /* key1 trimmed */
+        test_assert(absentCachePutKey(absent,key1));
+        test_assert(absentCachePutSubkey(absent,key1,first));
+        test_assert(absentCacheGetKey(absent,key1));
+        test_assert(absentCacheGetSubkey(absent,key1,first));
 
-        test_assert(absentCachePutSubkey(absent,key2,second));
-        test_assert(!absentCacheGetSubkey(absent,key1,first)); /* key1.first trimmed */
+        absentCacheSetCapacity(absent,2);
+        test_assert(absent->count == 2);
+        absentCacheFree(absent);
 
-        test_assert(absentCacheDelete(absent,key2));
-        test_assert(!absentCacheGetKey(absent,key2));
-        test_assert(!absentCacheGetSubkey(absent,key2,first));
-        test_assert(!absentCacheGetSubkey(absent,key2,second));
+        sdsfree(first), sdsfree(second);
+        sdsfree(key1), sdsfree(key2);
+    }
 
-        test_assert(absentCachePutKey(absent,key2));
-        test_assert(absentCachePutSubkey(absent,key2,first));
-        test_assert(absentCachePutSubkey(absent,key2,second));
-        test_assert(absentCacheGetSubkey(absent,key1,second));
+    TEST("absent: capacity & memory") {
+        size_t capacity = 100000, nkeys = 300000;
+        absentCache *absent = absentCacheNew(capacity);
+        sds key = sdsempty(), subkey = sdsempty();
 
-        absentCacheSetCapacity(absent,2);
+        for (size_t i = 0; i < nkeys; i++) {
+            key = sdscpylen(key,(char*)&i,sizeof(i));
+            if (i % 2) {
+                absentCachePutKey(absent,key);
+            } else {
+                subkey = sdscpylen(subkey,(char*)&i,sizeof(i));
+                absentCachePutSubkey(absent,key,subkey);
+            }
+            if (i % 3 == 0) absentCacheDelete(absent,key);
+            test_assert(absent->count <= capacity);
+        }
+        /* latest keys mostly cached */
+        size_t hits = 0;
+        for (size_t i = nkeys-1000; i < nkeys; i++) {
+            key = sdscpylen(key,(char*)&i,sizeof(i));
+            if (i % 3 != 0 && i % 2 && absentCacheExistsKey(absent,key)) hits++;
+        }
+        test_assert(hits > 200);
+        /* load factor kept over 3/8 when full */
+        test_assert(absent->nslots*3 <= capacity*8);
+        test_assert(sizeof(absentSlot) == 16);
 
-        test_assert(absentCacheGetSubkey(absent,key2,second));
-        test_assert(absentCacheGetSubkey(absent,key1,second));
-        test_assert(!absentCacheGetKey(absent,key1));
-        test_assert(!absentCacheGetKey(absent,key2));
+        absentCacheSetCapacity(absent,1000);
+        test_assert(absent->count <= 1000);
+        test_assert(absent->nslots <= 8192);
 
+        sdsfree(key), sdsfree(subkey);
         absentCacheFree(absent);
-
-        sdsfree(first), sdsfree(second);
-        sdsfree(key1), sdsfree(key2);
     }
 
     return error;
@@ -32,6 +32,9 @@
 #include <string.h>
 #include "ctrip_cuckoo_filter.h"
 #include "ctrip_cuckoo_malloc.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 static int isPowOf2(uint64_t n) { return (n & (n - 1)) == 0 && n != 0; }
 
@@ -65,12 +68,15 @@ void cuckooTableInit(cuckooTable *table, int bits_per_tag, size_t nbuckets) {
     table->victim.index = 0;
     table->victim.tag = 0;
     table->ntags = 0;
-    table->data = cuckoo_calloc(nbuckets*(bytes_per_bucket));
+    /* Bucket size is power of 2 for 8/16/32 bits tag, with data cache line
+     * aligned a bucket never straddles cache line and can be probed with
+     * one (vector) load. */
+    table->data = cuckoo_aligned_calloc(nbuckets*(bytes_per_bucket));
 }
 
 void cuckooTableDeinit(cuckooTable *table) {
     if (table->data) {
-        cuckoo_free(table->data);
+        cuckoo_aligned_free(table->data);
         table->data = NULL;
     }
 }
@@ -191,27 +197,83 @@ int cuckooTableInsertKickOut(cuckooTable *table, uint64_t hv) {
     return cuckooTableInsertKickOutIndexTag(table,i,tag);
 }
 
-int cuckooTableContains(cuckooTable *table, uint64_t hv) {
+static inline uint8_t *cuckooTableBucket(cuckooTable *table, size_t i) {
+    return table->data + i*table->bytes_per_bucket;
+}
+
+/* Check if tag exists in bucket i1 or i2, both buckets are compared at once
+ * with SSE2 (or SWAR if SSE2 not available) for 8/16/32 bits tag. */
+static inline int cuckooTableBucketsMatch(cuckooTable *table, size_t i1,
+        size_t i2, uint32_t tag) {
+    uint8_t *b1 = cuckooTableBucket(table,i1), *b2 = cuckooTableBucket(table,i2);
+
+    if (table->bits_per_tag == 8) {
+        uint32_t w1, w2;
+        memcpy(&w1,b1,sizeof(w1));
+        memcpy(&w2,b2,sizeof(w2));
+#if defined(__SSE2__)
+        __m128i v = _mm_set_epi32(0,0,(int)w2,(int)w1);
+        __m128i eq = _mm_cmpeq_epi8(v,_mm_set1_epi8((char)tag));
+        return (_mm_movemask_epi8(eq) & 0xFF) != 0;
+#else
+        uint64_t x = (((uint64_t)w2 << 32) | w1) ^ (0x0101010101010101ULL*tag);
+        return ((x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL) != 0;
+#endif
+    } else if (table->bits_per_tag == 16) {
+        uint64_t w1, w2;
+        memcpy(&w1,b1,sizeof(w1));
+        memcpy(&w2,b2,sizeof(w2));
+#if defined(__SSE2__)
+        __m128i v = _mm_set_epi64x((long long)w2,(long long)w1);
+        __m128i eq = _mm_cmpeq_epi16(v,_mm_set1_epi16((short)tag));
+        return _mm_movemask_epi8(eq) != 0;
+#else
+        uint64_t t = 0x0001000100010001ULL*tag, x1 = w1 ^ t, x2 = w2 ^ t;
+        return ((((x1 - 0x0001000100010001ULL) & ~x1) |
+                ((x2 - 0x0001000100010001ULL) & ~x2)) &
+            0x8000800080008000ULL) != 0;
+#endif
+    } else if (table->bits_per_tag == 32) {
+#if defined(__SSE2__)
+        __m128i t = _mm_set1_epi32((int)tag);
+        __m128i eq = _mm_or_si128(
+                _mm_cmpeq_epi32(_mm_loadu_si128((__m128i*)b1),t),
+                _mm_cmpeq_epi32(_mm_loadu_si128((__m128i*)b2),t));
+        return _mm_movemask_epi8(eq) != 0;
+#else
+        uint32_t *p1 = (uint32_t*)b1, *p2 = (uint32_t*)b2;
+        return p1[0] == tag || p1[1] == tag || p1[2] == tag || p1[3] == tag ||
+            p2[0] == tag || p2[1] == tag || p2[2] == tag || p2[3] == tag;
+#endif
+    } else {
+        for (int j = 0; j < CUCKOO_FILTER_TAGS_PER_BUCKET; j++) {
+            if (cuckooTableReadTag(table,i1,j) == tag ||
+                    cuckooTableReadTag(table,i2,j) == tag)
+                return 1;
+        }
+        return 0;
+    }
+}
+
+static inline void cuckooTablePrefetch(cuckooTable *table, uint64_t hv) {
     size_t i1, i2;
     uint32_t tag;
 
     cuckooTableIndexTag(table,hv,&i1,&tag);
     i2 = cuckooTableAltIndex(table,i1,tag);
+    __builtin_prefetch(cuckooTableBucket(table,i1));
+    __builtin_prefetch(cuckooTableBucket(table,i2));
+}
 
-    if (table->bits_per_tag == CUCKOO_FILTER_BITS_PER_TAG_8) {
-        return CUCKOO_ERR;
-    }
+int cuckooTableContains(cuckooTable *table, uint64_t hv) {
+    size_t i1, i2;
+    uint32_t tag;
 
-    for (int j = 0; j < CUCKOO_FILTER_TAGS_PER_BUCKET; j++) {
-        if (cuckooTableReadTag(table,i1,j) == tag) {
-            return CUCKOO_OK;
-        }
-    }
+    cuckooTableIndexTag(table,hv,&i1,&tag);
+    i2 = cuckooTableAltIndex(table,i1,tag);
 
-    for (int j = 0; j < CUCKOO_FILTER_TAGS_PER_BUCKET; j++) {
-        if (cuckooTableReadTag(table,i2,j) == tag) {
-            return CUCKOO_OK;
-        }
+    if (cuckooTableBucketsMatch(table,i1,i2,tag)) {
+        return CUCKOO_OK;
     }
 
     if (table->victim.used && table->victim.tag == tag &&
@@ -357,6 +419,36 @@ int cuckooFilterContains(cuckooFilter *filter, const char *key, size_t klen) {
     return CUCKOO_ERR;
 }
 
+#define CUCKOO_FILTER_BATCH_SIZE 16
+
+/* Hash a batch of keys and prefetch their buckets in all tables before
+ * probing, so that cache misses of different keys overlap. */
+void cuckooFilterContainsBatch(cuckooFilter *filter, int nkeys,
+        const char **keys, size_t *klens, int *results) {
+    uint64_t hvs[CUCKOO_FILTER_BATCH_SIZE];
+
+    for (int start = 0; start < nkeys; start += CUCKOO_FILTER_BATCH_SIZE) {
+        int n = nkeys - start;
+        if (n > CUCKOO_FILTER_BATCH_SIZE) n = CUCKOO_FILTER_BATCH_SIZE;
+
+        for (int k = 0; k < n; k++) {
+            hvs[k] = cuckooFilterGenerateHash(filter,keys[start+k],klens[start+k]);
+            for (int i = filter->ntables-1; i >= 0; i--)
+                cuckooTablePrefetch(filter->tables+i,hvs[k]);
+        }
+
+        for (int k = 0; k < n; k++) {
+            results[start+k] = CUCKOO_ERR;
+            for (int i = filter->ntables-1; i >= 0; i--) {
+                if (cuckooTableContains(filter->tables+i,hvs[k]) == CUCKOO_OK) {
+                    results[start+k] = CUCKOO_OK;
+                    break;
+                }
+            }
+        }
+    }
+}
+
 int cuckooFilterDelete(cuckooFilter *filter, const char *key, size_t klen) {
     cuckooTable *table;
     uint64_t hv = cuckooFilterGenerateHash(filter,key,klen);
@@ -394,6 +486,104 @@ size_t cuckooFilterUsedMemory(cuckooFilter *filter) {
     return used_memory;
 }
 
+/* Dump format (little-endian, see cuckooFilterNew):
+ *   bits_per_tag(4) ntables(4)
+ *   [nbuckets(8) ntags(8) victim.used(4) victim.tag(4) victim.index(8) data]
+ *   ... one for each table. */
+#define CUCKOO_DUMP_HEADER_LEN 8
+#define CUCKOO_DUMP_TABLE_HEADER_LEN 32
+
+size_t cuckooFilterDumpLen(cuckooFilter *filter) {
+    size_t len = CUCKOO_DUMP_HEADER_LEN;
+    for (int i = 0; i < filter->ntables; i++) {
+        cuckooTable *table = filter->tables+i;
+        len += CUCKOO_DUMP_TABLE_HEADER_LEN +
+            table->bytes_per_bucket*table->nbuckets;
+    }
+    return len;
+}
+
+/* Dump filter into buf, which must be at least cuckooFilterDumpLen long. */
+void cuckooFilterDump(cuckooFilter *filter, char *buf) {
+    char *p = buf;
+    int32_t i32;
+    uint32_t u32;
+    uint64_t u64;
+
+#define CUCKOO_DUMP(v) do { memcpy(p,&(v),sizeof(v)); p += sizeof(v); } while (0)
+    i32 = filter->bits_per_tag; CUCKOO_DUMP(i32);
+    i32 = filter->ntables; CUCKOO_DUMP(i32);
+    for (int i = 0; i < filter->ntables; i++) {
+        cuckooTable *table = filter->tables+i;
+        size_t datalen = table->bytes_per_bucket*table->nbuckets;
+        u64 = table->nbuckets; CUCKOO_DUMP(u64);
+        u64 = table->ntags; CUCKOO_DUMP(u64);
+        u32 = table->victim.used; CUCKOO_DUMP(u32);
+        u32 = table->victim.tag; CUCKOO_DUMP(u32);
+        u64 = table->victim.index; CUCKOO_DUMP(u64);
+        memcpy(p,table->data,datalen);
+        p += datalen;
+    }
+#undef CUCKOO_DUMP
+    assert((size_t)(p - buf) == cuckooFilterDumpLen(filter));
+}
+
+/* Restore filter from dump, returns NULL if dump is malformed. */
+cuckooFilter *cuckooFilterRestore(cuckoo_hash_fn hash_fn, const char *buf,
+        size_t len) {
+    const char *p = buf, *end = buf + len;
+    int32_t bits_per_tag, ntables;
+    cuckooFilter *filter;
+
+    if (len < CUCKOO_DUMP_HEADER_LEN) return NULL;
+    memcpy(&bits_per_tag,p,sizeof(bits_per_tag)), p += sizeof(bits_per_tag);
+    memcpy(&ntables,p,sizeof(ntables)), p += sizeof(ntables);
+    if ((bits_per_tag != 8 && bits_per_tag != 12 && bits_per_tag != 16 &&
+            bits_per_tag != 32) || ntables <= 0 ||
+            ntables > CUCKOO_FILTER_MAX_TABLES)
+        return NULL;
+
+    filter = cuckoo_malloc(sizeof(cuckooFilter));
+    filter->hash_fn = hash_fn;
+    filter->bits_per_tag = bits_per_tag;
+    filter->ntables = 0;
+    filter->tables = cuckoo_calloc(ntables*sizeof(cuckooTable));
+
+    for (int i = 0; i < ntables; i++) {
+        cuckooTable *table = filter->tables+i;
+        uint64_t nbuckets, ntags, victim_index;
+        uint32_t victim_used, victim_tag;
+        size_t datalen;
+
+        if (end - p < CUCKOO_DUMP_TABLE_HEADER_LEN) goto err;
+        memcpy(&nbuckets,p,sizeof(nbuckets)), p += sizeof(nbuckets);
+        memcpy(&ntags,p,sizeof(ntags)), p += sizeof(ntags);
+        memcpy(&victim_used,p,sizeof(victim_used)), p += sizeof(victim_used);
+        memcpy(&victim_tag,p,sizeof(victim_tag)), p += sizeof(victim_tag);
+        memcpy(&victim_index,p,sizeof(victim_index)), p += sizeof(victim_index);
+        if (!isPowOf2(nbuckets) || nbuckets > UINT32_MAX ||
+                victim_index >= nbuckets) goto err;
+
+        cuckooTableInit(table,bits_per_tag,nbuckets);
+        filter->ntables++;
+        datalen = table->bytes_per_bucket*table->nbuckets;
+        if ((size_t)(end - p) < datalen) goto err;
+        memcpy(table->data,p,datalen);
+        p += datalen;
+        table->ntags = ntags;
+        table->victim.used = victim_used ? 1 : 0;
+        table->victim.tag = victim_tag;
+        table->victim.index = victim_index;
+    }
+
+    if (p != end) goto err;
+    return filter;
+
+err:
+    cuckooFilterFree(filter);
+    return NULL;
+}
+
 #ifdef REDIS_TEST
 
 #define KEYMAXLEN 16
@@ -449,6 +639,77 @@ int cuckooFilterTest(int argc, char *argv[], int accurate) {
         }
     }
 
+    TEST("cuckoo-filter: buckets match") {
+        cuckooTable table_, *table = &table_;
+        int bits[4] = {8,12,16,32};
+        int nbuckets = 16;
+
+        for (int bi = 0; bi < 4; bi++) {
+            int nbit = bits[bi];
+            uint32_t tagmask = (uint32_t)((1ULL<<nbit)-1);
+
+            cuckooTableInit(table,nbit,nbuckets);
+            for (int i = 0; i < nbuckets; i++) {
+                for (int j = 0; j < CUCKOO_FILTER_TAGS_PER_BUCKET; j++) {
+                    /* leave some slots empty */
+                    uint32_t tag = (i+j)%3 ? (rand() & tagmask) : CUCKOO_TAG_NULL;
+                    cuckooTableWriteTag(table,i,j,tag);
+                }
+            }
+
+            for (int round = 0; round < 1024; round++) {
+                size_t i1 = rand() & (nbuckets-1), i2 = rand() & (nbuckets-1);
+                uint32_t tag = round & 1 ?
+                    cuckooTableReadTag(table,i2,rand()&3) : (rand() & tagmask);
+                int expected = 0;
+                for (int j = 0; j < CUCKOO_FILTER_TAGS_PER_BUCKET; j++) {
+                    if (cuckooTableReadTag(table,i1,j) == tag ||
+                            cuckooTableReadTag(table,i2,j) == tag)
+                        expected = 1;
+                }
+                test_assert(cuckooTableBucketsMatch(table,i1,i2,tag) == expected);
+            }
+            cuckooTableDeinit(table);
+        }
+    }
+
+    TEST("cuckoo-filter: contains batch") {
+        cuckooFilter *filter;
+        size_t ncases = 100;
+        char keybuf[ncases*2][KEYMAXLEN];
+        const char *keys[ncases*2];
+        size_t klens[ncases*2];
+        int results[ncases*2];
+
+        for (size_t i = 0; i < ncases*2; i++) {
+            snprintf(keybuf[i],KEYMAXLEN,"%08ld",i);
+            keys[i] = keybuf[i];
+            klens[i] = strlen(keybuf[i]);
+        }
+
+        for (int bt = 0; bt < CUCKOO_FILTER_BITS_PER_TAG_TYPES; bt++) {
+            filter = cuckooFilterNew(dictGenHashFunction,bt,16);
+            /* even keys inserted, expands to multiple tables. */
+            for (size_t i = 0; i < ncases*2; i += 2) {
+                test_assert(cuckooFilterInsert(filter,keys[i],klens[i]) == CUCKOO_OK);
+            }
+            test_assert(filter->ntables > 1);
+            for (int i = 0; i < filter->ntables; i++) {
+                test_assert(((uintptr_t)filter->tables[i].data &
+                            (CUCKOO_CACHE_LINE_SIZE-1)) == 0);
+            }
+
+            cuckooFilterContainsBatch(filter,ncases*2,keys,klens,results);
+            for (size_t i = 0; i < ncases*2; i++) {
+                test_assert(results[i] == cuckooFilterContains(filter,keys[i],klens[i]));
+                if (i % 2 == 0) test_assert(results[i] == CUCKOO_OK);
+            }
+
+            cuckooFilterContainsBatch(filter,0,keys,klens,results);
+            cuckooFilterFree(filter);
+        }
+    }
+
     TEST("cuckoo-filter: filter (unique keys) ") {
         cuckooFilter *filter;
         size_t ncases = 2048, nbuckets_base = 16;
@@ -533,6 +794,48 @@ int cuckooFilterTest(int argc, char *argv[], int accurate) {
         }
     }
 
+    TEST("cuckoo-filter: dump & restore") {
+        cuckooFilter *filter, *restored;
+        cuckooFilterStat stat_, *stat = &stat_;
+        size_t ncases = 2048, dumplen;
+        char key[KEYMAXLEN], *buf;
+
+        for (int bt = 0; bt < CUCKOO_FILTER_BITS_PER_TAG_TYPES; bt++) {
+            filter = cuckooFilterNew(dictGenHashFunction,bt,16);
+            for (size_t i = 0; i < ncases; i++) {
+                snprintf(key,KEYMAXLEN,"%08ld",i);
+                test_assert(cuckooFilterInsert(filter,key,strlen(key)) == CUCKOO_OK);
+            }
+
+            dumplen = cuckooFilterDumpLen(filter);
+            buf = zmalloc(dumplen);
+            cuckooFilterDump(filter,buf);
+
+            test_assert(cuckooFilterRestore(dictGenHashFunction,buf,dumplen-1) == NULL);
+            test_assert(cuckooFilterRestore(dictGenHashFunction,buf,4) == NULL);
+
+            restored = cuckooFilterRestore(dictGenHashFunction,buf,dumplen);
+            test_assert(restored != NULL);
+            test_assert(restored->ntables == filter->ntables);
+            test_assert(cuckooFilterUsedMemory(restored) == cuckooFilterUsedMemory(filter));
+            for (size_t i = 0; i < ncases*2; i++) {
+                snprintf(key,KEYMAXLEN,"%08ld",i);
+                test_assert(cuckooFilterContains(restored,key,strlen(key)) ==
+                        cuckooFilterContains(filter,key,strlen(key)));
+            }
+            for (size_t i = 0; i < ncases; i++) {
+                snprintf(key,KEYMAXLEN,"%08ld",i);
+                test_assert(cuckooFilterDelete(restored,key,strlen(key)) == CUCKOO_OK);
+            }
+            cuckooFilterGetStat(restored,stat);
+            test_assert(stat->ntags == 0);
+
+            zfree(buf);
+            cuckooFilterFree(restored);
+            cuckooFilterFree(filter);
+        }
+    }
+
     TEST("cuckoo-filter: bench") {
         size_t nkeys = 1000000;
         double fp_rate;
@@ -561,11 +864,35 @@ int cuckooFilterTest(int argc, char *argv[], int accurate) {
             fp_rate = (double)false_positive/total;
             test_assert(fp_rate < fp_rate_max[bt]);
 
+            long long start = ustime();
+            for (size_t i = 0; i < nkeys; i++) {
+                cuckooFilterContains(filter,(char*)&i,sizeof(size_t));
+            }
+            long long contains_us = ustime() - start;
+
+            size_t batch_keys[CUCKOO_FILTER_BATCH_SIZE];
+            const char *batch_ptrs[CUCKOO_FILTER_BATCH_SIZE];
+            size_t batch_lens[CUCKOO_FILTER_BATCH_SIZE];
+            int batch_results[CUCKOO_FILTER_BATCH_SIZE];
+            for (int k = 0; k < CUCKOO_FILTER_BATCH_SIZE; k++) {
+                batch_ptrs[k] = (char*)(batch_keys+k);
+                batch_lens[k] = sizeof(size_t);
+            }
+            start = ustime();
+            for (size_t i = 0; i < nkeys; i += CUCKOO_FILTER_BATCH_SIZE) {
+                for (int k = 0; k < CUCKOO_FILTER_BATCH_SIZE; k++)
+                    batch_keys[k] = i+k;
+                cuckooFilterContainsBatch(filter,CUCKOO_FILTER_BATCH_SIZE,
+                        batch_ptrs,batch_lens,batch_results);
+            }
+            long long batch_us = ustime() - start;
+
             cuckooFilterStat stat_, *stat = &stat_;
             cuckooFilterGetStat(filter, stat);
             test_assert(filter->ntables == 1);
-            printf("cucoo-filter(%d): fp_rate=%0.4f, ntables=%ld, ntags=%ld, load_factor[0] = %0.2f\n",
-                    cuckooGetBitsPerTag(bt),fp_rate,stat->ntables,stat->ntags,stat->load_factors[0]);
+            printf("cucoo-filter(%d): fp_rate=%0.4f, ntables=%ld, ntags=%ld, load_factor[0] = %0.2f, contains=%lldus, contains_batch=%lldus\n",
+                    cuckooGetBitsPerTag(bt),fp_rate,stat->ntables,stat->ntags,stat->load_factors[0],
+                    contains_us,batch_us);
             if (filter->ntables > 1) {
                 printf(" load_factors[1]= %0.2f\n", stat->load_factors[1]);
             }
@@ -91,11 +91,19 @@ void cuckooFilterFree(cuckooFilter *filter);
 int cuckooFilterInsert(cuckooFilter *filter, const char *key, size_t klen);
 /* Report if the item is inserted, with false positive rate. */
 int cuckooFilterContains(cuckooFilter *filter, const char *key, size_t klen);
+/* Batch version of cuckooFilterContains, results[i] set to CUCKOO_OK/CUCKOO_ERR. */
+void cuckooFilterContainsBatch(cuckooFilter *filter, int nkeys, const char **keys, size_t *klens, int *results);
 /* Delete an key from the filter (Note that key MUST added previously). */
 int cuckooFilterDelete(cuckooFilter *filter, const char *key, size_t klen);
 /* Get filter stats. */
 void cuckooFilterGetStat(cuckooFilter *filter, cuckooFilterStat *stat);
 /* Get filter used memory */
 size_t cuckooFilterUsedMemory(cuckooFilter *filter);
+/* Get length of filter dump */
+size_t cuckooFilterDumpLen(cuckooFilter *filter);
+/* Dump filter tables into buf (at least cuckooFilterDumpLen bytes). */
+void cuckooFilterDump(cuckooFilter *filter, char *buf);
+/* Restore filter from dump, NULL returned if dump malformed. */
+cuckooFilter *cuckooFilterRestore(cuckoo_hash_fn hash_fn, const char *buf, size_t len);
 
 #endif
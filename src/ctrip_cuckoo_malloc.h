@@ -29,9 +29,28 @@
 #ifndef __CTRIP_CUCKOO_ALLOC_H__
 #define __CTRIP_CUCKOO_ALLOC_H__
 #include <stddef.h>
+#include <stdint.h>
 #include "zmalloc.h"
 #define cuckoo_malloc zmalloc
 #define cuckoo_realloc zrealloc
 #define cuckoo_calloc zcalloc
 #define cuckoo_free zfree
+
+#define CUCKOO_CACHE_LINE_SIZE 64
+
+/* zmalloc prefix header (libc malloc) breaks natural alignment, so cache
+ * line aligned memory is over-allocated by a cache line and aligned by
+ * hand, with the original pointer saved right before aligned memory (so
+ * it's still accounted by zmalloc). */
+static inline void *cuckoo_aligned_calloc(size_t size) {
+    char *ptr = cuckoo_calloc(size+CUCKOO_CACHE_LINE_SIZE), *aligned;
+    aligned = (char*)(((uintptr_t)ptr+CUCKOO_CACHE_LINE_SIZE) &
+            ~(uintptr_t)(CUCKOO_CACHE_LINE_SIZE-1));
+    ((void**)aligned)[-1] = ptr;
+    return aligned;
+}
+
+static inline void cuckoo_aligned_free(void *aligned) {
+    if (aligned) cuckoo_free(((void**)aligned)[-1]);
+}
 #endif
@@ -28,97 +28,362 @@
 #include "ctrip_swap.h"
 #include "ctrip_lru_cache.h"
 
-/* holds most recently accessed keys that definitely not exists in rocksdb. */
-dictType lruCacheDictType = {
-    dictSdsHash,               /* hash function */
-    NULL,                      /* key dup */
-    NULL,                      /* val dup */
-    dictSdsKeyCompare,         /* key compare */
-    dictSdsDestructor,         /* key destructor */
-    NULL,                      /* val destructor */
-    NULL                       /* allow to expand */
-};
+#define LRU_CACHE_MIN_NODES 16
 
-lruCache *lruCacheNew(size_t capacity) {
+#define lruShardLock(cache,shard) do { \
+    if ((cache)->flags & LRU_CACHE_THREADSAFE) \
+        pthread_mutex_lock(&(shard)->lock); \
+} while (0)
+
+#define lruShardUnlock(cache,shard) do { \
+    if ((cache)->flags & LRU_CACHE_THREADSAFE) \
+        pthread_mutex_unlock(&(shard)->lock); \
+} while (0)
+
+static inline const char *lruCacheNodeKey(lruCacheNode *node) {
+    return node->klen <= LRU_CACHE_INLINE_KEYLEN ? node->key.buf : node->key.ptr;
+}
+
+static inline uint32_t lruCacheNextPower(size_t size) {
+    uint32_t i = 1;
+    while (i < size && i < (1U<<31)) i <<= 1;
+    return i;
+}
+
+static inline size_t lruCacheShardCapacity(lruCache *cache, size_t capacity) {
+    size_t shard_capacity = (capacity+cache->nshards-1)/cache->nshards;
+    /* node index is 32bit and LRU_CACHE_NIL reserved. */
+    if (shard_capacity >= LRU_CACHE_NIL) shard_capacity = LRU_CACHE_NIL-1;
+    return shard_capacity;
+}
+
+/* high bits selects shard, low bits selects bucket. */
+static inline lruCacheShard *lruCacheGetShard(lruCache *cache, uint64_t hash) {
+    return cache->shards + ((hash >> 32) & (cache->nshards-1));
+}
+
+static void lruCacheShardRehash(lruCacheShard *shard) {
+    uint32_t nbuckets = lruCacheNextPower(shard->nnodes);
+
+    if (nbuckets != shard->nbuckets) {
+        zfree(shard->buckets);
+        shard->buckets = zmalloc(sizeof(uint32_t)*nbuckets);
+        shard->nbuckets = nbuckets;
+    }
+    for (uint32_t i = 0; i < nbuckets; i++)
+        shard->buckets[i] = LRU_CACHE_NIL;
+
+    for (uint32_t i = 0; i < shard->nnodes; i++) {
+        lruCacheNode *node = shard->nodes+i;
+        if (!node->used) continue;
+        uint32_t b = node->hash & (nbuckets-1);
+        node->next = shard->buckets[b];
+        shard->buckets[b] = i;
+    }
+}
+
+/* Resize node arena to nnodes (>= count), used nodes are packed to the
+ * front when shrinking so that node index stays below nnodes. */
+static void lruCacheShardResize(lruCacheShard *shard, uint32_t nnodes) {
+    uint32_t i, j;
+
+    serverAssert(nnodes >= shard->count);
+    if (nnodes < shard->nnodes) {
+        for (i = 0, j = 0; i < shard->nnodes; i++) {
+            if (!shard->nodes[i].used) continue;
+            if (i != j) shard->nodes[j] = shard->nodes[i];
+            j++;
+        }
+        shard->hand = 0;
+        shard->free = LRU_CACHE_NIL;
+    } else {
+        j = shard->nnodes;
+    }
+
+    shard->nodes = zrealloc(shard->nodes,sizeof(lruCacheNode)*nnodes);
+
+    /* link unused nodes into free list, lower index popped first. */
+    for (i = nnodes; i > j; i--) {
+        lruCacheNode *node = shard->nodes+i-1;
+        node->used = 0;
+        node->ref = 0;
+        node->next = shard->free;
+        shard->free = i-1;
+    }
+    shard->nnodes = nnodes;
+    if (shard->hand >= nnodes) shard->hand = 0;
+
+    lruCacheShardRehash(shard);
+}
+
+static uint32_t lruCacheShardFind(lruCacheShard *shard, uint64_t hash,
+        const char *key, size_t klen) {
+    uint32_t idx;
+    if (shard->nbuckets == 0) return LRU_CACHE_NIL;
+    idx = shard->buckets[hash & (shard->nbuckets-1)];
+    while (idx != LRU_CACHE_NIL) {
+        lruCacheNode *node = shard->nodes+idx;
+        if (node->hash == hash && node->klen == klen &&
+                memcmp(lruCacheNodeKey(node),key,klen) == 0)
+            return idx;
+        idx = node->next;
+    }
+    return LRU_CACHE_NIL;
+}
+
+static void lruCacheShardRemove(lruCacheShard *shard, uint32_t idx) {
+    lruCacheNode *node = shard->nodes+idx;
+    uint32_t *link = shard->buckets + (node->hash & (shard->nbuckets-1));
+
+    while (*link != idx) {
+        serverAssert(*link != LRU_CACHE_NIL);
+        link = &shard->nodes[*link].next;
+    }
+    *link = node->next;
+
+    if (node->klen > LRU_CACHE_INLINE_KEYLEN) {
+        shard->keys_alloc -= zmalloc_size(node->key.ptr);
+        zfree(node->key.ptr);
+    }
+    node->used = 0;
+    node->ref = 0;
+    node->next = shard->free;
+    shard->free = idx;
+    shard->count--;
+}
+
+/* CLOCK: sweep hand over arena, give referenced nodes a second chance. */
+static void lruCacheShardEvict(lruCacheShard *shard) {
+    serverAssert(shard->count > 0);
+    while (1) {
+        uint32_t idx = shard->hand;
+        lruCacheNode *node = shard->nodes+idx;
+        shard->hand = idx+1 < shard->nnodes ? idx+1 : 0;
+        if (!node->used) continue;
+        if (node->ref) {
+            node->ref = 0;
+            continue;
+        }
+        lruCacheShardRemove(shard,idx);
+        shard->stats.evictions++;
+        return;
+    }
+}
+
+static void lruCacheShardTrim(lruCacheShard *shard) {
+    uint32_t nnodes;
+
+    while (shard->count > shard->capacity)
+        lruCacheShardEvict(shard);
+
+    /* release arena if it's much larger than needed. */
+    nnodes = shard->capacity < LRU_CACHE_MIN_NODES ?
+        LRU_CACHE_MIN_NODES : shard->capacity;
+    if (shard->nnodes > nnodes*2) lruCacheShardResize(shard,nnodes);
+}
+
+static void lruCacheShardInsert(lruCacheShard *shard, uint64_t hash,
+        const char *key, size_t klen) {
+    uint32_t idx;
+    lruCacheNode *node;
+
+    if (shard->count >= shard->capacity)
+        lruCacheShardEvict(shard);
+
+    if (shard->free == LRU_CACHE_NIL) {
+        size_t nnodes = shard->nnodes ? (size_t)shard->nnodes*2 : LRU_CACHE_MIN_NODES;
+        if (nnodes > shard->capacity) nnodes = shard->capacity;
+        serverAssert(nnodes > shard->nnodes);
+        lruCacheShardResize(shard,nnodes);
+    }
+
+    idx = shard->free;
+    node = shard->nodes+idx;
+    shard->free = node->next;
+
+    node->hash = hash;
+    node->klen = klen;
+    node->used = 1;
+    node->ref = 0;
+    if (klen <= LRU_CACHE_INLINE_KEYLEN) {
+        memcpy(node->key.buf,key,klen);
+    } else {
+        node->key.ptr = zmalloc(klen);
+        memcpy(node->key.ptr,key,klen);
+        shard->keys_alloc += zmalloc_size(node->key.ptr);
+    }
+
+    uint32_t b = hash & (shard->nbuckets-1);
+    node->next = shard->buckets[b];
+    shard->buckets[b] = idx;
+    shard->count++;
+    shard->stats.inserts++;
+}
+
+lruCache *lruCacheNewSharded(size_t capacity, int nshards, int flags) {
     lruCache *cache = zcalloc(sizeof(lruCache));
+    if (nshards < 1) nshards = 1;
+    if (nshards > LRU_CACHE_MAX_SHARDS) nshards = LRU_CACHE_MAX_SHARDS;
+    cache->nshards = lruCacheNextPower(nshards);
+    cache->flags = flags;
     cache->capacity = capacity;
-    cache->map = dictCreate(&lruCacheDictType,NULL);
-    cache->list = listCreate();
+    cache->shards = zcalloc(sizeof(lruCacheShard)*cache->nshards);
+    for (int i = 0; i < cache->nshards; i++) {
+        lruCacheShard *shard = cache->shards+i;
+        if (flags & LRU_CACHE_THREADSAFE) pthread_mutex_init(&shard->lock,NULL);
+        shard->capacity = lruCacheShardCapacity(cache,capacity);
+        shard->free = LRU_CACHE_NIL;
+    }
     return cache;
 }
 
-void lruCacheFree(lruCache *cache) {
-   if (cache == NULL) return;
-   dictRelease(cache->map);
-   cache->map = NULL;
-   listRelease(cache->list);
-   cache->list = NULL;
-   zfree(cache);
+lruCache *lruCacheNew(size_t capacity) {
+    return lruCacheNewSharded(capacity,1,0);
 }
 
-static void lruCacheTrim(lruCache *cache) {
-    while (listLength(cache->list) > cache->capacity) {
-        listNode *ln = listLast(cache->list);
-        serverAssert(dictDelete(cache->map,listNodeValue(ln)) == DICT_OK);
-        listDelNode(cache->list, ln);
+void lruCacheFree(lruCache *cache) {
+    if (cache == NULL) return;
+    for (int i = 0; i < cache->nshards; i++) {
+        lruCacheShard *shard = cache->shards+i;
+        for (uint32_t j = 0; j < shard->nnodes; j++) {
+            lruCacheNode *node = shard->nodes+j;
+            if (node->used && node->klen > LRU_CACHE_INLINE_KEYLEN)
+                zfree(node->key.ptr);
+        }
+        zfree(shard->nodes);
+        zfree(shard->buckets);
+        if (cache->flags & LRU_CACHE_THREADSAFE)
+            pthread_mutex_destroy(&shard->lock);
     }
+    zfree(cache->shards);
+    zfree(cache);
 }
 
+/* Returns 1 if key inserted, 0 if key already cached (marked as accessed). */
 int lruCachePut(lruCache *cache, sds key) {
-    dictEntry *de;
-    listNode *ln;
-
-    if ((de = dictFind(cache->map,key))) {
-        ln = dictGetVal(de);
-        listUnlink(cache->list,ln);
-        listLinkHead(cache->list,ln);
-        return 0;
+    int inserted;
+    size_t klen = sdslen(key);
+    uint64_t hash = dictGenHashFunction(key,klen);
+    lruCacheShard *shard = lruCacheGetShard(cache,hash);
+    uint32_t idx;
+
+    lruShardLock(cache,shard);
+    if ((idx = lruCacheShardFind(shard,hash,key,klen)) != LRU_CACHE_NIL) {
+        shard->nodes[idx].ref = 1;
+        inserted = 0;
     } else {
-        sds dup = sdsdup(key);
-        listAddNodeHead(cache->list,dup);
-        dictAdd(cache->map,dup,listFirst(cache->list));
-        lruCacheTrim(cache);
-        return 1;
+        if (shard->capacity > 0) lruCacheShardInsert(shard,hash,key,klen);
+        inserted = 1;
     }
+    lruShardUnlock(cache,shard);
+
+    return inserted;
 }
 
 int lruCacheDelete(lruCache *cache, sds key) {
-    dictEntry *de;
-    listNode *ln;
-
-    if ((de = dictUnlink(cache->map,key))) {
-        ln = dictGetVal(de);
-        listDelNode(cache->list,ln);
-        dictFreeUnlinkedEntry(cache->map,de);
-        return 1;
+    int deleted;
+    size_t klen = sdslen(key);
+    uint64_t hash = dictGenHashFunction(key,klen);
+    lruCacheShard *shard = lruCacheGetShard(cache,hash);
+    uint32_t idx;
+
+    lruShardLock(cache,shard);
+    if ((idx = lruCacheShardFind(shard,hash,key,klen)) != LRU_CACHE_NIL) {
+        lruCacheShardRemove(shard,idx);
+        deleted = 1;
     } else {
-        return 0;
+        deleted = 0;
     }
+    lruShardUnlock(cache,shard);
+
+    return deleted;
 }
 
 int lruCacheGet(lruCache *cache, sds key) {
-    dictEntry *de;
-    listNode *ln;
-
-    if ((de = dictFind(cache->map,key))) {
-        ln = dictGetVal(de);
-        listUnlink(cache->list,ln);
-        listLinkHead(cache->list,ln);
-        return 1;
+    int found;
+    size_t klen = sdslen(key);
+    uint64_t hash = dictGenHashFunction(key,klen);
+    lruCacheShard *shard = lruCacheGetShard(cache,hash);
+    uint32_t idx;
+
+    lruShardLock(cache,shard);
+    if ((idx = lruCacheShardFind(shard,hash,key,klen)) != LRU_CACHE_NIL) {
+        shard->nodes[idx].ref = 1;
+        shard->stats.hits++;
+        found = 1;
     } else {
-        return 0;
+        shard->stats.misses++;
+        found = 0;
     }
+    lruShardUnlock(cache,shard);
+
+    return found;
 }
 
 void lruCacheSetCapacity(lruCache *cache, size_t capacity) {
     cache->capacity = capacity;
-    lruCacheTrim(cache);
+    for (int i = 0; i < cache->nshards; i++) {
+        lruCacheShard *shard = cache->shards+i;
+        lruShardLock(cache,shard);
+        shard->capacity = lruCacheShardCapacity(cache,capacity);
+        lruCacheShardTrim(shard);
+        lruShardUnlock(cache,shard);
+    }
+}
+
+size_t lruCacheCount(lruCache *cache) {
+    size_t count = 0;
+    for (int i = 0; i < cache->nshards; i++) {
+        lruCacheShard *shard = cache->shards+i;
+        lruShardLock(cache,shard);
+        count += shard->count;
+        lruShardUnlock(cache,shard);
+    }
+    return count;
+}
+
+size_t lruCacheMemoryUsage(lruCache *cache) {
+    size_t mem = sizeof(lruCache) + sizeof(lruCacheShard)*cache->nshards;
+    for (int i = 0; i < cache->nshards; i++) {
+        lruCacheShard *shard = cache->shards+i;
+        lruShardLock(cache,shard);
+        mem += sizeof(lruCacheNode)*shard->nnodes;
+        mem += sizeof(uint32_t)*shard->nbuckets;
+        mem += shard->keys_alloc;
+        lruShardUnlock(cache,shard);
+    }
+    return mem;
+}
+
+void lruCacheGetStats(lruCache *cache, lruCacheStats *stats) {
+    memset(stats,0,sizeof(lruCacheStats));
+    for (int i = 0; i < cache->nshards; i++) {
+        lruCacheShard *shard = cache->shards+i;
+        lruShardLock(cache,shard);
+        stats->hits += shard->stats.hits;
+        stats->misses += shard->stats.misses;
+        stats->inserts += shard->stats.inserts;
+        stats->evictions += shard->stats.evictions;
+        lruShardUnlock(cache,shard);
+    }
+}
+
+void lruCacheResetStats(lruCache *cache) {
+    for (int i = 0; i < cache->nshards; i++) {
+        lruCacheShard *shard = cache->shards+i;
+        lruShardLock(cache,shard);
+        memset(&shard->stats,0,sizeof(lruCacheStats));
+        lruShardUnlock(cache,shard);
+    }
 }
 
 #ifdef REDIS_TEST
 
 static int lruCacheExists(lruCache *cache, sds key) {
-    return dictFind(cache->map,key) != NULL;
+    size_t klen = sdslen(key);
+    uint64_t hash = dictGenHashFunction(key,klen);
+    lruCacheShard *shard = lruCacheGetShard(cache,hash);
+    return lruCacheShardFind(shard,hash,key,klen) != LRU_CACHE_NIL;
 }
 
 int lruCacheTest(int argc, char *argv[], int accurate) {
@@ -201,6 +466,101 @@ int lruCacheTest(int argc, char *argv[], int accurate) {
         sdsfree(first2), sdsfree(fourth2);
     }
 
+    TEST("lru: long key & arena reuse") {
+        sds longkey = sdsnewlen(NULL,LRU_CACHE_INLINE_KEYLEN*4);
+        sds longkey2 = sdsdup(longkey);
+        lruCache *cache = lruCacheNew(2);
+
+        longkey2[LRU_CACHE_INLINE_KEYLEN*2] = 'x';
+        test_assert(lruCachePut(cache,longkey) == 1);
+        test_assert(lruCachePut(cache,longkey) == 0);
+        test_assert(lruCacheGet(cache,longkey) == 1);
+        test_assert(lruCacheGet(cache,longkey2) == 0);
+        test_assert(cache->shards[0].keys_alloc > 0);
+        test_assert(lruCacheDelete(cache,longkey) == 1);
+        test_assert(cache->shards[0].keys_alloc == 0);
+        test_assert(lruCacheCount(cache) == 0);
+
+        for (int i = 0; i < 100; i++) {
+            sds key = sdscatfmt(sdsempty(),"key-%i",i);
+            lruCachePut(cache,key);
+            sdsfree(key);
+        }
+        test_assert(lruCacheCount(cache) == 2);
+        test_assert(cache->shards[0].nnodes == 2);
+
+        lruCacheFree(cache);
+        sdsfree(longkey), sdsfree(longkey2);
+    }
+
+    TEST("lru: sharded & stats") {
+        lruCacheStats stats;
+        lruCache *cache = lruCacheNewSharded(1000,5,LRU_CACHE_THREADSAFE);
+        size_t memory_full;
+
+        test_assert(cache->nshards == 8);
+        for (int i = 0; i < 2000; i++) {
+            sds key = sdscatfmt(sdsempty(),"key-%i",i);
+            lruCachePut(cache,key);
+            sdsfree(key);
+        }
+        test_assert(lruCacheCount(cache) <= 8*125);
+        test_assert(lruCacheCount(cache) > 500);
+
+        for (int i = 0; i < 2000; i++) {
+            sds key = sdscatfmt(sdsempty(),"key-%i",i);
+            lruCacheGet(cache,key);
+            sdsfree(key);
+        }
+        lruCacheGetStats(cache,&stats);
+        test_assert(stats.inserts == 2000);
+        test_assert(stats.hits == lruCacheCount(cache));
+        test_assert(stats.hits + stats.misses == 2000);
+        test_assert(stats.evictions == 2000 - lruCacheCount(cache));
+
+        memory_full = lruCacheMemoryUsage(cache);
+        lruCacheSetCapacity(cache,8);
+        test_assert(lruCacheCount(cache) <= 8);
+        test_assert(lruCacheMemoryUsage(cache) < memory_full);
+
+        lruCacheResetStats(cache);
+        lruCacheGetStats(cache,&stats);
+        test_assert(stats.hits == 0 && stats.misses == 0 &&
+                stats.inserts == 0 && stats.evictions == 0);
+
+        lruCacheSetCapacity(cache,0);
+        test_assert(lruCacheCount(cache) == 0);
+        sds key = sdsnew("key");
+        test_assert(lruCachePut(cache,key) == 1);
+        test_assert(lruCacheGet(cache,key) == 0);
+        sdsfree(key);
+
+        lruCacheFree(cache);
+    }
+
+    TEST("lru: clock keeps referenced keys") {
+        lruCache *cache = lruCacheNew(100);
+        sds hot[10];
+        int hot_kept = 0;
+
+        for (int i = 0; i < 10; i++) {
+            hot[i] = sdscatfmt(sdsempty(),"hot-%i",i);
+            lruCachePut(cache,hot[i]);
+        }
+        for (int i = 0; i < 1000; i++) {
+            sds key = sdscatfmt(sdsempty(),"cold-%i",i);
+            lruCachePut(cache,key);
+            for (int j = 0; j < 10; j++) lruCacheGet(cache,hot[j]);
+            sdsfree(key);
+        }
+        for (int i = 0; i < 10; i++) {
+            hot_kept += lruCacheExists(cache,hot[i]);
+            sdsfree(hot[i]);
+        }
+        test_assert(hot_kept == 10);
+        lruCacheFree(cache);
+    }
+
     return error;
 }
 
@@ -28,21 +28,73 @@
 #ifndef __CTRIP_LRU_CACHE__
 #define __CTRIP_LRU_CACHE__
 
-#include "dict.h"
-#include "adlist.h"
+#include <stdint.h>
+#include <pthread.h>
 #include "sds.h"
 
+/* Keys not longer than LRU_CACHE_INLINE_KEYLEN are stored inside the node,
+ * longer keys fall back to a separate allocation. */
+#define LRU_CACHE_INLINE_KEYLEN 40
+#define LRU_CACHE_MAX_SHARDS 64
+#define LRU_CACHE_NIL UINT32_MAX
+
+/* lruCache flags */
+#define LRU_CACHE_THREADSAFE (1<<0)
+
+/* Nodes are allocated from a flat per-shard arena and linked by index, so
+ * put/delete never malloc/free (unless key exceeds inline length). Recency
+ * is approximated with CLOCK: hit sets ref bit, eviction hand clears ref
+ * bits until it finds an unreferenced node. */
+typedef struct lruCacheNode {
+  uint64_t hash;
+  uint32_t next;        /* next node in bucket chain or free list. */
+  uint32_t klen:30;
+  uint32_t used:1;
+  uint32_t ref:1;
+  union {
+    char buf[LRU_CACHE_INLINE_KEYLEN];
+    char *ptr;
+  } key;
+} lruCacheNode;
+
+typedef struct lruCacheStats {
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long inserts;
+  unsigned long long evictions;
+} lruCacheStats;
+
+typedef struct lruCacheShard {
+  pthread_mutex_t lock;
+  size_t capacity;
+  size_t count;
+  uint32_t nnodes;
+  uint32_t free;
+  uint32_t hand;
+  uint32_t nbuckets;    /* power of 2 */
+  uint32_t *buckets;
+  lruCacheNode *nodes;
+  size_t keys_alloc;    /* bytes allocated for keys not inlined. */
+  lruCacheStats stats;
+} lruCacheShard;
+
 typedef struct lruCache {
   size_t capacity;
-  dict *map;
-  list *list;
+  int flags;
+  int nshards;          /* power of 2 */
+  lruCacheShard *shards;
 } lruCache;
 
 lruCache *lruCacheNew(size_t capacity);
+lruCache *lruCacheNewSharded(size_t capacity, int nshards, int flags);
 void lruCacheFree(lruCache *cache);
 int lruCachePut(lruCache *cache, sds key);
 int lruCacheGet(lruCache *cache, sds key);
 int lruCacheDelete(lruCache *cache, sds key);
 void lruCacheSetCapacity(lruCache *cache, size_t capacity);
+size_t lruCacheCount(lruCache *cache);
+size_t lruCacheMemoryUsage(lruCache *cache);
+void lruCacheGetStats(lruCache *cache, lruCacheStats *stats);
+void lruCacheResetStats(lruCache *cache);
 
 #endif
@@ -252,6 +252,18 @@ void continueProcessCommand(client *c) {
 	if (c->swap_errcode) {
         replySwapFailed(c);
         c->swap_errcode = 0;
+        c->swap_zrank = -1;
+        c->swap_stream_replied = 0;
+        c->swap_strlen = -1;
+        if (c->swap_getrange) {
+            sdsfree(c->swap_getrange);
+            c->swap_getrange = NULL;
+        }
+        if (c->swap_keys_reply) {
+            sdsfree(c->swap_keys_reply);
+            c->swap_keys_reply = NULL;
+        }
+        c->swap_keys_count = 0;
     } else {
 		call(c,CMD_CALL_FULL);
 		/* post call */
@@ -296,11 +308,69 @@ void normalClientKeyRequestFinished(client *c, swapCtx *ctx) {
     }
 }
 
-void keyRequestSwapFinished(swapData *data, void *pd, int errcode) {
-    UNUSED(data);
-    swapCtx *ctx = pd;
-	if (errcode) ctx->errcode = errcode;
+void keyRequestSwapFinished(swapData *data, void *pd, int errcode);
+
+static void keyRequestSwapStreamSubmit(swapCtx *ctx, swapData *data) {
+    swapRequest *req;
+    void *msgs = NULL;
+    int thread_idx = ctx->key_request->deferred ? server.swap_defer_thread_idx : -1;
+
+#ifdef SWAP_DEBUG
+    msgs = &ctx->msgs;
+#endif
+    DEBUG_MSGS_APPEND(&ctx->msgs,"stream-continue","replied=%lld/%lld",
+            data->stream->replied,data->stream->total);
+    req = swapDataRequestNew(SWAP_IN,0,ctx,data,ctx->datactx,NULL,
+            keyRequestSwapFinished,ctx,msgs);
+    req->priority = swapCtxPriority(ctx);
+    swapBatchCtxFeed(server.swap_batch_ctx,1,req,thread_idx);
+}
+
+static inline int swapStreamClientClosing(client *c) {
+    return (c->flags & CLIENT_CLOSE_ASAP) || c->CLIENT_DEFERED_CLOSING;
+}
+
+/* Next chunk is not swapped untill client reply drains under limit, so that
+ * slow reader won't pile up the whole object in reply buffer. */
+static inline int swapStreamReplyShouldPause(client *c) {
+    return server.swap_stream_reply_buffer_limit &&
+        !swapStreamClientClosing(c) &&
+        getClientOutputBufferMemoryUsage(c) > server.swap_stream_reply_buffer_limit;
+}
+
+/* Streamed reply is written chunk by chunk with key lock held (request io
+ * not released), returns 1 if swap for next chunk submitted (or paused). */
+static int keyRequestSwapStreamContinue(swapCtx *ctx, swapData *data) {
+    client *c = ctx->c;
+
+    if (ctx->errcode) {
+        /* partial reply can't be taken back. */
+        if (swapStreamReplyStarted(data->stream)) {
+            serverLog(LL_WARNING,
+                    "Streamed reply aborted by swap error(%d), closing client.",
+                    ctx->errcode);
+            freeClientAsync(c);
+        }
+        return 0;
+    }
+
+    if (c->flags & CLIENT_CLOSE_ASAP) return 0;
+
+    if (!swapDataStreamReply(data,c)) return 0;
+
+    if (swapStreamReplyShouldPause(c)) {
+        DEBUG_MSGS_APPEND(&ctx->msgs,"stream-paused","reply_bytes=%lu",
+                getClientOutputBufferMemoryUsage(c));
+        listAddNodeTail(server.swap_stream_paused_ctxs,ctx);
+        server.stat_swap_stream_reply_paused_count++;
+        return 1;
+    }
 
+    keyRequestSwapStreamSubmit(ctx,data);
+    return 1;
+}
+
+static void keyRequestSwapFinish(swapCtx *ctx, swapData *data) {
     if (data) {
         swapDataKeyRequestFinished(data);
         DEBUG_MSGS_APPEND(&ctx->msgs,"swap-finished",
@@ -316,6 +386,62 @@ void keyRequestSwapFinished(swapData *data, void *pd, int errcode) {
     ctx->finished(ctx->c,ctx);
 }
 
+/* KEYS scans meta cf chunk by chunk with db lock held, returns 1 if swap
+ * for next chunk submitted. */
+static int keyRequestMetaScanContinue(swapCtx *ctx, swapData *data) {
+    swapRequest *req;
+    void *msgs = NULL;
+    int thread_idx = ctx->key_request->deferred ? server.swap_defer_thread_idx : -1;
+
+    if (ctx->errcode || (ctx->c->flags & CLIENT_CLOSE_ASAP)) return 0;
+    if (!metaScanSwapDataHasMore(data,ctx->datactx)) return 0;
+
+#ifdef SWAP_DEBUG
+    msgs = &ctx->msgs;
+#endif
+    DEBUG_MSGS_APPEND(&ctx->msgs,"metascan-continue","count=%ld",
+            ctx->c->swap_keys_count);
+    req = swapDataRequestNew(SWAP_IN,0,ctx,data,ctx->datactx,NULL,
+            keyRequestSwapFinished,ctx,msgs);
+    req->priority = swapCtxPriority(ctx);
+    swapBatchCtxFeed(server.swap_batch_ctx,1,req,thread_idx);
+    return 1;
+}
+
+void keyRequestSwapFinished(swapData *data, void *pd, int errcode) {
+    swapCtx *ctx = pd;
+	if (errcode) ctx->errcode = errcode;
+
+    if (data && data->stream && keyRequestSwapStreamContinue(ctx,data))
+        return;
+
+    if (data && keyRequestMetaScanContinue(ctx,data))
+        return;
+
+    keyRequestSwapFinish(ctx,data);
+}
+
+/* Called before sleep: resume paused streamed replies whose client reply
+ * drained under limit, finish those of closing clients. */
+void swapStreamResumePausedReplies(void) {
+    listIter li;
+    listNode *ln;
+
+    listRewind(server.swap_stream_paused_ctxs,&li);
+    while ((ln = listNext(&li))) {
+        swapCtx *ctx = listNodeValue(ln);
+        client *c = ctx->c;
+
+        if (swapStreamClientClosing(c)) {
+            listDelNode(server.swap_stream_paused_ctxs,ln);
+            keyRequestSwapFinish(ctx,ctx->data);
+        } else if (!swapStreamReplyShouldPause(c)) {
+            listDelNode(server.swap_stream_paused_ctxs,ln);
+            keyRequestSwapStreamSubmit(ctx,ctx->data);
+        }
+    }
+}
+
 /* Expired key should delete only if server is master, check expireIfNeeded
  * for more details. */
 int keyExpiredAndShouldDelete(redisDb *db, robj *key) {
@@ -334,6 +460,30 @@ int keyExpiredAndShouldDelete(redisDb *db, robj *key) {
 #define NOSWAP_REASON_ALREAY_SWAPPED_OUT 7
 #define NOSWAP_REASON_UNEXPECTED 100
 
+/* Requests of internal clients (evict/persist/expire) are background. */
+int swapCtxPriority(swapCtx *ctx) {
+    client *c = ctx->c;
+    int dbid = ctx->key_request->dbid;
+
+    if (c->client_hold_mode != CLIENT_HOLD_MODE_EVICT ||
+            dbid < 0 || dbid >= server.dbnum)
+        return SWAP_PRIORITY_FOREGROUND;
+
+    if (c == server.evict_clients[dbid]) {
+        if (ctx->key_request->cmd_intention_flags & SWAP_OUT_PERSIST)
+            return SWAP_PRIORITY_PERSIST;
+        else
+            return SWAP_PRIORITY_EVICT;
+    }
+
+    if (c == server.expire_clients[dbid] ||
+            c == server.scan_expire_clients[dbid] ||
+            c == server.ttl_clients[dbid])
+        return SWAP_PRIORITY_EXPIRE;
+
+    return SWAP_PRIORITY_FOREGROUND;
+}
+
 void keyRequestProceed(void *lock, int flush, redisDb *db, robj *key,
         client *c, void *pd) {
     int reason_num = 0, retval = 0, swap_intention, errcode;
@@ -368,7 +518,10 @@ void keyRequestProceed(void *lock, int flush, redisDb *db, robj *key,
 	/* handle metascan request. */
     if (isMetaScanRequest(cmd_intention_flags)) {
         data = createSwapData(db,NULL,NULL,NULL);
-        retval = swapDataSetupMetaScan(data,cmd_intention_flags,c,&datactx);
+        if (cmd_intention_flags & SWAP_METASCAN_EXPIRE_CLEAN)
+            retval = swapDataSetupExpireIndexClean(data,ctx->key_request,c,&datactx);
+        else
+            retval = swapDataSetupMetaScan(data,cmd_intention_flags,c,&datactx);
         swapCtxSetSwapData(ctx,data,datactx);
         if (retval) {
             ctx->errcode = retval;
@@ -404,7 +557,8 @@ void keyRequestProceed(void *lock, int flush, redisDb *db, robj *key,
         }
 
         int filt_by;
-        if (!coldFilterMayContainKey(db->cold_filter,key->ptr,&filt_by)) {
+        if (!coldFilterMayContainKeyProbed(db->cold_filter,key->ptr,
+                    ctx->cold_filter_probe,ctx->cold_filter_version,&filt_by)) {
             reason = "key is absent";
             if (filt_by == COLDFILTER_FILT_BY_CUCKOO_FILTER)
                 reason_num = NOSWAP_REASON_FILT_BY_CUCKOOFILTER;
@@ -415,6 +569,7 @@ void keyRequestProceed(void *lock, int flush, redisDb *db, robj *key,
             req = swapMetaRequestNew(ctx->key_request,
                     ctx,data,datactx,ctx->key_request->trace,
                     keyRequestSwapFinished,ctx,msgs);
+            req->priority = swapCtxPriority(ctx);
             swapBatchCtxFeed(server.swap_batch_ctx,flush,req,thread_idx);
             return;
         }
@@ -467,6 +622,7 @@ allset:
 
     req = swapDataRequestNew(swap_intention,swap_intention_flags,ctx,data,
             datactx,ctx->key_request->trace,keyRequestSwapFinished,ctx,msgs);
+    req->priority = swapCtxPriority(ctx);
     swapBatchCtxFeed(server.swap_batch_ctx,flush,req,thread_idx);
 
     return;
@@ -490,15 +646,74 @@ noswap:
     return;
 }
 
+/* Probe cold filter for cold keys of multi-key requests (MGET, MSET, DEL,
+ * EXEC...) in one batch per db, so that cuckoo filter lookups of different
+ * keys overlap instead of missing cache one after another. */
+static void probeClientKeyRequestsColdFilter(getKeyRequestsResult *result,
+        int *probes, unsigned long long *versions) {
+    int nkeys, *idxs = zmalloc(result->num*sizeof(int));
+    const char **keys = zmalloc(result->num*sizeof(char*));
+    size_t *klens = zmalloc(result->num*sizeof(size_t));
+    int *dbprobes = zmalloc(result->num*sizeof(int));
+
+    for (int i = 0; i < result->num; i++) probes[i] = -1;
+
+    for (int i = 0; i < result->num; i++) {
+        keyRequest *key_request = result->key_requests + i;
+        if (probes[i] != -1) continue;
+        probes[i] = COLDFILTER_PROBE_NONE;
+        if (key_request->level != REQUEST_LEVEL_KEY ||
+                key_request->key == NULL)
+            continue;
+
+        redisDb *db = server.db + key_request->dbid;
+        nkeys = 0;
+        for (int j = i; j < result->num; j++) {
+            keyRequest *kr = result->key_requests + j;
+            if (j > i && (probes[j] != -1 || kr->dbid != key_request->dbid))
+                continue;
+            probes[j] = COLDFILTER_PROBE_NONE;
+            if (kr->level != REQUEST_LEVEL_KEY || kr->key == NULL ||
+                    kr->cmd_intention == SWAP_OUT ||
+                    dictFind(db->dict,kr->key->ptr) != NULL)
+                continue;
+            idxs[nkeys] = j;
+            keys[nkeys] = kr->key->ptr;
+            klens[nkeys] = sdslen(kr->key->ptr);
+            nkeys++;
+        }
+        if (nkeys <= 1) continue;
+
+        coldFilterMayContainKeys(db->cold_filter,nkeys,keys,klens,dbprobes);
+        for (int k = 0; k < nkeys; k++) {
+            probes[idxs[k]] = dbprobes[k];
+            versions[idxs[k]] = db->cold_filter->version;
+        }
+    }
+
+    zfree(idxs);
+    zfree(keys);
+    zfree(klens);
+    zfree(dbprobes);
+}
+
 void _submitClientKeyRequests(client *c, getKeyRequestsResult *result,
         clientKeyRequestFinished cb, void* ctx_pd, int deferred) {
     int64_t txid = server.swap_txid++;
+    int *probes = NULL;
+    unsigned long long *versions = NULL;
 
     if (pauseClientKeyRequestsIfNeeded(c,result,cb))
         return;
 
     pauseClientSwapIfNeeded(c);
 
+    if (result->num > 1 && server.swap_cuckoo_filter_enabled) {
+        probes = zmalloc(result->num*sizeof(int));
+        versions = zmalloc(result->num*sizeof(unsigned long long));
+        probeClientKeyRequestsColdFilter(result,probes,versions);
+    }
+
     if (result->swap_cmd) swapCmdSwapSubmitted(result->swap_cmd);
     for (int i = 0; i < result->num; i++) {
         void *msgs = NULL;
@@ -509,6 +724,10 @@ void _submitClientKeyRequests(client *c, getKeyRequestsResult *result,
         robj *key = key_request->key;
 
         swapCtx *ctx = swapCtxCreate(c,key_request,cb, ctx_pd);
+        if (probes) {
+            ctx->cold_filter_probe = probes[i];
+            ctx->cold_filter_version = versions[i];
+        }
 #ifdef SWAP_DEBUG
         msgs = &ctx->msgs;
 #endif
@@ -519,6 +738,9 @@ void _submitClientKeyRequests(client *c, getKeyRequestsResult *result,
         lockLock(txid,db,key,keyRequestProceed,c,ctx,
                 (freefunc)swapCtxFree,msgs);
     }
+
+    if (probes) zfree(probes);
+    if (versions) zfree(versions);
 }
 
 void submitDeferredClientKeyRequests(client *c, getKeyRequestsResult *result,
@@ -588,7 +810,10 @@ int dbSwap(client *c) {
          * 1. repl stream will not propagate to sub-slaves
          * 2. client will not reset
          * 3. client will break out process loop. */
-        if (c->keyrequests_count) c->flags |= CLIENT_SWAPPING;
+        if (c->keyrequests_count) {
+            c->flags |= CLIENT_SWAPPING;
+            if (!(c->flags & CLIENT_MASTER)) swapPrefetchPipeline(c);
+        }
         return C_ERR;
     } else if (keyrequests_submit < 0) {
         /* Swapping command parsed and dispatched, return C_OK so that:
@@ -666,15 +891,18 @@ void swapInit() {
     server.mutex_client->cmd = lookupCommandByCString("SWAP.MUTEXOP");
     server.mutex_client->client_hold_mode = CLIENT_HOLD_MODE_EVICT;
 
-    server.repl_workers = 256;
+    server.prefetch_client = createClient(NULL);
+    server.prefetch_client->client_hold_mode = CLIENT_HOLD_MODE_EVICT;
+    server.swap_prefetch_inprogress_count = 0;
+
+    /* repl worker clients are created on demand (up to repl_workers). */
     server.repl_swapping_clients = listCreate();
     server.repl_worker_clients_free = listCreate();
     server.repl_worker_clients_used = listCreate();
-    for (i = 0; i < server.repl_workers; i++) {
-        client *c = createClient(NULL);
-        c->client_hold_mode = CLIENT_HOLD_MODE_REPL;
-        listAddNodeTail(server.repl_worker_clients_free, c);
-    }
+    server.repl_apply_ahead_inflight = 0;
+
+    server.swap_stream_paused_ctxs = listCreate();
+    server.stat_swap_stream_reply_paused_count = 0;
 
     server.rdb_load_ctx = NULL;
 
@@ -691,6 +919,8 @@ void swapInit() {
 
     server.swap_batch_ctx = swapBatchCtxNew();
 
+    server.swap_subkey_access_tracker = subkeyAccessTrackerNew(SUBKEY_ACCESS_TRACKER_BITS);
+
     if (server.swap_persist_enabled)
         server.swap_persist_ctx = swapPersistCtxNew();
     else
@@ -777,12 +1007,16 @@ int swapTest(int argc, char **argv, int accurate) {
   result += swapListMetaTest(argc, argv, accurate);
   result += swapListDataTest(argc, argv, accurate);
   result += swapListUtilsTest(argc, argv, accurate);
+  result += swapDataStreamTest(argc, argv, accurate);
   result += lruCacheTest(argc, argv, accurate);
   result += swapAbsentTest(argc, argv, accurate);
   result += swapRIOTest(argc, argv, accurate);
   result += swapBatchTest(argc, argv, accurate);
   result += cuckooFilterTest(argc, argv, accurate);
   result += swapPersistTest(argc, argv, accurate);
+  result += swapIngestTest(argc, argv, accurate);
+  result += swapPrefetchTest(argc, argv, accurate);
+  result += swapSubkeyAccessTest(argc, argv, accurate);
 
   return result;
 }
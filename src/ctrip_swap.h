@@ -44,11 +44,13 @@
 #define DATA_CF 0
 #define META_CF 1
 #define SCORE_CF 2
-#define CF_COUNT 3
+#define EXPIRE_CF 3
+#define CF_COUNT 4
 
 #define data_cf_name "default"
 #define meta_cf_name "meta"
 #define score_cf_name "score"
+#define expire_cf_name "expire"
 extern const char *swap_cf_names[CF_COUNT];
 #define rocksdb_stats_section "rocksdb.stats"
 #define rocksdb_stats_section_len 13
@@ -81,6 +83,16 @@ extern const char *swap_cf_names[CF_COUNT];
 #define SWAP_OUT_PERSIST (1U<<10)
 /* Keep data in memory because memory is sufficient. */
 #define SWAP_OUT_KEEP_DATA (1U<<11)
+/* Swap in only the requested member and count its rank in rocksdb. */
+#define SWAP_IN_RANK (1U<<12)
+/* Reply big object chunk by chunk without swapping it in. */
+#define SWAP_IN_STREAM (1U<<13)
+/* This is a metascan request for keys command. */
+#define SWAP_METASCAN_KEYS (1U<<14)
+/* Read (or write) only the chunks of cold string touched by command. */
+#define SWAP_IN_PARTIAL (1U<<15)
+/* This is a metascan request to clean stale expire index entry of key. */
+#define SWAP_METASCAN_EXPIRE_CLEAN (1U<<16)
 
 /* --- swap intention flags --- */
 /* Delete rocksdb data key when swap in */
@@ -123,7 +135,9 @@ static inline int getSwapIntentionByName(char *name) {
 static inline int isMetaScanRequest(uint32_t intention_flag) {
     return (intention_flag & SWAP_METASCAN_SCAN) ||
            (intention_flag & SWAP_METASCAN_RANDOMKEY) ||
-           (intention_flag & SWAP_METASCAN_EXPIRE);
+           (intention_flag & SWAP_METASCAN_EXPIRE) ||
+           (intention_flag & SWAP_METASCAN_KEYS) ||
+           (intention_flag & SWAP_METASCAN_EXPIRE_CLEAN);
 }
 
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
@@ -161,6 +175,7 @@ typedef struct range {
 #define KEYREQUEST_TYPE_SUBKEY 1
 #define KEYREQUEST_TYPE_RANGE  2
 #define KEYREQUEST_TYPE_SCORE  3
+#define KEYREQUEST_TYPE_STREAM 4
 
 typedef struct argRewriteRequest {
   int mstate_idx; /* >=0 if current command is a exec, means index in mstate; -1 means req not in multi/exec */
@@ -180,6 +195,7 @@ typedef struct keyRequest{
   uint64_t cmd_flags;
   int type;
   int deferred;
+  int prefetch; /* swap in ahead of command execution. */
   robj *key;
   union {
     struct {
@@ -195,6 +211,10 @@ typedef struct keyRequest{
       int reverse;
       int limit;
     } zs; /* zset score*/
+    struct {
+      streamID start;
+      streamID end;
+    } x; /* id range (both inclusive): stream */
   };
   argRewriteRequest list_arg_rewrite[2];
   swapCmdTrace *swap_cmd;
@@ -205,6 +225,7 @@ void copyKeyRequest(keyRequest *dst, keyRequest *src);
 void moveKeyRequest(keyRequest *dst, keyRequest *src);
 void keyRequestDeinit(keyRequest *key_request);
 void getKeyRequests(client *c, struct getKeyRequestsResult *result);
+void getSingleCommandKeyRequests(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 void releaseKeyRequests(struct getKeyRequestsResult *result);
 int getKeyRequestsNone(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsGlobal(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
@@ -213,6 +234,10 @@ int getKeyRequestsMetaScan(int dbid, struct redisCommand *cmd, robj **argv, int
 int getKeyRequestsBitop(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsSort(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 
+int getKeyRequestsGetrange(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
+int getKeyRequestsSetrange(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
+int getKeyRequestsAppend(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
+
 #define getKeyRequestsHsetnx getKeyRequestsHset
 #define getKeyRequestsHget getKeyRequestsHmget
 #define getKeyRequestsHdel getKeyRequestsHmget
@@ -250,6 +275,7 @@ int getKeyRequestsLtrim(int dbid, struct redisCommand *cmd, robj **argv, int arg
 int getKeyRequestsZAdd(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsZScore(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsZMScore(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
+int getKeyRequestsZrank(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsZincrby(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsZrange(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsZrangestore(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
@@ -263,6 +289,11 @@ int getKeyRequestsZremRangeByScore1(int dbid, struct redisCommand *cmd, robj **a
 int getKeyRequestsZrevrangeByLex(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsZrangeByLex(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsZremRangeByLex(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
+int getKeyRequestsXadd(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
+int getKeyRequestsXrange(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
+int getKeyRequestsXrevrange(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
+int getKeyRequestsXread(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
+int getKeyRequestsXsetid(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsZlexCount(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 
 #define getKeyRequestsSdiffstore getKeyRequestsSinterstore
@@ -490,6 +521,8 @@ typedef struct objectMeta {
 
 extern objectMetaType lenObjectMetaType;
 extern objectMetaType listObjectMetaType;
+extern objectMetaType streamObjectMetaType;
+extern objectMetaType wholekeyObjectMetaType;
 
 static inline void swapInitVersion() { server.swap_key_version = 1; }
 static inline void swapSetVersion(uint64_t version) { server.swap_key_version = version; }
@@ -560,6 +593,19 @@ typedef struct swapDataAbsentSubkey {
 #define SWAP_ANA_THD_MAIN 0
 #define SWAP_ANA_THD_SWAP 1
 
+/* Streamed read of big object (HGETALL/SMEMBERS...): subkeys in rocksdb
+ * are swapped in chunk by chunk with key lock held, each chunk replied and
+ * released right away, so object never turns hot. */
+typedef struct swapStream {
+  int limit; /* subkeys per chunk */
+  int eof;
+  sds end; /* own, range end of object subkeys */
+  sds nextseek; /* own, start of next chunk */
+  robj *chunk; /* own, subkeys swapped in by last chunk */
+  long long total; /* reply length, -1 if reply not started yet */
+  long long replied;
+} swapStream;
+
 /* SwapData represents key state when swap start. It is stable during
  * key swapping, misc dynamic data are save in dataCtx. */
 typedef struct swapData {
@@ -580,6 +626,7 @@ typedef struct swapData {
   unsigned set_persist_keep:1;
   unsigned reserved:27;
   sds nextseek; /* own, moved from exec */
+  swapStream *stream; /* own, not NULL if replied by stream */
   swapDataAbsentSubkey *absent;
   robj *dirty_subkeys;
   void *extends[2];
@@ -607,6 +654,7 @@ typedef struct swapDataType {
   int (*rocksDel)(struct swapData *data_,  void *datactx_, int inaction, int num, int* cfs, sds *rawkeys, sds *rawvals, OUT int *outaction, OUT int *outnum, OUT int** outcfs,OUT sds **outrawkeys);
   int (*mergedIsHot)(struct swapData *data, MOVE void *result, void *datactx);
   void* (*getObjectMetaAux)(struct swapData *data, void *datactx);
+  int (*streamReply)(struct swapData *data, client *c);
 } swapDataType;
 
 swapData *createSwapData(redisDb *db, robj *key, robj *value, robj *dirty_subkeys);
@@ -629,6 +677,14 @@ void *swapDataCreateOrMergeObject(swapData *d, MOVE void *decoded, void *datactx
 int swapDataCleanObject(swapData *d, void *datactx, int keep_data);
 int swapDataBeforeCall(swapData *d, client *c, void *datactx);
 int swapDataKeyRequestFinished(swapData *data);
+int swapDataSetupStream(swapData *data, uint32_t cmd_intention_flags);
+int swapDataStreamReply(swapData *data, client *c);
+void swapStreamResumePausedReplies(void);
+void swapStreamFree(swapStream *stream);
+void swapStreamSetChunk(swapStream *stream, MOVE robj *chunk);
+static inline int swapStreamReplyStarted(swapStream *stream) {
+  return stream->total >= 0;
+}
 char swapDataGetObjectAbbrev(robj *value);
 void swapDataFree(swapData *data, void *datactx);
 int swapDataMergedIsHot(swapData *d, void *result, void *datactx);
@@ -706,6 +762,7 @@ int swapDataObjectMergedIsHot(swapData *data, void *result, void *datactx);
 #define hashMergedIsHot swapDataObjectMergedIsHot
 #define zsetMergedIsHot swapDataObjectMergedIsHot
 #define wholeKeyMergedIsHot swapDataObjectMergedIsHot
+#define streamMergedIsHot swapDataObjectMergedIsHot
 
 
 /* Debug msgs */
@@ -781,6 +838,8 @@ typedef struct swapCtx {
   clientKeyRequestFinished finished;
   int errcode;
   void *swap_lock;
+  int cold_filter_probe; /* COLDFILTER_PROBE_XXX */
+  unsigned long long cold_filter_version; /* cold filter version when probed */
 #ifdef SWAP_DEBUG
   swapDebugMsgs msgs;
 #endif
@@ -805,8 +864,30 @@ typedef struct wholeKeySwapData {
   swapData d;
 } wholeKeySwapData;
 
+/* String no shorter than swap-string-chunk-threshold is persisted as fixed
+ * size chunks (chunk index as subkey), with string length kept in meta. */
+#define SWAP_STRING_CHUNK_SIZE (64*1024)
+#define stringChunkCount(len) (((len)+SWAP_STRING_CHUNK_SIZE-1)/SWAP_STRING_CHUNK_SIZE)
+
+#define STRING_PARTIAL_NONE 0
+#define STRING_PARTIAL_STRLEN 1
+#define STRING_PARTIAL_GETRANGE 2
+#define STRING_PARTIAL_SETRANGE 3
+
+typedef struct wholeKeyDataCtx {
+  int partial; /* STRING_PARTIAL_XXX */
+  long long start; /* first byte read or written */
+  long long end; /* last byte read or written (inclusive) */
+  robj *value; /* SETRANGE/APPEND: bytes to write (own) */
+  long long strlen; /* string length after command */
+  sds range; /* GETRANGE: bytes read from chunks (own) */
+  int errcode; /* SETRANGE/APPEND: write chunks failed */
+} wholeKeyDataCtx;
+
 int swapDataSetupWholeKey(swapData *d, OUT void **datactx);
 
+#define createStringObjectMeta(version, len) createLenObjectMeta(OBJ_STRING, version, len)
+
 /* Hash */
 typedef struct hashSwapData {
   swapData d;
@@ -879,12 +960,31 @@ long ctripListTypeLength(robj *list, objectMeta *object_meta);
 void ctripListTypePush(robj *subject, robj *value, int where, redisDb *db, robj *key);
 robj *ctripListTypePop(robj *subject, int where, redisDb *db, robj *key);
 void ctripListMetaDelRange(redisDb *db, robj *key, long ltrim, long rtrim);
+
+/* Stream */
+typedef struct streamSwapData {
+  swapData d;
+} streamSwapData;
+
+typedef struct streamDataCtx {
+  int num; /* # of nodes to swap in/out */
+  int capacity;
+  streamID *nodes; /* master ID of nodes */
+  int swap_all; /* swap in all nodes */
+  int ctx_flag;
+} streamDataCtx;
+
+struct streamMeta *streamMetaCreate();
+objectMeta *createStreamObjectMeta(uint64_t version, MOVE struct streamMeta *stream_meta);
+int swapDataSetupStreamType(swapData *d, void **pdatactx);
+
 /* zset */
 typedef struct zsetSwapData {
   swapData sd;
 } zsetSwapData;
 #define TYPE_NONE 0
 #define TYPE_ZS 1
+#define TYPE_ZR 2
 
 typedef struct zsetDataCtx {
 	baseBigDataCtx bdc;
@@ -895,6 +995,9 @@ typedef struct zsetDataCtx {
       int reverse;
       int limit;
     } zs;
+    struct {
+      long rank; /* members ordered before subkey in rocksdb, -1 if unknown */
+    } zr;
   };
 
 } zsetDataCtx;
@@ -913,6 +1016,7 @@ typedef struct scanMeta {
 } scanMeta;
 
 int scanMetaExpireIfNeeded(redisDb *db, scanMeta *meta);
+void submitExpireIndexCleanRequest(client *c, sds key, long long expire);
 
 typedef struct metaScanResult {
   scanMeta buffer[DEFAULT_SCANMETA_BUFFER];
@@ -931,7 +1035,7 @@ typedef struct metaScanSwapData {
   swapData d;
 } metaScanSwapData;
 
-/* There are three kinds of meta scan ctx: scan/randomkey/activeexpire */
+/* There are four kinds of meta scan ctx: scan/randomkey/activeexpire/keys */
 struct metaScanDataCtx;
 
 typedef struct metaScanDataCtxType {
@@ -945,10 +1049,16 @@ typedef struct metaScanDataCtx {
     client *c;
     int limit;
     sds seek;
+    sds pattern; /* own, NULL if all keys match */
     void *extend;
 } metaScanDataCtx;
 
 int swapDataSetupMetaScan(swapData *d, uint32_t intention_flags, client *c, OUT void **datactx);
+int swapDataSetupExpireIndexClean(swapData *d, keyRequest *key_request, client *c, OUT void **datactx);
+int metaScanSwapDataHasMore(swapData *d, void *datactx);
+
+/* KEYS scans cold keys by chunk of this many metas. */
+#define METASCAN_KEYS_CHUNK_LIMIT 1024
 
 robj *metaScanResultRandomKey(redisDb *db, metaScanResult *result);
 
@@ -968,7 +1078,8 @@ void freeExpireCandidates(expireCandidates *candidates);
 typedef struct scanExpire {
     expireCandidates *candidates;
     int inprogress;
-    sds nextseek;
+    int use_index; /* scan expire cf instead of meta cf */
+    sds nextseek; /* raw expire key if use_index, otherwise key */
     int limit;
     double stale_percent;
     long long stat_estimated_cycle_seconds;
@@ -976,6 +1087,7 @@ typedef struct scanExpire {
     size_t stat_expired_per_sec;
     long long stat_scan_time_used;
     long long stat_expire_time_used;
+    long long stat_index_lag_ms; /* now - oldest due expire in last scan */
 } scanExpire;
 
 scanExpire *scanExpireCreate();
@@ -1078,6 +1190,7 @@ typedef struct swapRequest {
 #endif
   int errcode;
   swapTrace *trace;
+  int priority; /* SWAP_PRIORITY_* */
 } swapRequest;
 
 swapRequest *swapRequestNew(keyRequest *key_request, int intention,
@@ -1125,6 +1238,8 @@ typedef struct swapRequestBatch {
   void *notify_pd;
   monotime notify_queue_timer;
   monotime swap_queue_timer;
+  int priority; /* all reqs in batch have the same priority */
+  monotime dispatch_time;
 } swapRequestBatch;
 
 swapRequestBatch *swapRequestBatchNew();
@@ -1187,13 +1302,49 @@ void swapExecBatchCtxFeed(swapExecBatch *exec_ctx, swapRequest *req);
 #define SWAP_THREADS_DEFAULT     4
 #define SWAP_THREADS_MAX         64
 
+/* Swap priority: foreground (client command) batches are always popped
+ * first, background classes are granted their share (percent of pops) only
+ * when contending with foreground. */
+#define SWAP_PRIORITY_FOREGROUND 0
+#define SWAP_PRIORITY_EXPIRE 1
+#define SWAP_PRIORITY_EVICT 2
+#define SWAP_PRIORITY_PERSIST 3
+#define SWAP_PRIORITY_TYPES 4
+
+static inline const char *swapPriorityName(int priority) {
+    const char *name = "?";
+    const char *names[] = {"foreground", "expire", "evict", "persist"};
+    if (priority >= 0 && (size_t)priority < sizeof(names)/sizeof(char*))
+        name = names[priority];
+    return name;
+}
+
+typedef struct swapPriorityStat {
+    redisAtomic long pending;
+    redisAtomic long long processed;
+    redisAtomic long long queue_us; /* accumulated dispatch to process time */
+} swapPriorityStat;
+
+int swapPriorityShare(int priority);
+int swapCtxPriority(struct swapCtx *ctx);
+
+/* Swap threads [0,swap_threads_num) pop batches from head of their own
+ * pending_reqs (by priority), and steal from others' when their own drained.
+ * Defer & util threads only process batches dispatched to them. */
 typedef struct swapThread {
     int id;
     pthread_t thread_id;
     pthread_mutex_t lock;
     pthread_cond_t cond;
-    list *pending_reqs;
+    list *pending_reqs[SWAP_PRIORITY_TYPES];
+    int credits[SWAP_PRIORITY_TYPES]; /* background credits, see swapThreadPopLocked */
     redisAtomic unsigned long is_running_rio;
+    redisAtomic long pending_count; /* total length of pending_reqs */
+    redisAtomic int idle; /* parked waiting for reqs */
+    redisAtomic long long busy_us;
+    redisAtomic long long idle_us;
+    redisAtomic long long processed_count;
+    redisAtomic long long steal_count; /* batches stolen from others */
 } swapThread;
 
 int swapThreadsInit();
@@ -1267,6 +1418,7 @@ typedef struct RIO {
         sds *rawkeys;
         sds *rawvals;
         sds nextseek; /* own */
+        size_t count; /* keys counted if ROCKS_ITERATE_COUNT_ONLY */
     } iterate;
 	};
   sds err;
@@ -1282,6 +1434,8 @@ typedef struct RIO {
 #define ROCKS_ITERATE_HIGH_BOUND_EXCLUDE (1<<3)
 #define ROCKS_ITERATE_DISABLE_CACHE (1<<4)
 #define ROCKS_ITERATE_PREFIX_MATCH (1<<5)
+#define ROCKS_ITERATE_COUNT_ONLY (1<<6) /* only count keys, limit ignored */
+#define ROCKS_ITERATE_META_PREFIX (1<<7) /* only meta keys prefixed by end's key */
 
 void RIOInitGet(RIO *rio, int numkeys, int *cfs, sds *rawkeys);
 void RIOInitPut(RIO *rio, int numkeys, int *cfs, sds *rawkeys, sds *rawvals);
@@ -1328,11 +1482,12 @@ void RIOBatchUpdateStatsDataNotFound(RIOBatch *rios);
 #define SWAP_BATCH_FLUSH_THREAD_SWITCH  3
 #define SWAP_BATCH_FLUSH_INTENT_SWITCH  4
 #define SWAP_BATCH_FLUSH_BEFORE_SLEEP   5
-#define SWAP_BATCH_FLUSH_TYPES          6
+#define SWAP_BATCH_FLUSH_PRIORITY_SWITCH 6
+#define SWAP_BATCH_FLUSH_TYPES          7
 
 static inline const char *swapBatchFlushTypeName(int type) {
     const char *name = "?";
-    const char *names[] = {"FORCE_FLUSH", "REACH_LIMIT", "UTILS_TYPE", "THREAD_SWITCH", "INTENT_SWITCH", "BEFORE_SLEEP"};
+    const char *names[] = {"FORCE_FLUSH", "REACH_LIMIT", "UTILS_TYPE", "THREAD_SWITCH", "INTENT_SWITCH", "BEFORE_SLEEP", "PRIORITY_SWITCH"};
     if (type >= 0 && (size_t)type < sizeof(names)/sizeof(char*))
         name = names[type];
     return name;
@@ -1351,6 +1506,7 @@ typedef struct swapBatchCtx {
   swapRequestBatch *batch;
   int thread_idx;
   int cmd_intention;
+  int priority;
 } swapBatchCtx;
 
 swapBatchCtx *swapBatchCtxNew();
@@ -1550,6 +1706,8 @@ static inline int evictResultIsFreed(int evict_result) {
 
 typedef struct swapEvictionStat {
     long long evict_result[EVICT_RESULT_TYPES];
+    long long freed_bytes; /* estimated bytes of keys freed without IO */
+    long long swapped_bytes; /* estimated bytes of keys swapped out */
 } swapEvictionStat;
 
 typedef struct swapEvictionCtx {
@@ -1596,6 +1754,7 @@ size_t ctrip_getMemoryToFree(size_t mem_used);
 void ctrip_performEvictionStart(swapEvictKeysCtx *sectx);
 int ctrip_performEvictionLoopStartShouldBreak(swapEvictKeysCtx *sectx);
 size_t performEvictionSwapSelectedKey(swapEvictKeysCtx *sectx, redisDb *db, robj *keyobj);
+int ctrip_evictionPoolCandidateScore(int dbid, sds key, robj *o, unsigned long long *idle);
 int ctrip_performEvictionLoopCheckShouldBreak(swapEvictKeysCtx *sectx);
 void ctrip_performEvictionEnd(swapEvictKeysCtx *sectx);
 static inline int ctrip_performEvictionLoopCheckInterval(int keys_freed) {
@@ -1661,6 +1820,7 @@ int submitExpireClientRequest(client *c, robj *key, int force);
 #define ROCKS_DIR_MAX_LEN 512
 #define ROCKS_DATA "data.rocks"
 #define ROCKS_DISK_HEALTH_DETECT_FILE "disk_health_detect"
+#define ROCKS_COLD_FILTER_SNAPSHOT_FILE "cold_filter.snapshot"
 
 typedef struct rocksdbCFInternalStats {
   char* rocksdb_stats_cache;
@@ -1684,6 +1844,51 @@ typedef struct swapData4RocksdbFlush {
 int parseCfNames(const char *cfnames, rocksdb_column_family_handle_t *handles[CF_COUNT], const char *names[CF_COUNT+1]);
 int swapShouldFlushMeta();
 
+/* Rocksdb key format: dbid|keylen prefix of meta/data/score keys. */
+#define SWAP_KEY_FORMAT_LEGACY 0 /* 4 bytes host-endian dbid & keylen */
+#define SWAP_KEY_FORMAT_COMPACT 1 /* order preserving varint dbid & keylen */
+#define SWAP_KEY_FORMAT_TYPES 2
+#define SWAP_KEY_FORMAT_NONE -1 /* detect: db not exists or is empty */
+#define SWAP_KEY_FORMAT_ERR -2 /* detect: failed to open or read db */
+
+/* Key format marker saved in meta cf, never prefixes a valid key of either
+ * format: 0xff is not a compact varint head, and 0xffffffff is dbid -1 in
+ * legacy format (whatever host endian is). */
+#define SWAP_KEY_FORMAT_MARKER "\xff\xff\xff\xff"
+#define SWAP_KEY_FORMAT_MARKER_LEN 4
+
+static inline const char *swapKeyFormatName(int format) {
+    const char *name = "?";
+    const char *names[] = {"legacy", "compact"};
+    if (format >= 0 && (size_t)format < sizeof(names)/sizeof(char*))
+        name = names[format];
+    return name;
+}
+
+/* Rocksdb block cache */
+#define ROCKSDB_BLOCK_CACHE_SEPARATE 0 /* data/score cf share one LRU, meta cf owns another. */
+#define ROCKSDB_BLOCK_CACHE_SHARED 1 /* all cfs share one LRU. */
+#define ROCKSDB_BLOCK_CACHE_HYPER_CLOCK 2 /* all cfs share one HyperClockCache. */
+
+static inline const char *rocksdbBlockCacheTypeName(int type) {
+    const char *name = "?";
+    const char *names[] = {"separate", "shared", "hyper-clock"};
+    if (type >= 0 && (size_t)type < sizeof(names)/sizeof(char*))
+        name = names[type];
+    return name;
+}
+
+typedef struct rocksdbBlockCacheStat {
+    redisAtomic long long hit;
+    redisAtomic long long miss;
+} rocksdbBlockCacheStat;
+
+/* Values got as pinnable slices, copied into rawvals (sds) once. */
+typedef struct rocksdbPinnedGetStat {
+    redisAtomic long long count;
+    redisAtomic long long bytes;
+} rocksdbPinnedGetStat;
+
 /* Rocksdb engine */
 typedef struct rocks {
     rocksdb_t *db;
@@ -1691,6 +1896,8 @@ typedef struct rocks {
     rocksdb_block_based_table_options_t *block_opts[CF_COUNT];
     rocksdb_column_family_handle_t *cf_handles[CF_COUNT];
     rocksdb_compactionfilterfactory_t *cf_compactionfilterfatorys[CF_COUNT];
+    rocksdb_cache_t *data_block_cache; /* shared by data & score cf, also by meta cf unless separate. */
+    rocksdb_cache_t *meta_block_cache; /* NULL if meta cf uses data_block_cache. */
     rocksdb_options_t *db_opts;
     rocksdb_readoptions_t *ropts;
     rocksdb_writeoptions_t *wopts;
@@ -1729,6 +1936,7 @@ int setFilterState(filterState state);
 filterState getFilterState();
 rocksdb_compactionfilterfactory_t* createDataCfCompactionFilterFactory();
 rocksdb_compactionfilterfactory_t* createScoreCfCompactionFilterFactory();
+rocksdb_compactionfilterfactory_t* createExpireCfCompactionFilterFactory();
 
 int rocksInit(void);
 void rocksRelease(void);
@@ -1738,6 +1946,10 @@ void rocksReleaseCheckpoint(void);
 void rocksReleaseSnapshot(void);
 int rocksCreateSnapshot(void);
 int readCheckpointDirFromPipe(int pipe);
+int rmdirRecursive(const char *path);
+sds rocksCheckpointStageDir(void);
+int rocksCheckpointStageInit(void);
+int rocksInstallCheckpoint(void);
 struct rocksdbMemOverhead *rocksGetMemoryOverhead();
 void rocksFreeMemoryOverhead(struct rocksdbMemOverhead *mh);
 sds genRocksdbInfoString(sds info);
@@ -1749,6 +1961,9 @@ char *rocksdbVersion(void);
 
 /* Repl */
 int submitReplClientRequests(client *c);
+void replWorkerClientsTrim(void);
+int replClientAppliedAheadCount(client *c);
+void replClientFinishDispatchedCommands(client *c);
 sds genSwapReplInfoString(sds info);
 
 /* Swap */
@@ -1857,10 +2072,14 @@ typedef struct swapHitStat {
     redisAtomic long long stat_swapin_data_not_found_count;
     redisAtomic long long stat_absent_subkey_query_count;
     redisAtomic long long stat_absent_subkey_filt_count;
+    redisAtomic long long stat_pipeline_prefetch_cmd_count;
+    redisAtomic long long stat_pipeline_prefetch_key_count;
+    redisAtomic long long stat_evict_subkey_kept_count;
+    redisAtomic long long stat_evict_subkey_swapin_avoided_count;
 } swapHitStat;
 
 static inline int isSwapHitStatKeyRequest(keyRequest *kr) {
-    return kr && kr->cmd_intention == SWAP_IN &&
+    return kr && kr->cmd_intention == SWAP_IN && !kr->prefetch &&
         !isMetaScanRequest(kr->cmd_intention_flags);
 }
 
@@ -1871,6 +2090,9 @@ typedef struct rorStat {
     struct swapStat *swap_stats; /* array of swap stats (one for each swap type). */
     struct swapStat *rio_stats; /* array of rio stats (one for each rio type). */
     struct compactionFilterStat *compaction_filter_stats; /* array of compaction filter stats (one for each column family). */
+    struct swapPriorityStat *priority_stats; /* array of swap priority stats (one for each priority class). */
+    struct rocksdbBlockCacheStat *block_cache_stats; /* array of block cache stats (one for each column family). */
+    struct rocksdbPinnedGetStat *pinned_get_stats; /* array of pinned get stats (one for each column family). */
 } rorStat;
 
 void initStatsSwap(void);
@@ -1905,39 +2127,62 @@ sds genSwapUnblockInfoString(sds info);
 /* Rocks iter thread */
 #define ITER_BUFFER_CAPACITY_DEFAULT 4096
 #define ITER_NOTIFY_BATCH 32
+#define ITER_SPIN_MAX 1024 /* spins before parking on cond */
 
 typedef struct iterResult {
     int cf;
-    sds rawkey;
+    sds rawkey; /* owned by slot and reused by producer */
     unsigned char rdbtype;
-    sds rawval;
+    sds rawval; /* moved to consumer */
 } iterResult;
 
+/* Single producer(io thread) single consumer ring: producer publishes
+ * buffered_count after a batch of slots filled, consumer publishes
+ * processed_count after slot consumed. Both spin for a while before
+ * parking on cond, the other side signals only if peer parked. */
 typedef struct bufferedIterCompleteQueue {
     int buffer_capacity;
     iterResult *buffered;
-    int iter_finished;
-    int64_t buffered_count;
-    int64_t processed_count;
-    pthread_mutex_t buffer_lock;
+    redisAtomic int iter_finished;
+    redisAtomic int64_t buffered_count;
+    redisAtomic int64_t processed_count;
+    redisAtomic int consumer_parked;
+    redisAtomic int producer_parked;
+    pthread_mutex_t buffer_lock; /* only used to park & unpark. */
     pthread_cond_t ready_cond;
     pthread_cond_t vacant_cond;
+    long long consumer_park_count;
+    long long producer_park_count;
 } bufferedIterCompleteQueue;
 
+/* Rocksdb (checkpoint or live) that iterators read from, could be shared by
+ * multiple range iterators so that checkpoint opened only once. */
+typedef struct rocksIterSource {
+    struct rocks *rocks;
+    rocksdb_t *db; /* ref: checkpoint_db or rocks->db */
+    rocksdb_column_family_handle_t *cf_handles[CF_COUNT];
+    rocksdb_t* checkpoint_db;
+} rocksIterSource;
+
+rocksIterSource *rocksCreateIterSource(struct rocks *rocks);
+void rocksReleaseIterSource(rocksIterSource *source);
+sds *rocksIterSourceSplitDb(rocksIterSource *source, int dbid, int nranges, int *pnbounds);
+
 typedef struct rocksIter{
     redisDb *db;
     struct rocks *rocks;
     pthread_t io_thread;
     bufferedIterCompleteQueue *buffered_cq;
-    rocksdb_column_family_handle_t *cf_handles[CF_COUNT];
+    rocksIterSource *source;
+    int own_source; /* source created by and released with iter */
     rocksdb_iterator_t *data_iter;
     rocksdb_iterator_t *meta_iter;
-    rocksdb_t* checkpoint_db;
     sds data_endkey;
     sds meta_endkey;
 } rocksIter;
 
 rocksIter *rocksCreateIter(struct rocks *rocks, redisDb *db);
+rocksIter *rocksCreateRangeIter(rocksIterSource *source, redisDb *db, MOVE sds start, MOVE sds end);
 int rocksIterSeekToFirst(rocksIter *it);
 int rocksIterNext(rocksIter *it);
 void rocksIterCfKeyTypeValue(rocksIter *it, int *cf, sds *rawkey, unsigned char *type, sds *rawval);
@@ -1954,6 +2199,7 @@ void rocksIterGetError(rocksIter *it, char **error);
 #define DEFAULT_LIST_ELE_SIZE 128
 #define DEFAULT_ZSET_MEMBER_COUNT 16
 #define DEFAULT_ZSET_MEMBER_SIZE 128
+#define DEFAULT_STREAM_NODE_SIZE 4096
 #define DEFAULT_KEY_SIZE 48
 
 typedef enum swapRdbSaveErrType {
@@ -1969,6 +2215,9 @@ void receiveSwapChildErrs(void);
 void swapLoadCommand(client *c);
 int tryLoadKey(redisDb *db, robj *key, int oom_sensitive);
 
+/* pipeline prefetch */
+void swapPrefetchPipeline(client *c);
+
 /* result that decoded from current rocksIter value */
 typedef struct decodedResult {
   int cf;
@@ -2034,6 +2283,54 @@ typedef struct rdbSaveRocksStats {
     long long save_ok;
 } rdbSaveRocksStats;
 
+#define SWAP_RDB_SAVE_THREADS_MAX 16
+
+#define RDB_SAVE_RANGE_STATE_NONE 0
+#define RDB_SAVE_RANGE_STATE_SAVING 1
+#define RDB_SAVE_RANGE_STATE_DONE 2
+#define RDB_SAVE_RANGE_STATE_ERR 3
+
+/* Progress of each key range saved by bgsave child, allocated in shared
+ * memory so that parent could report it in INFO. */
+typedef struct rdbSaveRangeStat {
+    redisAtomic int state;
+    redisAtomic long long keys;
+    redisAtomic long long bytes;
+} rdbSaveRangeStat;
+
+typedef struct rdbSaveRangesStat {
+    redisAtomic int dbid;
+    redisAtomic int nranges;
+    rdbSaveRangeStat ranges[SWAP_RDB_SAVE_THREADS_MAX];
+} rdbSaveRangesStat;
+
+rdbSaveRangesStat *rdbSaveRangesStatCreate(void);
+sds genSwapRdbSaveInfoString(sds info);
+
+/* Physical full resync: cold keys are shipped as rocks checkpoint files
+ * (RDB_OPCODE_ROCKS_FILE) ahead of hot/warm keys, replica installs them as
+ * its rocks data instead of transcoding keys one by one. */
+#define ROCKS_CHECKPOINT_CHUNK_SIZE (1024*1024)
+#define ROCKS_CHECKPOINT_STAGE_SUFFIX ".checkpoint"
+
+#define ROCKS_CHECKPOINT_SHIP_NONE 0
+#define ROCKS_CHECKPOINT_SHIP_INPROGRESS 1
+#define ROCKS_CHECKPOINT_SHIP_DONE 2
+#define ROCKS_CHECKPOINT_SHIP_ERR 3
+
+typedef struct rocksCheckpointShipStat {
+    redisAtomic int state;
+    redisAtomic long long files;
+    redisAtomic long long bytes;
+    redisAtomic long long start_time; /* ms */
+    redisAtomic long long update_time; /* ms */
+} rocksCheckpointShipStat;
+
+rocksCheckpointShipStat *rocksCheckpointShipStatCreate(int shared);
+int rdbSaveRocksCheckpoint(rio *rdb);
+int rdbLoadRocksCheckpointFile(rio *rdb);
+sds genSwapCheckpointInfoString(sds info);
+
 /* rdb save */
 int rdbSaveRocks(rio *rdb, int *error, redisDb *db, int rdbflags);
 int rdbSaveKeyHeader(rio *rdb, robj *key, robj *evict, unsigned char rdbtype, long long expiretime);
@@ -2043,10 +2340,12 @@ int rdbKeySaveStart(struct rdbKeySaveData *keydata, rio *rdb);
 int rdbKeySave(struct rdbKeySaveData *keydata, rio *rdb, decodedData *d);
 int rdbKeySaveEnd(struct rdbKeySaveData *keydata, rio *rdb, int save_result);
 void wholeKeySaveInit(rdbKeySaveData *keydata);
+int chunkedStringSaveInit(rdbKeySaveData *save, uint64_t version, const char *extend, size_t extlen);
 int hashSaveInit(rdbKeySaveData *save, uint64_t version, const char *extend, size_t extlen);
 int setSaveInit(rdbKeySaveData *save, uint64_t version, const char *extend, size_t extlen);
 int listSaveInit(rdbKeySaveData *save, uint64_t version, const char *extend, size_t extlen);
 int zsetSaveInit(rdbKeySaveData *save, uint64_t version, const char *extend, size_t extlen);
+int streamSaveInit(rdbKeySaveData *save, uint64_t version, const char *extend, size_t extlen);
 
 /* Rdb load */
 /* RDB_LOAD_ERR_*: [1 +inf), SWAP_ERR_RDB_LOAD_*: (-inf -500] */
@@ -2055,6 +2354,72 @@ int zsetSaveInit(rdbKeySaveData *save, uint64_t version, const char *extend, siz
 #define RDB_LOAD_BATCH_COUNT 50
 #define RDB_LOAD_BATCH_CAPACITY  (4*1024*1024)
 
+/* Bulk rdb load: instead of put through swap threads, pairs fed are
+ * buffered and handed to ingest threads, which sort and write each buffer
+ * into one run file per cf. Once rdb loaded, ingest threads merge runs
+ * range by range (split keys sampled from first buffer) into sst files of
+ * disjoint key ranges, which then get ingested. Later pair wins for
+ * duplicated key, same as put. */
+#define RDB_LOAD_INGEST_THREADS_MAX 16
+#define RDB_LOAD_INGEST_BUFFER_INIT_COUNT 1024
+#define RDB_LOAD_INGEST_RANGES_PER_THREAD 4
+#define RDB_LOAD_INGEST_RANGE_SAMPLES 64
+#define RDB_LOAD_INGEST_YIELD_MS 100
+#define RDB_LOAD_INGEST_DIR_SUFFIX ".ingest"
+
+typedef struct rdbLoadIngestBuffer {
+  long long seq;
+  size_t count;
+  size_t capacity;
+  size_t memory;
+  int *cfs;
+  sds *rawkeys;
+  sds *rawvals;
+  sds files[CF_COUNT]; /* run file of each cf, NULL if no pair of that cf. */
+  off_t *offsets[CF_COUNT]; /* start offset of each key range in run file. */
+  int refs[CF_COUNT]; /* range merges not yet done with run file. */
+  long long file_size;
+  int error;
+} rdbLoadIngestBuffer;
+
+typedef struct rdbLoadIngestMerge {
+  int cf;
+  int range;
+  list *ssts; /* sst files merged, sorted and disjoint. */
+  int error;
+} rdbLoadIngestMerge;
+
+typedef struct rdbLoadIngestCtx {
+  sds dir;
+  long long seq;
+  rdbLoadIngestBuffer *buffer; /* buffer being fed by main thread. */
+  size_t buffer_size;
+  int nthreads;
+  pthread_t threads[RDB_LOAD_INGEST_THREADS_MAX];
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  list *pending; /* buffers waiting for ingest threads. */
+  list *written; /* buffers with run files written. */
+  int inflight; /* buffers pending or being written. */
+  int stop;
+  sds *splits[CF_COUNT]; /* split keys of each cf, nranges-1 of them. */
+  int nranges[CF_COUNT];
+  rdbLoadIngestBuffer **bufs; /* written buffers in feed order. */
+  size_t nbufs;
+  rdbLoadIngestMerge *merges; /* cf by cf, range by range. */
+  int nmerges;
+  int merge_next; /* next merge to be picked by ingest threads. */
+  int merge_inflight; /* merges not yet done. */
+  long long keys;
+  long long start_time;
+  long long last_yield;
+} rdbLoadIngestCtx;
+
+rdbLoadIngestCtx *rdbLoadIngestCtxNew(void);
+void rdbLoadIngestCtxFree(rdbLoadIngestCtx *ctx);
+void rdbLoadIngestFeed(rdbLoadIngestCtx *ctx, int cf, MOVE sds rawkey, MOVE sds rawval);
+int rdbLoadIngestFinish(rdbLoadIngestCtx *ctx);
+
 typedef struct ctripRdbLoadCtx {
   size_t errors;
   size_t idx;
@@ -2067,10 +2432,12 @@ typedef struct ctripRdbLoadCtx {
     sds *rawkeys;
     sds *rawvals;
   } batch;
+  rdbLoadIngestCtx *ingest; /* NULL if bulk load not enabled. */
 } ctripRdbLoadCtx;
 
 void evictStartLoading(void);
 void evictStopLoading(int success);
+int ctripRdbLoadIngest(void);
 
 struct rdbKeyLoadData;
 
@@ -2125,6 +2492,7 @@ void setLoadInit(rdbKeyLoadData *load);
 void listLoadInit(rdbKeyLoadData *load);
 
 void zsetLoadInit(rdbKeyLoadData *load);
+void streamLoadInit(rdbKeyLoadData *load);
 int rdbLoadLenVerbatim(rio *rdb, sds *verbatim, int *isencoded, unsigned long long *lenptr);
 
 /* persist load fix */
@@ -2154,20 +2522,22 @@ typedef struct loadFixStats {
 sds loadFixStatsDump(loadFixStats *stats);
 
 /* absent cache */
-typedef struct absentKeyMapEntry {
-  dict *subkeys;
-  listNode *ln;
-} absentKeyMapEntry;
-
-typedef struct absentListEntry {
-  sds key; /* ref */
-  sds subkey; /* ref */
-} absentListEntry;
+typedef struct absentSlot {
+  uint64_t fp; /* fingerprint of key or key+subkey, 0 if slot empty. */
+  uint32_t keytag; /* high 32 bits of key hash, locates generation. */
+  uint32_t gen:30; /* generation of key when subkey cached. */
+  uint32_t ref:1; /* CLOCK reference bit. */
+  uint32_t subkey:1;
+} absentSlot;
 
 typedef struct absentCache {
   size_t capacity;
-  dict *map;
-  list *list;
+  size_t count;
+  size_t nslots; /* power of 2 */
+  size_t hand; /* CLOCK hand */
+  absentSlot *slots;
+  size_t ngens; /* power of 2 */
+  uint32_t *gens; /* key generations */
 } absentCache;
 
 absentCache *absentCacheNew(size_t capacity);
@@ -2179,6 +2549,37 @@ int absentCacheGetKey(absentCache *absent, sds key);
 int absentCacheGetSubkey(absentCache *absent, sds key, sds subkey);
 void absentCacheSetCapacity(absentCache *absent, size_t capacity);
 
+/* subkey access tracker */
+#define SUBKEY_ACCESS_TRACKER_BITS (1<<20)
+
+typedef struct subkeyAccessTracker {
+  size_t nbits; /* power of 2 */
+  size_t nref;
+  size_t nkept;
+  unsigned char *ref; /* CLOCK reference bits of accessed subkeys. */
+  unsigned char *kept; /* subkeys skipped by evict because referenced. */
+} subkeyAccessTracker;
+
+subkeyAccessTracker *subkeyAccessTrackerNew(size_t nbits);
+void subkeyAccessTrackerFree(subkeyAccessTracker *tracker);
+void subkeyAccessTrackerReset(subkeyAccessTracker *tracker);
+int subkeyAccessTrackerTouch(subkeyAccessTracker *tracker, int dbid, sds key, sds subkey, int hit);
+int subkeyAccessTrackerEvictable(subkeyAccessTracker *tracker, int dbid, sds key, sds subkey);
+size_t subkeyAccessTrackerMemoryUsage(subkeyAccessTracker *tracker);
+
+void swapDataTouchSubkeys(swapData *data, struct keyRequest *req, unsigned long (*length)(const robj *value), int (*exists)(robj *value, sds subkey));
+
+typedef struct evictKeptSubkeys {
+  int num;
+  int capacity;
+  robj **subkeys;
+  size_t *memory;
+} evictKeptSubkeys;
+
+void evictKeptSubkeysInit(evictKeptSubkeys *kept, size_t candidates, size_t count);
+int evictKeptSubkeysKeep(evictKeptSubkeys *kept, swapData *data, robj *subkey, size_t memory);
+int evictKeptSubkeysDeinit(evictKeptSubkeys *kept, robj **subkeys, int *num, size_t count, unsigned long long *evict_memory);
+
 
 /* cold keys filter */
 #define COLDFILTER_FILT_BY_CUCKOO_FILTER 1
@@ -2199,8 +2600,13 @@ typedef struct coldFilter {
   absentCache *absents;
   cuckooFilter *filter;
   swapCuckooFilterStat filter_stat;
+  unsigned long long version; /* bumped when key added */
 } coldFilter;
 
+#define COLDFILTER_PROBE_NONE 0
+#define COLDFILTER_PROBE_ABSENT 1
+#define COLDFILTER_PROBE_MAYEXIST 2
+
 coldFilter *coldFilterCreate();
 void coldFilterDestroy(coldFilter *filter);
 void coldFilterInit(coldFilter *filter);
@@ -2210,11 +2616,16 @@ void coldFilterAddKey(coldFilter *filter, sds key);
 void coldFilterDeleteKey(coldFilter *filter, sds key);
 void coldFilterKeyNotFound(coldFilter *filter, sds key);
 int coldFilterMayContainKey(coldFilter *filter, sds key, int *filt_by);
+void coldFilterMayContainKeys(coldFilter *filter, int nkeys, const char **keys, size_t *klens, int *probes);
+int coldFilterMayContainKeyProbed(coldFilter *filter, sds key, int probe, unsigned long long version, int *filt_by);
 
 void coldFilterSubkeyAdded(coldFilter *filter, sds key);
 void coldFilterSubkeyNotFound(coldFilter *filter, sds key, sds subkey);
 int coldFilterMayContainSubkey(coldFilter *filter, sds key, sds subkey);
 
+int coldFiltersSaveSnapshot(void);
+int coldFiltersLoadSnapshot(void);
+
 /* Util */
 
 #define ROCKS_KEY_FLAG_NONE 0x0
@@ -2229,6 +2640,8 @@ sds rocksEncodeDataRangeStartKey(redisDb *db, sds key, uint64_t version);
 sds rocksEncodeDataRangeEndKey(redisDb *db, sds key, uint64_t version);
 #define rocksEncodeDataScanPrefix(db,key,version) rocksEncodeDataRangeStartKey(db,key,version)
 int rocksDecodeDataKey(const char *raw, size_t rawlen, int *dbid, const char **key, size_t *keylen, uint64_t *version, const char **subkey, size_t *subkeylen);
+size_t rocksDecodeDataKeyPrefixLen(const char *raw, size_t rawlen);
+sds rocksTranscodeKey(int from, int to, const char *raw, size_t rawlen);
 sds rocksEncodeMetaVal(int object_type, long long expire, uint64_t version, sds extend);
 int rocksDecodeMetaVal(const char* raw, size_t rawlen, int *object_type, long long *expire, uint64_t *version, const char **extend, size_t *extend_len);
 sds rocksEncodeValRdb(robj *value);
@@ -2239,6 +2652,8 @@ sds encodeMetaScanKey(unsigned long cursor, int limit, sds seek);
 int decodeMetaScanKey(sds meta_scan_key, unsigned long *cursor, int *limit, const char **seek, size_t *seeklen);
 sds rocksEncodeDbRangeStartKey(int dbid);
 sds rocksEncodeDbRangeEndKey(int dbid);
+sds rocksEncodeExpireKey(int dbid, long long expire, sds key);
+int rocksDecodeExpireKey(const char *raw, size_t rawlen, int *dbid, long long *expire, const char **key, size_t *keylen);
 
 #define sizeOfDouble (BYTE_ORDER == BIG_ENDIAN? sizeof(double):8)
 int encodeDouble(char* buf, double value);
@@ -2439,12 +2854,16 @@ int swapFilterTest(int argc, char **argv, int accurate);
 int swapListMetaTest(int argc, char *argv[], int accurate);
 int swapListDataTest(int argc, char *argv[], int accurate);
 int swapListUtilsTest(int argc, char *argv[], int accurate);
+int swapDataStreamTest(int argc, char *argv[], int accurate);
 int swapAbsentTest(int argc, char *argv[], int accurate);
 int lruCacheTest(int argc, char *argv[], int accurate);
 int swapRIOTest(int argc, char *argv[], int accurate);
 int swapBatchTest(int argc, char *argv[], int accurate);
 int cuckooFilterTest(int argc, char *argv[], int accurate);
 int swapPersistTest(int argc, char *argv[], int accurate);
+int swapIngestTest(int argc, char *argv[], int accurate);
+int swapPrefetchTest(int argc, char *argv[], int accurate);
+int swapSubkeyAccessTest(int argc, char *argv[], int accurate);
 
 int swapTest(int argc, char **argv, int accurate);
 
@@ -0,0 +1,292 @@
+/* Copyright (c) 2023, ctrip.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "ctrip_swap.h"
+
+/* Subkey access tracker samples recently accessed subkeys of big objects,
+ * so that evicting big object in steps swaps out cold subkeys first and
+ * subkeys needed by next command stay in memory.
+ *
+ * Subkeys are hashed (with dbid and key) into two bitmaps shared by all
+ * objects: ref holds CLOCK reference bits set on access, kept marks
+ * subkeys that evict skipped (and cleared reference bit, second chance).
+ * A kept subkey accessed while still in memory is a partial swap-in
+ * avoided. Bitmaps are cleared all at once when half of the bits are set,
+ * collisions only make evict keep some cold subkeys a bit longer. */
+
+#define SUBKEY_ACCESS_MIN_BITS 64
+
+static inline uint64_t subkeyAccessHash(int dbid, sds key, sds subkey) {
+    uint64_t keyhash = dictGenHashFunction(key,sdslen(key));
+    uint64_t subhash = dictGenHashFunction(subkey,sdslen(subkey));
+    uint64_t h = keyhash ^ (subhash*0x9e3779b97f4a7c15ULL) ^ (uint64_t)dbid;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline int subkeyAccessBitTest(unsigned char *bitmap, size_t i) {
+    return (bitmap[i>>3] >> (i&7)) & 1;
+}
+
+static inline void subkeyAccessBitSet(unsigned char *bitmap, size_t i) {
+    bitmap[i>>3] |= 1<<(i&7);
+}
+
+static inline void subkeyAccessBitClear(unsigned char *bitmap, size_t i) {
+    bitmap[i>>3] &= ~(1<<(i&7));
+}
+
+subkeyAccessTracker *subkeyAccessTrackerNew(size_t nbits) {
+    subkeyAccessTracker *tracker = zcalloc(sizeof(subkeyAccessTracker));
+    size_t n = SUBKEY_ACCESS_MIN_BITS;
+    while (n < nbits) n <<= 1;
+    tracker->nbits = n;
+    tracker->ref = zcalloc(n/8);
+    tracker->kept = zcalloc(n/8);
+    return tracker;
+}
+
+void subkeyAccessTrackerFree(subkeyAccessTracker *tracker) {
+    if (tracker == NULL) return;
+    zfree(tracker->ref);
+    zfree(tracker->kept);
+    zfree(tracker);
+}
+
+void subkeyAccessTrackerReset(subkeyAccessTracker *tracker) {
+    memset(tracker->ref,0,tracker->nbits/8);
+    memset(tracker->kept,0,tracker->nbits/8);
+    tracker->nref = 0;
+    tracker->nkept = 0;
+}
+
+/* Record access of subkey, hit if subkey is in memory. Returns 1 if hit
+ * subkey was kept by evict (partial swap-in avoided), otherwise 0. */
+int subkeyAccessTrackerTouch(subkeyAccessTracker *tracker, int dbid,
+        sds key, sds subkey, int hit) {
+    size_t i = subkeyAccessHash(dbid,key,subkey) & (tracker->nbits-1);
+    int avoided = 0;
+
+    if (subkeyAccessBitTest(tracker->kept,i)) {
+        subkeyAccessBitClear(tracker->kept,i);
+        tracker->nkept--;
+        avoided = hit;
+    }
+
+    if (!subkeyAccessBitTest(tracker->ref,i)) {
+        if (tracker->nref >= tracker->nbits/2) subkeyAccessTrackerReset(tracker);
+        subkeyAccessBitSet(tracker->ref,i);
+        tracker->nref++;
+    }
+
+    return avoided;
+}
+
+/* Returns 1 if subkey is cold and should be evicted, otherwise reference
+ * bit is cleared (second chance) and subkey marked kept. */
+int subkeyAccessTrackerEvictable(subkeyAccessTracker *tracker, int dbid,
+        sds key, sds subkey) {
+    size_t i = subkeyAccessHash(dbid,key,subkey) & (tracker->nbits-1);
+
+    if (!subkeyAccessBitTest(tracker->ref,i)) {
+        if (subkeyAccessBitTest(tracker->kept,i)) {
+            subkeyAccessBitClear(tracker->kept,i);
+            tracker->nkept--;
+        }
+        return 1;
+    }
+
+    subkeyAccessBitClear(tracker->ref,i);
+    tracker->nref--;
+    if (!subkeyAccessBitTest(tracker->kept,i)) {
+        if (tracker->nkept >= tracker->nbits/2) {
+            memset(tracker->kept,0,tracker->nbits/8);
+            tracker->nkept = 0;
+        }
+        subkeyAccessBitSet(tracker->kept,i);
+        tracker->nkept++;
+    }
+    return 0;
+}
+
+size_t subkeyAccessTrackerMemoryUsage(subkeyAccessTracker *tracker) {
+    return sizeof(subkeyAccessTracker) + tracker->nbits/4;
+}
+
+/* Sample access of subkeys requested by command, only subkeys of big
+ * objects (evicted in steps) tracked. Must be called in main thread. */
+void swapDataTouchSubkeys(swapData *data, struct keyRequest *req,
+        unsigned long (*length)(const robj *value),
+        int (*exists)(robj *value, sds subkey)) {
+    objectMeta *meta;
+    size_t len;
+
+    if (!server.swap_evict_track_subkey_access ||
+            server.swap_subkey_access_tracker == NULL) return;
+    if (req->type != KEYREQUEST_TYPE_SUBKEY || req->b.num_subkeys <= 0) return;
+    if (req->cmd_intention_flags & SWAP_IN_DEL) return;
+
+    meta = swapDataObjectMeta(data);
+    len = meta ? meta->len : 0;
+    if (data->value) len += length(data->value);
+    if (len <= (size_t)server.swap_evict_step_max_subkeys) return;
+
+    for (int i = 0; i < req->b.num_subkeys; i++) {
+        sds subkey = req->b.subkeys[i]->ptr;
+        int hit = data->value != NULL && exists(data->value,subkey);
+        if (subkeyAccessTrackerTouch(server.swap_subkey_access_tracker,
+                    data->db->id,data->key->ptr,subkey,hit)) {
+            atomicIncr(server.swap_hit_stats->stat_evict_subkey_swapin_avoided_count,1);
+        }
+    }
+}
+
+/* Evict skips recently accessed subkeys if there are more candidates than
+ * could be evicted in one step, skipped subkeys are kept aside to fill up
+ * the step if not enough cold subkeys found. At most count subkeys kept
+ * aside, so that at most 2*count candidates scanned. */
+void evictKeptSubkeysInit(evictKeptSubkeys *kept, size_t candidates,
+        size_t count) {
+    memset(kept,0,sizeof(evictKeptSubkeys));
+    if (!server.swap_evict_track_subkey_access ||
+            server.swap_subkey_access_tracker == NULL) return;
+    if (count == 0 || candidates <= count) return;
+    kept->capacity = count;
+    kept->subkeys = zmalloc(count*sizeof(robj*));
+    kept->memory = zmalloc(count*sizeof(size_t));
+}
+
+/* Returns 1 if subkey kept aside (ownership taken), 0 if it should be
+ * evicted. */
+int evictKeptSubkeysKeep(evictKeptSubkeys *kept, swapData *data,
+        robj *subkey, size_t memory) {
+    if (kept->num >= kept->capacity) return 0;
+    if (subkeyAccessTrackerEvictable(server.swap_subkey_access_tracker,
+                data->db->id,data->key->ptr,subkey->ptr)) return 0;
+    kept->subkeys[kept->num] = subkey;
+    kept->memory[kept->num] = memory;
+    kept->num++;
+    return 1;
+}
+
+/* Fill up evict step with kept subkeys, returns number of subkeys left in
+ * memory. */
+int evictKeptSubkeysDeinit(evictKeptSubkeys *kept, robj **subkeys,
+        int *num, size_t count, unsigned long long *evict_memory) {
+    int i, left = 0;
+
+    for (i = 0; i < kept->num; i++) {
+        if ((size_t)*num < count &&
+                *evict_memory < server.swap_evict_step_max_memory) {
+            subkeys[(*num)++] = kept->subkeys[i];
+            *evict_memory += kept->memory[i];
+        } else {
+            decrRefCount(kept->subkeys[i]);
+            left++;
+        }
+    }
+    if (left) atomicIncr(server.swap_hit_stats->stat_evict_subkey_kept_count,left);
+
+    zfree(kept->subkeys);
+    zfree(kept->memory);
+    memset(kept,0,sizeof(evictKeptSubkeys));
+    return left;
+}
+
+#ifdef REDIS_TEST
+
+int swapSubkeyAccessTest(int argc, char *argv[], int accurate) {
+    UNUSED(argc);
+    UNUSED(argv);
+    UNUSED(accurate);
+    int error = 0;
+
+    TEST("subkey-access: touch & evictable") {
+        sds key = sdsnew("key"), f1 = sdsnew("f1"), f2 = sdsnew("f2");
+        subkeyAccessTracker *tracker = subkeyAccessTrackerNew(1<<16);
+
+        test_assert(tracker->nbits == 1<<16);
+        /* cold subkey evictable, and no avoided swap-in */
+        test_assert(subkeyAccessTrackerEvictable(tracker,0,key,f1));
+        test_assert(subkeyAccessTrackerTouch(tracker,0,key,f1,1) == 0);
+        test_assert(tracker->nref == 1);
+        /* other db or other subkey not affected */
+        test_assert(subkeyAccessTrackerEvictable(tracker,1,key,f1));
+        test_assert(subkeyAccessTrackerEvictable(tracker,0,key,f2));
+        /* referenced subkey gets second chance */
+        test_assert(!subkeyAccessTrackerEvictable(tracker,0,key,f1));
+        test_assert(tracker->nref == 0 && tracker->nkept == 1);
+        test_assert(subkeyAccessTrackerEvictable(tracker,0,key,f1));
+        test_assert(tracker->nkept == 0);
+
+        /* kept subkey hit: swap-in avoided */
+        subkeyAccessTrackerTouch(tracker,0,key,f2,0);
+        test_assert(!subkeyAccessTrackerEvictable(tracker,0,key,f2));
+        test_assert(subkeyAccessTrackerTouch(tracker,0,key,f2,1) == 1);
+        test_assert(subkeyAccessTrackerTouch(tracker,0,key,f2,1) == 0);
+        /* kept subkey missed (swapped out meanwhile): not avoided */
+        test_assert(!subkeyAccessTrackerEvictable(tracker,0,key,f2));
+        test_assert(subkeyAccessTrackerTouch(tracker,0,key,f2,0) == 0);
+
+        sdsfree(key), sdsfree(f1), sdsfree(f2);
+        subkeyAccessTrackerFree(tracker);
+    }
+
+    TEST("subkey-access: reset when half referenced") {
+        sds key = sdsnew("key");
+        subkeyAccessTracker *tracker = subkeyAccessTrackerNew(1);
+
+        test_assert(tracker->nbits == SUBKEY_ACCESS_MIN_BITS);
+        for (int i = 0; i < 1000; i++) {
+            sds subkey = sdsfromlonglong(i);
+            subkeyAccessTrackerTouch(tracker,0,key,subkey,1);
+            test_assert(tracker->nref <= tracker->nbits/2);
+            sdsfree(subkey);
+        }
+        test_assert(tracker->nref > 0);
+        for (int i = 0; i < 1000; i++) {
+            sds subkey = sdsfromlonglong(i);
+            subkeyAccessTrackerTouch(tracker,0,key,subkey,1);
+            subkeyAccessTrackerEvictable(tracker,0,key,subkey);
+            test_assert(tracker->nkept <= tracker->nbits/2);
+            sdsfree(subkey);
+        }
+        subkeyAccessTrackerReset(tracker);
+        test_assert(tracker->nref == 0 && tracker->nkept == 0);
+
+        sdsfree(key);
+        subkeyAccessTrackerFree(tracker);
+    }
+
+    return error;
+}
+
+#endif
@@ -122,6 +122,8 @@ swapRequestBatch *swapRequestBatchNew() {
     reqs->count = 0;
     reqs->swap_queue_timer = 0;
     reqs->notify_queue_timer = 0;
+    reqs->priority = SWAP_PRIORITY_FOREGROUND;
+    reqs->dispatch_time = 0;
     return reqs;
 }
 
@@ -330,6 +332,7 @@ swapBatchCtx *swapBatchCtxNew() {
     batch_ctx->batch = swapRequestBatchNew();
     batch_ctx->thread_idx = -1;
     batch_ctx->cmd_intention = SWAP_UNSET;
+    batch_ctx->priority = SWAP_PRIORITY_FOREGROUND;
     return batch_ctx;
 }
 
@@ -345,6 +348,7 @@ void swapBatchCtxFree(swapBatchCtx *batch_ctx) {
 static inline swapRequestBatch *swapBatchCtxShift(swapBatchCtx *batch_ctx) {
     serverAssert(batch_ctx->batch != NULL);
     swapRequestBatch *reqs = batch_ctx->batch;
+    reqs->priority = batch_ctx->priority;
     batch_ctx->batch = swapRequestBatchNew();
     return reqs;
 }
@@ -392,12 +396,16 @@ void swapBatchCtxFeed(swapBatchCtx *batch_ctx, int flush,
         swapBatchCtxFlush(batch_ctx,SWAP_BATCH_FLUSH_THREAD_SWITCH);
     } else if (batch_ctx->cmd_intention != cmd_intention) {
         swapBatchCtxFlush(batch_ctx,SWAP_BATCH_FLUSH_INTENT_SWITCH);
+    } else if (batch_ctx->priority != req->priority) {
+        /* batch is scheduled by priority, so don't mix them. */
+        swapBatchCtxFlush(batch_ctx,SWAP_BATCH_FLUSH_PRIORITY_SWITCH);
     } else {
         /* no need to flush beforehand */
     }
 
     batch_ctx->thread_idx = thread_idx;
     batch_ctx->cmd_intention = cmd_intention;
+    batch_ctx->priority = req->priority;
 
     swapRequestBatchAppend(batch_ctx->batch,req);
 
@@ -39,6 +39,7 @@ struct SwapDataTypeItem {
     {"swap_set", CMD_SWAP_DATATYPE_SET},
     {"swap_zset", CMD_SWAP_DATATYPE_ZSET},
     {"swap_list", CMD_SWAP_DATATYPE_LIST},
+    {"swap_stream", CMD_SWAP_DATATYPE_STREAM},
     {NULL,0} /* Terminator. */
 };
 /* Given the category name the command returns the corresponding flag, or
@@ -98,6 +99,7 @@ void copyKeyRequest(keyRequest *dst, keyRequest *src) {
     dst->type = src->type;
     dst->swap_cmd = src->swap_cmd;
     dst->deferred = src->deferred;
+    dst->prefetch = src->prefetch;
     dst->trace = src->trace;
     dst->cmd_flags = src->cmd_flags;
 
@@ -124,6 +126,10 @@ void copyKeyRequest(keyRequest *dst, keyRequest *src) {
         dst->zs.reverse = src->zs.reverse;
         dst->zs.limit = src->zs.limit;
         break;
+    case KEYREQUEST_TYPE_STREAM:
+        dst->x.start = src->x.start;
+        dst->x.end = src->x.end;
+        break;
     default:
         break;
     }
@@ -143,6 +149,7 @@ void moveKeyRequest(keyRequest *dst, keyRequest *src) {
     dst->swap_cmd = src->swap_cmd;
     dst->trace = src->trace;
     dst->deferred = src->deferred;
+    dst->prefetch = src->prefetch;
     dst->cmd_flags = src->cmd_flags;
 
     switch (src->type) {
@@ -165,6 +172,10 @@ void moveKeyRequest(keyRequest *dst, keyRequest *src) {
         dst->zs.reverse = src->zs.reverse;
         dst->zs.limit = src->zs.limit;
         break;
+    case KEYREQUEST_TYPE_STREAM:
+        dst->x.start = src->x.start;
+        dst->x.end = src->x.end;
+        break;
     default:
         break;
     }
@@ -202,6 +213,8 @@ void keyRequestDeinit(keyRequest *key_request) {
             key_request->zs.rangespec = NULL;
         }
         break;
+    case KEYREQUEST_TYPE_STREAM:
+        break;
     default:
         break;
     }
@@ -261,6 +274,7 @@ keyRequest *getKeyRequestsAppendCommonResult(getKeyRequestsResult *result,
     key_request->dbid = dbid;
     key_request->trace = NULL;
     key_request->deferred = 0;
+    key_request->prefetch = 0;
     argRewriteRequestInit(key_request->list_arg_rewrite+0);
     argRewriteRequestInit(key_request->list_arg_rewrite+1);
     return key_request;
@@ -283,6 +297,7 @@ void getKeyRequestsAppendScoreResult(getKeyRequestsResult *result, int level,
     key_request->dbid = dbid;
     key_request->trace = NULL;
     key_request->deferred = 0;
+    key_request->prefetch = 0;
 }
 
 /* Note that key&subkeys ownership moved */
@@ -298,6 +313,7 @@ void getKeyRequestsAppendSubkeyResult(getKeyRequestsResult *result, int level,
     key_request->swap_cmd = NULL;
     key_request->trace = NULL;
     key_request->deferred = 0;
+    key_request->prefetch = 0;
 }
 
 inline void getKeyRequestsAttachSwapTrace(getKeyRequestsResult * result, swapCmdTrace *swap_cmd,
@@ -359,6 +375,13 @@ static void getSingleCmdKeyRequests(client *c, getKeyRequestsResult *result) {
     _getSingleCmdKeyRequests(c->db->id,c->cmd,c->argv,c->argc,result);
 }
 
+/* Key requests of single command not bound to client (no swap trace). */
+void getSingleCommandKeyRequests(int dbid, struct redisCommand *cmd,
+        robj **argv, int argc, getKeyRequestsResult *result) {
+    getKeyRequestsPrepareResult(result, MAX_KEYREQUESTS_BUFFER);
+    _getSingleCmdKeyRequests(dbid,cmd,argv,argc,result);
+}
+
 static inline int clientSwitchDb(client *c, int argidx) {
     long long dbid;
     if (getLongLongFromObject(c->argv[argidx],&dbid)) return C_ERR;
@@ -410,6 +433,14 @@ void getKeyRequests(client *c, getKeyRequestsResult *result) {
             for (int j = prev_keyrequest_num; j < result->num; j++) {
                 result->key_requests[j].list_arg_rewrite[0].mstate_idx = i;
                 result->key_requests[j].list_arg_rewrite[1].mstate_idx = i;
+                /* rank counted at swap time might be staled by previous
+                 * commands in transaction, swap in whole zset instead. */
+                result->key_requests[j].cmd_intention_flags &= ~SWAP_IN_RANK;
+                /* reply can't be streamed before exec, swap in instead. */
+                result->key_requests[j].cmd_intention_flags &= ~SWAP_IN_STREAM;
+                /* string might be modified by previous commands in
+                 * transaction, swap in whole string instead. */
+                result->key_requests[j].cmd_intention_flags &= ~SWAP_IN_PARTIAL;
             }
 
             if (c->cmd->proc == selectCommand) {
@@ -824,6 +855,32 @@ int getKeyRequestsLtrim(int dbid, struct redisCommand *cmd, robj **argv,
             result,1,2,3,1/*num_ranges*/,2,0,start-1,stop+1,-1);
     return 0;
 }
+
+/** string **/
+/* GETRANGE/SUBSTR: only chunks in range are read if string is chunked. */
+int getKeyRequestsGetrange(int dbid, struct redisCommand *cmd, robj **argv,
+        int argc, struct getKeyRequestsResult *result) {
+    long long start, end;
+    if (getLongLongFromObject(argv[2],&start) != C_OK) return -1;
+    if (getLongLongFromObject(argv[3],&end) != C_OK) return -1;
+    getKeyRequestsSingleKeyWithRanges(dbid,cmd,argv,argc,
+            result,1,-1,-1,1/*num_ranges*/,(long)start,(long)end);
+    return 0;
+}
+
+/* SETRANGE: offset and value carried as subkeys, so that chunks touched
+ * could be written by swap thread if string is chunked. */
+int getKeyRequestsSetrange(int dbid, struct redisCommand *cmd, robj **argv,
+        int argc, struct getKeyRequestsResult *result) {
+    return getKeyRequestsSingleKeyWithSubkeys(dbid,cmd,argv,argc,result,1,2,3,1);
+}
+
+/* APPEND: value carried as subkey, see SETRANGE. */
+int getKeyRequestsAppend(int dbid, struct redisCommand *cmd, robj **argv,
+        int argc, struct getKeyRequestsResult *result) {
+    return getKeyRequestsSingleKeyWithSubkeys(dbid,cmd,argv,argc,result,1,2,2,1);
+}
+
 /** zset **/
 int getKeyRequestsZAdd(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result) {
     int first_score = 2;
@@ -856,6 +913,11 @@ int getKeyRequestsZMScore(int dbid, struct redisCommand *cmd, robj **argv, int a
     return getKeyRequestsSingleKeyWithSubkeys(dbid, cmd, argv, argc, result, 1, 2, -1, 1);
 }
 
+/* ZRANK/ZREVRANK: swap in member only, rank counted in score cf. */
+int getKeyRequestsZrank(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result) {
+    return getKeyRequestsSingleKeyWithSubkeys(dbid, cmd, argv, argc, result, 1, 2, 2, 1);
+}
+
 #define ZMIN -1
 #define ZMAX 1
 int getKeyRequestsZpopGeneric(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result, int flags) {
@@ -990,6 +1052,120 @@ int getKeyRequestsZlexCount(int dbid, struct redisCommand *cmd, robj **argv, int
 int getKeyRequestsZremRangeByLex(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result) {
     return getKeyRequestsZrangeGeneric(dbid, cmd, argv, argc, result, ZRANGE_LEX, ZRANGE_DIRECTION_FORWARD);
 }
+/** stream **/
+/* Note that key ownership moved */
+void getKeyRequestsAppendStreamResult(getKeyRequestsResult *result, int level,
+        robj *key, streamID *start, streamID *end, int cmd_intention,
+        int cmd_intention_flags, uint64_t cmd_flags, int dbid) {
+    keyRequest *key_request = getKeyRequestsAppendCommonResult(result,level,
+            key,cmd_intention,cmd_intention_flags,cmd_flags,dbid);
+
+    key_request->type = KEYREQUEST_TYPE_STREAM;
+    key_request->x.start = *start;
+    key_request->x.end = *end;
+    key_request->swap_cmd = NULL;
+}
+
+static inline void streamIDSetEmptyRange(streamID *start, streamID *end) {
+    start->ms = UINT64_MAX, start->seq = UINT64_MAX;
+    end->ms = 0, end->seq = 0;
+}
+
+static inline void streamIDSetTailRange(streamID *start, streamID *end) {
+    start->ms = UINT64_MAX, start->seq = UINT64_MAX;
+    *end = *start;
+}
+
+/* Exclusive interval swaps the same nodes as inclusive one, invalid
+ * interval swaps no node (command replies error anyway). */
+static int getKeyRequestsStreamRange(int dbid, struct redisCommand *cmd,
+        robj *key, robj *startarg, robj *endarg, getKeyRequestsResult *result) {
+    int exclude;
+    streamID start, end;
+
+    if (streamParseIntervalIDOrReply(NULL,startarg,&start,&exclude,0) != C_OK ||
+            streamParseIntervalIDOrReply(NULL,endarg,&end,&exclude,UINT64_MAX) != C_OK) {
+        streamIDSetEmptyRange(&start,&end);
+    }
+
+    incrRefCount(key);
+    getKeyRequestsAppendStreamResult(result,REQUEST_LEVEL_KEY,key,&start,&end,
+            cmd->intention,cmd->intention_flags,cmd->flags,dbid);
+    return 0;
+}
+
+int getKeyRequestsXrange(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result) {
+    UNUSED(argc);
+    return getKeyRequestsStreamRange(dbid,cmd,argv[1],argv[2],argv[3],result);
+}
+
+int getKeyRequestsXrevrange(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result) {
+    UNUSED(argc);
+    return getKeyRequestsStreamRange(dbid,cmd,argv[1],argv[3],argv[2],result);
+}
+
+/* XADD: swap in tail node to append to, trimming swaps in whole stream. */
+int getKeyRequestsXadd(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result) {
+    int i;
+    streamID start, end;
+
+    for (i = 2; i < argc; i++) {
+        char *opt = argv[i]->ptr;
+        if (!strcasecmp(opt,"nomkstream")) continue;
+        if (!strcasecmp(opt,"maxlen") || !strcasecmp(opt,"minid")) {
+            incrRefCount(argv[1]);
+            getKeyRequestsAppendSubkeyResult(result,REQUEST_LEVEL_KEY,argv[1],
+                    0,NULL,cmd->intention,cmd->intention_flags,cmd->flags,dbid);
+            return 0;
+        }
+        break;
+    }
+
+    streamIDSetTailRange(&start,&end);
+    incrRefCount(argv[1]);
+    getKeyRequestsAppendStreamResult(result,REQUEST_LEVEL_KEY,argv[1],&start,&end,
+            cmd->intention,cmd->intention_flags,cmd->flags,dbid);
+    return 0;
+}
+
+/* XSETID: last valid id checked against tail node. */
+int getKeyRequestsXsetid(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result) {
+    streamID start, end;
+    UNUSED(argc);
+    streamIDSetTailRange(&start,&end);
+    incrRefCount(argv[1]);
+    getKeyRequestsAppendStreamResult(result,REQUEST_LEVEL_KEY,argv[1],&start,&end,
+            cmd->intention,cmd->intention_flags,cmd->flags,dbid);
+    return 0;
+}
+
+/* XREAD: swap in nodes after id, '$' only waits for new entries, which
+ * are served by XADD (tail node swapped in by XADD). */
+int getKeyRequestsXread(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result) {
+    int i, numkeys;
+    getKeysResult keys = GETKEYS_RESULT_INIT;
+
+    numkeys = xreadGetKeys(cmd,argv,argc,&keys);
+    getKeyRequestsPrepareResult(result,result->num+numkeys);
+    for (i = 0; i < numkeys; i++) {
+        streamID start, end;
+        robj *key = argv[keys.keys[i]], *idarg = argv[keys.keys[i]+numkeys];
+
+        if (!strcmp(idarg->ptr,"$") ||
+                streamParseIntervalIDOrReply(NULL,idarg,&start,NULL,0) != C_OK) {
+            streamIDSetEmptyRange(&start,&end);
+        } else {
+            end.ms = UINT64_MAX, end.seq = UINT64_MAX;
+        }
+
+        incrRefCount(key);
+        getKeyRequestsAppendStreamResult(result,REQUEST_LEVEL_KEY,key,&start,&end,
+                cmd->intention,cmd->intention_flags,cmd->flags,dbid);
+    }
+    getKeysFreeResult(&keys);
+    return 0;
+}
+
 /** geo **/
 int getKeyRequestsGeoAdd(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result) {
     int first_score = 2;
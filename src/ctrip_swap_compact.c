@@ -89,7 +89,7 @@ static inline void metaVersionFilterDestroy(void* mvfilter_) {
 }
 
 static unsigned char metaVersionFilterFilt(void* mvfilter_, int level, int cf, const char* rawkey,
-                                   size_t rawkey_length,
+                                   size_t rawkey_length, size_t value_length,
                                    int (*decodekey)(const char*, size_t , int* , const char**, size_t* ,uint64_t*)) {
     int dbid, result = 0;
     uint64_t key_version;
@@ -120,8 +120,13 @@ static unsigned char metaVersionFilterFilt(void* mvfilter_, int level, int cf, c
     int retval = decodekey(rawkey, rawkey_length, &dbid, &key, &key_len, &key_version);
     if (retval != 0) return 0;
 
-    /* Type is string*/
-    if (key_version == SWAP_VERSION_ZERO) return 0;
+    /* Type is string: whole key value is deleted explicitly, except that
+     * it's overwritten as empty when string turned chunked. */
+    if (key_version == SWAP_VERSION_ZERO) {
+        result = value_length == 0;
+        if (result) updateCompactionFiltSuccessCount(cf);
+        return result;
+    }
 
     if (server.swap_debug_compaction_filter_delay_micro > 0)
         usleep(server.swap_debug_compaction_filter_delay_micro);
@@ -165,7 +170,8 @@ static unsigned char metaVersionFilterFilt(void* mvfilter_, int level, int cf, c
     }
 
 end:
-    result = meta_version > key_version;
+    /* Chunks also obsolete if string turned whole key (version zero). */
+    result = meta_version > key_version || meta_version == SWAP_VERSION_ZERO;
     if (result) updateCompactionFiltSuccessCount(cf);
     sdsfree(meta_key);
     if (meta_val != NULL) sdsfree(meta_val);
@@ -192,11 +198,10 @@ static unsigned char dataFilterFilter(void* mvfilter, int level, const char* raw
                                    size_t* new_value_length,
                                    unsigned char* value_changed) {
     UNUSED(existing_value);
-    UNUSED(value_length);
     UNUSED(new_value);
     UNUSED(new_value_length);
     UNUSED(value_changed);
-    return metaVersionFilterFilt(mvfilter, level, DATA_CF,rawkey, rawkey_length, decodeDataVersion);
+    return metaVersionFilterFilt(mvfilter, level, DATA_CF,rawkey, rawkey_length, value_length, decodeDataVersion);
 }
 
 rocksdb_compactionfilter_t* createDataCfCompactionFilter(void *state, rocksdb_compactionfiltercontext_t *context) {
@@ -236,11 +241,10 @@ static unsigned char scoreFilterFilter(void* mvfilter, int level, const char* ra
                                    size_t* new_value_length,
                                    unsigned char* value_changed) {
     UNUSED(existing_value);
-    UNUSED(value_length);
     UNUSED(new_value);
     UNUSED(new_value_length);
     UNUSED(value_changed);
-    return metaVersionFilterFilt(mvfilter, level, SCORE_CF,rawkey, rawkey_length, decodeScoreVersion);
+    return metaVersionFilterFilt(mvfilter, level, SCORE_CF,rawkey, rawkey_length, value_length, decodeScoreVersion);
 }
 
 rocksdb_compactionfilter_t* createScoreCfCompactionFilter(void *state, rocksdb_compactionfiltercontext_t *context) {
@@ -260,6 +264,90 @@ rocksdb_compactionfilterfactory_t* createScoreCfCompactionFilterFactory() {
             createScoreCfCompactionFilter,scoreFilterFactoryName);
 }
 
+/* expire cf compaction filter: index entry is stale if meta of the key is
+ * gone or carries a different expire. Index entries are not deleted when
+ * key deleted or expire changed (previous expire not known when meta
+ * rewritten), scan expire cleans due ones on master, this filter cleans
+ * the rest (e.g. on replica, where scan expire never runs). */
+static const char* expireFilterName(void* arg) {
+  (void)arg;
+  return "expire_cf_filter";
+}
+
+static unsigned char expireFilterFilter(void* state, int level, const char* rawkey,
+                                   size_t rawkey_length,
+                                   const char* existing_value,
+                                   size_t value_length, char** new_value,
+                                   size_t* new_value_length,
+                                   unsigned char* value_changed) {
+    int dbid, object_type, result = 0;
+    long long expire, meta_expire;
+    uint64_t meta_version;
+    const char *key, *extend;
+    size_t key_len, extend_len, inflight_snapshot;
+    filterState fstate;
+    char *err = NULL;
+    sds meta_key, meta_val;
+    UNUSED(state);
+    UNUSED(existing_value);
+    UNUSED(value_length);
+    UNUSED(new_value);
+    UNUSED(new_value_length);
+    UNUSED(value_changed);
+
+    if (server.unixtime < (time_t)server.swap_compaction_filter_disable_until)
+        return 0;
+    atomicGet(filter_state, fstate);
+    if (fstate == FILTER_STATE_CLOSE) return 0;
+    atomicGet(server.inflight_snapshot, inflight_snapshot);
+    if (inflight_snapshot > 0) return 0;
+
+    updateCompactionFiltScanCount(EXPIRE_CF);
+    if (level <= server.swap_compaction_filter_skip_level) return 0;
+
+    if (rocksDecodeExpireKey(rawkey,rawkey_length,&dbid,&expire,&key,&key_len))
+        return 0;
+
+    updateCompactionFiltRioCount(EXPIRE_CF);
+    meta_key = encodeMetaKey(dbid,key,key_len);
+    meta_val = rocksdbGet(server.rocks->filter_meta_ropts,META_CF,meta_key,&err);
+    if (err != NULL) {
+        serverLog(LL_NOTICE, "[expireFilter] rockget (%s) meta val fail: %s ", meta_key, err);
+        zlibc_free(err);
+        /* if error happened, index entry will not be filtered. */
+    } else if (meta_val == NULL) {
+        result = 1;
+    } else if (!rocksDecodeMetaVal(meta_val,sdslen(meta_val),&object_type,
+                &meta_expire,&meta_version,&extend,&extend_len)) {
+        result = meta_expire != expire;
+    }
+
+    if (result) updateCompactionFiltSuccessCount(EXPIRE_CF);
+    sdsfree(meta_key);
+    if (meta_val) sdsfree(meta_val);
+    return result;
+}
+
+static void expireFilterDestroy(void* state) {
+    UNUSED(state);
+}
+
+rocksdb_compactionfilter_t* createExpireCfCompactionFilter(void *state, rocksdb_compactionfiltercontext_t *context) {
+    UNUSED(state), UNUSED(context);
+    return rocksdb_compactionfilter_create(NULL, expireFilterDestroy,
+                                              expireFilterFilter, expireFilterName);
+}
+
+static const char* expireFilterFactoryName(void* arg) {
+  (void)arg;
+  return "expire_cf_filter_factory";
+}
+
+rocksdb_compactionfilterfactory_t* createExpireCfCompactionFilterFactory() {
+    return rocksdb_compactionfilterfactory_create(NULL,NULL,
+            createExpireCfCompactionFilter,expireFilterFactoryName);
+}
+
 #ifdef REDIS_TEST
 static void rocksdbPut(int cf, sds rawkey, sds rawval, char** err) {
     serverAssert(cf < CF_COUNT);
@@ -489,6 +577,52 @@ int swapFilterTest(int argc, char **argv, int accurate) {
             test_assert(filt_count == 0);
             test_assert(scan_count >= 1);
         }
+
+        /* version == 0 && empty value => (string turned chunked) (filter) */
+        {
+            rocksdb_compact_range_cf(server.rocks->db, server.rocks->cf_handles[DATA_CF], NULL, 0, NULL, 0);
+            resetStatsSwap();
+
+            sds rawkey = rocksEncodeDataKey(db, key1->ptr, 0, NULL);
+            sds emptyval = sdsempty();
+            rocksdbPut(DATA_CF,rawkey,emptyval,&err);
+            test_assert(err == NULL);
+            sdsfree(emptyval);
+            rocksdb_compact_range_cf(server.rocks->db, server.rocks->cf_handles[DATA_CF], NULL, 0, NULL, 0);
+            sds val = rocksdbGet(server.rocks->ropts, DATA_CF, rawkey, &err);
+            test_assert(err == NULL);
+            test_assert(val == NULL);
+            sdsfree(rawkey);
+            atomicGet(server.ror_stats->compaction_filter_stats[DATA_CF].filt_count, filt_count);
+            test_assert(filt_count == 1);
+        }
+
+        /* metaversion == 0 => (string chunks obsolete) (filter) */
+        {
+            rocksdb_compact_range_cf(server.rocks->db, server.rocks->cf_handles[DATA_CF], NULL, 0, NULL, 0);
+            resetStatsSwap();
+
+            sds rawkey = rocksEncodeDataKey(db, key1->ptr, 3, subkey);
+            rocksdbPut(DATA_CF,rawkey,val1->ptr, &err);
+            test_assert(err == NULL);
+            sds rawmetakey = rocksEncodeMetaKey(db, key1->ptr);
+            sds rawmetaval = rocksEncodeMetaVal(OBJ_STRING, -1, 0, NULL);
+            rocksdbPut(META_CF, rawmetakey, rawmetaval, &err);
+            test_assert(err == NULL);
+
+            rocksdb_compact_range_cf(server.rocks->db, server.rocks->cf_handles[DATA_CF], NULL, 0, NULL, 0);
+            sds val = rocksdbGet(server.rocks->ropts, DATA_CF, rawkey, &err);
+            test_assert(err == NULL);
+            test_assert(val == NULL);
+
+            rocksdbDelete(META_CF, rawmetakey, &err);
+            test_assert(err == NULL);
+            sdsfree(rawkey);
+            sdsfree(rawmetakey);
+            sdsfree(rawmetaval);
+            atomicGet(server.ror_stats->compaction_filter_stats[DATA_CF].filt_count, filt_count);
+            test_assert(filt_count == 1);
+        }
    }
 
    TEST("exec: score compaction filter -data") {
@@ -658,6 +792,45 @@ int swapFilterTest(int argc, char **argv, int accurate) {
             test_assert(scan_count == 1);
         }
     }
+
+    TEST("exec: expire compaction filter") {
+        rocksdb_compact_range_cf(server.rocks->db, server.rocks->cf_handles[EXPIRE_CF], NULL, 0, NULL, 0);
+        resetStatsSwap();
+        sds stale = rocksEncodeExpireKey(db->id, 1000, key1->ptr);
+        sds current = rocksEncodeExpireKey(db->id, 2000, key1->ptr);
+        sds empty = sdsempty();
+        rocksdbPut(EXPIRE_CF, stale, empty, &err);
+        test_assert(err == NULL);
+        rocksdbPut(EXPIRE_CF, current, empty, &err);
+        test_assert(err == NULL);
+        sds rawmetakey = rocksEncodeMetaKey(db, key1->ptr);
+        sds extend = rocksEncodeObjectMetaLen(1);
+        sds rawmetaval = rocksEncodeMetaVal(OBJ_HASH, 2000, 1, extend);
+        rocksdbPut(META_CF, rawmetakey, rawmetaval, &err);
+        test_assert(err == NULL);
+
+        /* entry of previous expire filtered, entry of meta expire kept. */
+        rocksdb_compact_range_cf(server.rocks->db, server.rocks->cf_handles[EXPIRE_CF], NULL, 0, NULL, 0);
+        sds val = rocksdbGet(server.rocks->ropts, EXPIRE_CF, stale, &err);
+        test_assert(err == NULL && val == NULL);
+        val = rocksdbGet(server.rocks->ropts, EXPIRE_CF, current, &err);
+        test_assert(err == NULL && val != NULL);
+        sdsfree(val);
+        atomicGet(server.ror_stats->compaction_filter_stats[EXPIRE_CF].filt_count, filt_count);
+        test_assert(filt_count == 1);
+
+        /* entry filtered once meta deleted. */
+        rocksdbDelete(META_CF, rawmetakey, &err);
+        test_assert(err == NULL);
+        rocksdb_compact_range_cf(server.rocks->db, server.rocks->cf_handles[EXPIRE_CF], NULL, 0, NULL, 0);
+        val = rocksdbGet(server.rocks->ropts, EXPIRE_CF, current, &err);
+        test_assert(err == NULL && val == NULL);
+        atomicGet(server.ror_stats->compaction_filter_stats[EXPIRE_CF].filt_count, filt_count);
+        test_assert(filt_count == 2);
+
+        sdsfree(stale), sdsfree(current), sdsfree(empty);
+        sdsfree(rawmetakey), sdsfree(extend), sdsfree(rawmetaval);
+    }
     return error;
 
 }
@@ -169,9 +169,45 @@ inline int swapDataEncodeData(swapData *d, int intention, void *datactx,
         return 0;
 }
 
+/* Swap-thread: stream reaches eof if chunk not full or iterator moved out of
+ * object range (nextseek might belong to next key if no prefix bound). */
+static void swapStreamChunkIterated(swapData *d, int num) {
+    swapStream *stream = d->stream;
+    sds nextseek = d->nextseek;
+
+    d->nextseek = NULL;
+    if (num < stream->limit || nextseek == NULL ||
+            sdscmp(nextseek,stream->end) > 0) {
+        stream->eof = 1;
+        if (nextseek) sdsfree(nextseek);
+    } else {
+        stream->nextseek = nextseek;
+    }
+}
+
+static int swapStreamEncodeRange(swapData *d, int *limit, uint32_t *flags,
+        int *pcf, sds *start, sds *end) {
+    swapStream *stream = d->stream;
+    uint64_t version = swapDataObjectVersion(d);
+
+    *pcf = DATA_CF;
+    *flags = ROCKS_ITERATE_CONTINUOUSLY_SEEK;
+    if (stream->nextseek) {
+        *start = stream->nextseek;
+        stream->nextseek = NULL; /* moved to rio */
+    } else {
+        *start = rocksEncodeDataRangeStartKey(d->db,d->key->ptr,version);
+    }
+    *end = sdsdup(stream->end);
+    *limit = stream->limit;
+    return 0;
+}
+
 inline int swapDataEncodeRange(struct swapData *d, int intention, void *datactx,
         int *limit, uint32_t *flags, int *pcf, sds *start, sds *end) {
-    if (d->type->encodeRange)
+    if (d->stream)
+        return swapStreamEncodeRange(d,limit,flags,pcf,start,end);
+    else if (d->type->encodeRange)
         return d->type->encodeRange(d,intention,datactx,limit,flags,pcf,start,end);
     else
         return 0;
@@ -180,6 +216,7 @@ inline int swapDataEncodeRange(struct swapData *d, int intention, void *datactx,
 /* Swap-thread: decode val/subval from rawvalss returned by rocksdb. */
 inline int swapDataDecodeData(swapData *d, int num, int *cfs, sds *rawkeys,
         sds *rawvals, void **decoded) {
+    if (d->stream) swapStreamChunkIterated(d,num);
     if (d->type->decodeData)
         return d->type->decodeData(d,num,cfs,rawkeys,rawvals,decoded);
     else
@@ -215,7 +252,10 @@ inline int swapDataSwapDel(swapData *d, void *datactx, int async) {
  * - merge fields into robj: subvals merged into db.value, returns NULL */
 inline void *swapDataCreateOrMergeObject(swapData *d, void *decoded,
         void *datactx) {
-    if (d->type->createOrMergeObject)
+    /* streamed chunk is replied as is, never merged into keyspace. */
+    if (d->stream)
+        return decoded;
+    else if (d->type->createOrMergeObject)
         return d->type->createOrMergeObject(d,decoded,datactx);
     else
         return NULL;
@@ -230,6 +270,7 @@ inline int swapDataCleanObject(swapData *d, void *datactx, int keep_data) {
 }
 
 inline int swapDataBeforeCall(swapData *d, client *c, void *datactx) {
+    if (d->stream) c->swap_stream_replied = 1;
     if (d->type->beforeCall)
         return d->type->beforeCall(d,c,datactx);
     else
@@ -290,6 +331,8 @@ inline void swapDataFree(swapData *d, void *datactx) {
     if (d->value) decrRefCount(d->value);
     if (d->dirty_subkeys) decrRefCount(d->dirty_subkeys);
     if (d->absent) swapDataAbsentSubkeyFree(d->absent);
+    if (d->nextseek) sdsfree(d->nextseek);
+    if (d->stream) swapStreamFree(d->stream);
     zfree(d);
 }
 
@@ -349,7 +392,7 @@ int swapDataSetupMeta(swapData *d, int object_type, long long expire,
         retval = swapDataSetupList(d, datactx);
         break;
     case OBJ_STREAM:
-        retval = SWAP_ERR_SETUP_UNSUPPORTED;
+        retval = swapDataSetupStreamType(d,datactx);
         break;
     default:
         retval = SWAP_ERR_SETUP_FAIL;
@@ -380,6 +423,73 @@ int swapDataDecodeAndSetupMeta(swapData *d, sds rawval, void **datactx) {
     return retval;
 }
 
+static swapStream *swapStreamNew(swapData *data) {
+    swapStream *stream = zmalloc(sizeof(swapStream));
+    uint64_t version = swapDataObjectVersion(data);
+    stream->limit = server.swap_stream_chunk_subkeys;
+    stream->eof = 0;
+    stream->end = rocksEncodeDataRangeEndKey(data->db,data->key->ptr,version);
+    stream->nextseek = NULL;
+    stream->chunk = NULL;
+    stream->total = -1;
+    stream->replied = 0;
+    return stream;
+}
+
+void swapStreamFree(swapStream *stream) {
+    if (stream == NULL) return;
+    if (stream->end) sdsfree(stream->end);
+    if (stream->nextseek) sdsfree(stream->nextseek);
+    if (stream->chunk) decrRefCount(stream->chunk);
+    zfree(stream);
+}
+
+void swapStreamSetChunk(swapStream *stream, robj *chunk) {
+    if (stream->chunk) decrRefCount(stream->chunk);
+    stream->chunk = chunk;
+}
+
+/* Main/swap-thread: HGETALL/SMEMBERS... of big (more subkeys in rocksdb than
+ * a chunk) warm or cold object are replied by stream, so that reading big
+ * object won't swap in the whole object and inflate used memory. Returns 1
+ * if stream setup. */
+int swapDataSetupStream(swapData *data, uint32_t cmd_intention_flags) {
+    objectMeta *meta;
+
+    if (!(cmd_intention_flags & SWAP_IN_STREAM)) return 0;
+    if (server.swap_stream_chunk_subkeys <= 0) return 0;
+    if (data->type->streamReply == NULL) return 0;
+    if (!swapDataPersisted(data)) return 0;
+    meta = swapDataObjectMeta(data);
+    if (meta->len <= server.swap_stream_chunk_subkeys) return 0;
+    /* expired key deleted by normal swap in. */
+    if (timestampIsExpired(data->expire)) return 0;
+
+    serverAssert(data->stream == NULL);
+    data->stream = swapStreamNew(data);
+    return 1;
+}
+
+/* Main-thread: reply swapped in chunk, returns 1 if more chunks to swap. */
+int swapDataStreamReply(swapData *data, client *c) {
+    swapStream *stream = data->stream;
+    int more;
+
+    serverAssert(stream);
+    more = data->type->streamReply(data,c);
+    swapStreamSetChunk(stream,NULL);
+
+    if (!more && stream->replied != stream->total) {
+        sds repr = sdscatrepr(sdsempty(),data->key->ptr,sdslen(data->key->ptr));
+        serverLog(LL_WARNING,
+                "Streamed reply of %s replied(%lld) != expected(%lld), closing client.",
+                repr,stream->replied,stream->total);
+        sdsfree(repr);
+        freeClientAsync(c);
+    }
+    return more;
+}
+
 void swapDataTurnWarmOrHot(swapData *data) {
     if (data->expire != -1) {
         setExpire(NULL,data->db,data->key,data->expire);
@@ -76,6 +76,8 @@ static int getCfOrReply(client *c, robj *cf) {
         return DATA_CF;
     } else if (!strcasecmp(cf->ptr, "score")) {
         return SCORE_CF;
+    } else if (!strcasecmp(cf->ptr, "expire")) {
+        return EXPIRE_CF;
     } else {
         addReplyError(c,"invalid cf");
         return -1;
@@ -112,9 +114,9 @@ void swapCommand(client *c) {
 "    Encode data key.",
 "DECODE-DATA-KEY <rawkey>",
 "    Decode data key.",
-"RIO-GET meta|data <rawkey> <rawkey> ...",
+"RIO-GET meta|data|score|expire <rawkey> <rawkey> ...",
 "    Get raw value from rocksdb.",
-"RIO-SCAN meta|data <prefix>",
+"RIO-SCAN meta|data|score|expire <prefix>",
 "    Scan rocksdb with prefix.",
 "RIO-ERROR <count> [ACTION name]",
 "    Make next count rio return error.",
@@ -237,8 +237,57 @@ void swapEvictionCtxFree(swapEvictionCtx *ctx) {
     zfree(ctx);
 }
 
-static inline void swapEvictionCtxUpdateStat(swapEvictionCtx *ctx, int evict_result) {
+static inline void swapEvictionCtxUpdateStat(swapEvictionCtx *ctx,
+        int evict_result, size_t mem_freed) {
     ctx->stat.evict_result[evict_result]++;
+    if (evict_result == EVICT_SUCC_FREED)
+        ctx->stat.freed_bytes += mem_freed;
+    else if (evict_result == EVICT_SUCC_SWAPPED)
+        ctx->stat.swapped_bytes += mem_freed;
+}
+
+size_t objectComputeSize(robj *o, size_t sample_size);
+
+/* Cost aware eviction, similar to GreedyDual-Size-Frequency: value of
+ * keeping a key in memory is hotness*cost/size, where size is memory
+ * freed by evicting it, and cost is the IO needed: clean key is freed
+ * right away while dirty key have to be written to rocksdb. Candidate
+ * score is the inverse, so that evict pool (which evicts higher score
+ * first) prefers big, cold and clean keys over small or dirty ones.
+ * Hotness comes from maxmemory-policy: idle seconds for LRU, inverted
+ * counter for LFU. Returns 0 if key should not be evict candidate. */
+#define SWAP_EVICT_COST_CLEAN 1
+#define SWAP_EVICT_COST_DIRTY 4
+#define SWAP_EVICT_SIZE_SAMPLES 8
+
+int ctrip_evictionPoolCandidateScore(int dbid, sds key, robj *o,
+        unsigned long long *idle) {
+    redisDb *db = server.db+dbid;
+    double coldness, score;
+    size_t size;
+    int cost;
+    robj keyobj;
+
+    if (server.swap_mode == SWAP_MODE_MEMORY ||
+            !server.swap_evict_cost_aware ||
+            !(server.maxmemory_policy & (MAXMEMORY_FLAG_LRU|MAXMEMORY_FLAG_LFU)))
+        return 1;
+
+    /* value of locked key might be touched by swap threads, and it
+     * can't be evicted right now anyway. */
+    initStaticStringObject(keyobj,key);
+    if (lockWouldBlock(server.swap_txid++,db,&keyobj)) return 0;
+
+    size = objectComputeSize(o,SWAP_EVICT_SIZE_SAMPLES);
+    cost = objectIsDirty(o) ? SWAP_EVICT_COST_DIRTY : SWAP_EVICT_COST_CLEAN;
+    if (server.maxmemory_policy & MAXMEMORY_FLAG_LRU)
+        coldness = 1 + (double)*idle/1000;
+    else
+        coldness = 1 + (double)*idle;
+
+    score = (double)size*coldness/cost;
+    *idle = score >= (double)ULLONG_MAX ? ULLONG_MAX : (unsigned long long)score;
+    return 1;
 }
 
 inline size_t performEvictionSwapSelectedKey(swapEvictKeysCtx *sectx, redisDb *db,
@@ -266,7 +315,7 @@ inline size_t performEvictionSwapSelectedKey(swapEvictKeysCtx *sectx, redisDb *d
     } else {
         ctx->failed_inrow++;
     }
-    swapEvictionCtxUpdateStat(ctx,evict_result);
+    swapEvictionCtxUpdateStat(ctx,evict_result,mem_freed);
 
     latencyEndMonitor(eviction_latency);
     latencyAddSampleIfNeeded("swap-eviction",eviction_latency);
@@ -307,6 +356,7 @@ inline void ctrip_performEvictionEnd(swapEvictKeysCtx *sectx) {
 
 sds genSwapEvictionInfoString(sds info) {
     swapEvictionCtx *ctx = server.swap_eviction_ctx;
+    long long swapped;
 
     info = sdscatprintf(info,"swap_inprogress_evict_count:%lld\r\n",
             ctx->inprogress_count);
@@ -321,6 +371,14 @@ sds genSwapEvictionInfoString(sds info) {
         }
     }
     info = sdscatprintf(info,"\r\n");
+
+    swapped = ctx->stat.evict_result[EVICT_SUCC_SWAPPED];
+    info = sdscatprintf(info,
+            "swap_evict_freed_bytes:%lld\r\n"
+            "swap_evict_swapped_bytes:%lld\r\n"
+            "swap_evict_bytes_per_io:%lld\r\n",
+            ctx->stat.freed_bytes,ctx->stat.swapped_bytes,
+            swapped ? (ctx->stat.freed_bytes+ctx->stat.swapped_bytes)/swapped : 0);
     return info;
 }
 
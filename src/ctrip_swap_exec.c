@@ -49,6 +49,7 @@ swapRequest *swapRequestNew(keyRequest *key_request, int intention,
 #endif
     req->errcode = 0;
     req->trace = trace;
+    req->priority = SWAP_PRIORITY_FOREGROUND;
     return req;
 }
 
@@ -240,6 +241,12 @@ void swapRequestMerge(swapRequest *req) {
 
         break;
     case SWAP_IN:
+        if (data->stream) {
+            /* streamed chunk kept for reply, key stays cold or warm. */
+            swapStreamSetChunk(data->stream,req->result);
+            req->result = NULL;
+            break;
+        }
         retval = swapDataSwapIn(data,req->result,datactx);
         if (retval == 0) {
             if (swapDataIsCold(data) && req->result) {
@@ -581,17 +588,29 @@ static void swapExecBatchExecuteDoOutMeta(swapExecBatch *exec_batch) {
     sds *meta_rawkeys = NULL, *meta_rawvals = NULL;
     size_t count = exec_batch->count;
 
-    meta_cfs = zmalloc(sizeof(int)*count);
-    meta_rawkeys = zmalloc(sizeof(sds)*count);
-    meta_rawvals = zmalloc(sizeof(sds)*count);
+    /* each meta may come with an expire index entry. */
+    meta_cfs = zmalloc(sizeof(int)*count*2);
+    meta_rawkeys = zmalloc(sizeof(sds)*count*2);
+    meta_rawvals = zmalloc(sizeof(sds)*count*2);
     for (size_t i = 0; i < count; i++) {
         swapRequest *req = exec_batch->reqs[i];
+        swapData *data = req->data;
         /* rdb out do not meta already encoded, can't put. */
-        if (req->data->db == NULL || req->data->key == NULL) continue;
+        if (data->db == NULL || data->key == NULL) continue;
         meta_cfs[num_metas] = META_CF;
-        meta_rawkeys[num_metas] = swapDataEncodeMetaKey(req->data);
-        meta_rawvals[num_metas] = swapDataEncodeMetaVal(req->data,req->datactx);
+        meta_rawkeys[num_metas] = swapDataEncodeMetaKey(data);
+        meta_rawvals[num_metas] = swapDataEncodeMetaVal(data,req->datactx);
         num_metas++;
+        /* index entry of previous expire (if changed) is left stale, and
+         * cleaned by scan expire when it is due or by expire cf compaction
+         * filter (scan expire not running on replica). */
+        if (data->expire != -1) {
+            meta_cfs[num_metas] = EXPIRE_CF;
+            meta_rawkeys[num_metas] = rocksEncodeExpireKey(data->db->id,
+                    data->expire,data->key->ptr);
+            meta_rawvals[num_metas] = sdsempty();
+            num_metas++;
+        }
     }
     RIOInitPut(meta_rio,num_metas,meta_cfs,meta_rawkeys,meta_rawvals);
     RIODo(meta_rio);
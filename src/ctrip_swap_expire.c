@@ -71,6 +71,22 @@ int scanMetaExpireIfNeeded(redisDb *db, scanMeta *meta) {
     return 1;
 }
 
+/* Stale expire index entry found by scan expire is deleted with key lock
+ * held, see expireIndexScanValidate. */
+void submitExpireIndexCleanRequest(client *c, sds key, long long expire) {
+    getKeyRequestsResult result = GET_KEYREQUESTS_RESULT_INIT;
+    robj *keyobj = createStringObject(key,sdslen(key));
+    robj **subkeys = zmalloc(sizeof(robj*));
+    subkeys[0] = createStringObjectFromLongLong(expire);
+    getKeyRequestsPrepareResult(&result,1);
+    getKeyRequestsAppendSubkeyResult(&result,REQUEST_LEVEL_KEY,keyobj,1,subkeys,
+            SWAP_IN,SWAP_METASCAN_EXPIRE_CLEAN,c->cmd->flags,c->db->id);
+    c->keyrequests_count++;
+    submitClientKeyRequests(c,&result,expireClientKeyRequestFinished,NULL);
+    releaseKeyRequests(&result);
+    getKeyRequestsFreeResult(&result);
+}
+
 void swapExpiredCommand(client *c) {
     addReply(c, shared.ok);
 }
@@ -177,6 +193,7 @@ size_t expireCandidatesRemoveExpired(expireCandidates *ecs, long long now,
 scanExpire *scanExpireCreate() {
     scanExpire *scan_expire = zcalloc(sizeof(scanExpire));
     scan_expire->nextseek = NULL;
+    scan_expire->use_index = server.swap_scan_expire_index;
     scan_expire->limit = EXPIRESCAN_DEFAULT_LIMIT;
     scan_expire->candidates = expireCandidatesCreate(EXPIRESCAN_DEFAULT_CANDIDATES);
     return scan_expire;
@@ -272,12 +289,22 @@ int scanExpireDbCycle(redisDb *db, int type, long long timelimit) {
 
         for (int i = 0; i < metas->num; i++) {
             scanMeta *meta = metas->metas + i;
-            if (meta->expire != -1) {
-                expireCandidatesAdd(scan_expire->candidates,
-                        meta->expire,meta->key);
+            if (meta->expire == -1) continue;
+            if (scan_expire->use_index && meta->object_type == -1) {
+                submitExpireIndexCleanRequest(server.expire_clients[db->id],
+                        meta->key,meta->expire);
+                continue;
             }
+            expireCandidatesAdd(scan_expire->candidates,
+                    meta->expire,meta->key);
         }
 
+        /* Index scan returns due keys in expire order. */
+        if (scan_expire->use_index && metas->num > 0)
+            scan_expire->stat_index_lag_ms = start/1000 - metas->metas[0].expire;
+        else
+            scan_expire->stat_index_lag_ms = 0;
+
         stat_scan_keys += metas->num;
         freeScanMetaResult(metas);
         c->swap_metas = NULL;
@@ -287,6 +314,14 @@ int scanExpireDbCycle(redisDb *db, int type, long long timelimit) {
     /* Start new scan expire */
     if (type != ACTIVE_EXPIRE_CYCLE_FAST && !scan_expire->inprogress) {
         serverAssert(c->swap_metas == NULL);
+        /* nextseek of meta scan is not valid for index scan & vice versa */
+        if (scan_expire->use_index != server.swap_scan_expire_index) {
+            if (scan_expire->nextseek) {
+                sdsfree(scan_expire->nextseek);
+                scan_expire->nextseek = NULL;
+            }
+            scan_expire->use_index = server.swap_scan_expire_index;
+        }
         scan_expire->inprogress = 1;
         startMetaScan4ScanExpire(c);
     }
@@ -357,7 +392,7 @@ sds genSwapScanExpireInfoString(sds info) {
     double stale_percent = 0;
     int limit = 0;
     long long estimated_cycle_seconds = 0, scan_time_used = 0,
-         expire_time_used = 0;
+         expire_time_used = 0, index_lag_ms = 0;
 
     for (int dbid = 0; dbid < server.dbnum; dbid++) {
         db = server.db + dbid;
@@ -380,6 +415,8 @@ sds genSwapScanExpireInfoString(sds info) {
         expired_per_sec += scan_expire->stat_expired_per_sec;
         scan_time_used += scan_expire->stat_scan_time_used;
         expire_time_used += scan_expire->stat_expire_time_used;
+        if (index_lag_ms < scan_expire->stat_index_lag_ms)
+            index_lag_ms = scan_expire->stat_index_lag_ms;
     }
 
 	info = sdscatprintf(info,
@@ -391,7 +428,9 @@ sds genSwapScanExpireInfoString(sds info) {
 			"swap_scan_expire_scan_key_per_second:%ld\r\n"
 			"swap_scan_expire_expired_key_per_second:%ld\r\n"
 			"swap_scan_expire_scan_used_time:%lld\r\n"
-			"swap_scan_expire_expire_used_time:%lld\r\n",
+			"swap_scan_expire_expire_used_time:%lld\r\n"
+			"swap_scan_expire_index:%d\r\n"
+			"swap_scan_expire_index_lag_ms:%lld\r\n",
             used_memory,
             candidates_count,
             stale_percent*100,
@@ -400,7 +439,9 @@ sds genSwapScanExpireInfoString(sds info) {
             scan_per_sec,
             expired_per_sec,
             scan_time_used,
-            expire_time_used);
+            expire_time_used,
+            server.swap_scan_expire_index,
+            index_lag_ms);
     return info;
 }
 
@@ -28,6 +28,18 @@
 
 #include "ctrip_swap.h"
 #include "dict.h"
+#include <sys/stat.h>
+
+/* Cold filter hashes with its own seed (instead of dict seed, which changes
+ * every restart) so that snapshot could be reused after restart. */
+uint64_t siphash(const uint8_t *in, const size_t inlen, const uint8_t *k);
+
+static uint8_t cold_filter_hash_seed[16];
+static int cold_filter_hash_seed_inited;
+
+static uint64_t coldFilterHashFunction(const void *key, int len) {
+    return siphash(key,len,cold_filter_hash_seed);
+}
 
 static void coldFilterDisableCuckooFilters() {
     for (int i = 0; i < server.dbnum; i++) {
@@ -50,7 +62,7 @@ static inline
 void coldFilterInitCuckooFilter(coldFilter *filter) {
     if (server.swap_cuckoo_filter_enabled && filter->filter == NULL) {
         filter->filter = cuckooFilterNew(
-                dictGenHashFunction,
+                coldFilterHashFunction,
                 server.swap_cuckoo_filter_bit_type,
                 server.swap_cuckoo_filter_estimated_keys);
     }
@@ -69,6 +81,10 @@ void coldFilterDeinit(coldFilter *filter) {
 
 coldFilter *coldFilterCreate() {
     coldFilter *filter = zcalloc(sizeof(coldFilter));
+    if (!cold_filter_hash_seed_inited) {
+        getRandomBytes(cold_filter_hash_seed,sizeof(cold_filter_hash_seed));
+        cold_filter_hash_seed_inited = 1;
+    }
     coldFilterInitAbsentCache(filter);
     return filter;
 }
@@ -102,6 +118,9 @@ void coldFilterAddKey(coldFilter *filter, sds key) {
     }
 
     if (filter->absents) absentCacheDelete(filter->absents,key);
+    /* keys only turn cold here, so unchanged version means batch probe
+     * results of absent keys still hold. */
+    filter->version++;
 }
 
 void coldFilterDeleteKey(coldFilter *filter, sds key) {
@@ -115,11 +134,39 @@ void coldFilterKeyNotFound(coldFilter *filter, sds key) {
     if (filter->filter) filter->filter_stat.false_positive_count++;
 }
 
-int coldFilterMayContainKey(coldFilter *filter, sds key, int *filt_by) {
+/* Probe cuckoo filter for keys of a multi-key request in one batch, so that
+ * bucket cache misses of different keys overlap. probes[i] is set to
+ * COLDFILTER_PROBE_NONE if cuckoo filter not available. */
+void coldFilterMayContainKeys(coldFilter *filter, int nkeys,
+        const char **keys, size_t *klens, int *probes) {
+    coldFilterInitCuckooFilter(filter);
+
+    if (filter->filter == NULL) {
+        for (int i = 0; i < nkeys; i++) probes[i] = COLDFILTER_PROBE_NONE;
+        return;
+    }
+
+    filter->filter_stat.lookup_count += nkeys;
+    cuckooFilterContainsBatch(filter->filter,nkeys,keys,klens,probes);
+    for (int i = 0; i < nkeys; i++) {
+        probes[i] = probes[i] == CUCKOO_OK ?
+            COLDFILTER_PROBE_MAYEXIST : COLDFILTER_PROBE_ABSENT;
+    }
+}
+
+/* Same as coldFilterMayContainKey, but reuse cuckoo filter probe result of
+ * coldFilterMayContainKeys if no key turned cold since then. */
+int coldFilterMayContainKeyProbed(coldFilter *filter, sds key, int probe,
+        unsigned long long version, int *filt_by) {
     /* cuckoo filter are lazily created to save memory */
     coldFilterInitCuckooFilter(filter);
 
-    if (filter->filter) {
+    if (probe != COLDFILTER_PROBE_NONE && version == filter->version) {
+        if (probe == COLDFILTER_PROBE_ABSENT) {
+            *filt_by = COLDFILTER_FILT_BY_CUCKOO_FILTER;
+            return 0;
+        }
+    } else if (filter->filter) {
         filter->filter_stat.lookup_count++;
         if (cuckooFilterContains(filter->filter,key,sdslen(key)) == CUCKOO_ERR) {
             *filt_by = COLDFILTER_FILT_BY_CUCKOO_FILTER;
@@ -135,6 +182,10 @@ int coldFilterMayContainKey(coldFilter *filter, sds key, int *filt_by) {
     return 1;
 }
 
+int coldFilterMayContainKey(coldFilter *filter, sds key, int *filt_by) {
+    return coldFilterMayContainKeyProbed(filter,key,COLDFILTER_PROBE_NONE,0,filt_by);
+}
+
 /* Invalidate key from absent cache when subkey added to rocksdb so that
  * we don't need to save evicted subkeys (cant maintain absent cache
  * from swap thread) and delete every subkey in main thread.  */
@@ -162,6 +213,259 @@ int coldFilterMayContainSubkey(coldFilter *filter, sds key, sds subkey) {
     }
 }
 
+/* Cold filter snapshot:
+ *   magic(8) epoch(4) dbnum(4) bit_type(4) reserved(4) sequence(8)
+ *   swap_key_version(8) hash_seed(16)
+ *   [cold_keys(8) dumplen(8) cuckoo filter dump] ... one for each db
+ *   crc64(8) */
+#define COLDFILTER_SNAPSHOT_MAGIC "CFSNAP01"
+#define COLDFILTER_SNAPSHOT_HEADER_LEN 56
+
+static void coldFilterSnapshotPath(char *path, char *tmppath) {
+    snprintf(path,ROCKS_DIR_MAX_LEN,"%s/%s",
+            ROCKS_DATA,ROCKS_COLD_FILTER_SNAPSHOT_FILE);
+    if (tmppath) snprintf(tmppath,ROCKS_DIR_MAX_LEN,"%s/%s.tmp-%d",
+            ROCKS_DATA,ROCKS_COLD_FILTER_SNAPSHOT_FILE,(int)getpid());
+}
+
+/* Keys in rocksdb turns cold after restart, so snapshot of db filter also
+ * contains keys in memory that persisted to rocksdb. */
+static int coldFilterSnapshotCatDb(sds *pbuf, redisDb *db) {
+    cuckooFilter *filter = NULL;
+    int64_t cold_keys = db->cold_keys;
+    uint64_t dumplen = 0;
+    dictIterator *di;
+    dictEntry *de;
+
+    if (db->cold_filter->filter) {
+        cuckooFilter *origin = db->cold_filter->filter;
+        char *dump = zmalloc(cuckooFilterDumpLen(origin));
+        cuckooFilterDump(origin,dump);
+        filter = cuckooFilterRestore(coldFilterHashFunction,dump,
+                cuckooFilterDumpLen(origin));
+        zfree(dump);
+        serverAssert(filter);
+    }
+
+    di = dictGetIterator(db->dict);
+    while ((de = dictNext(di)) != NULL) {
+        sds key = dictGetKey(de);
+        robj *o = dictGetVal(de);
+        if (!getObjectPersistent(o)) continue;
+        if (filter == NULL) {
+            filter = cuckooFilterNew(coldFilterHashFunction,
+                    server.swap_cuckoo_filter_bit_type,
+                    server.swap_cuckoo_filter_estimated_keys);
+        }
+        if (cuckooFilterInsert(filter,key,sdslen(key)) != CUCKOO_OK) {
+            dictReleaseIterator(di);
+            cuckooFilterFree(filter);
+            return C_ERR;
+        }
+        cold_keys++;
+    }
+    dictReleaseIterator(di);
+
+    if (filter) dumplen = cuckooFilterDumpLen(filter);
+    *pbuf = sdscatlen(*pbuf,&cold_keys,sizeof(cold_keys));
+    *pbuf = sdscatlen(*pbuf,&dumplen,sizeof(dumplen));
+    if (filter) {
+        size_t offset = sdslen(*pbuf);
+        *pbuf = sdsMakeRoomFor(*pbuf,dumplen);
+        cuckooFilterDump(filter,*pbuf+offset);
+        sdsIncrLen(*pbuf,dumplen);
+        cuckooFilterFree(filter);
+    }
+    return C_OK;
+}
+
+/* Save cold filters of all dbs to data.rocks on shutdown, snapshot is valid
+ * only if rocksdb sequence not changed when loaded. */
+int coldFiltersSaveSnapshot(void) {
+    char path[ROCKS_DIR_MAX_LEN], tmppath[ROCKS_DIR_MAX_LEN];
+    int32_t i32;
+    uint64_t u64;
+    sds buf = NULL;
+    FILE *fp = NULL;
+    long long start = ustime();
+
+    coldFilterSnapshotPath(path,tmppath);
+    /* snapshot of previous run must not survive. */
+    unlink(path);
+
+    if (!server.swap_cuckoo_filter_snapshot_enabled ||
+            !server.swap_cuckoo_filter_enabled)
+        return C_OK;
+
+    /* in-flight swaps might change rocksdb after sequence sampled. */
+    asyncCompleteQueueDrain(-1);
+
+    buf = sdscatlen(sdsempty(),COLDFILTER_SNAPSHOT_MAGIC,8);
+    i32 = server.rocksdb_epoch;
+    buf = sdscatlen(buf,&i32,sizeof(i32));
+    i32 = server.dbnum;
+    buf = sdscatlen(buf,&i32,sizeof(i32));
+    i32 = server.swap_cuckoo_filter_bit_type;
+    buf = sdscatlen(buf,&i32,sizeof(i32));
+    i32 = 0; /* reserved */
+    buf = sdscatlen(buf,&i32,sizeof(i32));
+    u64 = rocksdb_get_latest_sequence_number(server.rocks->db);
+    buf = sdscatlen(buf,&u64,sizeof(u64));
+    u64 = server.swap_key_version;
+    buf = sdscatlen(buf,&u64,sizeof(u64));
+    buf = sdscatlen(buf,cold_filter_hash_seed,sizeof(cold_filter_hash_seed));
+    serverAssert(sdslen(buf) == COLDFILTER_SNAPSHOT_HEADER_LEN);
+
+    for (int i = 0; i < server.dbnum; i++) {
+        if (coldFilterSnapshotCatDb(&buf,server.db+i) != C_OK) {
+            serverLog(LL_WARNING,"Save cold filter snapshot failed: "
+                    "insert persisted keys of db-%d failed.", i);
+            sdsfree(buf);
+            return C_ERR;
+        }
+    }
+    u64 = crc64(0,(unsigned char*)buf,sdslen(buf));
+    buf = sdscatlen(buf,&u64,sizeof(u64));
+
+    if ((fp = fopen(tmppath,"w")) == NULL ||
+            fwrite(buf,sdslen(buf),1,fp) != 1 ||
+            fflush(fp) || fsync(fileno(fp))) {
+        goto werr;
+    }
+    fclose(fp), fp = NULL;
+    if (rename(tmppath,path) == -1) goto werr;
+
+    serverLog(LL_NOTICE,"Cold filter snapshot saved: %lu bytes in %lld ms.",
+            sdslen(buf),(ustime()-start)/1000);
+    sdsfree(buf);
+    return C_OK;
+
+werr:
+    serverLog(LL_WARNING,"Write cold filter snapshot %s failed: %s",
+            tmppath,strerror(errno));
+    if (fp) fclose(fp);
+    unlink(tmppath);
+    sdsfree(buf);
+    return C_ERR;
+}
+
+static const char *coldFiltersParseSnapshot(const char *buf, size_t len,
+        cuckooFilter **filters, long long *cold_keys,
+        uint64_t *swap_key_version) {
+    const char *p = buf + 8, *end = buf + len - sizeof(uint64_t);
+    int32_t epoch, dbnum, bit_type;
+    uint64_t sequence, crc;
+
+    if (len < COLDFILTER_SNAPSHOT_HEADER_LEN+sizeof(uint64_t) ||
+            memcmp(buf,COLDFILTER_SNAPSHOT_MAGIC,8))
+        return "bad magic";
+    memcpy(&crc,end,sizeof(crc));
+    if (crc != crc64(0,(unsigned char*)buf,len-sizeof(crc)))
+        return "checksum mismatch";
+
+    memcpy(&epoch,p,sizeof(epoch)), p += sizeof(epoch);
+    memcpy(&dbnum,p,sizeof(dbnum)), p += sizeof(dbnum);
+    memcpy(&bit_type,p,sizeof(bit_type)), p += 2*sizeof(bit_type);
+    memcpy(&sequence,p,sizeof(sequence)), p += sizeof(sequence);
+    memcpy(swap_key_version,p,sizeof(*swap_key_version));
+    p += sizeof(*swap_key_version) + sizeof(cold_filter_hash_seed);
+
+    if (epoch != server.rocksdb_epoch || dbnum != server.dbnum)
+        return "rocksdb epoch or dbnum changed";
+    if (bit_type != server.swap_cuckoo_filter_bit_type)
+        return "cuckoo filter bit type changed";
+    if (sequence != rocksdb_get_latest_sequence_number(server.rocks->db))
+        return "rocksdb changed since snapshot";
+
+    for (int i = 0; i < dbnum; i++) {
+        int64_t keys;
+        uint64_t dumplen;
+        if ((size_t)(end - p) < sizeof(keys)+sizeof(dumplen))
+            return "truncated";
+        memcpy(&keys,p,sizeof(keys)), p += sizeof(keys);
+        memcpy(&dumplen,p,sizeof(dumplen)), p += sizeof(dumplen);
+        if ((uint64_t)(end - p) < dumplen) return "truncated";
+        if (dumplen && (filters[i] = cuckooFilterRestore(
+                        coldFilterHashFunction,p,dumplen)) == NULL)
+            return "malformed cuckoo filter";
+        cold_keys[i] = keys;
+        p += dumplen;
+    }
+
+    return p == end ? NULL : "trailing bytes";
+}
+
+/* Load cold filters & cold keys from snapshot saved on shutdown. Snapshot
+ * is removed once tried: rocksdb will be changed after server started. */
+int coldFiltersLoadSnapshot(void) {
+    char path[ROCKS_DIR_MAX_LEN];
+    cuckooFilter **filters = NULL;
+    long long *cold_keys = NULL, start = ustime();
+    uint64_t swap_key_version = 0;
+    const char *reason = NULL;
+    char *buf = NULL;
+    struct redis_stat sb;
+    FILE *fp = NULL;
+
+    coldFilterSnapshotPath(path,NULL);
+    if (redis_stat(path,&sb) == -1) return C_ERR;
+
+    if (!server.swap_cuckoo_filter_snapshot_enabled ||
+            !server.swap_cuckoo_filter_enabled) {
+        reason = "disabled";
+        goto end;
+    }
+
+    for (int i = 0; i < server.dbnum; i++) {
+        if (server.db[i].cold_filter->filter || server.db[i].cold_keys) {
+            reason = "cold keys already exists";
+            goto end;
+        }
+    }
+
+    buf = zmalloc(sb.st_size);
+    if ((fp = fopen(path,"r")) == NULL ||
+            (sb.st_size && fread(buf,sb.st_size,1,fp) != 1)) {
+        reason = strerror(errno);
+        goto end;
+    }
+
+    filters = zcalloc(server.dbnum*sizeof(cuckooFilter*));
+    cold_keys = zcalloc(server.dbnum*sizeof(long long));
+    if ((reason = coldFiltersParseSnapshot(buf,sb.st_size,filters,
+                    cold_keys,&swap_key_version)))
+        goto end;
+
+    memcpy(cold_filter_hash_seed,buf+COLDFILTER_SNAPSHOT_HEADER_LEN-
+            sizeof(cold_filter_hash_seed),sizeof(cold_filter_hash_seed));
+    for (int i = 0; i < server.dbnum; i++) {
+        server.db[i].cold_filter->filter = filters[i];
+        server.db[i].cold_keys = cold_keys[i];
+        filters[i] = NULL;
+    }
+    if (server.swap_key_version < swap_key_version)
+        swapSetVersion(swap_key_version);
+
+end:
+    if (reason) {
+        serverLog(LL_NOTICE,"Cold filter snapshot skipped (%s), "
+                "rebuild by scanning rocksdb.", reason);
+    } else {
+        serverLog(LL_NOTICE,"Cold filter snapshot loaded in %lld ms "
+                "(version start from %lu).",
+                (ustime()-start)/1000,server.swap_key_version);
+    }
+    if (filters) {
+        for (int i = 0; i < server.dbnum; i++) cuckooFilterFree(filters[i]);
+        zfree(filters);
+    }
+    if (cold_keys) zfree(cold_keys);
+    if (fp) fclose(fp);
+    if (buf) zfree(buf);
+    unlink(path);
+    return reason ? C_ERR : C_OK;
+}
+
 /* cuckoo filter not counted in maxmemory */
 size_t coldFiltersUsedMemory() {
     size_t used_memory = 0;
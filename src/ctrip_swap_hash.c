@@ -79,12 +79,15 @@ static int hashSwapAnaOutSelectSubkeys(swapData *data, hashDataCtx *datactx,
 
     *may_keep_data = 1;
     if (select_type == SELECT_MAIN) {
+        evictKeptSubkeys kept;
         hashTypeIterator *hi = hashTypeInitIterator(subkeys);
+        evictKeptSubkeysInit(&kept,hashTypeLength(subkeys),count);
         while (hashTypeNext(hi) != C_ERR) {
             robj *subkey;
             unsigned char *vstr;
             unsigned int vlen;
             long long vll;
+            size_t memory;
 
             if ((size_t)datactx->ctx.num >= count ||
                     evict_memory >= server.swap_evict_step_max_memory) {
@@ -102,21 +105,29 @@ static int hashSwapAnaOutSelectSubkeys(swapData *data, hashDataCtx *datactx,
                 subkey = createStringObjectFromLongLong(vll);
                 subkey = unshareStringValue(subkey);
             }
-            datactx->ctx.subkeys[datactx->ctx.num++] = subkey;
 
             hashTypeCurrentObject(hi,OBJ_HASH_VALUE,&vstr,&vlen,&vll);
-            if (vstr)
-                evict_memory += vlen;
-            else
-                evict_memory += sizeof(vll);
+            memory = vstr ? vlen : sizeof(vll);
+
+            /* Recently accessed fields are evicted only if not enough
+             * cold fields found. */
+            if (evictKeptSubkeysKeep(&kept,data,subkey,memory)) continue;
+
+            datactx->ctx.subkeys[datactx->ctx.num++] = subkey;
+            evict_memory += memory;
         }
         hashTypeReleaseIterator(hi);
+        if (evictKeptSubkeysDeinit(&kept,datactx->ctx.subkeys,
+                    &datactx->ctx.num,count,&evict_memory) && !noswap)
+            *may_keep_data = 0;
     } else {
         robj *subkey;
         size_t sublen;
         dirtySubkeysIterator dss_iter;
         list *redundent_subkeys = listCreate();
+        evictKeptSubkeys kept;
 
+        evictKeptSubkeysInit(&kept,dirtySubkeysLength(subkeys),count);
         dirtySubkeysIteratorInit(&dss_iter, subkeys);
         while ((subkey = dirtySubkeysIteratorNext(&dss_iter,&sublen)) != NULL) {
             if ((size_t)datactx->ctx.num >= count ||
@@ -129,6 +140,7 @@ static int hashSwapAnaOutSelectSubkeys(swapData *data, hashDataCtx *datactx,
 
             /* check with lock hold so that evicting subkeys must exist. */
             if (hashTypeExists(data->value,subkey->ptr)) {
+                if (evictKeptSubkeysKeep(&kept,data,subkey,sublen)) continue;
                 datactx->ctx.subkeys[datactx->ctx.num++] = subkey;
                 evict_memory += sublen;
             } else {
@@ -136,6 +148,9 @@ static int hashSwapAnaOutSelectSubkeys(swapData *data, hashDataCtx *datactx,
             }
         }
         dirtySubkeysIteratorDeinit(&dss_iter);
+        if (evictKeptSubkeysDeinit(&kept,datactx->ctx.subkeys,
+                    &datactx->ctx.num,count,&evict_memory) && !noswap)
+            *may_keep_data = 0;
 
         listIter li;
         listNode *ln;
@@ -167,6 +182,8 @@ int hashSwapAna(swapData *data, int thd, struct keyRequest *req,
     case SWAP_IN:
         serverAssert(req->type == KEYREQUEST_TYPE_SUBKEY);
         serverAssert(req->b.num_subkeys >= 0);
+        if (thd == SWAP_ANA_THD_MAIN)
+            swapDataTouchSubkeys(data,req,hashTypeLength,hashTypeExists);
         if (!swapDataPersisted(data)) {
             /* No need to swap for pure hot key */
             *intention = SWAP_NOP;
@@ -203,6 +220,12 @@ int hashSwapAna(swapData *data, int thd, struct keyRequest *req,
                 datactx->ctx.subkeys[datactx->ctx.num++] = createStringObject("foo",3);
                 *intention = SWAP_IN;
                 *intention_flags = 0;
+            } else if (swapDataSetupStream(data,cmd_intention_flags)) {
+                /* HKEYS/HVALS/HGETALL of big hash: reply chunk by chunk. */
+                datactx->ctx.num = 0;
+                datactx->ctx.subkeys = NULL;
+                *intention = SWAP_IN;
+                *intention_flags = 0;
             } else {
                 /* HKEYS/HVALS/..., swap in all fields */
                 datactx->ctx.num = 0;
@@ -595,6 +618,58 @@ void freeHashSwapData(swapData *data_, void *datactx_) {
     zfree(datactx);
 }
 
+static inline int hashStreamReplyFlags(client *c) {
+    if (c->cmd->proc == hkeysCommand) return OBJ_HASH_KEY;
+    if (c->cmd->proc == hvalsCommand) return OBJ_HASH_VALUE;
+    return OBJ_HASH_KEY|OBJ_HASH_VALUE;
+}
+
+/* Reply fields of o, fields that also exists in hot (memory is newer
+ * than rocksdb) are skipped. */
+static void hashStreamReplyFields(client *c, swapStream *stream, robj *o,
+        robj *hot, int flags) {
+    hashTypeIterator *hi = hashTypeInitIterator(o);
+    while (stream->replied < stream->total && hashTypeNext(hi) != C_ERR) {
+        if (hot) {
+            sds subkey = hashTypeCurrentObjectNewSds(hi,OBJ_HASH_KEY);
+            int exists = hashTypeExists(hot,subkey);
+            sdsfree(subkey);
+            if (exists) continue;
+        }
+        if (flags & OBJ_HASH_KEY)
+            addHashIteratorCursorToReply(c,hi,OBJ_HASH_KEY);
+        if (flags & OBJ_HASH_VALUE)
+            addHashIteratorCursorToReply(c,hi,OBJ_HASH_VALUE);
+        stream->replied++;
+    }
+    hashTypeReleaseIterator(hi);
+}
+
+/* HGETALL/HKEYS/HVALS: reply header and hot fields with the first chunk,
+ * then fields in rocksdb chunk by chunk. */
+int hashStreamReply(swapData *data, client *c) {
+    swapStream *stream = data->stream;
+    int flags = hashStreamReplyFlags(c);
+
+    if (!swapStreamReplyStarted(stream)) {
+        stream->total = swapDataObjectMeta(data)->len;
+        if (data->value) stream->total += hashTypeLength(data->value);
+
+        if (flags == (OBJ_HASH_KEY|OBJ_HASH_VALUE))
+            addReplyMapLen(c,stream->total);
+        else
+            addReplyArrayLen(c,stream->total);
+
+        if (data->value)
+            hashStreamReplyFields(c,stream,data->value,NULL,flags);
+    }
+
+    if (stream->chunk)
+        hashStreamReplyFields(c,stream,stream->chunk,data->value,flags);
+
+    return !stream->eof;
+}
+
 void *hashGetObjectMetaAux(swapData *data, void *datactx) {
     UNUSED(datactx);
     size_t hotlen = data->value ? hashTypeLength(data->value) : 0;
@@ -620,6 +695,7 @@ swapDataType hashSwapDataType = {
     .rocksDel = NULL,
     .mergedIsHot = hashMergedIsHot,
     .getObjectMetaAux = hashGetObjectMetaAux,
+    .streamReply = hashStreamReply,
 };
 
 int swapDataSetupHash(swapData *d, void **pdatactx) {
@@ -627,6 +703,7 @@ int swapDataSetupHash(swapData *d, void **pdatactx) {
     d->omtype = &hashObjectMetaType;
     hashDataCtx *datactx = zmalloc(sizeof(hashDataCtx));
     datactx->ctx.num = 0;
+    datactx->ctx.ctx_flag = BIG_DATA_CTX_FLAG_NONE;
     datactx->ctx.subkeys = NULL;
     *pdatactx = datactx;
     return 0;
@@ -0,0 +1,906 @@
+/* Copyright (c) 2024, ctrip.com * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ctrip_swap.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+
+static rdbLoadIngestBuffer *rdbLoadIngestBufferNew(long long seq) {
+    rdbLoadIngestBuffer *buf = zcalloc(sizeof(rdbLoadIngestBuffer));
+    buf->seq = seq;
+    buf->capacity = RDB_LOAD_INGEST_BUFFER_INIT_COUNT;
+    buf->cfs = zmalloc(sizeof(int)*buf->capacity);
+    buf->rawkeys = zmalloc(sizeof(sds)*buf->capacity);
+    buf->rawvals = zmalloc(sizeof(sds)*buf->capacity);
+    return buf;
+}
+
+static void rdbLoadIngestBufferReleasePairs(rdbLoadIngestBuffer *buf) {
+    for (size_t i = 0; i < buf->count; i++) {
+        sdsfree(buf->rawkeys[i]);
+        sdsfree(buf->rawvals[i]);
+    }
+    buf->count = 0;
+    buf->memory = 0;
+}
+
+static void rdbLoadIngestBufferFree(rdbLoadIngestBuffer *buf) {
+    if (buf == NULL) return;
+    rdbLoadIngestBufferReleasePairs(buf);
+    zfree(buf->cfs);
+    zfree(buf->rawkeys);
+    zfree(buf->rawvals);
+    for (int cf = 0; cf < CF_COUNT; cf++) {
+        zfree(buf->offsets[cf]);
+        if (buf->files[cf] == NULL) continue;
+        unlink(buf->files[cf]);
+        sdsfree(buf->files[cf]);
+    }
+    zfree(buf);
+}
+
+static void rdbLoadIngestBufferAppend(rdbLoadIngestBuffer *buf, int cf,
+        MOVE sds rawkey, MOVE sds rawval) {
+    if (buf->count == buf->capacity) {
+        buf->capacity *= 2;
+        buf->cfs = zrealloc(buf->cfs,sizeof(int)*buf->capacity);
+        buf->rawkeys = zrealloc(buf->rawkeys,sizeof(sds)*buf->capacity);
+        buf->rawvals = zrealloc(buf->rawvals,sizeof(sds)*buf->capacity);
+    }
+    buf->cfs[buf->count] = cf;
+    buf->rawkeys[buf->count] = rawkey;
+    buf->rawvals[buf->count] = rawval;
+    buf->count++;
+    buf->memory += sdslen(rawkey) + sdslen(rawval);
+}
+
+typedef struct ingestPair {
+    sds rawkey;
+    sds rawval;
+    size_t idx; /* feed order in buffer */
+} ingestPair;
+
+static inline int ingestRawkeyCmp(sds a, sds b) {
+    size_t alen = sdslen(a), blen = sdslen(b);
+    int cmp = memcmp(a,b,MIN(alen,blen));
+    if (cmp == 0 && alen != blen) cmp = alen < blen ? -1 : 1;
+    return cmp;
+}
+
+static int ingestPairCmp(const void *a_, const void *b_) {
+    const ingestPair *a = a_, *b = b_;
+    int cmp = ingestRawkeyCmp(a->rawkey,b->rawkey);
+    if (cmp == 0) cmp = a->idx < b->idx ? -1 : (a->idx > b->idx);
+    return cmp;
+}
+
+/* Collect pairs of cf sorted in bytewise order (the comparator of all cfs),
+ * sst file requires strictly increasing keys, so only the last fed pair is
+ * kept for duplicated rawkey. Returns number of pairs collected. */
+static size_t rdbLoadIngestBufferSortCf(rdbLoadIngestBuffer *buf, int cf,
+        ingestPair *pairs) {
+    size_t i, n = 0, m = 0;
+
+    for (i = 0; i < buf->count; i++) {
+        if (buf->cfs[i] != cf) continue;
+        pairs[n].rawkey = buf->rawkeys[i];
+        pairs[n].rawval = buf->rawvals[i];
+        pairs[n].idx = i;
+        n++;
+    }
+    if (n == 0) return 0;
+
+    qsort(pairs,n,sizeof(ingestPair),ingestPairCmp);
+    for (i = 0; i < n; i++) {
+        if (i+1 < n && !ingestRawkeyCmp(pairs[i].rawkey,pairs[i+1].rawkey))
+            continue;
+        pairs[m++] = pairs[i];
+    }
+    return m;
+}
+
+/* Run file is a flat sequence of <klen:u32><vlen:u32><rawkey><rawval>,
+ * sorted by rawkey and without duplicated rawkey. */
+static int ingestRunWritePair(FILE *fp, sds rawkey, sds rawval) {
+    uint32_t hdr[2] = {(uint32_t)sdslen(rawkey), (uint32_t)sdslen(rawval)};
+    if (fwrite(hdr,sizeof(hdr),1,fp) != 1) return C_ERR;
+    if (hdr[0] && fwrite(rawkey,hdr[0],1,fp) != 1) return C_ERR;
+    if (hdr[1] && fwrite(rawval,hdr[1],1,fp) != 1) return C_ERR;
+    return C_OK;
+}
+
+/* Write buffer into one sorted run file per cf, pairs are released
+ * afterwards. Start offset of each key range is recorded, so that ranges
+ * could be merged in parallel by rdbLoadIngestFinish. Writing sst files
+ * here directly would make each file span the whole keyspace (rdb is not
+ * sorted). */
+static void rdbLoadIngestBufferWrite(rdbLoadIngestCtx *ctx,
+        rdbLoadIngestBuffer *buf) {
+    ingestPair *pairs = zmalloc(sizeof(ingestPair)*(buf->count ? buf->count : 1));
+
+    for (int cf = 0; cf < CF_COUNT && !buf->error; cf++) {
+        int r = 0, nranges = ctx->nranges[cf], retval = C_OK;
+        off_t *offsets, offset = 0;
+        size_t i, n;
+        FILE *fp;
+        sds path;
+
+        if ((n = rdbLoadIngestBufferSortCf(buf,cf,pairs)) == 0) continue;
+
+        path = sdscatprintf(sdsempty(),"%s/%lld-%s.run",ctx->dir,buf->seq,
+                swap_cf_names[cf]);
+        offsets = zmalloc(sizeof(off_t)*(nranges+1));
+        offsets[0] = 0;
+        if ((fp = fopen(path,"w")) == NULL) {
+            retval = C_ERR;
+        } else {
+            for (i = 0; i < n && retval == C_OK; i++) {
+                while (r+1 < nranges &&
+                        ingestRawkeyCmp(pairs[i].rawkey,ctx->splits[cf][r]) >= 0)
+                    offsets[++r] = offset;
+                retval = ingestRunWritePair(fp,pairs[i].rawkey,pairs[i].rawval);
+                offset += sizeof(uint32_t)*2 +
+                    sdslen(pairs[i].rawkey) + sdslen(pairs[i].rawval);
+            }
+            while (r < nranges) offsets[++r] = offset;
+            if (fclose(fp) != 0) retval = C_ERR;
+        }
+
+        if (retval != C_OK) {
+            serverLog(LL_WARNING, "[rdb load] write run file %s failed: %s",
+                    path, strerror(errno));
+            unlink(path);
+            sdsfree(path);
+            zfree(offsets);
+            buf->error = 1;
+            break;
+        }
+        buf->files[cf] = path;
+        buf->offsets[cf] = offsets;
+        buf->refs[cf] = nranges;
+        buf->file_size += offset;
+    }
+
+    zfree(pairs);
+    rdbLoadIngestBufferReleasePairs(buf);
+}
+
+typedef struct ingestRunReader {
+    FILE *fp;
+    long long seq;
+    off_t remaining; /* bytes left in key range being merged. */
+    sds rawkey;
+    sds rawval;
+} ingestRunReader;
+
+/* Returns 1 if pair read, 0 if key range exhausted, -1 if failed. */
+static int ingestRunReaderNext(ingestRunReader *r) {
+    uint32_t hdr[2];
+
+    sdsfree(r->rawkey);
+    sdsfree(r->rawval);
+    r->rawkey = r->rawval = NULL;
+    if (r->remaining == 0) return 0;
+    if (fread(hdr,sizeof(hdr),1,r->fp) != 1) return -1;
+    r->rawkey = sdsnewlen(SDS_NOINIT,hdr[0]);
+    r->rawval = sdsnewlen(SDS_NOINIT,hdr[1]);
+    if ((hdr[0] && fread(r->rawkey,hdr[0],1,r->fp) != 1) ||
+            (hdr[1] && fread(r->rawval,hdr[1],1,r->fp) != 1))
+        return -1;
+    r->remaining -= sizeof(hdr) + hdr[0] + hdr[1];
+    return r->remaining >= 0 ? 1 : -1;
+}
+
+/* Heap order: smaller rawkey first, newer run first for same rawkey. */
+static inline int ingestRunReaderCmp(ingestRunReader *a, ingestRunReader *b) {
+    int cmp = ingestRawkeyCmp(a->rawkey,b->rawkey);
+    if (cmp == 0) cmp = a->seq > b->seq ? -1 : (a->seq < b->seq);
+    return cmp;
+}
+
+static void ingestRunHeapSiftDown(ingestRunReader **heap, size_t n, size_t i) {
+    while (1) {
+        size_t l = 2*i+1, r = l+1, min = i;
+        ingestRunReader *tmp;
+        if (l < n && ingestRunReaderCmp(heap[l],heap[min]) < 0) min = l;
+        if (r < n && ingestRunReaderCmp(heap[r],heap[min]) < 0) min = r;
+        if (min == i) break;
+        tmp = heap[i], heap[i] = heap[min], heap[min] = tmp;
+        i = min;
+    }
+}
+
+typedef struct ingestSstFile {
+    sds path;
+    sds smallest;
+    sds largest;
+    uint64_t file_size;
+} ingestSstFile;
+
+static void ingestSstFileFree(void *ptr) {
+    ingestSstFile *sst = ptr;
+    if (sst == NULL) return;
+    sdsfree(sst->path);
+    sdsfree(sst->smallest);
+    sdsfree(sst->largest);
+    zfree(sst);
+}
+
+/* Release key range of runs consumed by merge: the range is punched out of
+ * run file where supported, run file is unlinked once all ranges of it
+ * merged, so that runs don't stay on disk along with whole merged data. */
+static void rdbLoadIngestMergeRelease(rdbLoadIngestCtx *ctx,
+        rdbLoadIngestMerge *merge, ingestRunReader *readers) {
+    int cf = merge->cf;
+
+    for (size_t i = 0; i < ctx->nbufs; i++) {
+        rdbLoadIngestBuffer *buf = ctx->bufs[i];
+        if (readers[i].fp) {
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+            off_t start = buf->offsets[cf][merge->range];
+            off_t len = buf->offsets[cf][merge->range+1] - start;
+            if (!merge->error && len > 0) {
+                fallocate(fileno(readers[i].fp),
+                        FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE,start,len);
+            }
+#endif
+            fclose(readers[i].fp);
+            readers[i].fp = NULL;
+        }
+        if (buf->files[cf] == NULL) continue;
+        pthread_mutex_lock(&ctx->lock);
+        if (--buf->refs[cf] == 0) {
+            unlink(buf->files[cf]);
+            sdsfree(buf->files[cf]);
+            buf->files[cf] = NULL;
+        }
+        pthread_mutex_unlock(&ctx->lock);
+    }
+}
+
+/* Merge key range of runs (newer run wins for duplicated rawkey) into sst
+ * files of about buffer_size each. Files appended to merge->ssts are sorted
+ * and disjoint, and so are files of different ranges, so that all files of
+ * a cf could be ingested in one shot and placed in the lowest level that
+ * not overlaps, instead of piling up in L0. */
+static void rdbLoadIngestMergeRange(rdbLoadIngestCtx *ctx,
+        rdbLoadIngestMerge *merge) {
+    int cf = merge->cf, range = merge->range;
+    size_t i, n = 0, written = 0, nbufs = ctx->nbufs;
+    ingestRunReader *readers = zcalloc(sizeof(ingestRunReader)*nbufs);
+    ingestRunReader **heap = zmalloc(sizeof(ingestRunReader*)*nbufs);
+    rocksdb_envoptions_t *envopts = rocksdb_envoptions_create();
+    rocksdb_sstfilewriter_t *writer = NULL;
+    ingestSstFile *sst = NULL;
+    int ret, retval = C_OK;
+    char *err = NULL;
+    sds last = NULL;
+
+    for (i = 0; i < nbufs && retval == C_OK; i++) {
+        rdbLoadIngestBuffer *buf = ctx->bufs[i];
+        ingestRunReader *r = readers+i;
+        off_t start;
+
+        if (buf->files[cf] == NULL) continue;
+        start = buf->offsets[cf][range];
+        if ((r->remaining = buf->offsets[cf][range+1] - start) == 0) continue;
+        r->seq = buf->seq;
+        if ((r->fp = fopen(buf->files[cf],"r+")) == NULL ||
+                fseeko(r->fp,start,SEEK_SET) != 0) {
+            serverLog(LL_WARNING, "[rdb load] open run file %s failed: %s",
+                    buf->files[cf], strerror(errno));
+            retval = C_ERR;
+        } else if ((ret = ingestRunReaderNext(r)) < 0) {
+            retval = C_ERR;
+        } else if (ret > 0) {
+            heap[n++] = r;
+        }
+    }
+    for (i = n/2; i > 0; i--) ingestRunHeapSiftDown(heap,n,i-1);
+
+    while (n > 0 && retval == C_OK) {
+        ingestRunReader *top = heap[0];
+
+        if (last == NULL || ingestRawkeyCmp(top->rawkey,last)) {
+            if (writer && written >= ctx->buffer_size) {
+                rocksdb_sstfilewriter_finish(writer,&err);
+                if (err == NULL)
+                    rocksdb_sstfilewriter_file_size(writer,&sst->file_size);
+                rocksdb_sstfilewriter_destroy(writer);
+                writer = NULL;
+                if (err != NULL) break;
+                sst->largest = sdsdup(last);
+                listAddNodeTail(merge->ssts,sst);
+                sst = NULL;
+            }
+            if (writer == NULL) {
+                sst = zcalloc(sizeof(ingestSstFile));
+                sst->path = sdscatprintf(sdsempty(),"%s/%s-%d-%lu.sst",
+                        ctx->dir,swap_cf_names[cf],range,
+                        listLength(merge->ssts));
+                sst->smallest = sdsdup(top->rawkey);
+                writer = rocksdb_sstfilewriter_create(envopts,
+                        server.rocks->cf_opts[cf]);
+                rocksdb_sstfilewriter_open(writer,sst->path,&err);
+                written = 0;
+                if (err != NULL) break;
+            }
+            rocksdb_sstfilewriter_put(writer,
+                    top->rawkey,sdslen(top->rawkey),
+                    top->rawval,sdslen(top->rawval),&err);
+            if (err != NULL) break;
+            written += sdslen(top->rawkey) + sdslen(top->rawval);
+            last = last ? sdscpylen(last,top->rawkey,sdslen(top->rawkey)) :
+                sdsdup(top->rawkey);
+        }
+
+        if ((ret = ingestRunReaderNext(top)) < 0) {
+            retval = C_ERR;
+        } else if (ret == 0) {
+            heap[0] = heap[--n];
+        }
+        if (n > 0) ingestRunHeapSiftDown(heap,n,0);
+    }
+
+    if (retval == C_OK && err == NULL && writer != NULL) {
+        rocksdb_sstfilewriter_finish(writer,&err);
+        if (err == NULL)
+            rocksdb_sstfilewriter_file_size(writer,&sst->file_size);
+        if (err == NULL) {
+            sst->largest = sdsdup(last);
+            listAddNodeTail(merge->ssts,sst);
+            sst = NULL;
+        }
+    }
+    if (writer != NULL) rocksdb_sstfilewriter_destroy(writer);
+
+    if (err != NULL) {
+        serverLog(LL_WARNING, "[rdb load] write sst file %s failed: %s",
+                sst ? sst->path : "", err);
+        zlibc_free(err);
+        retval = C_ERR;
+    } else if (retval != C_OK) {
+        serverLog(LL_WARNING, "[rdb load] read %s run files failed: %s",
+                swap_cf_names[cf], strerror(errno));
+    }
+    merge->error = retval != C_OK;
+
+    rdbLoadIngestMergeRelease(ctx,merge,readers);
+    ingestSstFileFree(sst);
+    sdsfree(last);
+    for (i = 0; i < nbufs; i++) {
+        sdsfree(readers[i].rawkey);
+        sdsfree(readers[i].rawval);
+    }
+    rocksdb_envoptions_destroy(envopts);
+    zfree(heap);
+    zfree(readers);
+}
+
+static void *rdbLoadIngestThreadMain(void *arg) {
+    rdbLoadIngestCtx *ctx = arg;
+    rdbLoadIngestBuffer *buf;
+    rdbLoadIngestMerge *merge;
+    listNode *ln;
+
+    redis_set_thread_title("rdb_load_ingest");
+
+    while (1) {
+        buf = NULL, merge = NULL;
+        pthread_mutex_lock(&ctx->lock);
+        while (listLength(ctx->pending) == 0 &&
+                ctx->merge_next >= ctx->nmerges && !ctx->stop)
+            pthread_cond_wait(&ctx->cond,&ctx->lock);
+        if (listLength(ctx->pending)) {
+            ln = listFirst(ctx->pending);
+            buf = listNodeValue(ln);
+            listDelNode(ctx->pending,ln);
+        } else if (ctx->merge_next < ctx->nmerges) {
+            merge = ctx->merges + ctx->merge_next++;
+        } else {
+            pthread_mutex_unlock(&ctx->lock);
+            break;
+        }
+        pthread_mutex_unlock(&ctx->lock);
+
+        if (buf) rdbLoadIngestBufferWrite(ctx,buf);
+        else rdbLoadIngestMergeRange(ctx,merge);
+
+        pthread_mutex_lock(&ctx->lock);
+        if (buf) {
+            listAddNodeTail(ctx->written,buf);
+            ctx->inflight--;
+        } else {
+            ctx->merge_inflight--;
+        }
+        pthread_cond_broadcast(&ctx->cond);
+        pthread_mutex_unlock(&ctx->lock);
+    }
+
+    return NULL;
+}
+
+static int rdbLoadIngestThreadsNum(void) {
+    int nthreads = server.swap_rdb_load_ingest_threads;
+    if (nthreads > RDB_LOAD_INGEST_THREADS_MAX)
+        nthreads = RDB_LOAD_INGEST_THREADS_MAX;
+    return nthreads;
+}
+
+static void rdbLoadIngestStartThreads(rdbLoadIngestCtx *ctx) {
+    int i, err, nthreads = rdbLoadIngestThreadsNum();
+
+    for (i = 0; i < nthreads; i++) {
+        if ((err = pthread_create(&ctx->threads[i],NULL,
+                        rdbLoadIngestThreadMain,ctx))) {
+            serverLog(LL_WARNING, "[rdb load] create ingest thread failed: %s",
+                    strerror(err));
+            break;
+        }
+        ctx->nthreads++;
+    }
+}
+
+static void rdbLoadIngestStopThreads(rdbLoadIngestCtx *ctx) {
+    pthread_mutex_lock(&ctx->lock);
+    ctx->stop = 1;
+    pthread_cond_broadcast(&ctx->cond);
+    pthread_mutex_unlock(&ctx->lock);
+
+    for (int i = 0; i < ctx->nthreads; i++)
+        pthread_join(ctx->threads[i],NULL);
+    ctx->nthreads = 0;
+    ctx->stop = 0;
+}
+
+/* Serve clients (LOADING error, PING from sentinel) and keep master link
+ * alive while waiting for ingest threads, same as rdb load progress. */
+static void rdbLoadIngestYield(rdbLoadIngestCtx *ctx) {
+    if (!server.loading) return;
+    if (mstime() - ctx->last_yield < RDB_LOAD_INGEST_YIELD_MS) return;
+    ctx->last_yield = mstime();
+    updateCachedTime(0);
+    if (server.masterhost && server.repl_state == REPL_STATE_TRANSFER)
+        replicationSendNewlineToMaster();
+    processEventsWhileBlocked();
+    processModuleLoadingProgressEvent(0);
+}
+
+/* Wait for ingest threads progress (with lock held), yielding to event
+ * loop at least every RDB_LOAD_INGEST_YIELD_MS. */
+static void rdbLoadIngestWaitLocked(rdbLoadIngestCtx *ctx) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME,&ts);
+    ts.tv_nsec += RDB_LOAD_INGEST_YIELD_MS*1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&ctx->cond,&ctx->lock,&ts);
+
+    pthread_mutex_unlock(&ctx->lock);
+    rdbLoadIngestYield(ctx);
+    pthread_mutex_lock(&ctx->lock);
+}
+
+static int ingestSdsCmp(const void *a, const void *b) {
+    return ingestRawkeyCmp(*(sds*)a,*(sds*)b);
+}
+
+/* Pick split keys of each cf from first full buffer: rdb is not sorted
+ * (keys come in dict order), so pairs of first buffer are a fair sample of
+ * keyspace. Splits must be fixed before any run written. */
+static void rdbLoadIngestSampleSplits(rdbLoadIngestCtx *ctx,
+        rdbLoadIngestBuffer *buf) {
+    int nranges = rdbLoadIngestThreadsNum()*RDB_LOAD_INGEST_RANGES_PER_THREAD;
+    size_t nsamples = (size_t)nranges*RDB_LOAD_INGEST_RANGE_SAMPLES;
+    sds *samples;
+
+    if (nranges <= 1) return;
+    samples = zmalloc(sizeof(sds)*nsamples);
+    for (int cf = 0; cf < CF_COUNT; cf++) {
+        size_t i, j = 0, n = 0, count = 0, stride;
+        int nsplits = 0;
+
+        for (i = 0; i < buf->count; i++) if (buf->cfs[i] == cf) count++;
+        if (count < nsamples) continue; /* too few pairs to split. */
+
+        stride = count/nsamples;
+        for (i = 0; i < buf->count && n < nsamples; i++) {
+            if (buf->cfs[i] != cf) continue;
+            if (j++ % stride == 0) samples[n++] = buf->rawkeys[i];
+        }
+        qsort(samples,n,sizeof(sds),ingestSdsCmp);
+
+        ctx->splits[cf] = zmalloc(sizeof(sds)*(nranges-1));
+        for (int r = 1; r < nranges; r++) {
+            sds split = samples[r*n/nranges];
+            if (nsplits && !ingestRawkeyCmp(split,ctx->splits[cf][nsplits-1]))
+                continue;
+            ctx->splits[cf][nsplits++] = sdsdup(split);
+        }
+        ctx->nranges[cf] = nsplits+1;
+    }
+    zfree(samples);
+}
+
+/* Hand current buffer to ingest threads, blocks if all threads busy so
+ * that at most (nthreads+1) buffers are in memory. */
+static void rdbLoadIngestDispatch(rdbLoadIngestCtx *ctx) {
+    rdbLoadIngestBuffer *buf = ctx->buffer;
+
+    if (buf == NULL) return;
+    ctx->buffer = NULL;
+
+    if (ctx->nthreads == 0) rdbLoadIngestStartThreads(ctx);
+    if (ctx->nthreads == 0) {
+        rdbLoadIngestBufferWrite(ctx,buf);
+        listAddNodeTail(ctx->written,buf);
+        return;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    while (ctx->inflight >= ctx->nthreads)
+        pthread_cond_wait(&ctx->cond,&ctx->lock);
+    ctx->inflight++;
+    listAddNodeTail(ctx->pending,buf);
+    pthread_cond_broadcast(&ctx->cond);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+rdbLoadIngestCtx *rdbLoadIngestCtxNew(void) {
+    rdbLoadIngestCtx *ctx;
+    struct stat statbuf;
+    sds dir = sdscatprintf(sdsempty(),"%s/%d%s",ROCKS_DATA,
+            server.rocksdb_epoch,RDB_LOAD_INGEST_DIR_SUFFIX);
+
+    if (!stat(dir,&statbuf)) rmdirRecursive(dir);
+    if (mkdir(dir,0755)) {
+        serverLog(LL_WARNING, "[rdb load] mkdir %s failed: %s, "
+                "fallback to load without ingest.", dir, strerror(errno));
+        sdsfree(dir);
+        return NULL;
+    }
+
+    ctx = zcalloc(sizeof(rdbLoadIngestCtx));
+    ctx->dir = dir;
+    ctx->buffer_size = server.swap_rdb_load_ingest_buffer_size;
+    pthread_mutex_init(&ctx->lock,NULL);
+    pthread_cond_init(&ctx->cond,NULL);
+    ctx->pending = listCreate();
+    ctx->written = listCreate();
+    for (int cf = 0; cf < CF_COUNT; cf++) ctx->nranges[cf] = 1;
+    ctx->start_time = ustime();
+    return ctx;
+}
+
+void rdbLoadIngestCtxFree(rdbLoadIngestCtx *ctx) {
+    listNode *ln;
+    listIter li;
+    size_t i;
+
+    if (ctx == NULL) return;
+    if (ctx->nthreads) rdbLoadIngestStopThreads(ctx);
+
+    rdbLoadIngestBufferFree(ctx->buffer);
+    listRewind(ctx->pending,&li);
+    while ((ln = listNext(&li))) rdbLoadIngestBufferFree(listNodeValue(ln));
+    listRelease(ctx->pending);
+    listRewind(ctx->written,&li);
+    while ((ln = listNext(&li))) rdbLoadIngestBufferFree(listNodeValue(ln));
+    listRelease(ctx->written);
+    for (i = 0; i < ctx->nbufs; i++) rdbLoadIngestBufferFree(ctx->bufs[i]);
+    zfree(ctx->bufs);
+    for (int m = 0; m < ctx->nmerges; m++) listRelease(ctx->merges[m].ssts);
+    zfree(ctx->merges);
+    for (int cf = 0; cf < CF_COUNT; cf++) {
+        if (ctx->splits[cf] == NULL) continue;
+        for (int r = 0; r < ctx->nranges[cf]-1; r++) sdsfree(ctx->splits[cf][r]);
+        zfree(ctx->splits[cf]);
+    }
+
+    pthread_mutex_destroy(&ctx->lock);
+    pthread_cond_destroy(&ctx->cond);
+    rmdirRecursive(ctx->dir);
+    sdsfree(ctx->dir);
+    zfree(ctx);
+}
+
+void rdbLoadIngestFeed(rdbLoadIngestCtx *ctx, int cf, MOVE sds rawkey,
+        MOVE sds rawval) {
+    if (ctx->buffer == NULL)
+        ctx->buffer = rdbLoadIngestBufferNew(ctx->seq++);
+    rdbLoadIngestBufferAppend(ctx->buffer,cf,rawkey,rawval);
+    ctx->keys++;
+    if (ctx->buffer->memory >= ctx->buffer_size) {
+        if (ctx->buffer->seq == 0) rdbLoadIngestSampleSplits(ctx,ctx->buffer);
+        rdbLoadIngestDispatch(ctx);
+    }
+}
+
+static int rdbLoadIngestBufferSeqCmp(const void *a_, const void *b_) {
+    const rdbLoadIngestBuffer *a = *(rdbLoadIngestBuffer**)a_,
+          *b = *(rdbLoadIngestBuffer**)b_;
+    return a->seq < b->seq ? -1 : (a->seq > b->seq);
+}
+
+/* Merge runs of written buffers (ctx->bufs) range by range, in ingest
+ * threads if any, while main thread keeps serving events. */
+static int rdbLoadIngestMergeAll(rdbLoadIngestCtx *ctx) {
+    rdbLoadIngestMerge *merges;
+    int nmerges = 0, retval = C_OK;
+
+    for (int cf = 0; cf < CF_COUNT; cf++) nmerges += ctx->nranges[cf];
+    merges = zcalloc(sizeof(rdbLoadIngestMerge)*nmerges);
+    nmerges = 0;
+    for (int cf = 0; cf < CF_COUNT; cf++) {
+        size_t i;
+        for (i = 0; i < ctx->nbufs && ctx->bufs[i]->files[cf] == NULL; i++);
+        if (i == ctx->nbufs) continue; /* no pair of this cf. */
+        for (int r = 0; r < ctx->nranges[cf]; r++) {
+            rdbLoadIngestMerge *merge = merges + nmerges++;
+            merge->cf = cf;
+            merge->range = r;
+            merge->ssts = listCreate();
+            listSetFreeMethod(merge->ssts,ingestSstFileFree);
+        }
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    ctx->merges = merges;
+    ctx->nmerges = nmerges;
+    ctx->merge_next = 0;
+    ctx->merge_inflight = nmerges;
+    if (ctx->nthreads) {
+        pthread_cond_broadcast(&ctx->cond);
+        while (ctx->merge_inflight) rdbLoadIngestWaitLocked(ctx);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    /* no ingest thread available: merge in main thread. */
+    while (ctx->merge_next < ctx->nmerges) {
+        rdbLoadIngestMergeRange(ctx,ctx->merges + ctx->merge_next++);
+        ctx->merge_inflight--;
+        rdbLoadIngestYield(ctx);
+    }
+
+    for (int m = 0; m < nmerges; m++) {
+        if (merges[m].error) retval = C_ERR;
+    }
+    return retval;
+}
+
+/* Wait until all buffers written, merge runs into sst files of disjoint key
+ * ranges and ingest them cf by cf: ingested files are assigned a newer
+ * seqno, so that loaded keys overwrite keys existed before loading, while
+ * newer run wins for duplicated rawkey within merge, same as put. */
+int rdbLoadIngestFinish(rdbLoadIngestCtx *ctx) {
+    rocksdb_ingestexternalfileoptions_t *opts;
+    long long files = 0, file_size = 0;
+    char *err = NULL;
+    listNode *ln;
+    listIter li;
+    size_t i;
+    int m = 0, retval = C_OK;
+
+    rdbLoadIngestDispatch(ctx);
+    pthread_mutex_lock(&ctx->lock);
+    while (ctx->inflight) rdbLoadIngestWaitLocked(ctx);
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (listLength(ctx->written) == 0) return C_OK;
+
+    ctx->nbufs = listLength(ctx->written);
+    ctx->bufs = zmalloc(sizeof(rdbLoadIngestBuffer*)*ctx->nbufs);
+    for (i = 0; i < ctx->nbufs; i++) {
+        ln = listFirst(ctx->written);
+        ctx->bufs[i] = listNodeValue(ln);
+        listDelNode(ctx->written,ln);
+        if (ctx->bufs[i]->error) retval = C_ERR;
+    }
+    if (retval != C_OK) return retval;
+    qsort(ctx->bufs,ctx->nbufs,sizeof(rdbLoadIngestBuffer*),
+            rdbLoadIngestBufferSeqCmp);
+
+    if (rdbLoadIngestMergeAll(ctx) != C_OK) return C_ERR;
+
+    opts = rocksdb_ingestexternalfileoptions_create();
+    rocksdb_ingestexternalfileoptions_set_move_files(opts,1);
+    rocksdb_ingestexternalfileoptions_set_allow_global_seqno(opts,1);
+    rocksdb_ingestexternalfileoptions_set_allow_blocking_flush(opts,1);
+    while (m < ctx->nmerges && retval == C_OK) {
+        int cf = ctx->merges[m].cf;
+        const char **paths;
+        size_t npaths = 0;
+
+        for (i = m; i < (size_t)ctx->nmerges && ctx->merges[i].cf == cf; i++)
+            npaths += listLength(ctx->merges[i].ssts);
+        paths = zmalloc(sizeof(char*)*(npaths ? npaths : 1));
+        npaths = 0;
+        for (; m < ctx->nmerges && ctx->merges[m].cf == cf; m++) {
+            listRewind(ctx->merges[m].ssts,&li);
+            while ((ln = listNext(&li))) {
+                ingestSstFile *sst = listNodeValue(ln);
+                paths[npaths++] = sst->path;
+                file_size += sst->file_size;
+            }
+        }
+
+        if (npaths) {
+            rocksdb_ingest_external_file_cf(server.rocks->db,
+                    server.rocks->cf_handles[cf],paths,npaths,opts,&err);
+        }
+        zfree(paths);
+        if (err != NULL) {
+            serverLog(LL_WARNING, "[rdb load] ingest %zu %s sst files failed: %s",
+                    npaths, swap_cf_names[cf], err);
+            zlibc_free(err);
+            retval = C_ERR;
+            break;
+        }
+        files += npaths;
+    }
+    rocksdb_ingestexternalfileoptions_destroy(opts);
+
+    if (retval == C_OK) {
+        serverLog(LL_NOTICE,
+                "[rdb load] ingested %lld sst files (%lld bytes, %lld pairs) in %lld ms.",
+                files, file_size, ctx->keys, (ustime()-ctx->start_time)/1000);
+    }
+    return retval;
+}
+
+#ifdef REDIS_TEST
+
+void initServerConfig(void);
+int swapIngestTest(int argc, char *argv[], int accurate) {
+    UNUSED(argc);
+    UNUSED(argv);
+    UNUSED(accurate);
+    int error = 0;
+
+    TEST("ingest: init") {
+        initServerConfig();
+        if (!server.rocks) rocksInit();
+    }
+
+    TEST("ingest: sort & dedup buffer") {
+        rdbLoadIngestBuffer *buf = rdbLoadIngestBufferNew(0);
+        ingestPair *pairs = zmalloc(sizeof(ingestPair)*8);
+        size_t n;
+
+        rdbLoadIngestBufferAppend(buf,DATA_CF,sdsnew("b"),sdsnew("1"));
+        rdbLoadIngestBufferAppend(buf,META_CF,sdsnew("a"),sdsnew("m"));
+        rdbLoadIngestBufferAppend(buf,DATA_CF,sdsnew("ab"),sdsnew("2"));
+        rdbLoadIngestBufferAppend(buf,DATA_CF,sdsnew("a"),sdsnew("3"));
+        rdbLoadIngestBufferAppend(buf,DATA_CF,sdsnew("b"),sdsnew("4"));
+
+        n = rdbLoadIngestBufferSortCf(buf,DATA_CF,pairs);
+        test_assert(n == 3);
+        test_assert(!strcmp(pairs[0].rawkey,"a") && !strcmp(pairs[0].rawval,"3"));
+        test_assert(!strcmp(pairs[1].rawkey,"ab") && !strcmp(pairs[1].rawval,"2"));
+        test_assert(!strcmp(pairs[2].rawkey,"b") && !strcmp(pairs[2].rawval,"4"));
+        test_assert(rdbLoadIngestBufferSortCf(buf,META_CF,pairs) == 1);
+        test_assert(rdbLoadIngestBufferSortCf(buf,SCORE_CF,pairs) == 0);
+
+        zfree(pairs);
+        rdbLoadIngestBufferFree(buf);
+    }
+
+    TEST("ingest: later buffer overwrites former") {
+        rdbLoadIngestCtx *ctx;
+        char *val, *err = NULL;
+        size_t vlen;
+
+        server.swap_rdb_load_ingest_threads = 2;
+        server.swap_rdb_load_ingest_buffer_size = 1;
+        ctx = rdbLoadIngestCtxNew();
+        test_assert(ctx != NULL);
+        rdbLoadIngestFeed(ctx,DATA_CF,sdsnew("ingest_k1"),sdsnew("v1"));
+        rdbLoadIngestFeed(ctx,META_CF,sdsnew("ingest_k2"),sdsnew("v2"));
+        rdbLoadIngestFeed(ctx,DATA_CF,sdsnew("ingest_k1"),sdsnew("v3"));
+        test_assert(rdbLoadIngestFinish(ctx) == C_OK);
+        rdbLoadIngestCtxFree(ctx);
+
+        val = rocksdb_get_cf(server.rocks->db,server.rocks->ropts,
+                server.rocks->cf_handles[DATA_CF],"ingest_k1",9,&vlen,&err);
+        test_assert(err == NULL && val && vlen == 2 && !memcmp(val,"v3",2));
+        zlibc_free(val);
+        val = rocksdb_get_cf(server.rocks->db,server.rocks->ropts,
+                server.rocks->cf_handles[META_CF],"ingest_k2",9,&vlen,&err);
+        test_assert(err == NULL && val && vlen == 2 && !memcmp(val,"v2",2));
+        zlibc_free(val);
+
+        rocksdb_delete_cf(server.rocks->db,server.rocks->wopts,
+                server.rocks->cf_handles[DATA_CF],"ingest_k1",9,&err);
+        test_assert(err == NULL);
+        rocksdb_delete_cf(server.rocks->db,server.rocks->wopts,
+                server.rocks->cf_handles[META_CF],"ingest_k2",9,&err);
+        test_assert(err == NULL);
+    }
+
+    TEST("ingest: merge runs into sst files of disjoint key ranges") {
+        rdbLoadIngestBuffer *bufs[2];
+        rdbLoadIngestCtx *ctx;
+        ingestSstFile *sst, *prev = NULL;
+        listNode *ln;
+        listIter li;
+
+        ctx = rdbLoadIngestCtxNew();
+        test_assert(ctx != NULL);
+        ctx->buffer_size = 32;
+        ctx->nranges[DATA_CF] = 2;
+        ctx->splits[DATA_CF] = zmalloc(sizeof(sds));
+        ctx->splits[DATA_CF][0] = sdsnew("ingest_m10");
+        for (int i = 0; i < 2; i++) bufs[i] = rdbLoadIngestBufferNew(i);
+        for (int i = 0; i < 20; i++) {
+            rdbLoadIngestBufferAppend(bufs[i%2],DATA_CF,
+                    sdscatprintf(sdsempty(),"ingest_m%02d",i),sdsnew("v"));
+        }
+        rdbLoadIngestBufferAppend(bufs[1],DATA_CF,sdsnew("ingest_m00"),sdsnew("v"));
+        for (int i = 0; i < 2; i++) {
+            rdbLoadIngestBufferWrite(ctx,bufs[i]);
+            test_assert(!bufs[i]->error && bufs[i]->files[DATA_CF] != NULL);
+            test_assert(bufs[i]->files[SCORE_CF] == NULL);
+            test_assert(bufs[i]->offsets[DATA_CF][0] == 0);
+            test_assert(bufs[i]->offsets[DATA_CF][1] > 0);
+            test_assert(bufs[i]->offsets[DATA_CF][2] > bufs[i]->offsets[DATA_CF][1]);
+        }
+        ctx->nbufs = 2;
+        ctx->bufs = zmalloc(sizeof(rdbLoadIngestBuffer*)*2);
+        ctx->bufs[0] = bufs[0], ctx->bufs[1] = bufs[1];
+
+        test_assert(rdbLoadIngestMergeAll(ctx) == C_OK);
+        test_assert(ctx->nmerges == 2);
+        for (int m = 0; m < ctx->nmerges; m++) {
+            test_assert(ctx->merges[m].cf == DATA_CF && ctx->merges[m].range == m);
+            test_assert(listLength(ctx->merges[m].ssts) > 1);
+            listRewind(ctx->merges[m].ssts,&li);
+            while ((ln = listNext(&li))) {
+                sst = listNodeValue(ln);
+                test_assert(ingestRawkeyCmp(sst->smallest,sst->largest) <= 0);
+                if (prev) test_assert(ingestRawkeyCmp(prev->largest,sst->smallest) < 0);
+                if (m == 0) test_assert(strcmp(sst->largest,"ingest_m10") < 0);
+                else test_assert(strcmp(sst->smallest,"ingest_m10") >= 0);
+                prev = sst;
+            }
+        }
+        sst = listNodeValue(listFirst(ctx->merges[0].ssts));
+        test_assert(!strcmp(sst->smallest,"ingest_m00"));
+        sst = listNodeValue(listLast(ctx->merges[1].ssts));
+        test_assert(!strcmp(sst->largest,"ingest_m19"));
+        /* runs unlinked once all ranges merged. */
+        test_assert(bufs[0]->files[DATA_CF] == NULL && bufs[1]->files[DATA_CF] == NULL);
+
+        rdbLoadIngestCtxFree(ctx);
+    }
+
+    return error;
+}
+
+#endif
@@ -27,79 +27,143 @@
  */
 
 #include "ctrip_swap.h"
+#include <sched.h>
 
+static inline void rocksIterSpinPause(int spins) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+    if ((spins & 63) == 63) sched_yield();
+}
+
+static inline int rocksIterReady(bufferedIterCompleteQueue *cq,
+        int64_t processed, int *finished) {
+    int64_t buffered;
+    atomicGetWithSync(cq->iter_finished,*finished);
+    atomicGetWithSync(cq->buffered_count,buffered);
+    return processed < buffered;
+}
+
+/* Wait untill iterResult ready (returns 1) or iter finished (returns 0),
+ * only consumer calls. */
 static int rocksIterWaitReady(rocksIter* it) {
+    int spins = 0, finished;
+    int64_t processed;
     bufferedIterCompleteQueue *cq = it->buffered_cq;
-    pthread_mutex_lock(&cq->buffer_lock);
+
+    atomicGet(cq->processed_count,processed);
+
     while (1) {
-        /* iterResult ready */
-        if (cq->processed_count < cq->buffered_count)
-            break;
-        /* iter finished */
-        if (cq->iter_finished) {
-            pthread_mutex_unlock(&cq->buffer_lock);
-            return 0;
+        /* iter_finished checked before buffered_count, so that results
+         * buffered before finish won't be missed. */
+        if (rocksIterReady(cq,processed,&finished)) return 1;
+        if (finished) return 0;
+
+        if (spins++ < ITER_SPIN_MAX) {
+            rocksIterSpinPause(spins);
+            continue;
         }
-        /* wait io thread */
-        pthread_cond_wait(&cq->ready_cond, &cq->buffer_lock);
+
+        /* park untill producer publish or finish. */
+        pthread_mutex_lock(&cq->buffer_lock);
+        atomicSetWithSync(cq->consumer_parked,1);
+        if (!rocksIterReady(cq,processed,&finished) && !finished) {
+            cq->consumer_park_count++;
+            pthread_cond_wait(&cq->ready_cond, &cq->buffer_lock);
+        }
+        atomicSetWithSync(cq->consumer_parked,0);
+        pthread_mutex_unlock(&cq->buffer_lock);
+        spins = 0;
     }
-    pthread_mutex_unlock(&cq->buffer_lock);
-    return 1;
 }
 
-static void rocksIterNotifyReady(rocksIter* it, int signal) {
-    bufferedIterCompleteQueue *cq = it->buffered_cq;
+static inline void rocksIterUnpark(bufferedIterCompleteQueue *cq,
+        redisAtomic int *parked, pthread_cond_t *cond) {
+    int is_parked;
+    atomicGetWithSync(*parked,is_parked);
+    if (!is_parked) return;
     pthread_mutex_lock(&cq->buffer_lock);
-    cq->buffered_count++;
-    if (signal) pthread_cond_signal(&cq->ready_cond);
+    pthread_cond_signal(cond);
     pthread_mutex_unlock(&cq->buffer_lock);
 }
 
+/* Publish count buffered results, only producer calls. */
+static void rocksIterNotifyReady(rocksIter* it, int64_t count) {
+    int64_t buffered;
+    bufferedIterCompleteQueue *cq = it->buffered_cq;
+    atomicGet(cq->buffered_count,buffered);
+    atomicSetWithSync(cq->buffered_count,buffered+count);
+    rocksIterUnpark(cq,&cq->consumer_parked,&cq->ready_cond);
+}
+
 static void rocksIterNotifyFinshed(rocksIter* it) {
     bufferedIterCompleteQueue *cq = it->buffered_cq;
-    pthread_mutex_lock(&cq->buffer_lock);
-    cq->iter_finished = 1;
-    pthread_cond_signal(&cq->ready_cond);
-    pthread_mutex_unlock(&cq->buffer_lock);
+    atomicSetWithSync(cq->iter_finished,1);
+    rocksIterUnpark(cq,&cq->consumer_parked,&cq->ready_cond);
+}
+
+static inline int64_t rocksIterVacant(bufferedIterCompleteQueue *cq,
+        int64_t buffered) {
+    int64_t processed, slots;
+    atomicGetWithSync(cq->processed_count,processed);
+    slots = cq->buffer_capacity - (buffered - processed);
+    if (slots < 0) serverPanic("CQ slots is negative.");
+    return slots;
 }
 
-static int rocksIterWaitVacant(rocksIter *it) {
-    int64_t slots, occupied;
+/* Wait untill there are vacant slots in buffer, only producer calls. */
+static int64_t rocksIterWaitVacant(rocksIter *it) {
+    int spins = 0;
+    int64_t slots, buffered;
     bufferedIterCompleteQueue *cq = it->buffered_cq;
-    /* wait untill there are vacant slots in buffer. */
-    pthread_mutex_lock(&cq->buffer_lock);
+
+    atomicGet(cq->buffered_count,buffered);
+
     while (1) {
-        occupied = cq->buffered_count - cq->processed_count;
-        slots = cq->buffer_capacity - occupied;
-        if (slots < 0) {
-            serverPanic("CQ slots is negative.");
-        } else if (slots == 0) {
+        if ((slots = rocksIterVacant(cq,buffered)) > 0) return slots;
+
+        if (spins++ < ITER_SPIN_MAX) {
+            rocksIterSpinPause(spins);
+            continue;
+        }
+
+        pthread_mutex_lock(&cq->buffer_lock);
+        atomicSetWithSync(cq->producer_parked,1);
+        if ((slots = rocksIterVacant(cq,buffered)) == 0) {
+            cq->producer_park_count++;
             pthread_cond_wait(&cq->vacant_cond, &cq->buffer_lock);
-        } else {
-            break;
         }
+        atomicSetWithSync(cq->producer_parked,0);
+        pthread_mutex_unlock(&cq->buffer_lock);
+        spins = 0;
     }
-    pthread_mutex_unlock(&cq->buffer_lock);
-    return slots;
 }
 
+/* Release slot consumed, only consumer calls. */
 static void rocksIterNotifyVacant(rocksIter* it) {
+    int64_t processed;
     bufferedIterCompleteQueue *cq = it->buffered_cq;
-    pthread_mutex_lock(&cq->buffer_lock);
-    cq->processed_count++;
-    pthread_cond_signal(&cq->vacant_cond);
-    pthread_mutex_unlock(&cq->buffer_lock);
+    atomicGet(cq->processed_count,processed);
+    atomicSetWithSync(cq->processed_count,processed+1);
+    rocksIterUnpark(cq,&cq->producer_parked,&cq->vacant_cond);
 }
 
 static inline void iterResultInit(iterResult *result,
-        int cf, unsigned char rdbtype,
-        MOVE sds rawkey, MOVE sds rawval) {
+        int cf, unsigned char rdbtype, const char *rawkey, size_t rklen,
+        MOVE sds rawval) {
     result->cf = cf;
     result->rdbtype = rdbtype;
-    result->rawkey = rawkey;
+    /* rawkey buffer reused, so that only rawval allocated for each result. */
+    if (result->rawkey) {
+        result->rawkey = sdscpylen(result->rawkey,rawkey,rklen);
+    } else {
+        result->rawkey = sdsnewlen(rawkey,rklen);
+    }
     result->rawval = rawval;
 #ifdef SWAP_DEBUG
-    sds rawkeyrepr = sdscatrepr(sdsempty(),rawkey,sdslen(rawkey));
+    sds rawkeyrepr = sdscatrepr(sdsempty(),rawkey,rklen);
     sds rawvalrepr = sdscatrepr(sdsempty(),rawval,sdslen(rawval));
     serverLog(LL_WARNING, "iterated: cf=%d, rawkey=%s, rawval=%s",
             cf, rawkeyrepr, rawvalrepr);
@@ -123,16 +187,19 @@ void *rocksIterIOThreadMain(void *arg) {
     rocksIter *it = arg;
     size_t meta_itered = 0, data_itered = 0, accumulated_memory = 0;
     mstime_t last_ratelimit_time = mstime();
-    int signal;
+    int finished = 0;
     bufferedIterCompleteQueue *cq = it->buffered_cq;
 
     redis_set_thread_title("rocks_iter");
 
-    while (!cq->iter_finished) {
-        int64_t slots = rocksIterWaitVacant(it);
+    while (!finished) {
+        int64_t slots = rocksIterWaitVacant(it), buffered, pending = 0;
+
+        atomicGet(cq->buffered_count,buffered);
 
         /* there are only one producer, slots will decrease only by current
-         * thread, we can produce multiple iterResult in one loop. */
+         * thread, we can produce multiple iterResult in one loop, results
+         * are published in batch of ITER_NOTIFY_BATCH. */
         while (slots--) {
             iterResult *cur;
             int curidx, meta_valid, data_valid, cf = -1;
@@ -143,16 +210,11 @@ void *rocksIterIOThreadMain(void *arg) {
             meta_valid = rocksdbIterValid(it->meta_iter,it->meta_endkey);
             data_valid = rocksdbIterValid(it->data_iter,it->data_endkey);
             if (!meta_valid && !data_valid) {
-                rocksIterNotifyFinshed(it);
-                if (meta_itered || data_itered) {
-                    serverLog(LL_WARNING,
-                            "Rocks iter thread iterated meta=%ld data=%ld.",
-                            meta_itered, data_itered);
-                }
+                finished = 1;
                 break;
             }
 
-            curidx = cq->buffered_count % cq->buffer_capacity;
+            curidx = (buffered + pending) % cq->buffer_capacity;
             cur = cq->buffered + curidx;
 
             if (meta_valid) {
@@ -185,7 +247,7 @@ void *rocksIterIOThreadMain(void *arg) {
             }
 
             if (cf == META_CF) {
-                iterResultInit(cur,cf,-1,sdsnewlen(meta_rawkey,meta_rklen),
+                iterResultInit(cur,cf,-1,meta_rawkey,meta_rklen,
                         sdsnewlen(meta_rawval,meta_rvlen));
                 meta_itered++;
                 accumulated_memory += meta_rklen+meta_rvlen;
@@ -199,17 +261,20 @@ void *rocksIterIOThreadMain(void *arg) {
                     rdbtype = data_rawval[0];
                     data_rawval++, data_rvlen--;
                 }
-                iterResultInit(cur,cf,rdbtype,sdsnewlen(data_rawkey,data_rklen),
+                iterResultInit(cur,cf,rdbtype,data_rawkey,data_rklen,
                         sdsnewlen(data_rawval,data_rvlen));
                 data_itered++;
                 accumulated_memory += data_rklen+data_rvlen;
                 rocksdb_iter_next(it->data_iter);
             }
 
-            signal = ((data_itered + meta_itered) & (ITER_NOTIFY_BATCH-1)) ? 0 : 1;
-            rocksIterNotifyReady(it, signal);
+            if (++pending < ITER_NOTIFY_BATCH) continue;
+
+            rocksIterNotifyReady(it,pending);
+            buffered += pending;
+            pending = 0;
 
-            if (server.swap_repl_max_rocksdb_read_bps && signal &&
+            if (server.swap_repl_max_rocksdb_read_bps &&
                     mstime() - last_ratelimit_time >
                     ITER_RATE_LIMIT_INTERVAL_MS) {
                 mstime_t minimal_timespan = accumulated_memory*1000/server.swap_repl_max_rocksdb_read_bps;
@@ -226,6 +291,18 @@ void *rocksIterIOThreadMain(void *arg) {
                 accumulated_memory = 0;
             }
         }
+
+        /* publish partial batch before waiting for vacant or finish. */
+        if (pending) rocksIterNotifyReady(it,pending);
+    }
+
+    rocksIterNotifyFinshed(it);
+    if (meta_itered || data_itered) {
+        serverLog(LL_WARNING,
+                "Rocks iter thread iterated meta=%ld data=%ld, "
+                "parked consumer=%lld producer=%lld.",
+                meta_itered, data_itered, cq->consumer_park_count,
+                cq->producer_park_count);
     }
 
     return NULL;
@@ -274,15 +351,12 @@ void bufferedIterCompleteQueueFree(bufferedIterCompleteQueue *buffered_cq) {
     zfree(buffered_cq);
 }
 
-rocksIter *rocksCreateIter(rocks *rocks, redisDb *db) {
-    int error, i;
-    rocksdb_iterator_t *data_iter = NULL, *meta_iter = NULL;
-    rocksIter *it = zcalloc(sizeof(rocksIter));
-    sds meta_start_key = NULL, data_start_key = NULL;
+rocksIterSource *rocksCreateIterSource(rocks *rocks) {
+    int i;
+    rocksIterSource *source = zcalloc(sizeof(rocksIterSource));
 
-    it->rocks = rocks;
-    it->db = db;
-    it->checkpoint_db = NULL;
+    source->rocks = rocks;
+    source->checkpoint_db = NULL;
 
     if (rocks->rdb_checkpoint_dir != NULL) {
         serverLog(LL_WARNING, "[rocks] create iter from checkpoint %s.", rocks->rdb_checkpoint_dir);
@@ -301,43 +375,169 @@ rocksIter *rocksCreateIter(rocks *rocks, redisDb *db) {
         rocksdb_t* checkpoint_db = rocksdb_open_column_families(rocks->db_opts,
                 rocks->rdb_checkpoint_dir, CF_COUNT, swap_cf_names,
                 (const rocksdb_options_t *const *)cf_opts,
-                it->cf_handles, errs);
+                source->cf_handles, errs);
         for (i = 0; i < CF_COUNT; i++) rocksdb_options_destroy(cf_opts[i]);
 
-        if (errs[0] || errs[1] || errs[2]) {
+        if (errs[0] || errs[1] || errs[2] || errs[3]) {
             serverLog(LL_WARNING,
-                    "[rocks] rocksdb open db fail, dir:%s, default_cf=%s, meta_cf=%s, score_cf=%s",
-                    rocks->rdb_checkpoint_dir, errs[0], errs[1], errs[2]);
+                    "[rocks] rocksdb open db fail, dir:%s, default_cf=%s, meta_cf=%s, score_cf=%s, expire_cf=%s",
+                    rocks->rdb_checkpoint_dir, errs[0], errs[1], errs[2], errs[3]);
             goto err;
         }
-        it->checkpoint_db = checkpoint_db;
-        data_iter = rocksdb_create_iterator_cf(it->checkpoint_db, rocks->ropts,
-                it->cf_handles[DATA_CF]);
-        meta_iter = rocksdb_create_iterator_cf(it->checkpoint_db, rocks->ropts,
-                it->cf_handles[META_CF]);
+        source->checkpoint_db = checkpoint_db;
+        source->db = checkpoint_db;
     } else {
-        data_iter = rocksdb_create_iterator_cf(rocks->db, rocks->ropts,
-                rocks->cf_handles[DATA_CF]);
-        meta_iter = rocksdb_create_iterator_cf(rocks->db, rocks->ropts,
-                rocks->cf_handles[META_CF]);
+        source->db = rocks->db;
+    }
+
+    return source;
+
+err:
+    rocksReleaseIterSource(source);
+    return NULL;
+}
+
+void rocksReleaseIterSource(rocksIterSource *source) {
+    int i;
+
+    if (source == NULL) return;
+
+    if (source->checkpoint_db != NULL) {
+        for (i = 0; i < CF_COUNT; i++) {
+            if (source->cf_handles[i]) {
+                rocksdb_column_family_handle_destroy(source->cf_handles[i]);
+                source->cf_handles[i] = NULL;
+            }
+        }
+        rocksdb_close(source->checkpoint_db);
+        source->checkpoint_db = NULL;
+    }
+    source->db = NULL;
+    zfree(source);
+}
+
+static inline rocksdb_column_family_handle_t *rocksIterSourceCfHandle(
+        rocksIterSource *source, int cf) {
+    return source->checkpoint_db ? source->cf_handles[cf] :
+        source->rocks->cf_handles[cf];
+}
+
+typedef struct rangeBoundCandidate {
+    sds metakey;
+    size_t size;
+} rangeBoundCandidate;
+
+static int rangeBoundCandidateCmp(const void *a_, const void *b_) {
+    const rangeBoundCandidate *a = a_, *b = b_;
+    return sdscmp(a->metakey,b->metakey);
+}
+
+/* Split keyspace of db into at most nranges disjoint ranges with roughly
+ * equal sst size. Returns sorted inner boundaries (nbounds < nranges), each
+ * boundary is a meta key, and since meta key is prefix of all its data keys,
+ * no key straddles two ranges. Returns NULL if keyspace can't be split. */
+sds *rocksIterSourceSplitDb(rocksIterSource *source, int dbid,
+        int nranges, int *pnbounds) {
+    const rocksdb_livefiles_t *livefiles;
+    rangeBoundCandidate *candidates;
+    int i, count, ncandidates = 0, nbounds = 0;
+    size_t total = 0, accumulated = 0;
+    sds *bounds = NULL;
+
+    *pnbounds = 0;
+    if (nranges <= 1) return NULL;
+    if ((livefiles = rocksdb_livefiles(source->db)) == NULL) return NULL;
+
+    count = rocksdb_livefiles_count(livefiles);
+    candidates = zmalloc(sizeof(rangeBoundCandidate)*(count+1));
+
+    for (i = 0; i < count; i++) {
+        const char *cfname, *rawkey, *key;
+        size_t rklen, keylen;
+        int keydbid, retval;
+
+        cfname = rocksdb_livefiles_column_family_name(livefiles,i);
+        rawkey = rocksdb_livefiles_smallestkey(livefiles,i,&rklen);
+
+        if (!strcmp(cfname,swap_cf_names[META_CF])) {
+            retval = rocksDecodeMetaKey(rawkey,rklen,&keydbid,&key,&keylen);
+        } else if (!strcmp(cfname,swap_cf_names[DATA_CF])) {
+            retval = rocksDecodeDataKey(rawkey,rklen,&keydbid,&key,&keylen,
+                    NULL,NULL,NULL);
+        } else {
+            continue;
+        }
+        if (retval || keydbid != dbid) continue;
+
+        candidates[ncandidates].metakey = encodeMetaKey(dbid,key,keylen);
+        candidates[ncandidates].size = rocksdb_livefiles_size(livefiles,i);
+        total += candidates[ncandidates].size;
+        ncandidates++;
+    }
+    rocksdb_livefiles_destroy(livefiles);
+
+    qsort(candidates,ncandidates,sizeof(rangeBoundCandidate),
+            rangeBoundCandidateCmp);
+
+    for (i = 0; i < ncandidates; i++) {
+        rangeBoundCandidate *c = candidates+i;
+        /* start next range once accumulated size reaches its quantile,
+         * smallest key of the first sst is where the db starts anyway. */
+        if (nbounds < nranges-1 && i > 0 &&
+                accumulated >= total/nranges*(nbounds+1) &&
+                (nbounds == 0 || sdscmp(bounds[nbounds-1],c->metakey))) {
+            if (bounds == NULL) bounds = zmalloc(sizeof(sds)*(nranges-1));
+            bounds[nbounds++] = c->metakey;
+            c->metakey = NULL;
+        }
+        accumulated += c->size;
     }
 
+    for (i = 0; i < ncandidates; i++) {
+        if (candidates[i].metakey) sdsfree(candidates[i].metakey);
+    }
+    zfree(candidates);
+
+    *pnbounds = nbounds;
+    return bounds;
+}
+
+/* Iterate db within [start,end), start/end defaults to db range if NULL. */
+rocksIter *rocksCreateRangeIter(rocksIterSource *source, redisDb *db,
+        MOVE sds start, MOVE sds end) {
+    int error;
+    rocksdb_iterator_t *data_iter = NULL, *meta_iter = NULL;
+    rocksIter *it = zcalloc(sizeof(rocksIter));
+
+    it->rocks = source->rocks;
+    it->db = db;
+    it->source = source;
+    it->own_source = 0;
+
+    if (start == NULL) start = rocksEncodeDbRangeStartKey(db->id);
+    if (end == NULL) end = rocksEncodeDbRangeEndKey(db->id);
+
+    data_iter = rocksdb_create_iterator_cf(source->db, it->rocks->ropts,
+            rocksIterSourceCfHandle(source,DATA_CF));
+    meta_iter = rocksdb_create_iterator_cf(source->db, it->rocks->ropts,
+            rocksIterSourceCfHandle(source,META_CF));
+
     if (data_iter == NULL || meta_iter == NULL) {
         serverLog(LL_WARNING, "Create rocksdb iterator failed.");
+        if (data_iter) rocksdb_iter_destroy(data_iter);
+        if (meta_iter) rocksdb_iter_destroy(meta_iter);
+        sdsfree(start), sdsfree(end);
         goto err;
     }
 
-    data_start_key = rocksEncodeDbRangeStartKey(db->id);
-    meta_start_key = rocksEncodeDbRangeStartKey(db->id);
-    rocksdb_iter_seek(data_iter,data_start_key,sdslen(data_start_key));
-    rocksdb_iter_seek(meta_iter,meta_start_key,sdslen(meta_start_key));
-    sdsfree(data_start_key);
-    sdsfree(meta_start_key);
+    rocksdb_iter_seek(data_iter,start,sdslen(start));
+    rocksdb_iter_seek(meta_iter,start,sdslen(start));
 
     it->data_iter = data_iter;
     it->meta_iter = meta_iter;
-    it->data_endkey = rocksEncodeDbRangeEndKey(db->id);
-    it->meta_endkey = rocksEncodeDbRangeEndKey(db->id);
+    it->data_endkey = end;
+    it->meta_endkey = sdsdup(end);
+    sdsfree(start);
 
     it->buffered_cq = bufferedIterCompleteQueueNew(ITER_BUFFER_CAPACITY_DEFAULT);
 
@@ -353,23 +553,36 @@ err:
     return NULL;
 }
 
+rocksIter *rocksCreateIter(rocks *rocks, redisDb *db) {
+    rocksIterSource *source;
+    rocksIter *it;
+
+    if ((source = rocksCreateIterSource(rocks)) == NULL) return NULL;
+
+    if ((it = rocksCreateRangeIter(source,db,NULL,NULL)) == NULL) {
+        rocksReleaseIterSource(source);
+        return NULL;
+    }
+
+    it->own_source = 1;
+    return it;
+}
+
 int rocksIterSeekToFirst(rocksIter *it) {
     return rocksIterWaitReady(it);
 }
 
-/* rocks iter rawkey, rawval moved. */
+/* rocks iter rawval moved, rawkey owned by rocksIter and valid untill
+ * rocksIterNext. */
 void rocksIterCfKeyTypeValue(rocksIter *it, int *cf, sds *rawkey, unsigned char *rdbtype, sds *rawval) {
-    int idx;
+    int64_t processed;
     iterResult *cur;
     bufferedIterCompleteQueue *cq = it->buffered_cq;
-    idx = cq->processed_count % cq->buffer_capacity;
-    cur = it->buffered_cq->buffered+idx;
+    atomicGet(cq->processed_count,processed);
+    cur = it->buffered_cq->buffered+(processed % cq->buffer_capacity);
     if (cf) *cf = cur->cf;
     if (rdbtype) *rdbtype = cur->rdbtype;
-    if (rawkey) {
-        *rawkey = cur->rawkey;
-        cur->rawkey = NULL;
-    }
+    if (rawkey) *rawkey = cur->rawkey;
     if (rawval) {
         *rawval = cur->rawval;
         cur->rawval = NULL;
@@ -379,17 +592,12 @@ void rocksIterCfKeyTypeValue(rocksIter *it, int *cf, sds *rawkey, unsigned char
 /* Will block untill at least one result is ready.
  * note that rawkey and rawval are owned by rocksIter. */
 int rocksIterNext(rocksIter *it) {
-    int idx;
+    int64_t processed;
     iterResult *cur;
     bufferedIterCompleteQueue *cq = it->buffered_cq;
-    idx = cq->processed_count % cq->buffer_capacity;
-    cur = it->buffered_cq->buffered+idx;
-    /* clear previous state */
-    if (cur->rawkey) {
-        sdsfree(cur->rawkey);
-        cur->rawkey = NULL;
-    }
-
+    atomicGet(cq->processed_count,processed);
+    cur = it->buffered_cq->buffered+(processed % cq->buffer_capacity);
+    /* clear previous state, rawkey kept for reuse. */
     if (cur->rawval) {
         sdsfree(cur->rawval);
         cur->rawval = NULL;
@@ -399,7 +607,7 @@ int rocksIterNext(rocksIter *it) {
 }
 
 void rocksReleaseIter(rocksIter *it) {
-    int err, i;
+    int err;
 
     if (it == NULL) return;
 
@@ -418,12 +626,6 @@ void rocksReleaseIter(rocksIter *it) {
         it->buffered_cq = NULL;
     }
 
-    for (i = 0; i < CF_COUNT; i++) {
-        if (it->cf_handles[i]) {
-            rocksdb_column_family_handle_destroy(it->cf_handles[i]);
-        }
-    }
-
     if (it->data_iter) {
         rocksdb_iter_destroy(it->data_iter);
         it->data_iter = NULL;
@@ -444,9 +646,9 @@ void rocksReleaseIter(rocksIter *it) {
         it->meta_endkey = NULL;
     }
 
-    if (it->checkpoint_db != NULL) {
-        rocksdb_close(it->checkpoint_db);
-        it->checkpoint_db = NULL;
+    if (it->own_source) {
+        rocksReleaseIterSource(it->source);
+        it->source = NULL;
     }
     zfree(it);
 }
@@ -477,7 +679,6 @@ int rocksDecodeDataCF(sds rawkey, unsigned char rdbtype, sds rdbraw,
     decoded->rdbtype = rdbtype;
     decoded->rdbraw = rdbraw;
 
-    sdsfree(rawkey);
     return 0;
 }
 
@@ -503,7 +704,6 @@ int rocksDecodeMetaCF(sds rawkey, sds rawval, decodedMeta *decoded) {
     decoded->expire = expire;
     decoded->extend = extlen > 0 ? sdsnewlen(extend,extlen) : NULL;
 
-    sdsfree(rawkey);
     sdsfree(rawval);
     return 0;
 }
@@ -526,7 +726,8 @@ int rocksIterDecode(rocksIter *it, decodedResult *decoded,
     serverLog(LL_NOTICE, "%s", repr);
 #endif
 
-    /* rawkey,rawval moved from rocksIter to decoded if decode ok. */
+    /* rawval moved from rocksIter to decoded if decode ok, rawkey is
+     * owned by rocksIter. */
     switch (cf) {
     case META_CF:
         retval = rocksDecodeMetaCF(rawkey,rawval,(decodedMeta*)decoded);
@@ -545,7 +746,6 @@ int rocksIterDecode(rocksIter *it, decodedResult *decoded,
             serverLog(LL_WARNING, "Decode rocks raw failed: %s", repr);
             sdsfree(repr);
         }
-        sdsfree(rawkey);
         sdsfree(rawval);
     } else {
 #ifdef SWAP_DEBUG
@@ -652,12 +852,134 @@ void validateRocksIterForDb(redisDb *db) {
     sdsfree(ha), sdsfree(h), sdsfree(field_a);
 }
 
+/* Complete queue bench: io thread produces into queue while main thread
+ * consumes, ring queue compared with the mutex queue it replaced (one
+ * lock & signal for each result). */
+#define ITER_BENCH_RAWKEY "bench-rawkey-0123456789"
+#define ITER_BENCH_RAWVAL "bench-rawval-0123456789"
+
+static long long iter_bench_items;
+
+static void *iterRingBenchProducer(void *arg) {
+    rocksIter *it = arg;
+    bufferedIterCompleteQueue *cq = it->buffered_cq;
+    long long produced = 0;
+
+    while (produced < iter_bench_items) {
+        int64_t slots = rocksIterWaitVacant(it), buffered, pending = 0;
+        atomicGet(cq->buffered_count,buffered);
+        while (slots-- && produced < iter_bench_items) {
+            iterResult *cur = cq->buffered +
+                (buffered + pending) % cq->buffer_capacity;
+            iterResultInit(cur,DATA_CF,0,ITER_BENCH_RAWKEY,
+                    sizeof(ITER_BENCH_RAWKEY)-1,sdsnew(ITER_BENCH_RAWVAL));
+            produced++;
+            if (++pending < ITER_NOTIFY_BATCH) continue;
+            rocksIterNotifyReady(it,pending);
+            buffered += pending;
+            pending = 0;
+        }
+        if (pending) rocksIterNotifyReady(it,pending);
+    }
+    rocksIterNotifyFinshed(it);
+    return NULL;
+}
+
+static long long iterRingBenchConsume(rocksIter *it) {
+    long long consumed = 0;
+    sds rawval;
+    if (!rocksIterSeekToFirst(it)) return 0;
+    do {
+        rocksIterCfKeyTypeValue(it,NULL,NULL,NULL,&rawval);
+        sdsfree(rawval);
+        consumed++;
+    } while (rocksIterNext(it));
+    return consumed;
+}
+
+typedef struct lockedIterCompleteQueue {
+    int buffer_capacity;
+    iterResult *buffered;
+    int iter_finished;
+    int64_t buffered_count;
+    int64_t processed_count;
+    pthread_mutex_t buffer_lock;
+    pthread_cond_t ready_cond;
+    pthread_cond_t vacant_cond;
+} lockedIterCompleteQueue;
+
+static void *iterLockedBenchProducer(void *arg) {
+    lockedIterCompleteQueue *cq = arg;
+    long long produced = 0;
+
+    while (produced < iter_bench_items) {
+        int64_t slots;
+        pthread_mutex_lock(&cq->buffer_lock);
+        while ((slots = cq->buffer_capacity -
+                    (cq->buffered_count - cq->processed_count)) == 0)
+            pthread_cond_wait(&cq->vacant_cond,&cq->buffer_lock);
+        pthread_mutex_unlock(&cq->buffer_lock);
+
+        while (slots-- && produced < iter_bench_items) {
+            iterResult *cur = cq->buffered +
+                cq->buffered_count % cq->buffer_capacity;
+            cur->cf = DATA_CF;
+            cur->rdbtype = 0;
+            cur->rawkey = sdsnew(ITER_BENCH_RAWKEY);
+            cur->rawval = sdsnew(ITER_BENCH_RAWVAL);
+            produced++;
+            pthread_mutex_lock(&cq->buffer_lock);
+            cq->buffered_count++;
+            if (!(produced & (ITER_NOTIFY_BATCH-1)))
+                pthread_cond_signal(&cq->ready_cond);
+            pthread_mutex_unlock(&cq->buffer_lock);
+        }
+    }
+
+    pthread_mutex_lock(&cq->buffer_lock);
+    cq->iter_finished = 1;
+    pthread_cond_signal(&cq->ready_cond);
+    pthread_mutex_unlock(&cq->buffer_lock);
+    return NULL;
+}
+
+static long long iterLockedBenchConsume(lockedIterCompleteQueue *cq) {
+    long long consumed = 0;
+
+    while (1) {
+        iterResult *cur;
+        pthread_mutex_lock(&cq->buffer_lock);
+        while (cq->processed_count >= cq->buffered_count && !cq->iter_finished)
+            pthread_cond_wait(&cq->ready_cond,&cq->buffer_lock);
+        if (cq->processed_count >= cq->buffered_count) {
+            pthread_mutex_unlock(&cq->buffer_lock);
+            break;
+        }
+        pthread_mutex_unlock(&cq->buffer_lock);
+
+        cur = cq->buffered + cq->processed_count % cq->buffer_capacity;
+        sdsfree(cur->rawkey), sdsfree(cur->rawval);
+        cur->rawkey = cur->rawval = NULL;
+        consumed++;
+
+        pthread_mutex_lock(&cq->buffer_lock);
+        cq->processed_count++;
+        pthread_cond_signal(&cq->vacant_cond);
+        pthread_mutex_unlock(&cq->buffer_lock);
+    }
+    return consumed;
+}
+
 int swapIterTest(int argc, char *argv[], int accurate) {
     UNUSED(argc), UNUSED(argv), UNUSED(accurate);
 
-    int error = 0;
+    int error = 0, bench = 0;
     server.hz = 10;
 
+    for (int j = 3; j < argc; j++) {
+        if (!strcasecmp(argv[j],"--bench")) bench = 1;
+    }
+
     initTestRedisDb();
     redisDb *db = server.db, *db1 = server.db+1;
 
@@ -680,6 +1002,144 @@ int swapIterTest(int argc, char *argv[], int accurate) {
         validateRocksIterForDb(db1);
     }
 
+    TEST("iter: range") {
+        rocksIterSource *source = rocksCreateIterSource(server.rocks);
+        decodedResult decoded_ = {0}, *decoded = &decoded_;
+        rocksIterDecodeStats stats_ = {0}, *stats = &stats_;
+        sds ha = sdsnew("ha"), h = sdsnew("h"), *bounds;
+        rocksIter *it;
+        int i, nbounds;
+
+        prepareDataForDb(db);
+        doRocksdbFlush();
+
+        /* [db start, ha) */
+        it = rocksCreateRangeIter(source,db,NULL,rocksEncodeMetaKey(db,ha));
+        test_assert(rocksIterSeekToFirst(it));
+        rocksIterDecode(it,decoded,stats);
+        test_assert(decoded->cf == META_CF && !sdscmp(decoded->key,h));
+        decodedResultDeinit(decoded);
+        test_assert(rocksIterNext(it));
+        rocksIterDecode(it,decoded,stats);
+        test_assert(decoded->cf == DATA_CF && !sdscmp(decoded->key,h));
+        decodedResultDeinit(decoded);
+        test_assert(!rocksIterNext(it));
+        rocksReleaseIter(it);
+
+        /* [ha, db end) */
+        it = rocksCreateRangeIter(source,db,rocksEncodeMetaKey(db,ha),NULL);
+        test_assert(rocksIterSeekToFirst(it));
+        rocksIterDecode(it,decoded,stats);
+        test_assert(decoded->cf == META_CF && !sdscmp(decoded->key,ha));
+        decodedResultDeinit(decoded);
+        test_assert(rocksIterNext(it));
+        rocksIterDecode(it,decoded,stats);
+        test_assert(decoded->cf == DATA_CF && !sdscmp(decoded->key,ha));
+        decodedResultDeinit(decoded);
+        test_assert(!rocksIterNext(it));
+        rocksReleaseIter(it);
+
+        bounds = rocksIterSourceSplitDb(source,db->id,1,&nbounds);
+        test_assert(bounds == NULL && nbounds == 0);
+        bounds = rocksIterSourceSplitDb(source,db->id,4,&nbounds);
+        test_assert(nbounds < 4);
+        for (i = 0; i < nbounds; i++) {
+            int dbid;
+            test_assert(!rocksDecodeMetaKey(bounds[i],sdslen(bounds[i]),
+                        &dbid,NULL,NULL) && dbid == db->id);
+            if (i > 0) test_assert(sdscmp(bounds[i-1],bounds[i]) < 0);
+            sdsfree(bounds[i]);
+        }
+        zfree(bounds);
+
+        rocksReleaseIterSource(source);
+        sdsfree(ha), sdsfree(h);
+    }
+
+    /* make CFLAGS="-DREDIS_TEST" && ./src/redis-server test swap --bench
+     * (add --accurate to bench with 1M keys). */
+    if (bench) {
+        TEST("iter: bgsave bench") {
+            int i, nkeys = accurate ? 1000000 : 10000, rdberr = 0;
+            int child_info_pipe = server.child_info_pipe[1];
+            long long start, elapsed;
+            rio sdsrdb;
+            redisDb *bench_db = server.db+2;
+            robj *val = createStringObject("bench-value-0123456789",22);
+
+            for (i = 0; i < nkeys; i++) {
+                sds key = sdscatfmt(sdsempty(),"bench:%i",i);
+                PUT_META(bench_db,OBJ_STRING,key,-1);
+                PUT_DATA(bench_db,key,NULL,val);
+                sdsfree(key);
+            }
+            doRocksdbFlush();
+            /* no child info to send from bench */
+            server.child_info_pipe[1] = -1;
+
+            rioInitWithBuffer(&sdsrdb,sdsempty());
+            start = ustime();
+            test_assert(rdbSaveRocks(&sdsrdb,&rdberr,bench_db,0) == C_OK);
+            elapsed = ustime() - start;
+            serverLog(LL_NOTICE,"[bgsave bench] threads=%d, keys=%d, "
+                    "elapsed=%lldus, keys/sec=%lld, bytes=%ld",
+                    server.swap_rdb_save_threads, nkeys, elapsed,
+                    elapsed ? (long long)nkeys*1000000/elapsed : 0,
+                    sdslen(sdsrdb.io.buffer.ptr));
+            sdsfree(sdsrdb.io.buffer.ptr);
+
+            server.child_info_pipe[1] = child_info_pipe;
+            test_assert(rocksFlushDB(bench_db->id) == 0);
+            decrRefCount(val);
+        }
+
+        TEST("iter: complete queue bench") {
+            long long start, ring_elapsed, locked_elapsed;
+            pthread_t producer;
+
+            iter_bench_items = accurate ? 10000000 : 1000000;
+
+            /* ring queue: one io thread producing, main thread consuming. */
+            rocksIter ring_it = {0};
+            ring_it.buffered_cq = bufferedIterCompleteQueueNew(
+                    ITER_BUFFER_CAPACITY_DEFAULT);
+            start = ustime();
+            test_assert(pthread_create(&producer,NULL,
+                        iterRingBenchProducer,&ring_it) == 0);
+            test_assert(iterRingBenchConsume(&ring_it) == iter_bench_items);
+            pthread_join(producer,NULL);
+            ring_elapsed = ustime() - start;
+            bufferedIterCompleteQueueFree(ring_it.buffered_cq);
+
+            /* mutex queue: same capacity and thread count. */
+            lockedIterCompleteQueue locked_cq = {0};
+            locked_cq.buffer_capacity = ITER_BUFFER_CAPACITY_DEFAULT;
+            locked_cq.buffered = zcalloc(ITER_BUFFER_CAPACITY_DEFAULT*
+                    sizeof(iterResult));
+            pthread_mutex_init(&locked_cq.buffer_lock,NULL);
+            pthread_cond_init(&locked_cq.ready_cond,NULL);
+            pthread_cond_init(&locked_cq.vacant_cond,NULL);
+            start = ustime();
+            test_assert(pthread_create(&producer,NULL,
+                        iterLockedBenchProducer,&locked_cq) == 0);
+            test_assert(iterLockedBenchConsume(&locked_cq) == iter_bench_items);
+            pthread_join(producer,NULL);
+            locked_elapsed = ustime() - start;
+            pthread_mutex_destroy(&locked_cq.buffer_lock);
+            pthread_cond_destroy(&locked_cq.ready_cond);
+            pthread_cond_destroy(&locked_cq.vacant_cond);
+            zfree(locked_cq.buffered);
+
+            serverLog(LL_NOTICE,"[complete queue bench] items=%lld, "
+                    "ring=%lldus (%lld/sec), mutex=%lldus (%lld/sec)",
+                    iter_bench_items,
+                    ring_elapsed, ring_elapsed ?
+                    iter_bench_items*1000000/ring_elapsed : 0,
+                    locked_elapsed, locked_elapsed ?
+                    iter_bench_items*1000000/locked_elapsed : 0);
+        }
+    }
+
     return error;
 }
 
@@ -103,6 +103,45 @@ void freeScanMetaResult(metaScanResult *result) {
 }
 
 /* MetaScanDataCtx */
+static void metaScanDataCtxSetPattern(metaScanDataCtx *datactx, sds pattern) {
+    if (datactx->pattern) sdsfree(datactx->pattern);
+    if (pattern[0] == '*' && sdslen(pattern) == 1)
+        datactx->pattern = NULL;
+    else
+        datactx->pattern = sdsdup(pattern);
+}
+
+/* Literal prefix of glob-style pattern, e.g. "user:1*" => "user:1". */
+static sds metaScanPatternPrefix(sds pattern) {
+    size_t i, len = sdslen(pattern);
+    sds prefix = sdsempty();
+
+    for (i = 0; i < len; i++) {
+        char ch = pattern[i];
+        if (ch == '*' || ch == '?' || ch == '[') break;
+        if (ch == '\\' && i+1 < len) ch = pattern[++i];
+        prefix = sdscatlen(prefix,&ch,1);
+    }
+
+    return prefix;
+}
+
+/* Drop metas not matching pattern, keeping order of the rest. */
+static void metaScanResultFilter(metaScanResult *result, sds pattern) {
+    int i, j;
+    for (i = 0, j = 0; i < result->num; i++) {
+        scanMeta *meta = result->metas+i;
+        if (stringmatchlen(pattern,sdslen(pattern),meta->key,
+                    sdslen(meta->key),0)) {
+            if (i != j) result->metas[j] = *meta;
+            j++;
+        } else {
+            scanMetaDeinit(meta);
+        }
+    }
+    result->num = j;
+}
+
 void metaScanDataCtxSwapAna(metaScanDataCtx *datactx, int *intention,
         uint32_t *intention_flags) {
     if (datactx->type->swapAna) {
@@ -185,8 +224,9 @@ int setupMetaScanDataCtx4Scan(metaScanDataCtx *datactx, client *c) {
             long long value;
             if (getLongLongFromObject(c->argv[i+1],&value) == C_OK) {
                 datactx->limit = value;
-                break;
             }
+        } else if (!strcasecmp(c->argv[i]->ptr, "match") && j >= 2) {
+            metaScanDataCtxSetPattern(datactx,c->argv[i+1]->ptr);
         }
     }
 
@@ -323,6 +363,66 @@ int setupMetaScanDataCtx4ScanExpire(metaScanDataCtx *datactx, client *c) {
     return 0;
 }
 
+/* metaScanDataCtx - Keys */
+void metaScanDataCtxKeysSwapAna(metaScanDataCtx *datactx,
+        int *intention, uint32_t *intention_flags) {
+    client *c = datactx->c;
+    /* KEYS queued in transaction only sees hot keys, because argv
+     * (thus pattern) of queued command is not available here. */
+    if (c->cmd == NULL || c->cmd->proc != keysCommand) {
+        *intention = SWAP_NOP;
+    } else {
+        *intention = SWAP_IN;
+    }
+    *intention_flags = 0;
+}
+
+/* Encode cold keys of chunk into reply right away (only keys matched are
+ * kept), next chunk seeks from where this one stopped. */
+void metaScanDataCtxKeysSwapIn(metaScanDataCtx *datactx,
+        metaScanResult *result) {
+    client *c = datactx->c;
+
+    if (datactx->seek) {
+        sdsfree(datactx->seek);
+        datactx->seek = NULL;
+    }
+    if (result->nextseek) {
+        datactx->seek = result->nextseek;
+        result->nextseek = NULL;
+    }
+
+    if (c->swap_keys_reply == NULL) c->swap_keys_reply = sdsempty();
+    for (int i = 0; i < result->num; i++) {
+        scanMeta *meta = result->metas+i;
+        if (dictFind(c->db->dict,meta->key) != NULL) continue;
+        if (scanMetaExpireIfNeeded(c->db,meta)) continue;
+        c->swap_keys_reply = sdscatfmt(c->swap_keys_reply,"$%u\r\n%S\r\n",
+                (unsigned)sdslen(meta->key),meta->key);
+        c->swap_keys_count++;
+    }
+
+    serverAssert(c->swap_metas == result);
+    freeScanMetaResult(result);
+    c->swap_metas = NULL;
+}
+
+metaScanDataCtxType keysMetaScanDataCtxType = {
+    .swapAna = metaScanDataCtxKeysSwapAna,
+    .swapIn = metaScanDataCtxKeysSwapIn,
+    .freeExtend = NULL,
+};
+
+/* KEYS pattern: scan in chunks instead of all cold metas in one RIO. */
+int setupMetaScanDataCtx4Keys(metaScanDataCtx *datactx, client *c) {
+    datactx->type = &keysMetaScanDataCtxType;
+    datactx->limit = METASCAN_KEYS_CHUNK_LIMIT;
+    datactx->seek = NULL;
+    if (c->cmd && c->cmd->proc == keysCommand && c->argc == 2)
+        metaScanDataCtxSetPattern(datactx,c->argv[1]->ptr);
+    return 0;
+}
+
 /* MetaScan */
 int metaScanSwapAna(swapData *data, int thd, struct keyRequest *req,
         int *intention, uint32_t *intention_flags, void *datactx_) {
@@ -348,12 +448,17 @@ int SwapAnaAction(swapData *data, int intention, void *datactx_, int *action) {
 int metaScanEncodeRange(struct swapData *data, int intention, void *datactx_, int *limit,
         uint32_t *flags, int *pcf, sds *start, sds *end) {
     metaScanDataCtx *datactx = datactx_;
+    sds prefix = NULL;
     serverAssert(SWAP_IN == intention);
+    /* Seek only keys of current db with literal prefix of pattern, so that
+     * cost is proportional to matched keys instead of dbsize. */
+    if (datactx->pattern) prefix = metaScanPatternPrefix(datactx->pattern);
     *pcf = META_CF;
-    *flags |= ROCKS_ITERATE_CONTINUOUSLY_SEEK;
+    *flags |= ROCKS_ITERATE_CONTINUOUSLY_SEEK|ROCKS_ITERATE_META_PREFIX;
     *start = rocksEncodeMetaKey(data->db,datactx->seek);
-    *end = NULL;
+    *end = rocksEncodeMetaKey(data->db,prefix);
     *limit = datactx->limit;
+    if (prefix) sdsfree(prefix);
     return 0;
 }
 
@@ -400,8 +505,12 @@ int metaScanDecodeData(swapData *data, int num, int *cfs, sds *rawkeys,
     return retval;
 }
 
-void *metaScanCreateOrMergeObject(swapData *data, void *decoded, void *datactx) {
-    UNUSED(data), UNUSED(datactx);
+void *metaScanCreateOrMergeObject(swapData *data, void *decoded, void *datactx_) {
+    metaScanDataCtx *datactx = datactx_;
+    UNUSED(data);
+    /* Match rest of the pattern in swap thread. */
+    if (decoded && datactx && datactx->pattern)
+        metaScanResultFilter(decoded,datactx->pattern);
     return decoded;
 }
 
@@ -431,6 +540,10 @@ void freeMetaScanSwapData(swapData *data, void *datactx_) {
         sdsfree(datactx->seek);
         datactx->seek = NULL;
     }
+    if (datactx->pattern) {
+        sdsfree(datactx->pattern);
+        datactx->pattern = NULL;
+    }
     zfree(datactx);
 }
 
@@ -451,6 +564,247 @@ swapDataType metaScanSwapDataType = {
     .free = freeMetaScanSwapData,
 };
 
+/* Expire index scan: seek due entries of current db in expire cf, instead of
+ * scanning the whole meta cf for keys with expire. */
+int expireIndexScanEncodeRange(struct swapData *data, int intention,
+        void *datactx_, int *limit, uint32_t *flags, int *pcf, sds *start,
+        sds *end) {
+    metaScanDataCtx *datactx = datactx_;
+    serverAssert(SWAP_IN == intention);
+    *pcf = EXPIRE_CF;
+    *flags |= ROCKS_ITERATE_CONTINUOUSLY_SEEK|ROCKS_ITERATE_PREFIX_MATCH;
+    if (datactx->seek)
+        *start = sdsdup(datactx->seek);
+    else
+        *start = rocksEncodeExpireKey(data->db->id,0,NULL);
+    *end = rocksEncodeExpireKey(data->db->id,mstime(),NULL);
+    *limit = datactx->limit;
+    return 0;
+}
+
+int expireIndexScanDecodeData(swapData *data, int num, int *cfs,
+        sds *rawkeys, sds *rawvals, void **pdecoded) {
+    UNUSED(rawvals);
+    int i, retval = 0;
+    metaScanResult *result = metaScanResultCreate();
+
+    /* nextseek kept raw, it's only used to seek expire cf again. */
+    if (data->nextseek) {
+        metaScanResultSetNextSeek(result,data->nextseek);
+        data->nextseek = NULL;
+    }
+
+    for (i = 0; i < num; i++) {
+        const char *key;
+        size_t keylen;
+        long long expire;
+
+        serverAssert(cfs[i] == EXPIRE_CF);
+        if (rocksDecodeExpireKey(rawkeys[i],sdslen(rawkeys[i]),
+                NULL,&expire,&key,&keylen)) {
+            retval = SWAP_ERR_DATA_DECODE_FAIL;
+            break;
+        }
+        metaScanResultAppend(result,-1,sdsnewlen(key,keylen),expire);
+    }
+
+    if (pdecoded) *pdecoded = result;
+
+    return retval;
+}
+
+/* Index entries are not deleted along with keys or updated when expire
+ * changed, check them against meta and fill object type for entries that
+ * are valid. Stale entries are kept with object type -1 for scan expire,
+ * they are deleted only if clean is set, which requires the key lock of
+ * every entry: otherwise key might be written with the same expire right
+ * after meta is read, and its fresh index entry gets deleted. */
+static int expireIndexScanValidate(swapData *data, metaScanResult *result,
+        int clean) {
+    int i, j, errcode, num = result->num, numstale = 0;
+    int dbid = data->db->id;
+    int *cfs, *stale_cfs;
+    sds *rawkeys, *stale_rawkeys;
+    RIO _rio = {0}, *rio = &_rio;
+
+    if (num == 0) return 0;
+
+    cfs = zmalloc(sizeof(int)*num);
+    rawkeys = zmalloc(sizeof(sds)*num);
+    for (i = 0; i < num; i++) {
+        scanMeta *meta = result->metas+i;
+        cfs[i] = META_CF;
+        rawkeys[i] = encodeMetaKey(dbid,meta->key,sdslen(meta->key));
+    }
+    RIOInitGet(rio,num,cfs,rawkeys);
+    RIODo(rio);
+    if ((errcode = RIOGetError(rio))) {
+        RIODeinit(rio);
+        return errcode;
+    }
+
+    stale_cfs = zmalloc(sizeof(int)*num);
+    stale_rawkeys = zmalloc(sizeof(sds)*num);
+    for (i = 0, j = 0; i < num; i++) {
+        scanMeta *meta = result->metas+i;
+        sds rawval = rio->get.rawvals[i];
+        int object_type;
+        long long expire;
+
+        if (rawval != NULL && !rocksDecodeMetaVal(rawval,sdslen(rawval),
+                    &object_type,&expire,NULL,NULL,NULL) &&
+                expire == meta->expire) {
+            meta->object_type = object_type;
+            if (i != j) result->metas[j] = *meta;
+            j++;
+        } else if (!clean) {
+            meta->object_type = -1;
+            if (i != j) result->metas[j] = *meta;
+            j++;
+        } else {
+            stale_cfs[numstale] = EXPIRE_CF;
+            stale_rawkeys[numstale] = rocksEncodeExpireKey(dbid,
+                    meta->expire,meta->key);
+            numstale++;
+            scanMetaDeinit(meta);
+        }
+    }
+    result->num = j;
+    RIODeinit(rio);
+
+    RIOInitDel(rio,numstale,stale_cfs,stale_rawkeys);
+    if (numstale) RIODo(rio);
+    errcode = RIOGetError(rio);
+    RIODeinit(rio);
+
+    return errcode;
+}
+
+void *expireIndexScanCreateOrMergeObject(swapData *data, void *decoded,
+        void *datactx_) {
+    metaScanDataCtx *datactx = datactx_;
+    metaScanResult *result = decoded;
+    if (result == NULL) return NULL;
+    /* Iterate stopped at bound (not limit), restart from the earliest
+     * entry next time so that newly indexed due keys are not skipped. */
+    if (result->nextseek && result->num < datactx->limit) {
+        sdsfree(result->nextseek);
+        result->nextseek = NULL;
+    }
+    if (expireIndexScanValidate(data,result,0)) {
+        serverLog(LL_WARNING, "[rocks] validate expire index of db(%d) failed.",
+                data->db->id);
+    }
+    return result;
+}
+
+swapDataType expireIndexScanSwapDataType = {
+    .name = "expireindexscan",
+    .swapAna = metaScanSwapAna,
+    .swapAnaAction = SwapAnaAction,
+    .encodeKeys = NULL,
+    .encodeData = NULL,
+    .encodeRange = expireIndexScanEncodeRange,
+    .decodeData = expireIndexScanDecodeData,
+    .swapIn = metaScanSwapIn,
+    .swapOut = NULL,
+    .swapDel = NULL,
+    .createOrMergeObject = expireIndexScanCreateOrMergeObject,
+    .cleanObject = NULL,
+    .beforeCall = NULL,
+    .free = freeMetaScanSwapData,
+};
+
+/* Expire index clean: delete one stale index entry found by scan expire,
+ * with key lock held so that no swap writes meta of the key meanwhile. */
+int expireIndexCleanEncodeRange(struct swapData *data, int intention,
+        void *datactx_, int *limit, uint32_t *flags, int *pcf, sds *start,
+        sds *end) {
+    metaScanDataCtx *datactx = datactx_;
+    UNUSED(data), UNUSED(flags);
+    serverAssert(SWAP_IN == intention);
+    *pcf = EXPIRE_CF;
+    *start = sdsdup(datactx->seek);
+    *end = sdsdup(datactx->seek);
+    *limit = 1;
+    return 0;
+}
+
+void *expireIndexCleanCreateOrMergeObject(swapData *data, void *decoded,
+        void *datactx_) {
+    metaScanResult *result = decoded;
+    UNUSED(datactx_);
+    if (result == NULL) return NULL;
+    if (expireIndexScanValidate(data,result,1)) {
+        serverLog(LL_WARNING, "[rocks] clean expire index of db(%d) failed.",
+                data->db->id);
+    }
+    return result;
+}
+
+swapDataType expireIndexCleanSwapDataType = {
+    .name = "expireindexclean",
+    .swapAna = metaScanSwapAna,
+    .swapAnaAction = SwapAnaAction,
+    .encodeKeys = NULL,
+    .encodeData = NULL,
+    .encodeRange = expireIndexCleanEncodeRange,
+    .decodeData = expireIndexScanDecodeData,
+    .swapIn = metaScanSwapIn,
+    .swapOut = NULL,
+    .swapDel = NULL,
+    .createOrMergeObject = expireIndexCleanCreateOrMergeObject,
+    .cleanObject = NULL,
+    .beforeCall = NULL,
+    .free = freeMetaScanSwapData,
+};
+
+void metaScanDataCtxExpireCleanSwapAna(metaScanDataCtx *datactx,
+        int *intention, uint32_t *intention_flags) {
+    UNUSED(datactx);
+    *intention = SWAP_IN;
+    *intention_flags = 0;
+}
+
+/* Entries left are valid ones, nothing to do with them. */
+void metaScanDataCtxExpireCleanSwapIn(metaScanDataCtx *datactx,
+        metaScanResult *result) {
+    client *c = datactx->c;
+    serverAssert(c->swap_metas == result);
+    freeScanMetaResult(result);
+    c->swap_metas = NULL;
+}
+
+metaScanDataCtxType expireCleanMetaScanDataCtxType = {
+    .swapAna = metaScanDataCtxExpireCleanSwapAna,
+    .swapIn = metaScanDataCtxExpireCleanSwapIn,
+    .freeExtend = NULL,
+};
+
+/* Key request of key (locked) with expire of the stale entry as subkey. */
+int swapDataSetupExpireIndexClean(swapData *data, keyRequest *key_request,
+        client *c, void **pdatactx) {
+    metaScanDataCtx *datactx;
+    long long expire;
+
+    data->type = &expireIndexCleanSwapDataType;
+    data->expire = -1;
+    data->key = shared.redacted;
+    data->value = shared.redacted;
+
+    datactx = zcalloc(sizeof(metaScanDataCtx));
+    datactx->type = &expireCleanMetaScanDataCtxType;
+    datactx->c = c;
+    *pdatactx = datactx;
+
+    if (key_request->key == NULL || key_request->b.num_subkeys != 1 ||
+            getLongLongFromObject(key_request->b.subkeys[0],&expire) != C_OK)
+        return SWAP_ERR_SETUP_FAIL;
+
+    datactx->seek = rocksEncodeExpireKey(data->db->id,expire,
+            key_request->key->ptr);
+    return 0;
+}
 
 #define METASCAN_DEFAULT_LIMIT 16
 
@@ -470,6 +824,7 @@ int swapDataSetupMetaScan(swapData *data, uint32_t intention_flags,
     datactx->c = c;
     datactx->limit = METASCAN_DEFAULT_LIMIT;
     datactx->seek = NULL;
+    datactx->pattern = NULL;
     datactx->extend = NULL;
 
     if (c == NULL) {
@@ -480,6 +835,10 @@ int swapDataSetupMetaScan(swapData *data, uint32_t intention_flags,
         retval = setupMetaScanDataCtx4Randomkey(datactx,c);
     } else if (intention_flags & SWAP_METASCAN_EXPIRE) {
         retval = setupMetaScanDataCtx4ScanExpire(datactx,c);
+        if (c->db->scan_expire->use_index)
+            data->type = &expireIndexScanSwapDataType;
+    } else if (intention_flags & SWAP_METASCAN_KEYS) {
+        retval = setupMetaScanDataCtx4Keys(datactx,c);
     } else {
         retval = SWAP_ERR_SETUP_FAIL;
     }
@@ -488,6 +847,13 @@ int swapDataSetupMetaScan(swapData *data, uint32_t intention_flags,
     return retval;
 }
 
+/* Main-thread: returns 1 if KEYS not reached end of meta cf yet. */
+int metaScanSwapDataHasMore(swapData *data, void *datactx_) {
+    metaScanDataCtx *datactx = datactx_;
+    if (data->type != &metaScanSwapDataType || datactx == NULL) return 0;
+    return datactx->type == &keysMetaScanDataCtxType && datactx->seek != NULL;
+}
+
 /* make session ready to assign again (session_id not changed). */
 void swapScanSessionReset(swapScanSession *session) {
     session->last_active = 0;
@@ -770,6 +1136,7 @@ int metaScanTest(int argc, char *argv[], int accurate) {
         test_assert(numkeys == 3);
         test_assert(cf == META_CF);
         sdsfree(start);
+        sdsfree(end);
 
         onumkeys = numkeys;
         sds lastkey = sdsfromlonglong(onumkeys);
@@ -823,6 +1190,112 @@ int metaScanTest(int argc, char *argv[], int accurate) {
         sdsfree(lastkey);
     }
 
+    TEST("metascan - keys match pattern") {
+        int numkeys, retval, i, cf, cfs[3];
+        uint32_t flags = 0;
+        sds start, end, expected_end, pattern, prefix, rawkeys[3], rawvals[3];
+        const char *keys[3] = {"user:*1", "user:*2", "user:*10"};
+        metaScanDataCtx *datactx;
+        metaScanResult *result;
+        void *decoded;
+        swapData *data;
+
+        pattern = sdsnew("a\\?b[c]*");
+        prefix = metaScanPatternPrefix(pattern);
+        test_assert(!strcmp(prefix,"a?b"));
+        sdsfree(prefix), sdsfree(pattern);
+
+        c = createClient(NULL);
+        selectDb(c,0);
+        data = createSwapData(db,NULL,NULL,NULL);
+        rewriteResetClientCommandCString(c,2,"KEYS","user:\\*1*");
+        retval = swapDataSetupMetaScan(data,SWAP_METASCAN_KEYS,c,(void**)&datactx);
+        test_assert(retval == 0);
+        test_assert(datactx->limit == METASCAN_KEYS_CHUNK_LIMIT);
+        swapDataEncodeRange(data,SWAP_IN,datactx,&numkeys,&flags,&cf,&start,&end);
+        test_assert(cf == META_CF);
+        test_assert(flags & ROCKS_ITERATE_META_PREFIX);
+        prefix = sdsnew("user:*1");
+        expected_end = rocksEncodeMetaKey(db,prefix);
+        test_assert(!sdscmp(end,expected_end));
+        sdsfree(prefix), sdsfree(expected_end);
+        sdsfree(start), sdsfree(end);
+
+        for (i = 0; i < 3; i++) {
+            sds key = sdsnew(keys[i]);
+            cfs[i] = META_CF;
+            rawkeys[i] = rocksEncodeMetaKey(db,key);
+            rawvals[i] = rocksEncodeMetaVal(OBJ_STRING,-1,0,NULL);
+            sdsfree(key);
+        }
+        prefix = sdsnew("user:*2");
+        data->nextseek = rocksEncodeMetaKey(db,prefix);
+        sdsfree(prefix);
+        retval = swapDataDecodeData(data,3,cfs,rawkeys,rawvals,&decoded);
+        test_assert(retval == 0);
+        result = swapDataCreateOrMergeObject(data,decoded,datactx);
+        test_assert(result->num == 2);
+        test_assert(!strcmp(result->metas[0].key,"user:*1"));
+        test_assert(!strcmp(result->metas[1].key,"user:*10"));
+        for (i = 0; i < 3; i++) {
+            sdsfree(rawkeys[i]);
+            sdsfree(rawvals[i]);
+        }
+
+        /* chunk encoded into reply right away, next chunk seeks on. */
+        swapDataSwapIn(data,result,datactx);
+        test_assert(c->swap_metas == NULL);
+        test_assert(c->swap_keys_count == 2);
+        test_assert(!strcmp(c->swap_keys_reply,
+                    "$7\r\nuser:*1\r\n$8\r\nuser:*10\r\n"));
+        test_assert(!strcmp(datactx->seek,"user:*2"));
+        test_assert(metaScanSwapDataHasMore(data,datactx));
+
+        result = metaScanResultCreate();
+        swapDataSwapIn(data,result,datactx);
+        test_assert(c->swap_keys_count == 2);
+        test_assert(!metaScanSwapDataHasMore(data,datactx));
+        swapDataFree(data,datactx);
+        freeClient(c);
+    }
+
+    TEST("metascan - expire index clean") {
+        metaScanDataCtx *datactx;
+        keyRequest req_, *req = &req_;
+        robj *subkeys[1];
+        sds start, end, expected;
+        uint32_t flags = 0;
+        int retval, limit, cf;
+        swapData *data;
+
+        memset(req,0,sizeof(keyRequest));
+        req->key = createStringObject("key",3);
+        subkeys[0] = createStringObjectFromLongLong(1000);
+        req->b.num_subkeys = 1;
+        req->b.subkeys = subkeys;
+
+        /* only the stale entry of locked key is seeked. */
+        data = createSwapData(db,NULL,NULL,NULL);
+        retval = swapDataSetupExpireIndexClean(data,req,c,(void**)&datactx);
+        test_assert(retval == 0);
+        expected = rocksEncodeExpireKey(db->id,1000,req->key->ptr);
+        test_assert(!sdscmp(datactx->seek,expected));
+        swapDataEncodeRange(data,SWAP_IN,datactx,&limit,&flags,&cf,&start,&end);
+        test_assert(cf == EXPIRE_CF && limit == 1 && flags == 0);
+        test_assert(!sdscmp(start,expected) && !sdscmp(end,expected));
+        sdsfree(start), sdsfree(end), sdsfree(expected);
+        swapDataFree(data,datactx);
+
+        req->b.num_subkeys = 0;
+        data = createSwapData(db,NULL,NULL,NULL);
+        retval = swapDataSetupExpireIndexClean(data,req,c,(void**)&datactx);
+        test_assert(retval == SWAP_ERR_SETUP_FAIL);
+        swapDataFree(data,datactx);
+
+        decrRefCount(subkeys[0]);
+        decrRefCount(req->key);
+    }
+
     TEST("metascan - scan session cursor manipulate") {
         swapScanSession session_, *session = &session_;
 
@@ -37,7 +37,7 @@ static inline objectMetaType *getObjectMetaType(int object_type) {
     objectMetaType *omtype = NULL;
     switch (object_type) {
     case OBJ_STRING:
-        omtype = NULL;
+        omtype = &wholekeyObjectMetaType;
         break;
     case OBJ_HASH:
     case OBJ_SET:
@@ -47,6 +47,9 @@ static inline objectMetaType *getObjectMetaType(int object_type) {
     case OBJ_LIST:
         omtype = &listObjectMetaType;
         break;
+    case OBJ_STREAM:
+        omtype = &streamObjectMetaType;
+        break;
     default:
         break;
     }
@@ -157,6 +160,7 @@ int keyIsHot(objectMeta *object_meta, robj *value) {
 
 struct listMeta;
 sds listMetaDump(sds result, struct listMeta *lm);
+sds streamMetaDump(sds result, struct streamMeta *stream_meta);
 
 sds dumpObjectMeta(objectMeta *object_meta) {
     sds result = sdsempty();
@@ -167,12 +171,16 @@ sds dumpObjectMeta(objectMeta *object_meta) {
 
     objectMetaType *omtype = getObjectMetaType(object_meta->object_type);
     result = sdscatprintf(result,"version=%lu,",object_meta->version);
-    if (omtype == &lenObjectMetaType){
+    if (omtype == &lenObjectMetaType || omtype == &wholekeyObjectMetaType){
         result = sdscatprintf(result,"len=%ld",(long)object_meta->len);
     } else if (omtype == &listObjectMetaType) {
         result = sdscat(result,"list_meta=");
         struct listMeta *meta = objectMetaGetPtr(object_meta);;
         result = listMetaDump(result,meta);
+    } else if (omtype == &streamObjectMetaType) {
+        result = sdscat(result,"stream_meta=");
+        struct streamMeta *meta = objectMetaGetPtr(object_meta);
+        result = streamMetaDump(result,meta);
     } else {
         result = sdscat(result,"list_meta=<unknown>");
     }
@@ -316,7 +324,9 @@ size_t objectEstimateSize(robj *o) {
         asize = DEFAULT_ZSET_MEMBER_COUNT*DEFAULT_ZSET_MEMBER_SIZE;
         break;
     case OBJ_STREAM:
-        asize = objectComputeSize(o,OBJECT_ESTIMATE_SIZE_SAMPLE);
+        /* similar to List, node count of in-memory rax is read without
+         * iterating nodes that might be swapped in/out by swap thread. */
+        asize = raxSize(((stream*)o->ptr)->rax)*DEFAULT_STREAM_NODE_SIZE;
         break;
     case OBJ_MODULE:
         /*TODO support module*/
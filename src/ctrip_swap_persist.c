@@ -437,6 +437,7 @@ sds genSwapPersistInfoString(sds info) {
 #define INIT_FIX_SKIP -2
 
 struct listMeta *listMetaCreate();
+struct streamMeta *streamRebuildMetaCreate(objectMeta *cold_meta);
 
 int keyLoadFixDataInit(keyLoadFixData *fix, redisDb *db, decodedResult *dr) {
     uint64_t version;
@@ -468,7 +469,8 @@ int keyLoadFixDataInit(keyLoadFixData *fix, redisDb *db, decodedResult *dr) {
 
     switch (dm->object_type) {
     case OBJ_STRING:
-        rebuild_meta = NULL;
+        /* chunked string rebuilt by chunks, plain string has no meta. */
+        rebuild_meta = dm->extend ? createObjectMeta(OBJ_STRING,dm->version) : NULL;
         break;
     case OBJ_HASH:
     case OBJ_SET:
@@ -478,6 +480,10 @@ int keyLoadFixDataInit(keyLoadFixData *fix, redisDb *db, decodedResult *dr) {
     case OBJ_LIST:
         rebuild_meta = createListObjectMeta(dm->version,listMetaCreate());
         break;
+    case OBJ_STREAM:
+        rebuild_meta = createStreamObjectMeta(dm->version,
+                streamRebuildMetaCreate(cold_meta));
+        break;
     default:
         rebuild_meta = NULL;
         break;
@@ -561,7 +567,11 @@ static inline void keyLoadFixFeed(struct keyLoadFixData *fix, decodedData *d) {
 static int keyLoadFixAna(struct keyLoadFixData *fix) {
     objectMeta *rebuild_meta = fix->rebuild_meta,
                *cold_meta = fix->cold_meta;
-    if (fix->feed_err > 0 || fix->feed_ok <= 0)
+    if (fix->feed_err > 0)
+        return FIX_DELETE;
+
+    /* stream without nodes (e.g. all entries deleted) has no subkey. */
+    if (fix->feed_ok <= 0 && fix->object_type != OBJ_STREAM)
         return FIX_DELETE;
 
     if (rebuild_meta == NULL && cold_meta == NULL) {
@@ -580,6 +590,9 @@ static int keyLoadFixAna(struct keyLoadFixData *fix) {
 
     if (objectMetaEqual(rebuild_meta, cold_meta)) {
         return FIX_NONE;
+    } else if (cold_meta->object_type == OBJ_STRING) {
+        /* length of chunked string can't be recovered from chunks. */
+        return FIX_DELETE;
     } else {
 #ifdef SWAP_DEBUG
         sds cold_meta_dump = dumpObjectMeta(cold_meta);
@@ -823,8 +836,11 @@ void stopPersistLoadFix() {
             server.swap_persist_load_fix_version);
 }
 
-/* scan meta cf to rebuild cold_keys/cold_filter & fix keys */
+/* scan meta cf to rebuild cold_keys/cold_filter & fix keys, scan skipped
+ * if rocksdb not changed since cold filter snapshot saved on shutdown. */
 void loadDataFromRocksdb() {
+    if (coldFiltersLoadSnapshot() == C_OK) return;
+
     startPersistLoadFix();
     for (int i = 0; i < server.dbnum; i++) {
         redisDb *db = server.db+i;
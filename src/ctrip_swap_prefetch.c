@@ -0,0 +1,264 @@
+/* Copyright (c) 2023, ctrip.com * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "ctrip_swap.h"
+
+/* Pipeline prefetch: normal client stops parsing as soon as one command
+ * starts swapping, so N pipelined commands on cold keys costs N serialized
+ * swaps. When that happens, commands already queued in query buffer are
+ * parsed ahead (without being consumed) and keys of readonly ones are
+ * swapped in by prefetch client, so that the whole pipeline gets swapped in
+ * batch. Commands are still executed in order, prefetch only warms keys:
+ * lock is released as soon as swap in finished, and later commands simply
+ * find their keys hot. */
+
+#define SWAP_PREFETCH_MAX_ARGC 256
+#define SWAP_PREFETCH_INPROGRESS_LIMIT 4096
+
+#define SWAP_PREFETCH_PARSE_OK 0
+#define SWAP_PREFETCH_PARSE_INCOMPLETE 1
+#define SWAP_PREFETCH_PARSE_ERR 2
+
+typedef struct swapPrefetchArg {
+    size_t off;
+    size_t len;
+} swapPrefetchArg;
+
+static int swapPrefetchParseLine(const char *buf, size_t len, size_t *pos,
+        char prefix, long long *value) {
+    const char *newline;
+
+    if (*pos >= len) return SWAP_PREFETCH_PARSE_INCOMPLETE;
+    if (buf[*pos] != prefix) return SWAP_PREFETCH_PARSE_ERR;
+    newline = memchr(buf+*pos,'\r',len-*pos);
+    if (newline == NULL || (size_t)(newline-buf) + 1 >= len)
+        return SWAP_PREFETCH_PARSE_INCOMPLETE;
+    if (!string2ll(buf+*pos+1,newline-(buf+*pos+1),value))
+        return SWAP_PREFETCH_PARSE_ERR;
+    *pos = newline-buf+2;
+    return SWAP_PREFETCH_PARSE_OK;
+}
+
+/* Parse one multibulk command starting at *pos (see processMultibulkBuffer),
+ * position of first SWAP_PREFETCH_MAX_ARGC args are recorded. Inline
+ * command is reported as error so that prefetch stops there. */
+static int swapPrefetchParseCommand(const char *buf, size_t len, size_t *pos,
+        swapPrefetchArg *args, int *argc) {
+    long long multibulklen, bulklen;
+    size_t p = *pos;
+    int ret;
+
+    if ((ret = swapPrefetchParseLine(buf,len,&p,'*',&multibulklen)))
+        return ret;
+    if (multibulklen > INT_MAX) return SWAP_PREFETCH_PARSE_ERR;
+    if (multibulklen < 0) multibulklen = 0;
+
+    for (long long i = 0; i < multibulklen; i++) {
+        if ((ret = swapPrefetchParseLine(buf,len,&p,'$',&bulklen)))
+            return ret;
+        if (bulklen < 0 || bulklen > server.proto_max_bulk_len)
+            return SWAP_PREFETCH_PARSE_ERR;
+        if (len-p < (size_t)bulklen+2) return SWAP_PREFETCH_PARSE_INCOMPLETE;
+        if (i < SWAP_PREFETCH_MAX_ARGC) {
+            args[i].off = p;
+            args[i].len = bulklen;
+        }
+        p += bulklen+2;
+    }
+
+    *argc = (int)multibulklen;
+    *pos = p;
+    return SWAP_PREFETCH_PARSE_OK;
+}
+
+static inline int swapPrefetchKeyRequest(keyRequest *kr) {
+    return kr->level == REQUEST_LEVEL_KEY && kr->cmd_intention == SWAP_IN &&
+        !isMetaScanRequest(kr->cmd_intention_flags) &&
+        !(kr->cmd_intention_flags & (SWAP_IN_DEL|SWAP_IN_DEL_MOCK_VALUE|
+                    SWAP_IN_OVERWRITE|SWAP_IN_RANK|SWAP_IN_STREAM|
+                    SWAP_IN_PARTIAL));
+}
+
+static void prefetchClientKeyRequestFinished(client *c, swapCtx *ctx) {
+    c->keyrequests_count--;
+    serverAssert(c->client_hold_mode == CLIENT_HOLD_MODE_EVICT);
+    clientReleaseLocks(c,ctx);
+    server.swap_prefetch_inprogress_count--;
+}
+
+/* Returns number of key requests submitted. */
+static int swapPrefetchCommand(client *c, struct redisCommand *cmd,
+        robj **argv, int argc) {
+    getKeyRequestsResult result = GET_KEYREQUESTS_RESULT_INIT;
+    client *prefetch_client = server.prefetch_client;
+    int i, num = 0;
+
+    getSingleCommandKeyRequests(c->db->id,cmd,argv,argc,&result);
+    for (i = 0; i < result.num; i++) {
+        keyRequest *kr = result.key_requests+i;
+        if (!swapPrefetchKeyRequest(kr)) {
+            keyRequestDeinit(kr);
+            continue;
+        }
+        kr->prefetch = 1;
+        kr->cmd_intention_flags |= SWAP_OOM_CHECK;
+        if (i != num) result.key_requests[num] = *kr;
+        num++;
+    }
+    result.num = num;
+
+    if (num) {
+        prefetch_client->db = c->db;
+        prefetch_client->cmd = cmd;
+        prefetch_client->keyrequests_count += num;
+        server.swap_prefetch_inprogress_count += num;
+        submitClientKeyRequests(prefetch_client,&result,
+                prefetchClientKeyRequestFinished,NULL);
+    }
+
+    releaseKeyRequests(&result);
+    getKeyRequestsFreeResult(&result);
+    return num;
+}
+
+/* Called when command of normal client starts swapping, c->qb_pos already
+ * moved past current command. c->swap_prefetched counts queued commands
+ * that are already looked at, so that pipeline is not prefetched twice. */
+void swapPrefetchPipeline(client *c) {
+    swapPrefetchArg args[SWAP_PREFETCH_MAX_ARGC];
+    int depth = server.swap_pipeline_prefetch_depth, parsed = 0, argc, ret;
+    size_t pos = c->qb_pos, len = sdslen(c->querybuf);
+    long long prefetch_cmds = 0, prefetch_keys = 0;
+
+    if (depth <= 0 || c->swap_prefetched >= depth) return;
+    if (server.swap_pause_type != CLIENT_PAUSE_OFF) return;
+    if (c->flags & (CLIENT_MASTER|CLIENT_SLAVE|CLIENT_CLOSE_AFTER_REPLY|
+                CLIENT_CLOSE_ASAP)) return;
+    /* swapping in keys that client can't mention is not allowed. */
+    if (c->user && !(c->user->flags & USER_FLAG_ALLKEYS)) return;
+
+    while (parsed < depth && pos < len) {
+        robj *argv[SWAP_PREFETCH_MAX_ARGC];
+        struct redisCommand *cmd;
+        sds name;
+        int num;
+
+        if (server.swap_prefetch_inprogress_count >=
+                SWAP_PREFETCH_INPROGRESS_LIMIT) break;
+
+        ret = swapPrefetchParseCommand(c->querybuf,len,&pos,args,&argc);
+        if (ret != SWAP_PREFETCH_PARSE_OK) break;
+        if (++parsed <= c->swap_prefetched) continue;
+
+        if (argc == 0 || argc > SWAP_PREFETCH_MAX_ARGC) {
+            c->swap_prefetched = parsed;
+            continue;
+        }
+
+        name = sdsnewlen(c->querybuf+args[0].off,args[0].len);
+        cmd = lookupCommand(name);
+        sdsfree(name);
+
+        /* keys after SELECT belong to another db, retry after it executed. */
+        if (cmd && cmd->proc == selectCommand) break;
+
+        c->swap_prefetched = parsed;
+
+        if (cmd == NULL || !(cmd->flags & CMD_READONLY) ||
+                (cmd->flags & CMD_MODULE) || cmd->intention != SWAP_IN ||
+                (cmd->arity > 0 && cmd->arity != argc) ||
+                (argc < -cmd->arity)) continue;
+
+        for (int i = 0; i < argc; i++)
+            argv[i] = createStringObject(c->querybuf+args[i].off,args[i].len);
+
+        if ((num = swapPrefetchCommand(c,cmd,argv,argc))) {
+            prefetch_cmds++;
+            prefetch_keys += num;
+        }
+
+        for (int i = 0; i < argc; i++)
+            decrRefCount(argv[i]);
+    }
+
+    atomicIncr(server.swap_hit_stats->stat_pipeline_prefetch_cmd_count,prefetch_cmds);
+    atomicIncr(server.swap_hit_stats->stat_pipeline_prefetch_key_count,prefetch_keys);
+}
+
+#ifdef REDIS_TEST
+
+int swapPrefetchTest(int argc, char *argv[], int accurate) {
+    UNUSED(argc), UNUSED(argv), UNUSED(accurate);
+    swapPrefetchArg args[SWAP_PREFETCH_MAX_ARGC];
+    int error = 0, cmd_argc;
+    size_t pos;
+
+    server.proto_max_bulk_len = 512ll*1024*1024;
+
+    TEST("prefetch: parse pipeline") {
+        const char *buf = "*2\r\n$3\r\nget\r\n$2\r\nk1\r\n*0\r\n*3\r\n$4\r\nmget\r\n$2\r\nk2\r\n$3\r\nk30\r\n";
+        size_t len = strlen(buf);
+
+        pos = 0;
+        test_assert(swapPrefetchParseCommand(buf,len,&pos,args,&cmd_argc) == SWAP_PREFETCH_PARSE_OK);
+        test_assert(cmd_argc == 2);
+        test_assert(!memcmp(buf+args[0].off,"get",3) && args[0].len == 3);
+        test_assert(!memcmp(buf+args[1].off,"k1",2) && args[1].len == 2);
+        test_assert(swapPrefetchParseCommand(buf,len,&pos,args,&cmd_argc) == SWAP_PREFETCH_PARSE_OK);
+        test_assert(cmd_argc == 0);
+        test_assert(swapPrefetchParseCommand(buf,len,&pos,args,&cmd_argc) == SWAP_PREFETCH_PARSE_OK);
+        test_assert(cmd_argc == 3);
+        test_assert(!memcmp(buf+args[2].off,"k30",3) && args[2].len == 3);
+        test_assert(pos == len);
+        test_assert(swapPrefetchParseCommand(buf,len,&pos,args,&cmd_argc) == SWAP_PREFETCH_PARSE_INCOMPLETE);
+    }
+
+    TEST("prefetch: parse incomplete & invalid") {
+        const char *buf = "*2\r\n$3\r\nget\r\n$2\r\nk1\r\n";
+        size_t len = strlen(buf);
+
+        for (size_t i = 0; i < len; i++) {
+            pos = 0;
+            test_assert(swapPrefetchParseCommand(buf,i,&pos,args,&cmd_argc) == SWAP_PREFETCH_PARSE_INCOMPLETE);
+            test_assert(pos == 0);
+        }
+
+        pos = 0;
+        test_assert(swapPrefetchParseCommand("get k1\r\n",8,&pos,args,&cmd_argc) == SWAP_PREFETCH_PARSE_ERR);
+        pos = 0;
+        test_assert(swapPrefetchParseCommand("*1\r\n+get\r\n",10,&pos,args,&cmd_argc) == SWAP_PREFETCH_PARSE_ERR);
+        pos = 0;
+        test_assert(swapPrefetchParseCommand("*x\r\n",4,&pos,args,&cmd_argc) == SWAP_PREFETCH_PARSE_ERR);
+        pos = 0;
+        test_assert(swapPrefetchParseCommand("*1\r\n$-1\r\n",9,&pos,args,&cmd_argc) == SWAP_PREFETCH_PARSE_ERR);
+    }
+
+    return error;
+}
+
+#endif
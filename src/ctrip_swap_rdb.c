@@ -27,6 +27,10 @@
  */
 
 #include "ctrip_swap.h"
+#include <sys/mman.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 void decodedResultInit(decodedResult *decoded) {
     memset(decoded,0,sizeof(decodedResult));
@@ -210,6 +214,9 @@ static int rdbKeySaveDataInitWarm(rdbKeySaveData *save, redisDb *db,
     case OBJ_ZSET:
         zsetSaveInit(save,SWAP_VERSION_ZERO,NULL,0);
         break;
+    case OBJ_STREAM:
+        streamSaveInit(save,SWAP_VERSION_ZERO,NULL,0);
+        break;
     default:
         retval = INIT_SAVE_ERR;
         break;
@@ -227,8 +234,10 @@ static int rdbKeySaveDataInitCold(rdbKeySaveData *save, redisDb *db,
 
     switch (dm->object_type) {
     case OBJ_STRING:
-        serverAssert(dm->extend == NULL);
-        wholeKeySaveInit(save);
+        if (dm->extend == NULL)
+            wholeKeySaveInit(save);
+        else
+            retval = chunkedStringSaveInit(save,dm->version,dm->extend,sdslen(dm->extend));
         break;
     case OBJ_HASH:
         serverAssert(dm->extend != NULL);
@@ -246,6 +255,10 @@ static int rdbKeySaveDataInitCold(rdbKeySaveData *save, redisDb *db,
         serverAssert(dm->extend != NULL);
         retval = zsetSaveInit(save,dm->version,dm->extend,sdslen(dm->extend));
         break;
+    case OBJ_STREAM:
+        serverAssert(dm->extend != NULL);
+        retval = streamSaveInit(save,dm->version,dm->extend,sdslen(dm->extend));
+        break;
     default:
         retval = INIT_SAVE_ERR;
         break;
@@ -287,26 +300,478 @@ int rdbKeySaveDataInit(rdbKeySaveData *save, redisDb *db, decodedResult *dr) {
     }
 }
 
+rdbSaveRangesStat *rdbSaveRangesStatCreate(void) {
+    rdbSaveRangesStat *stat;
+    /* written by bgsave child, read by parent. */
+    stat = mmap(NULL,sizeof(rdbSaveRangesStat),PROT_READ|PROT_WRITE,
+            MAP_SHARED|MAP_ANONYMOUS,-1,0);
+    if (stat == MAP_FAILED) {
+        serverLog(LL_WARNING, "Failed to mmap rdb save ranges stat: %s",
+                strerror(errno));
+        return NULL;
+    }
+    memset(stat,0,sizeof(rdbSaveRangesStat));
+    return stat;
+}
+
+static const char *rdbSaveRangeStateName(int state) {
+    switch (state) {
+    case RDB_SAVE_RANGE_STATE_SAVING: return "saving";
+    case RDB_SAVE_RANGE_STATE_DONE: return "done";
+    case RDB_SAVE_RANGE_STATE_ERR: return "err";
+    default: return "none";
+    }
+}
+
+sds genSwapRdbSaveInfoString(sds info) {
+    int i, dbid, nranges, state;
+    long long keys, bytes;
+    rdbSaveRangesStat *stat = server.swap_rdb_save_ranges_stat;
+
+    info = sdscatprintf(info,"swap_rdb_save_threads:%d\r\n",
+            server.swap_rdb_save_threads);
+    if (stat == NULL) return info;
+
+    atomicGet(stat->dbid,dbid);
+    atomicGet(stat->nranges,nranges);
+    info = sdscatprintf(info,
+            "swap_rdb_save_db:%d\r\n"
+            "swap_rdb_save_ranges:%d\r\n",
+            dbid,nranges);
+    for (i = 0; i < nranges && i < SWAP_RDB_SAVE_THREADS_MAX; i++) {
+        rdbSaveRangeStat *range = stat->ranges+i;
+        atomicGet(range->state,state);
+        atomicGet(range->keys,keys);
+        atomicGet(range->bytes,bytes);
+        info = sdscatprintf(info,
+                "swap_rdb_save_range%d:state=%s,keys=%lld,bytes=%lld\r\n",
+                i,rdbSaveRangeStateName(state),keys,bytes);
+    }
+    return info;
+}
+
+/* ------------------------------ rocks checkpoint ------------------------------ */
+rocksCheckpointShipStat *rocksCheckpointShipStatCreate(int shared) {
+    rocksCheckpointShipStat *stat;
+    if (!shared) return zcalloc(sizeof(rocksCheckpointShipStat));
+    /* written by bgsave child, read by parent. */
+    stat = mmap(NULL,sizeof(rocksCheckpointShipStat),PROT_READ|PROT_WRITE,
+            MAP_SHARED|MAP_ANONYMOUS,-1,0);
+    if (stat == MAP_FAILED) {
+        serverLog(LL_WARNING, "Failed to mmap rocks checkpoint ship stat: %s",
+                strerror(errno));
+        return NULL;
+    }
+    memset(stat,0,sizeof(rocksCheckpointShipStat));
+    return stat;
+}
+
+static void rocksCheckpointShipStatStart(rocksCheckpointShipStat *stat) {
+    long long now = mstime();
+    if (stat == NULL) return;
+    atomicSet(stat->state,ROCKS_CHECKPOINT_SHIP_INPROGRESS);
+    atomicSet(stat->files,0);
+    atomicSet(stat->bytes,0);
+    atomicSet(stat->start_time,now);
+    atomicSet(stat->update_time,now);
+}
+
+static void rocksCheckpointShipStatUpdate(rocksCheckpointShipStat *stat,
+        long long files, long long bytes) {
+    if (stat == NULL) return;
+    atomicIncr(stat->files,files);
+    atomicIncr(stat->bytes,bytes);
+    atomicSet(stat->update_time,mstime());
+}
+
+static void rocksCheckpointShipStatSetState(rocksCheckpointShipStat *stat,
+        int state) {
+    if (stat == NULL) return;
+    atomicSet(stat->state,state);
+    atomicSet(stat->update_time,mstime());
+}
+
+static const char *rocksCheckpointShipStateName(int state) {
+    switch (state) {
+    case ROCKS_CHECKPOINT_SHIP_INPROGRESS: return "inprogress";
+    case ROCKS_CHECKPOINT_SHIP_DONE: return "done";
+    case ROCKS_CHECKPOINT_SHIP_ERR: return "err";
+    default: return "none";
+    }
+}
+
+static sds genRocksCheckpointShipInfoString(sds info, const char *name,
+        rocksCheckpointShipStat *stat) {
+    int state;
+    long long files, bytes, start_time, update_time, elapsed, bps;
+
+    if (stat == NULL) return info;
+    atomicGet(stat->state,state);
+    atomicGet(stat->files,files);
+    atomicGet(stat->bytes,bytes);
+    atomicGet(stat->start_time,start_time);
+    atomicGet(stat->update_time,update_time);
+    if (state == ROCKS_CHECKPOINT_SHIP_NONE) {
+        elapsed = 0;
+    } else if (state == ROCKS_CHECKPOINT_SHIP_INPROGRESS) {
+        elapsed = mstime() - start_time;
+    } else {
+        elapsed = update_time - start_time;
+    }
+    bps = elapsed > 0 ? bytes*1000/elapsed : 0;
+
+    return sdscatprintf(info,
+            "swap_checkpoint_%s:state=%s,files=%lld,bytes=%lld,"
+            "elapsed_ms=%lld,bps=%lld\r\n",
+            name,rocksCheckpointShipStateName(state),files,bytes,elapsed,bps);
+}
+
+sds genSwapCheckpointInfoString(sds info) {
+    info = genRocksCheckpointShipInfoString(info,"send",
+            server.swap_checkpoint_send_stat);
+    info = genRocksCheckpointShipInfoString(info,"recv",
+            server.swap_checkpoint_recv_stat);
+    return info;
+}
+
+static void rdbSaveRocksCheckpointRatelimit(long long bytes, mstime_t start) {
+    mstime_t minimal_timespan, elapsed_timespan;
+    if (!server.swap_repl_max_rocksdb_read_bps) return;
+    minimal_timespan = bytes*1000/server.swap_repl_max_rocksdb_read_bps;
+    elapsed_timespan = mstime() - start;
+    if (minimal_timespan > elapsed_timespan)
+        usleep((minimal_timespan-elapsed_timespan)*1000);
+}
+
+/* File is saved as: opcode, name, (chunk len, chunk bytes)..., 0. */
+static int rdbSaveRocksCheckpointFile(rio *rdb, const char *path,
+        const char *name, long long *bytes, mstime_t start) {
+    rocksCheckpointShipStat *stat = server.swap_checkpoint_send_stat;
+    char *buf = zmalloc(ROCKS_CHECKPOINT_CHUNK_SIZE);
+    ssize_t nread;
+    int fd, retval = -1;
+
+    if ((fd = open(path,O_RDONLY)) == -1) {
+        serverLog(LL_WARNING, "[rocks] open checkpoint file %s failed: %s",
+                path, strerror(errno));
+        goto end;
+    }
+
+    if (rdbSaveType(rdb,RDB_OPCODE_ROCKS_FILE) == -1) goto end;
+    if (rdbSaveRawString(rdb,(unsigned char*)name,strlen(name)) == -1) goto end;
+    while ((nread = read(fd,buf,ROCKS_CHECKPOINT_CHUNK_SIZE)) > 0) {
+        if (rdbSaveLen(rdb,nread) == -1) goto end;
+        if (rdbWriteRaw(rdb,buf,nread) == -1) goto end;
+        *bytes += nread;
+        rocksCheckpointShipStatUpdate(stat,0,nread);
+        rdbSaveRocksCheckpointRatelimit(*bytes,start);
+    }
+    if (nread < 0) {
+        serverLog(LL_WARNING, "[rocks] read checkpoint file %s failed: %s",
+                path, strerror(errno));
+        goto end;
+    }
+    if (rdbSaveLen(rdb,0) == -1) goto end;
+    rocksCheckpointShipStatUpdate(stat,1,0);
+    retval = 0;
+
+end:
+    if (fd != -1) close(fd);
+    zfree(buf);
+    return retval;
+}
+
+/* Ship files of rocks checkpoint created for this bgsave, followed by end
+ * marker (empty name) and current key version: keys loaded after checkpoint
+ * installed must not reuse version of keys in checkpoint. */
+int rdbSaveRocksCheckpoint(rio *rdb) {
+    rocksCheckpointShipStat *ship_stat = server.swap_checkpoint_send_stat;
+    const char *dir = server.rocks->rdb_checkpoint_dir;
+    long long files = 0, bytes = 0;
+    mstime_t start = mstime();
+    struct dirent *de;
+    DIR *d = NULL;
+
+    rocksCheckpointShipStatStart(ship_stat);
+
+    if (dir == NULL || (d = opendir(dir)) == NULL) {
+        serverLog(LL_WARNING, "[rocks] open checkpoint dir %s failed: %s",
+                dir ? dir : "(nil)", dir ? strerror(errno) : "no checkpoint");
+        goto err;
+    }
+
+    while ((de = readdir(d)) != NULL) {
+        struct stat statbuf;
+        sds path;
+        int retval;
+
+        if (!strcmp(de->d_name,".") || !strcmp(de->d_name,"..")) continue;
+        path = sdscatfmt(sdsempty(),"%s/%s",dir,de->d_name);
+        if (stat(path,&statbuf) || !S_ISREG(statbuf.st_mode)) {
+            sdsfree(path);
+            continue;
+        }
+        retval = rdbSaveRocksCheckpointFile(rdb,path,de->d_name,&bytes,start);
+        sdsfree(path);
+        if (retval) goto err;
+        files++;
+    }
+    closedir(d);
+    d = NULL;
+
+    if (rdbSaveType(rdb,RDB_OPCODE_ROCKS_FILE) == -1) goto err;
+    if (rdbSaveRawString(rdb,(unsigned char*)"",0) == -1) goto err;
+    if (rdbSaveLen(rdb,server.swap_key_version) == -1) goto err;
+
+    rocksCheckpointShipStatSetState(ship_stat,ROCKS_CHECKPOINT_SHIP_DONE);
+    serverLog(LL_NOTICE, "[rocks] shipped checkpoint %s: files=%lld, bytes=%lld, elapsed=%lldms.",
+            dir, files, bytes, mstime()-start);
+    return 0;
+
+err:
+    if (d) closedir(d);
+    rocksCheckpointShipStatSetState(ship_stat,ROCKS_CHECKPOINT_SHIP_ERR);
+    return -1;
+}
+
+static int rdbLoadRocksCheckpointInstall(rio *rdb) {
+    uint64_t version;
+    long long files, bytes;
+
+    if ((version = rdbLoadLen(rdb,NULL)) == RDB_LENERR) return -1;
+
+    if (rocksInstallCheckpoint()) return -1;
+
+    if (server.swap_key_version <= version) swapSetVersion(version+1);
+    server.swap_checkpoint_installed = 1;
+
+    atomicGet(server.swap_checkpoint_recv_stat->files,files);
+    atomicGet(server.swap_checkpoint_recv_stat->bytes,bytes);
+    serverLog(LL_NOTICE, "[rocks] rocks checkpoint installed: files=%lld, bytes=%lld.",
+            files, bytes);
+    return 0;
+}
+
+static int rdbLoadRocksCheckpointFileData(rio *rdb, sds name) {
+    rocksCheckpointShipStat *stat = server.swap_checkpoint_recv_stat;
+    sds stagedir = rocksCheckpointStageDir(), path;
+    char *buf = NULL;
+    uint64_t len;
+    int fd, retval = -1;
+
+    path = sdscatfmt(sdsempty(),"%S/%S",stagedir,name);
+    if ((fd = open(path,O_WRONLY|O_CREAT|O_TRUNC,0644)) == -1) {
+        serverLog(LL_WARNING, "[rocks] create checkpoint file %s failed: %s",
+                path, strerror(errno));
+        goto end;
+    }
+
+    buf = zmalloc(ROCKS_CHECKPOINT_CHUNK_SIZE);
+    while (1) {
+        if ((len = rdbLoadLen(rdb,NULL)) == RDB_LENERR) goto end;
+        if (len == 0) break;
+        if (len > ROCKS_CHECKPOINT_CHUNK_SIZE) {
+            serverLog(LL_WARNING, "[rocks] checkpoint file %s chunk too large: %llu",
+                    name, (unsigned long long)len);
+            goto end;
+        }
+        if (rioRead(rdb,buf,len) == 0) goto end;
+        if (write(fd,buf,len) != (ssize_t)len) {
+            serverLog(LL_WARNING, "[rocks] write checkpoint file %s failed: %s",
+                    path, strerror(errno));
+            goto end;
+        }
+        rocksCheckpointShipStatUpdate(stat,0,len);
+    }
+    if (redis_fsync(fd) == -1) {
+        serverLog(LL_WARNING, "[rocks] fsync checkpoint file %s failed: %s",
+                path, strerror(errno));
+        goto end;
+    }
+    rocksCheckpointShipStatUpdate(stat,1,0);
+    retval = 0;
+
+end:
+    if (fd != -1) close(fd);
+    if (buf) zfree(buf);
+    sdsfree(path);
+    sdsfree(stagedir);
+    return retval;
+}
+
+/* Load one RDB_OPCODE_ROCKS_FILE record: receive file into stage dir, or
+ * install stage dir as rocks data if it's the end marker. */
+int rdbLoadRocksCheckpointFile(rio *rdb) {
+    rocksCheckpointShipStat *stat = server.swap_checkpoint_recv_stat;
+    sds name;
+    int state, retval = -1;
+
+    if (server.swap_mode == SWAP_MODE_MEMORY) {
+        serverLog(LL_WARNING, "[rocks] rocks checkpoint can't be loaded in memory mode.");
+        return -1;
+    }
+
+    if ((name = rdbGenericLoadStringObject(rdb,RDB_LOAD_SDS,NULL)) == NULL)
+        return -1;
+
+    atomicGet(stat->state,state);
+    if (state != ROCKS_CHECKPOINT_SHIP_INPROGRESS) {
+        if (rocksCheckpointStageInit()) goto end;
+        rocksCheckpointShipStatStart(stat);
+    }
+
+    if (sdslen(name) == 0) {
+        if ((retval = rdbLoadRocksCheckpointInstall(rdb)) == 0)
+            rocksCheckpointShipStatSetState(stat,ROCKS_CHECKPOINT_SHIP_DONE);
+    } else if (strchr(name,'/') || !strcmp(name,".") || !strcmp(name,"..")) {
+        serverLog(LL_WARNING, "[rocks] invalid checkpoint file name: %s", name);
+    } else {
+        retval = rdbLoadRocksCheckpointFileData(rdb,name);
+    }
+
+end:
+    if (retval) rocksCheckpointShipStatSetState(stat,ROCKS_CHECKPOINT_SHIP_ERR);
+    sdsfree(name);
+    return retval;
+}
+
+/* Keys in installed checkpoint are not loaded through rdb, rebuild
+ * cold_keys & cold_filter by scanning meta cf. Unlike loadDataFromRocksdb,
+ * data cf is not scanned: checkpoint is a consistent snapshot of master. */
+static void rocksCheckpointLoadFix(void) {
+    rocks *rocks = server.rocks;
+    rocksdb_iterator_t *iter;
+    uint64_t max_version = 0;
+    long long keys = 0, start = ustime();
+    char *err = NULL;
+    int i;
+
+    for (i = 0; i < server.dbnum; i++) {
+        server.db[i].cold_keys = 0;
+        coldFilterReset(server.db[i].cold_filter);
+    }
+
+    iter = rocksdb_create_iterator_cf(rocks->db,rocks->ropts,
+            rocks->cf_handles[META_CF]);
+    for (rocksdb_iter_seek_to_first(iter); rocksdb_iter_valid(iter);
+            rocksdb_iter_next(iter)) {
+        const char *rawkey, *rawval, *key, *extend;
+        size_t klen, vlen, keylen, extend_len;
+        int dbid, object_type;
+        long long expire;
+        uint64_t version;
+        sds keystr;
+
+        rawkey = rocksdb_iter_key(iter,&klen);
+        if (klen == SWAP_KEY_FORMAT_MARKER_LEN &&
+                !memcmp(rawkey,SWAP_KEY_FORMAT_MARKER,klen))
+            continue;
+        if (rocksDecodeMetaKey(rawkey,klen,&dbid,&key,&keylen)) continue;
+        if (dbid < 0 || dbid >= server.dbnum) continue;
+        rawval = rocksdb_iter_value(iter,&vlen);
+        if (rocksDecodeMetaVal(rawval,vlen,&object_type,&expire,&version,
+                    &extend,&extend_len)) continue;
+
+        keystr = sdsnewlen(key,keylen);
+        server.db[dbid].cold_keys++;
+        coldFilterAddKey(server.db[dbid].cold_filter,keystr);
+        sdsfree(keystr);
+        max_version = MAX(max_version,version);
+        keys++;
+    }
+    rocksdb_iter_get_error(iter,&err);
+    rocksdb_iter_destroy(iter);
+    if (err != NULL) {
+        serverLog(LL_WARNING, "[rocks] scan checkpoint meta failed: %s", err);
+        zlibc_free(err);
+    }
+
+    if (server.swap_key_version <= max_version) swapSetVersion(max_version+1);
+    serverLog(LL_NOTICE, "[rocks] rebuilt %lld cold keys from checkpoint in %lld ms.",
+            keys, (ustime()-start)/1000);
+}
+
+typedef struct rdbSaveRocksRange {
+    int idx;
+    redisDb *db;
+    rocksIter *it;
+    rio *rdb; /* rdb of bgsave, or private tmp file for parallel save */
+    FILE *fp; /* tmp file for parallel save, NULL if save to rdb directly. */
+    rio tmp_rdb;
+    int rdbflags;
+    pthread_t thread;
+    int thread_created;
+    rocksIterDecodeStats iter_stats;
+    rdbSaveRocksStats stats;
+    int recoverable_err;
+    sds errstr;
+    int error;
+    int retval;
+} rdbSaveRocksRange;
+
+static pthread_mutex_t rdb_save_child_err_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void rdbSaveRocksRangeInit(rdbSaveRocksRange *range, int idx,
+        redisDb *db, rio *rdb, int rdbflags) {
+    memset(range,0,sizeof(rdbSaveRocksRange));
+    range->idx = idx;
+    range->db = db;
+    range->rdb = rdb;
+    range->rdbflags = rdbflags;
+    range->retval = C_OK;
+}
+
+static void rdbSaveRocksRangeDeinit(rdbSaveRocksRange *range) {
+    if (range->it) {
+        rocksReleaseIter(range->it);
+        range->it = NULL;
+    }
+    if (range->fp) {
+        fclose(range->fp);
+        range->fp = NULL;
+    }
+    if (range->errstr) {
+        sdsfree(range->errstr);
+        range->errstr = NULL;
+    }
+}
+
+static void rdbSaveRocksRangeUpdateStat(rdbSaveRocksRange *range) {
+    rdbSaveRangeStat *stat;
+    if (server.swap_rdb_save_ranges_stat == NULL) return;
+    stat = server.swap_rdb_save_ranges_stat->ranges+range->idx;
+    atomicSet(stat->keys,range->stats.save_ok);
+    atomicSet(stat->bytes,(long long)range->rdb->processed_bytes);
+}
+
+static void rdbSaveRocksRangeSetState(rdbSaveRocksRange *range, int state) {
+    if (server.swap_rdb_save_ranges_stat == NULL) return;
+    atomicSet(server.swap_rdb_save_ranges_stat->ranges[range->idx].state,state);
+}
+
+static int rdbSaveRocksKeyIsCold(redisDb *db, decodedResult *dr) {
+    robj key;
+    if (dr->cf != META_CF) return 0;
+    initStaticStringObject(key,dr->key);
+    return lookupKey(db,&key,LOOKUP_NOTOUCH) == NULL;
+}
+
 /* Bighash/set/zset... fields are located adjacent, and will be iterated
  * next to each.
  * Note that only IO error aborts rdbSaveRocks, keys with decode/init_save
  * errors are skipped. */
-int rdbSaveRocks(rio *rdb, int *error, redisDb *db, int rdbflags) {
-    rocksIter *it = NULL;
+static int rdbSaveRocksRangeIterate(rdbSaveRocksRange *range) {
+    rocksIter *it = range->it;
+    rio *rdb = range->rdb;
+    redisDb *db = range->db;
     sds errstr = NULL;
-    int recoverable_err = 0;
-    rocksIterDecodeStats _iter_stats = {0}, *iter_stats = &_iter_stats;
-    rdbSaveRocksStats _stats = {0}, *stats = &_stats;
+    rocksIterDecodeStats *iter_stats = &range->iter_stats;
+    rdbSaveRocksStats *stats = &range->stats;
     decodedResult  _cur, *cur = &_cur, _next, *next = &_next;
     decodedResultInit(cur);
     decodedResultInit(next);
     int iter_valid; /* true if current iter value is valid. */
 
-    if (!(it = rocksCreateIter(server.rocks,db))) {
-        serverLog(LL_WARNING, "Create rocks iterator failed.");
-        return C_ERR;
-    }
-
     iter_valid = rocksIterSeekToFirst(it);
 
     while (1) {
@@ -325,6 +790,14 @@ int rdbSaveRocks(rio *rdb, int *error, redisDb *db, int rdbflags) {
             serverAssert(cur->key != NULL);
         }
 
+        /* cold keys already shipped as rocks checkpoint files. */
+        if ((range->rdbflags & RDBFLAGS_ROCKS_CHECKPOINT) &&
+                rdbSaveRocksKeyIsCold(db,cur)) {
+            stats->init_save_skip++;
+            decodedResultDeinit(cur);
+            continue;
+        }
+
         init_result = rdbKeySaveDataInit(save,db,cur);
         if (init_result == INIT_SAVE_SKIP) {
             stats->init_save_skip++;
@@ -419,8 +892,10 @@ saveend:
             stats->save_ok++;
         } else if (server.swap_bgsave_fix_metalen_mismatch && save_result > SAVE_ERR_NONE && save_result < SAVE_ERR_UNRECOVERABLE) {
             /* try to fix err while swap_bgsave_robust set */
+            pthread_mutex_lock(&rdb_save_child_err_lock);
             sendSwapChildErr(save_result, db->id, save->key->ptr);
-            recoverable_err++;
+            pthread_mutex_unlock(&rdb_save_child_err_lock);
+            range->recoverable_err++;
         } else {
             if (errstr == NULL) {
                 errstr = sdscatfmt(sdsempty(),"Save key end failed: %s",
@@ -431,34 +906,194 @@ saveend:
         }
 
         rdbKeySaveDataDeinit(save);
-        rdbSaveProgress(rdb,rdbflags);
+        rdbSaveRocksRangeUpdateStat(range);
+        /* progress of parallel save reported when ranges stitched. */
+        if (range->fp == NULL) rdbSaveProgress(rdb,range->rdbflags);
     };
 
-    if (recoverable_err > 0) {
-        if (errstr == NULL) {
-            errstr = sdscatfmt(sdsempty(),"recoverable err: %i, try later",recoverable_err);
+    rdbSaveRocksRangeUpdateStat(range);
+    return C_OK;
+
+err:
+    range->error = errno;
+    range->errstr = errstr;
+    return C_ERR;
+}
+
+static void *rdbSaveRocksRangeThreadMain(void *arg) {
+    rdbSaveRocksRange *range = arg;
+    redis_set_thread_title("rdb_save_range");
+    range->retval = rdbSaveRocksRangeIterate(range);
+    if (range->retval == C_OK && rioFlush(range->rdb) == 0) {
+        range->error = errno;
+        range->errstr = sdscatfmt(sdsempty(),"Flush range failed: %s",
+                strerror(errno));
+        range->retval = C_ERR;
+    }
+    return NULL;
+}
+
+/* Append range saved in tmp file to rdb, rdb checksum updated by rioWrite. */
+static int rdbSaveRocksRangeStitch(rio *rdb, rdbSaveRocksRange *range) {
+    char buf[PROTO_IOBUF_LEN];
+    size_t nread;
+    long long k;
+
+    if (fseek(range->fp,0,SEEK_SET) == -1) goto err;
+    while ((nread = fread(buf,1,sizeof(buf),range->fp)) > 0) {
+        if (rioWrite(rdb,buf,nread) == 0) goto err;
+    }
+    if (ferror(range->fp)) goto err;
+
+    for (k = 0; k < range->stats.save_ok; k++) {
+        rdbSaveProgress(rdb,range->rdbflags);
+    }
+    return C_OK;
+
+err:
+    range->error = errno;
+    range->errstr = sdscatfmt(sdsempty(),"Stitch range %i failed: %s",
+            range->idx, strerror(errno));
+    return C_ERR;
+}
+
+static int rdbSaveRocksRangeOpenTmpFile(rdbSaveRocksRange *range) {
+    char tmpfile[256];
+
+    snprintf(tmpfile,sizeof(tmpfile),"temp-rdb-range-%d-%d.rdb",
+            (int) getpid(),range->idx);
+    if ((range->fp = fopen(tmpfile,"w+")) == NULL) {
+        range->error = errno;
+        range->errstr = sdscatfmt(sdsempty(),"Open tmp file %s failed: %s",
+                tmpfile, strerror(errno));
+        return C_ERR;
+    }
+    /* tmp file removed as soon as it is closed, even if we crashed. */
+    unlink(tmpfile);
+    rioInitWithFile(&range->tmp_rdb,range->fp);
+    range->rdb = &range->tmp_rdb;
+    return C_OK;
+}
+
+/* Keyspace of db is split into disjoint ranges at meta key boundaries, each
+ * range iterated and encoded by its own thread into a tmp file, which then
+ * appended to rdb in key order, so the rdb produced is byte-for-byte
+ * equivalent to that of serial save. */
+int rdbSaveRocks(rio *rdb, int *error, redisDb *db, int rdbflags) {
+    rocksIterSource *source = NULL;
+    rdbSaveRocksRange *ranges = NULL, *failed = NULL;
+    rocksIterDecodeStats iter_stats = {0};
+    rdbSaveRocksStats stats = {0};
+    sds *bounds = NULL, errstr = NULL;
+    int i, nbounds = 0, nranges, recoverable_err = 0, retval = C_OK;
+    rdbSaveRangesStat *ranges_stat = server.swap_rdb_save_ranges_stat;
+
+    if (!(source = rocksCreateIterSource(server.rocks))) {
+        serverLog(LL_WARNING, "Create rocks iterator failed.");
+        return C_ERR;
+    }
+
+    if (server.swap_rdb_save_threads > 1) {
+        bounds = rocksIterSourceSplitDb(source,db->id,
+                server.swap_rdb_save_threads,&nbounds);
+    }
+    nranges = nbounds+1;
+
+    if (ranges_stat) {
+        memset(ranges_stat->ranges,0,sizeof(ranges_stat->ranges));
+        atomicSet(ranges_stat->dbid,db->id);
+        atomicSet(ranges_stat->nranges,nranges);
+    }
+
+    ranges = zmalloc(sizeof(rdbSaveRocksRange)*nranges);
+    for (i = 0; i < nranges; i++) {
+        rdbSaveRocksRange *range = ranges+i;
+        sds start = i == 0 ? NULL : sdsdup(bounds[i-1]);
+        sds end = i == nranges-1 ? NULL : sdsdup(bounds[i]);
+
+        rdbSaveRocksRangeInit(range,i,db,rdb,rdbflags);
+
+        if (!(range->it = rocksCreateRangeIter(source,db,start,end))) {
+            range->errstr = sdsnew("Create rocks iterator failed.");
+            range->retval = C_ERR;
+            break;
         }
+
+        if (nranges > 1) {
+            int err;
+            if (rdbSaveRocksRangeOpenTmpFile(range) == C_ERR) {
+                range->retval = C_ERR;
+                break;
+            }
+            rdbSaveRocksRangeSetState(range,RDB_SAVE_RANGE_STATE_SAVING);
+            if ((err = pthread_create(&range->thread,NULL,
+                            rdbSaveRocksRangeThreadMain,range))) {
+                range->errstr = sdscatfmt(sdsempty(),
+                        "Create rdb save range thread failed: %s",
+                        strerror(err));
+                range->retval = C_ERR;
+                break;
+            }
+            range->thread_created = 1;
+        } else {
+            rdbSaveRocksRangeSetState(range,RDB_SAVE_RANGE_STATE_SAVING);
+            range->retval = rdbSaveRocksRangeIterate(range);
+        }
+    }
+    if (i < nranges) nranges = i+1; /* ranges after failed one not inited. */
+
+    for (i = 0; i < nranges; i++) {
+        rdbSaveRocksRange *range = ranges+i;
+        if (range->thread_created) pthread_join(range->thread,NULL);
+        if (range->retval == C_OK && range->fp && failed == NULL)
+            range->retval = rdbSaveRocksRangeStitch(rdb,range);
+        rdbSaveRocksRangeSetState(range,range->retval == C_OK ?
+                RDB_SAVE_RANGE_STATE_DONE : RDB_SAVE_RANGE_STATE_ERR);
+        if (range->retval != C_OK && failed == NULL) failed = range;
+
+        iter_stats.ok += range->iter_stats.ok;
+        iter_stats.err += range->iter_stats.err;
+        stats.init_save_ok += range->stats.init_save_ok;
+        stats.init_save_skip += range->stats.init_save_skip;
+        stats.init_save_err += range->stats.init_save_err;
+        stats.save_ok += range->stats.save_ok;
+        recoverable_err += range->recoverable_err;
+    }
+
+    if (failed) {
+        errno = failed->error;
+        errstr = failed->errstr ? sdsdup(failed->errstr) : NULL;
+        goto err;
+    }
+
+    if (recoverable_err > 0) {
+        errstr = sdscatfmt(sdsempty(),"recoverable err: %i, try later",recoverable_err);
         goto err;
     }
 
-    sds iter_stats_dump = rocksIterDecodeStatsDump(iter_stats);
-    sds stats_dump = rdbSaveRocksStatsDump(stats);
+    sds iter_stats_dump = rocksIterDecodeStatsDump(&iter_stats);
+    sds stats_dump = rdbSaveRocksStatsDump(&stats);
     serverLog(LL_NOTICE,
-            "Rdb save keys from rocksdb finished: iter=(%s), save=(%s)",
-            iter_stats_dump,stats_dump);
+            "Rdb save keys from rocksdb finished: ranges=%d, iter=(%s), save=(%s)",
+            nranges,iter_stats_dump,stats_dump);
     sdsfree(iter_stats_dump);
     sdsfree(stats_dump);
 
-    if (it) rocksReleaseIter(it);
-
-    return C_OK;
+    goto end;
 
 err:
     if (error && *error == 0) *error = errno;
     serverLog(LL_WARNING, "Save rocks data to rdb failed: %s", errstr);
-    if (it) rocksReleaseIter(it);
     if (errstr) sdsfree(errstr);
-    return C_ERR;
+    retval = C_ERR;
+
+end:
+    for (i = 0; i < nranges; i++) rdbSaveRocksRangeDeinit(ranges+i);
+    zfree(ranges);
+    for (i = 0; i < nbounds; i++) sdsfree(bounds[i]);
+    zfree(bounds);
+    rocksReleaseIterSource(source);
+    return retval;
 }
 
 /* ------------------------------ rdb load -------------------------------- */
@@ -565,6 +1200,8 @@ ctripRdbLoadCtx *ctripRdbLoadCtxNew() {
     ctx->batch.cfs = zmalloc(sizeof(int)*ctx->batch.count);
     ctx->batch.rawkeys = zmalloc(sizeof(sds)*ctx->batch.count);
     ctx->batch.rawvals = zmalloc(sizeof(sds)*ctx->batch.count);
+    ctx->ingest = server.swap_rdb_load_ingest_enabled ?
+        rdbLoadIngestCtxNew() : NULL;
     return ctx;
 }
 
@@ -601,6 +1238,11 @@ void ctripRdbLoadSendBatch(ctripRdbLoadCtx *ctx) {
 }
 
 void ctripRdbLoadCtxFeed(ctripRdbLoadCtx *ctx, int cf, MOVE sds rawkey, MOVE sds rawval) {
+    if (ctx->ingest) {
+        rdbLoadIngestFeed(ctx->ingest,cf,rawkey,rawval);
+        return;
+    }
+
     ctx->batch.cfs[ctx->batch.index] = cf;
     ctx->batch.rawkeys[ctx->batch.index] = rawkey;
     ctx->batch.rawvals[ctx->batch.index] = rawval;
@@ -620,21 +1262,49 @@ void ctripRdbLoadCtxFree(ctripRdbLoadCtx *ctx) {
     zfree(ctx->batch.cfs);
     zfree(ctx->batch.rawkeys);
     zfree(ctx->batch.rawvals);
+    rdbLoadIngestCtxFree(ctx->ingest);
     zfree(ctx);
 }
 
+/* Ingest sst files of bulk load, called once rdb loaded so that keys are
+ * readable afterwards (e.g. aof tail after rdb preamble). Pairs fed later
+ * go through swap threads. */
+int ctripRdbLoadIngest(void) {
+    ctripRdbLoadCtx *ctx = server.rdb_load_ctx;
+    int retval;
+
+    if (ctx == NULL || ctx->ingest == NULL) return C_OK;
+    retval = rdbLoadIngestFinish(ctx->ingest);
+    rdbLoadIngestCtxFree(ctx->ingest);
+    ctx->ingest = NULL;
+    return retval;
+}
+
 void evictStartLoading() {
     server.rdb_load_ctx = ctripRdbLoadCtxNew();
+    server.swap_checkpoint_installed = 0;
 }
 
 void evictStopLoading(int success) {
-    UNUSED(success);
+    rocksCheckpointShipStat *stat = server.swap_checkpoint_recv_stat;
+    int state;
+
     /* send last buffered batch. */
     ctripRdbLoadSendBatch(server.rdb_load_ctx);
     asyncCompleteQueueDrain(-1); /* CONFIRM */
     parallelSyncDrain();
     ctripRdbLoadCtxFree(server.rdb_load_ctx);
     server.rdb_load_ctx = NULL;
+
+    if (stat) {
+        atomicGet(stat->state,state);
+        if (state == ROCKS_CHECKPOINT_SHIP_INPROGRESS)
+            rocksCheckpointShipStatSetState(stat,ROCKS_CHECKPOINT_SHIP_ERR);
+    }
+    if (server.swap_checkpoint_installed) {
+        server.swap_checkpoint_installed = 0;
+        if (success) rocksCheckpointLoadFix();
+    }
 }
 
 /* ------------------------------ rdb load start -------------------------------- */
@@ -855,6 +1525,9 @@ int rdbKeyLoadDataInit(rdbKeyLoadData *load, int rdbtype,
     case RDB_TYPE_ZSET_ZIPLIST:
         zsetLoadInit(load);
         break;
+    case RDB_TYPE_STREAM_LISTPACKS:
+        streamLoadInit(load);
+        break;
     default:
         retval = SWAP_ERR_RDB_LOAD_UNSUPPORTED;
         break;
@@ -888,6 +1561,13 @@ int ctripRdbLoadObject(int rdbtype, rio *rdb, redisDb *db, sds key,
     } while (!error && cont);
 
     if (!error) error = rdbKeyLoadEnd(load,rdb);
+
+    /* Loaded keys are all cold, index expire for scan expire. */
+    if (!error && load->expire != -1) {
+        rawkey = rocksEncodeExpireKey(db->id,load->expire,key);
+        ctripRdbLoadCtxFeed(server.rdb_load_ctx,EXPIRE_CF,rawkey,sdsempty());
+        load->nfeeds++;
+    }
     return error;
 }
 
@@ -29,8 +29,71 @@
 #include "ctrip_swap.h"
 
 /* ----------------------------- repl swap ------------------------------ */
+/* Replicated commands are dispatched to repl worker clients and swapped in
+ * parallel. Command is applied when its swap finished and key locks (which
+ * are granted in dispatch order) acquired, so commands on the same key are
+ * still applied in dispatch order while commands on independent keys might
+ * be applied before preceding ones (if swap-repl-apply-out-of-order enabled)
+ * instead of waiting for a slow cold key swap.
+ *
+ * reploff (and repl stream propagated to sub-replicas and backlog) only
+ * advances to the watermark: offset of the last command that all commands
+ * before it have been applied. If master link lost, commands applied ahead
+ * of watermark are recorded by their offset, so that they will be skipped
+ * (but still propagated) when received again after psync. */
+
+/* Repl worker clients are created on demand, untill repl_workers reached. */
+static listNode *replWorkerClientsGetFree(void) {
+    listNode *ln = listFirst(server.repl_worker_clients_free);
+
+    if (ln == NULL && (int)listLength(server.repl_worker_clients_used) <
+            server.repl_workers) {
+        client *wc = createClient(NULL);
+        wc->client_hold_mode = CLIENT_HOLD_MODE_REPL;
+        listAddNodeTail(server.repl_worker_clients_free, wc);
+        ln = listLast(server.repl_worker_clients_free);
+    }
+
+    return ln;
+}
+
+static void replWorkerClientFree(client *wc) {
+    /* flags copied from master client, clear so that worker client won't
+     * be cached as master. */
+    wc->flags = 0;
+    wc->repl_client = NULL;
+    freeClient(wc);
+}
+
+static void replWorkerClientRelease(client *wc) {
+    wc->CLIENT_REPL_CMD_DISCARDED = 0;
+    wc->CLIENT_REPL_CMD_APPLIED = 0;
+    wc->CLIENT_REPL_CMD_BARRIER = 0;
+
+    if ((int)(listLength(server.repl_worker_clients_free) +
+            listLength(server.repl_worker_clients_used)) >= server.repl_workers) {
+        replWorkerClientFree(wc);
+    } else {
+        listAddNodeTail(server.repl_worker_clients_free, wc);
+    }
+}
+
+/* Free idle worker clients if repl_workers decreased, busy ones are freed
+ * when they finish. */
+void replWorkerClientsTrim(void) {
+    listNode *ln;
+
+    while ((int)(listLength(server.repl_worker_clients_free) +
+                listLength(server.repl_worker_clients_used)) > server.repl_workers &&
+            (ln = listFirst(server.repl_worker_clients_free))) {
+        client *wc = listNodeValue(ln);
+        listDelNode(server.repl_worker_clients_free, ln);
+        replWorkerClientFree(wc);
+    }
+}
+
 int replClientDiscardDispatchedCommands(client *c) {
-    int discarded = 0, scanned = 0;
+    int discarded = 0, applied = 0, scanned = 0;
     listIter li;
     listNode *ln;
 
@@ -41,21 +104,84 @@ int replClientDiscardDispatchedCommands(client *c) {
         client *wc = listNodeValue(ln);
         if (wc->repl_client == c) {
             wc->CLIENT_REPL_CMD_DISCARDED = 1;
-            discarded++;
-            serverLog(LL_NOTICE, "discarded: cmd_reploff(%lld)", wc->cmd_reploff);
+            if (wc->CLIENT_REPL_CMD_APPLIED) {
+                /* Already applied, skip when received again after psync. */
+                if (c->repl_applied_ahead == NULL)
+                    c->repl_applied_ahead = intsetNew();
+                c->repl_applied_ahead = intsetAdd(c->repl_applied_ahead,
+                        wc->cmd_reploff,NULL);
+                applied++;
+                serverLog(LL_NOTICE, "applied ahead: cmd_reploff(%lld)", wc->cmd_reploff);
+            } else {
+                discarded++;
+                serverLog(LL_NOTICE, "discarded: cmd_reploff(%lld)", wc->cmd_reploff);
+            }
         }
         scanned++;
     }
 
-    if (discarded) {
+    if (discarded || applied) {
         serverLog(LL_NOTICE,
-            "discard (%d/%d) dispatched but not executed commands for repl client(reploff:%lld, read_reploff:%lld)",
-            discarded, scanned, c->reploff, c->read_reploff);
+            "discard (%d/%d) dispatched but not executed commands, %d applied ahead, for repl client(reploff:%lld, read_reploff:%lld)",
+            discarded, scanned, applied, c->reploff, c->read_reploff);
     }
 
     return discarded;
 }
 
+/* Returns number of commands applied ahead of reploff before master link
+ * lost, those commands are not safe to skip if master changed. */
+int replClientAppliedAheadCount(client *c) {
+    return c->repl_applied_ahead ? (int)intsetLen(c->repl_applied_ahead) : 0;
+}
+
+/* Finish all dispatched commands of repl client before it's freed for
+ * promotion (REPLICAOF NO ONE): commands applied ahead of reploff can't be
+ * undone, so preceding commands are applied too and reploff advanced past
+ * them (propagated to sub-replicas and backlog as usual), otherwise promoted
+ * master ends up in a state old master never had, and sub-replicas psync
+ * from reploff never get commands applied ahead. */
+void replClientFinishDispatchedCommands(client *c) {
+    client *current_client = server.current_client;
+
+    if (c == NULL || c->keyrequests_count == 0) return;
+
+    serverLog(LL_NOTICE,
+        "finishing %d dispatched commands (%d applied ahead) for repl client(reploff:%lld, read_reploff:%lld)",
+        c->keyrequests_count, server.repl_apply_ahead_inflight,
+        c->reploff, c->read_reploff);
+
+    /* Swap finished callback applies & retires dispatched commands. */
+    asyncCompleteQueueDrain(-1);
+    server.current_client = current_client;
+
+    serverLog(LL_NOTICE,
+        "finished dispatched commands for repl client(reploff:%lld, read_reploff:%lld, dispatched:%d)",
+        c->reploff, c->read_reploff, c->keyrequests_count);
+}
+
+static void replClientDiscardAppliedAhead(client *c) {
+    if (c->repl_applied_ahead) {
+        zfree(c->repl_applied_ahead);
+        c->repl_applied_ahead = NULL;
+    }
+}
+
+/* Returns 1 if command at cmd_reploff have been applied before master link
+ * lost (and forget it). */
+static int replClientAppliedAhead(client *c, long long cmd_reploff) {
+    int success = 0;
+    if (c->repl_applied_ahead == NULL) return 0;
+    c->repl_applied_ahead = intsetRemove(c->repl_applied_ahead,cmd_reploff,
+            &success);
+    if (intsetLen(c->repl_applied_ahead) == 0 ||
+            intsetMax(c->repl_applied_ahead) <= cmd_reploff) {
+        /* Offsets passed will not be received again. */
+        replClientDiscardAppliedAhead(c);
+    }
+    return success;
+}
+
 void replClientDiscardSwappingState(client *c) {
     listNode *ln;
 
@@ -129,90 +255,169 @@ static void replCommandDispatch(client *wc, client *c) {
     c->keyrequests_count++;
 }
 
-static void processFinishedReplCommands() {
-    listNode *ln;
-    client *wc, *c;
+/* Commands without key requests (PING, PUBLISH, SCRIPT, ...) and scripts
+ * (which might access undeclared keys) are not ordered by key locks, they
+ * are applied in dispatch order and block applying of later commands. */
+static int replWorkerClientIsBarrier(client *wc, int keyrequests) {
+    if (keyrequests == 0) return 1;
+
+    if (wc->flags & CLIENT_MULTI) {
+        for (int i = 0; i < wc->mstate.count; i++) {
+            multiCmd *mc = wc->mstate.commands+i;
+            if (mc->swap_cmd == NULL ||
+                    mc->cmd->proc == evalCommand ||
+                    mc->cmd->proc == evalShaCommand)
+                return 1;
+        }
+        return 0;
+    }
+
+    return wc->cmd->proc == evalCommand || wc->cmd->proc == evalShaCommand;
+}
+
+static void replWorkerClientExecute(client *wc) {
+    client *c = wc->repl_client;
     struct redisCommand *backup_cmd;
 
-    serverLog(LL_DEBUG, "> processFinishedReplCommands");
+    wc->flags &= ~CLIENT_SWAPPING;
 
-    while ((ln = listFirst(server.repl_worker_clients_used))) {
-        wc = listNodeValue(ln);
-        if (wc->CLIENT_REPL_SWAPPING) break;
-        c = wc->repl_client;
+    backup_cmd = c->cmd;
+    c->cmd = wc->cmd;
+    server.current_client = c;
 
-        wc->flags &= ~CLIENT_SWAPPING;
-        c->keyrequests_count--;
-        listDelNode(server.repl_worker_clients_used, ln);
-        listAddNodeTail(server.repl_worker_clients_free, wc);
+    if (wc->swap_errcode) {
+        rejectCommandFormat(c,"Swap failed (code=%d)",wc->swap_errcode);
+        wc->swap_errcode = 0;
+    } else {
+        call(wc, CMD_CALL_FULL);
 
-        /* Discard dispatched but not executed commands like we never reveived, if
-         * - repl client is closing: client close defered untill all swapping
-         *   dispatched cmds finished, those cmds will be discarded.
-         * - repl client is cached: client cached but read_reploff will shirnk
-         *   back and dispatched cmd will be discared. */
-        if (wc->CLIENT_REPL_CMD_DISCARDED) {
+        /* post call */
+        c->woff = server.master_repl_offset;
+        if (listLength(server.ready_keys))
+            handleClientsBlockedOnKeys();
+    }
+
+    c->cmd = backup_cmd;
+
+    commandProcessed(wc);
+
+    serverAssert(wc->client_hold_mode == CLIENT_HOLD_MODE_REPL);
+}
+
+/* Apply command before preceding ones, locks released so that following
+ * commands on the same keys could proceed. */
+static void replWorkerClientApplyAhead(client *wc) {
+    replWorkerClientExecute(wc);
+    wc->CLIENT_REPL_CMD_APPLIED = 1;
+    server.repl_apply_ahead_inflight++;
+    server.stat_swap_repl_apply_ahead_count++;
+    clientReleaseLocks(wc,NULL/*ctx unused*/);
+}
+
+/* Retire command at the head of dispatched commands: apply if not applied
+ * yet, then advance reploff (the watermark) past it. */
+static void replWorkerClientRetire(listNode *ln) {
+    client *wc = listNodeValue(ln), *c = wc->repl_client;
+    int applied = wc->CLIENT_REPL_CMD_APPLIED;
+
+    wc->flags &= ~CLIENT_SWAPPING;
+    c->keyrequests_count--;
+    listDelNode(server.repl_worker_clients_used, ln);
+    if (applied) server.repl_apply_ahead_inflight--;
+
+    /* Discard dispatched but not executed commands like we never reveived, if
+     * - repl client is closing: client close defered untill all swapping
+     *   dispatched cmds finished, those cmds will be discarded.
+     * - repl client is cached: client cached but read_reploff will shirnk
+     *   back and dispatched cmd will be discared.
+     * Commands already applied are recorded when discarded. */
+    if (wc->CLIENT_REPL_CMD_DISCARDED) {
+        if (!applied) {
             commandProcessed(wc);
             serverAssert(wc->client_hold_mode == CLIENT_HOLD_MODE_REPL);
             clientReleaseLocks(wc,NULL/*ctx unused*/);
-            wc->CLIENT_REPL_CMD_DISCARDED = 0;
-            continue;
-        } else {
-            serverAssert(c->flags&CLIENT_MASTER);
         }
+        replWorkerClientRelease(wc);
+        return;
+    } else {
+        serverAssert(c->flags&CLIENT_MASTER);
+    }
 
-        backup_cmd = c->cmd;
-        c->cmd = wc->cmd;
-        server.current_client = c;
-
-        if (wc->swap_errcode) {
-            rejectCommandFormat(c,"Swap failed (code=%d)",wc->swap_errcode);
-            wc->swap_errcode = 0;
-        } else {
-            call(wc, CMD_CALL_FULL);
+    if (!applied) replWorkerClientExecute(wc);
+
+    long long prev_offset = c->reploff;
+    /* update reploff */
+    if (c->flags&CLIENT_MASTER) {
+        /* transaction commands wont dispatch to worker client untill
+         * exec (queued by repl client), so worker client wont have
+         * CLIENT_MULTI flag after call(). */
+        serverAssert(!(wc->flags & CLIENT_MULTI));
+        /* Update the applied replication offset of our master. */
+        c->reploff = wc->cmd_reploff;
+    }
 
-            /* post call */
-            c->woff = server.master_repl_offset;
-            if (listLength(server.ready_keys))
-                handleClientsBlockedOnKeys();
+    /* If the client is a master we need to compute the difference
+     * between the applied offset before and after processing the buffer,
+     * to understand how much of the replication stream was actually
+     * applied to the master state: this quantity, and its corresponding
+     * part of the replication stream, will be propagated to the
+     * sub-replicas and to the replication backlog. */
+    if ((c->flags&CLIENT_MASTER)) {
+        size_t applied_len = c->reploff - prev_offset;
+        if (applied_len) {
+            if(!server.repl_slave_repl_all){
+                replicationFeedSlavesFromMasterStream(server.slaves,
+                        c->pending_querybuf, applied_len);
+            }
+            sdsrange(c->pending_querybuf,applied_len,-1);
         }
+    }
 
-        c->cmd = backup_cmd;
+    if (!applied) clientReleaseLocks(wc,NULL/*ctx unused*/);
+    replWorkerClientRelease(wc);
+}
 
-        commandProcessed(wc);
+static void applyFinishedReplCommands(void) {
+    listIter li;
+    listNode *ln;
+    int head = 1; /* all preceding commands retired. */
 
-        serverAssert(wc->client_hold_mode == CLIENT_HOLD_MODE_REPL);
+    listRewind(server.repl_worker_clients_used,&li);
+    while ((ln = listNext(&li))) {
+        client *wc = listNodeValue(ln);
 
-        long long prev_offset = c->reploff;
-        /* update reploff */
-        if (c->flags&CLIENT_MASTER) {
-            /* transaction commands wont dispatch to worker client untill
-             * exec (queued by repl client), so worker client wont have
-             * CLIENT_MULTI flag after call(). */
-            serverAssert(!(wc->flags & CLIENT_MULTI));
-            /* Update the applied replication offset of our master. */
-            c->reploff = wc->cmd_reploff;
+        if (wc->CLIENT_REPL_SWAPPING) {
+            if (!server.swap_repl_apply_out_of_order ||
+                    wc->CLIENT_REPL_CMD_BARRIER) break;
+            head = 0;
+        } else if (head) {
+            replWorkerClientRetire(ln);
+        } else if (wc->CLIENT_REPL_CMD_BARRIER) {
+            break;
+        } else if (!wc->CLIENT_REPL_CMD_APPLIED &&
+                !wc->CLIENT_REPL_CMD_DISCARDED) {
+            replWorkerClientApplyAhead(wc);
         }
+    }
+}
+
+static void processFinishedReplCommands() {
+    static int processing, again;
 
-		/* If the client is a master we need to compute the difference
-		 * between the applied offset before and after processing the buffer,
-		 * to understand how much of the replication stream was actually
-		 * applied to the master state: this quantity, and its corresponding
-		 * part of the replication stream, will be propagated to the
-		 * sub-replicas and to the replication backlog. */
-		if ((c->flags&CLIENT_MASTER)) {
-			size_t applied = c->reploff - prev_offset;
-			if (applied) {
-				if(!server.repl_slave_repl_all){
-					replicationFeedSlavesFromMasterStream(server.slaves,
-							c->pending_querybuf, applied);
-				}
-				sdsrange(c->pending_querybuf,applied,-1);
-			}
-		}
-
-        clientReleaseLocks(wc,NULL/*ctx unused*/);
+    /* Applying commands release locks, which might finish swap of following
+     * commands and get here again, process them in the outer loop. */
+    if (processing) {
+        again = 1;
+        return;
     }
+
+    serverLog(LL_DEBUG, "> processFinishedReplCommands");
+    processing = 1;
+    do {
+        again = 0;
+        applyFinishedReplCommands();
+    } while (again);
+    processing = 0;
     serverLog(LL_DEBUG, "< processFinishedReplCommands");
 }
 
@@ -243,7 +448,8 @@ void replWorkerClientKeyRequestFinished(client *wc, swapCtx *ctx) {
      * into querybuf, read event will not trigger if we do not parse and
      * process again.  */
     if (!listFirst(server.repl_swapping_clients) ||
-            !listFirst(server.repl_worker_clients_free)) {
+            (!listFirst(server.repl_worker_clients_free) &&
+             (int)listLength(server.repl_worker_clients_used) >= server.repl_workers)) {
         serverLog(LL_DEBUG, "< replWorkerClientSwapFinished");
         return;
     }
@@ -299,15 +505,16 @@ int submitReplWorkerClientRequest(client *wc) {
  * can't catch up with master.
  * In order to speed up replication stream processing, slave.master client
  * dispatches command to multiple worker client and execute commands when
- * rocks IO finishes. Note that replicated commands swap in-parallel but
- * processed in received order. */
+ * rocks IO finishes. Note that replicated commands swap in-parallel and
+ * processed in received order, unless they don't conflict on keys. */
 int submitReplClientRequests(client *c) {
     client *wc;
     listNode *ln;
+    int keyrequests;
 
     c->cmd_reploff = c->read_reploff - sdslen(c->querybuf) + c->qb_pos;
     serverAssert(!(c->flags & CLIENT_SWAPPING));
-    if (!(ln = listFirst(server.repl_worker_clients_free))) {
+    if (!(ln = replWorkerClientsGetFree())) {
         /* return swapping if there are no worker to dispatch, so command
          * processing loop would break out.
          * Note that peer client might register no rocks callback but repl
@@ -333,19 +540,33 @@ int submitReplClientRequests(client *c) {
         /* either vanilla command or transaction are stored in client state,
          * client is ready to dispatch now. */
         replCommandDispatch(wc, c);
+        wc->repl_dispatch_time = mstime();
+        listDelNode(server.repl_worker_clients_free, ln);
 
-        /* swap data for replicated commands, note that command will be
-         * processed later in processFinishedReplCommands untill all preceeding
-         * commands finished. */
-        submitReplWorkerClientRequest(wc);
-        wc->CLIENT_REPL_SWAPPING = wc->keyrequests_count;
+        if (replClientAppliedAhead(c,wc->cmd_reploff)) {
+            /* Applied before master link lost, skip but still advance
+             * reploff and propagate when preceding commands applied. */
+            if (wc->flags & CLIENT_MULTI) discardTransaction(wc);
+            commandProcessed(wc);
+            wc->CLIENT_REPL_SWAPPING = 0;
+            wc->CLIENT_REPL_CMD_APPLIED = 1;
+            server.repl_apply_ahead_inflight++;
+            server.stat_swap_repl_apply_ahead_skipped_count++;
+        } else {
+            /* swap data for replicated commands, note that command will be
+             * processed later in processFinishedReplCommands when key locks
+             * acquired and swap finished. */
+            keyrequests = submitReplWorkerClientRequest(wc);
+            wc->CLIENT_REPL_SWAPPING = wc->keyrequests_count;
+            wc->CLIENT_REPL_CMD_BARRIER = replWorkerClientIsBarrier(wc,keyrequests);
+        }
 
-        listDelNode(server.repl_worker_clients_free, ln);
         listAddNodeTail(server.repl_worker_clients_used, wc);
     }
 
-    /* process repl commands in received order (not swap finished order) so
-     * that slave is consistent with master. */
+    /* process repl commands in received order (not swap finished order),
+     * or out of order if they don't conflict, so that slave is consistent
+     * with master. */
     processFinishedReplCommands();
 
     /* return dispatched(-1) when repl dispatched command to workers, caller
@@ -354,10 +575,32 @@ int submitReplClientRequests(client *c) {
 }
 
 sds genSwapReplInfoString(sds info) {
+    long long lag_bytes = 0, lag_ms = 0;
+    listNode *ln;
+
+    if (server.master)
+        lag_bytes = server.master->read_reploff - server.master->reploff;
+    if ((ln = listFirst(server.repl_worker_clients_used))) {
+        client *wc = listNodeValue(ln);
+        lag_ms = mstime() - wc->repl_dispatch_time;
+    }
+
     info = sdscatprintf(info,
-            "swap_repl_workers:free=%lu,used=%lu,swapping=%lu\r\n",
+            "swap_repl_workers:free=%lu,used=%lu,swapping=%lu,max=%d\r\n"
+            "swap_repl_apply_inflight:%lu\r\n"
+            "swap_repl_apply_ahead:%d\r\n"
+            "swap_repl_apply_ahead_count:%lld\r\n"
+            "swap_repl_apply_ahead_skipped_count:%lld\r\n"
+            "swap_repl_apply_lag_bytes:%lld\r\n"
+            "swap_repl_apply_lag_ms:%lld\r\n",
             listLength(server.repl_worker_clients_free),
             listLength(server.repl_worker_clients_used),
-            listLength(server.repl_swapping_clients));
+            listLength(server.repl_swapping_clients),
+            server.repl_workers,
+            listLength(server.repl_worker_clients_used),
+            server.repl_apply_ahead_inflight,
+            server.stat_swap_repl_apply_ahead_count,
+            server.stat_swap_repl_apply_ahead_skipped_count,
+            lag_bytes,lag_ms);
     return info;
 }
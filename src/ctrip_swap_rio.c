@@ -75,6 +75,7 @@ void RIOInitIterate(RIO *rio, int cf, uint32_t flags, sds start, sds end, size_t
     rio->iterate.rawkeys = NULL;
     rio->iterate.rawvals = NULL;
     rio->iterate.nextseek = NULL;
+    rio->iterate.count = 0;
     rio->err = NULL;
     rio->errcode = 0;
     rio->oom_check = 0;
@@ -127,35 +128,140 @@ void RIODeinit(RIO *rio) {
     }
 }
 
+/* Perf context is thread local, each thread doing rio owns one to count
+ * block cache hit/miss, which then get attributed to rio column family
+ * (multiget attributes to column family of each cf group). */
+static __thread rocksdb_perfcontext_t *rio_perf_context;
+
+static inline void RIOPerfContextBegin(void) {
+    if (rio_perf_context == NULL) {
+        rocksdb_set_perf_level(rocksdb_enable_count);
+        rio_perf_context = rocksdb_perfcontext_create();
+    }
+    rocksdb_perfcontext_reset(rio_perf_context);
+}
+
+static inline void RIOPerfContextEnd(int cf) {
+    rocksdbBlockCacheStat *stat = server.ror_stats->block_cache_stats+cf;
+    uint64_t hit = rocksdb_perfcontext_metric(rio_perf_context,
+            rocksdb_block_cache_hit_count);
+    uint64_t miss = rocksdb_perfcontext_metric(rio_perf_context,
+            rocksdb_block_read_count);
+    if (hit) atomicIncr(stat->hit,hit);
+    if (miss) atomicIncr(stat->miss,miss);
+}
+
+/* Multiget values as pinnable slices: values stay pinned in block cache
+ * (or memtable) until copied into rawvals, instead of being copied into
+ * malloc-ed buffers by rocksdb first. Batched multiget accepts only one
+ * cf per call, so keys are grouped by cf if needed, block cache hit/miss
+ * of each call are counted to its own cf. */
+static void RIOMultiGetPinned(size_t count, int *cfs, const char **keys_list,
+        size_t *keys_list_sizes, rocksdb_pinnableslice_t **values_list,
+        char **errs) {
+    size_t i, n;
+    int cf, mixed = 0;
+
+    for (i = 1; i < count; i++) {
+        if (cfs[i] != cfs[0]) {
+            mixed = 1;
+            break;
+        }
+    }
+
+    if (!mixed) {
+        if (count == 0) return;
+        RIOPerfContextBegin();
+        rocksdb_batched_multi_get_cf(server.rocks->db,server.rocks->ropts,
+                swapGetCF(cfs[0]),count,keys_list,keys_list_sizes,
+                values_list,errs,0);
+        RIOPerfContextEnd(cfs[0]);
+        return;
+    }
+
+    size_t *cf_idx = zmalloc(count*sizeof(size_t));
+    const char **cf_keys = zmalloc(count*sizeof(char*));
+    size_t *cf_keys_sizes = zmalloc(count*sizeof(size_t));
+    rocksdb_pinnableslice_t **cf_values = zmalloc(count*sizeof(rocksdb_pinnableslice_t*));
+    char **cf_errs = zmalloc(count*sizeof(char*));
+
+    for (cf = 0; cf < CF_COUNT; cf++) {
+        for (i = 0, n = 0; i < count; i++) {
+            if (cfs[i] != cf) continue;
+            cf_idx[n] = i;
+            cf_keys[n] = keys_list[i];
+            cf_keys_sizes[n] = keys_list_sizes[i];
+            n++;
+        }
+        if (n == 0) continue;
+        RIOPerfContextBegin();
+        rocksdb_batched_multi_get_cf(server.rocks->db,server.rocks->ropts,
+                swapGetCF(cf),n,cf_keys,cf_keys_sizes,cf_values,cf_errs,0);
+        RIOPerfContextEnd(cf);
+        for (i = 0; i < n; i++) {
+            values_list[cf_idx[i]] = cf_values[i];
+            errs[cf_idx[i]] = cf_errs[i];
+        }
+    }
+
+    zfree(cf_idx);
+    zfree(cf_keys);
+    zfree(cf_keys_sizes);
+    zfree(cf_values);
+    zfree(cf_errs);
+}
+
+static inline size_t RIOPinnedValueSize(rocksdb_pinnableslice_t *pinned) {
+    size_t vlen = 0;
+    if (pinned) rocksdb_pinnableslice_value(pinned,&vlen);
+    return vlen;
+}
+
+/* Unpin value: the only place pinned values get released. */
+static inline void RIOPinnedValueRelease(rocksdb_pinnableslice_t *pinned) {
+    if (pinned) rocksdb_pinnableslice_destroy(pinned);
+}
+
+/* Copy pinned value into rawval and release it. Note that this is a copy
+ * (the only one on get path): decoders consume rawvals as sds, which can't
+ * wrap a pinned buffer. */
+static inline sds RIOPinnedValueCopy(int cf, rocksdb_pinnableslice_t *pinned) {
+    size_t vlen;
+    const char *val = rocksdb_pinnableslice_value(pinned,&vlen);
+    rocksdbPinnedGetStat *stat = server.ror_stats->pinned_get_stats+cf;
+    sds rawval = sdsnewlen(val,vlen);
+    RIOPinnedValueRelease(pinned);
+    atomicIncr(stat->count,1);
+    atomicIncr(stat->bytes,vlen);
+    return rawval;
+}
+
 void RIODoGet(RIO *rio) {
     int i;
-    rocksdb_column_family_handle_t **cfs_list;
-    char **keys_list = zmalloc(rio->get.numkeys*sizeof(char*));
-    char **values_list = zmalloc(rio->get.numkeys*sizeof(char*));
+    const char **keys_list = zmalloc(rio->get.numkeys*sizeof(char*));
+    rocksdb_pinnableslice_t **values_list = zmalloc(rio->get.numkeys*sizeof(rocksdb_pinnableslice_t*));
     size_t *keys_list_sizes = zmalloc(rio->get.numkeys*sizeof(size_t));
-    size_t *values_list_sizes = zmalloc(rio->get.numkeys*sizeof(size_t));
     char **errs = zmalloc(rio->get.numkeys*sizeof(char*));
-    cfs_list = zmalloc(rio->get.numkeys*sizeof(rocksdb_column_family_handle_t*));
 
     for (i = 0; i < rio->get.numkeys; i++) {
-        cfs_list[i] = swapGetCF(rio->get.cfs[i]);
         keys_list[i] = rio->get.rawkeys[i];
         keys_list_sizes[i] = sdslen(rio->get.rawkeys[i]);
     }
 
-    rocksdb_multi_get_cf(server.rocks->db, server.rocks->ropts,
-            (const rocksdb_column_family_handle_t *const *)cfs_list,
-            rio->get.numkeys,
-            (const char**)keys_list, (const size_t*)keys_list_sizes,
-            values_list, values_list_sizes, errs);
+    RIOMultiGetPinned(rio->get.numkeys,rio->get.cfs,keys_list,
+            keys_list_sizes,values_list,errs);
 
     if (rio->oom_check) {
         size_t payload_size = 0;
-        for (i = 0; i < rio->get.numkeys; i++) payload_size += values_list_sizes[i];
+        for (i = 0; i < rio->get.numkeys; i++)
+            payload_size += RIOPinnedValueSize(values_list[i]);
         if (rioMayOOM(payload_size)) {
             RIOSetError(rio,SWAP_ERR_RIO_OOM,sdsnew("rio get oom"));
             serverLog(LL_WARNING,"[rocks] do rocksdb get failed: may OOM");
-            for (i = 0; i < rio->get.numkeys; i++) zlibc_free(values_list[i]);
+            for (i = 0; i < rio->get.numkeys; i++) {
+                RIOPinnedValueRelease(values_list[i]);
+                if (errs[i]) zlibc_free(errs[i]);
+            }
             goto end;
         }
     }
@@ -166,9 +272,7 @@ void RIODoGet(RIO *rio) {
             rio->get.rawvals[i] = NULL;
             rio->get.notfound++;
         } else {
-            rio->get.rawvals[i] = sdsnewlen(values_list[i],
-                    values_list_sizes[i]);
-            zlibc_free(values_list[i]);
+            rio->get.rawvals[i] = RIOPinnedValueCopy(rio->get.cfs[i],values_list[i]);
         }
         if (errs[i]) {
             if (!RIOGetError(rio)) {
@@ -181,11 +285,9 @@ void RIODoGet(RIO *rio) {
     }
 
 end:
-    zfree(cfs_list);
     zfree(keys_list);
     zfree(values_list);
     zfree(keys_list_sizes);
-    zfree(values_list_sizes);
     zfree(errs);
 }
 
@@ -226,14 +328,85 @@ static void RIODoDel(RIO *rio) {
     rocksdb_writebatch_destroy(wb);
 }
 
+/* Smallest key greater than any key prefixed with prefix, NULL if none. */
+static sds RIOPrefixSuccessor(const char *prefix, size_t len) {
+    sds successor = sdsnewlen(prefix,len);
+    while (len > 0) {
+        if ((unsigned char)successor[len-1] != 0xff) {
+            successor[len-1]++;
+            sdssetlen(successor,len);
+            return successor;
+        }
+        len--;
+    }
+    sdsfree(successor);
+    return NULL;
+}
+
+/* Iteration inside one object version (start & end share data key prefix)
+ * could be served with prefix bloom, returns prefix length or 0. */
+static size_t RIOIterateObjectPrefixLen(RIO *rio) {
+    sds start = rio->iterate.start, end = rio->iterate.end;
+    size_t prefix_len;
+
+    if (!server.rocksdb_data_prefix_bloom || (rio->iterate.cf != DATA_CF && rio->iterate.cf != SCORE_CF) ||
+            start == NULL || end == NULL)
+        return 0;
+    prefix_len = rocksDecodeDataKeyPrefixLen(start,sdslen(start));
+    if (prefix_len == 0 ||
+            rocksDecodeDataKeyPrefixLen(end,sdslen(end)) != prefix_len ||
+            memcmp(start,end,prefix_len))
+        return 0;
+    return prefix_len;
+}
+
+/* Position iter at the first meta key (current one included) whose user key
+ * is prefixed by user key of metakey end, returns 0 if found or -1 if
+ * iterated out of end's db. Meta keys are ordered by dbid|keylen|key, keys
+ * sharing prefix are contiguous only among keys of the same length, so we
+ * seek to prefix inside current keylen, or skip to next keylen if passed. */
+static int RIOIterateSeekMetaPrefix(rocksdb_iterator_t *iter,
+        const char *end, size_t end_len) {
+    int dbid, prefix_dbid;
+    const char *rawkey, *key, *prefix;
+    size_t klen, keylen, prefix_len, hdrlen;
+    sds target;
+
+    if (rocksDecodeMetaKey(end,end_len,&prefix_dbid,&prefix,&prefix_len))
+        return -1;
+
+    while (rocksdb_iter_valid(iter)) {
+        rawkey = rocksdb_iter_key(iter, &klen);
+        if (rocksDecodeMetaKey(rawkey,klen,&dbid,&key,&keylen) ||
+                dbid != prefix_dbid)
+            return -1;
+        if (keylen >= prefix_len && !memcmp(key,prefix,prefix_len))
+            return 0;
+
+        hdrlen = key - rawkey;
+        if (keylen >= prefix_len && memcmp(key,prefix,prefix_len) < 0) {
+            target = sdsnewlen(rawkey,hdrlen);
+            target = sdscatlen(target,prefix,prefix_len);
+        } else if ((target = RIOPrefixSuccessor(rawkey,hdrlen)) == NULL) {
+            return -1;
+        }
+        rocksdb_iter_seek(iter,target,sdslen(target));
+        sdsfree(target);
+    }
+
+    return -1;
+}
+
 static void RIODoIterate(RIO *rio) {
-    size_t numkeys = 0;
+    size_t numkeys = 0, count = 0;
     char *err = NULL;
     rocksdb_iterator_t *iter = NULL;
     sds start = rio->iterate.start;
     sds end = rio->iterate.end;
     size_t limit = rio->iterate.limit;
     rocksdb_readoptions_t *ropts = NULL;
+    sds lower_bound = NULL, upper_bound = NULL;
+    size_t prefix_len;
 
     int reverse = rio->iterate.flags & ROCKS_ITERATE_REVERSE;
     int low_bound_exclude = rio->iterate.flags & ROCKS_ITERATE_LOW_BOUND_EXCLUDE;
@@ -241,6 +414,8 @@ static void RIODoIterate(RIO *rio) {
     int next_seek = rio->iterate.flags & ROCKS_ITERATE_CONTINUOUSLY_SEEK;
     int disable_cache = rio->iterate.flags & ROCKS_ITERATE_DISABLE_CACHE;
     int prefix_match = rio->iterate.flags & ROCKS_ITERATE_PREFIX_MATCH;
+    int count_only = rio->iterate.flags & ROCKS_ITERATE_COUNT_ONLY;
+    int meta_prefix = rio->iterate.flags & ROCKS_ITERATE_META_PREFIX;
 
     size_t numalloc = ROCKS_ITERATE_NO_LIMIT == limit ? RIO_ITERATE_NUMKEYS_ALLOC_INIT : limit;
     numalloc = numalloc > RIO_ITERATE_NUMKEYS_ALLOC_LINER ? RIO_ITERATE_NUMKEYS_ALLOC_LINER : numalloc;
@@ -254,10 +429,25 @@ static void RIODoIterate(RIO *rio) {
 
     if (start == NULL && end == NULL) goto end;
 
-    if (disable_cache) {
+    prefix_len = RIOIterateObjectPrefixLen(rio);
+    if (disable_cache || prefix_len) {
         ropts = rocksdb_readoptions_create();
         rocksdb_readoptions_set_verify_checksums(ropts, 0);
-        rocksdb_readoptions_set_fill_cache(ropts, 0);
+        rocksdb_readoptions_set_fill_cache(ropts, !disable_cache);
+    }
+    if (prefix_len) {
+        /* bounds must outlive iterator. */
+        lower_bound = sdsnewlen(start,prefix_len);
+        upper_bound = RIOPrefixSuccessor(start,prefix_len);
+        rocksdb_readoptions_set_prefix_same_as_start(ropts, 1);
+        rocksdb_readoptions_set_iterate_lower_bound(ropts, lower_bound,
+                sdslen(lower_bound));
+        if (upper_bound) {
+            rocksdb_readoptions_set_iterate_upper_bound(ropts, upper_bound,
+                    sdslen(upper_bound));
+        }
+    } else if (ropts) {
+        rocksdb_readoptions_set_total_order_seek(ropts, 1);
     }
     iter = rocksdb_create_iterator_cf(server.rocks->db,NULL!=ropts?ropts:server.rocks->ropts,swapGetCF(rio->iterate.cf));
 
@@ -294,7 +484,8 @@ static void RIODoIterate(RIO *rio) {
         }
     }
 
-    sds bound = reverse ? start : end;
+    /* end is not a bound but the prefix in meta prefix mode. */
+    sds bound = meta_prefix ? NULL : (reverse ? start : end);
     size_t bound_len = reverse ? start_len : end_len;
     int bound_exclude = reverse ? low_bound_exclude : high_bound_exclude;
     while (rocksdb_iter_valid(iter) && (limit == ROCKS_ITERATE_NO_LIMIT || numkeys < limit)) {
@@ -304,6 +495,9 @@ static void RIODoIterate(RIO *rio) {
             goto end;
         }
 
+        if (meta_prefix && RIOIterateSeekMetaPrefix(iter,end,end_len))
+            break;
+
         rawkey = rocksdb_iter_key(iter, &klen);
         if (bound) {
             int cmp_result = memcmp(rawkey, bound, MIN(bound_len, klen));
@@ -314,6 +508,13 @@ static void RIODoIterate(RIO *rio) {
             if ((reverse && cmp_result < 0) || (!reverse && cmp_result > 0)) break;
         }
 
+        if (count_only) {
+            count++;
+            if (reverse) rocksdb_iter_prev(iter);
+            else rocksdb_iter_next(iter);
+            continue;
+        }
+
         rawval = rocksdb_iter_value(iter, &vlen);
         numkeys++;
 
@@ -343,18 +544,22 @@ static void RIODoIterate(RIO *rio) {
     }
 
     /* save next seek */
-    if (next_seek && rocksdb_iter_valid(iter)) {
+    if (next_seek && rocksdb_iter_valid(iter) && (!meta_prefix ||
+                !RIOIterateSeekMetaPrefix(iter,end,end_len))) {
         rawkey = rocksdb_iter_key(iter, &klen);
         rio->iterate.nextseek = sdsnewlen(rawkey, klen);
     }
 
     end:
     rio->iterate.numkeys = numkeys;
+    rio->iterate.count = count;
     rio->iterate.rawkeys = rawkeys;
     rio->iterate.rawvals = rawvals;
 
     if (iter) rocksdb_iter_destroy(iter);
     if (ropts) rocksdb_readoptions_destroy(ropts);
+    if (lower_bound) sdsfree(lower_bound);
+    if (upper_bound) sdsfree(upper_bound);
 }
 
 static sds RIODumpGeneric(RIO *rio, sds repr) {
@@ -444,6 +649,8 @@ void RIODo(RIO *rio) {
         }
     }
 
+    /* get counts block cache hit/miss by cf in RIOMultiGetPinned. */
+    if (rio->action != ROCKS_GET) RIOPerfContextBegin();
     switch (rio->action) {
     case ROCKS_GET:
         RIODoGet(rio);
@@ -460,6 +667,7 @@ void RIODo(RIO *rio) {
     default:
         serverPanic("[RIO] Unknown io action: %d", rio->action);
     }
+    if (rio->action != ROCKS_GET) RIOPerfContextEnd(RIOGetCF(rio));
 
 #ifdef ROCKS_DEBUG
     RIODump(rio);
@@ -568,31 +776,45 @@ void RIOBatchDoGet(RIOBatch *rios) {
         count += rios->rios[i].get.numkeys;
     }
 
-    rocksdb_column_family_handle_t **cfs_list;
-    char **keys_list = zmalloc(count*sizeof(char*));
-    char **values_list = zmalloc(count*sizeof(char*));
+    int *cfs_list = zmalloc(count*sizeof(int));
+    const char **keys_list = zmalloc(count*sizeof(char*));
+    rocksdb_pinnableslice_t **values_list = zmalloc(count*sizeof(rocksdb_pinnableslice_t*));
     size_t *keys_list_sizes = zmalloc(count*sizeof(size_t));
-    size_t *values_list_sizes = zmalloc(count*sizeof(size_t));
     char **errs = zmalloc(count*sizeof(char*));
-    cfs_list = zmalloc(count*sizeof(rocksdb_column_family_handle_t*));
+    size_t *pos_list = zmalloc(count*sizeof(size_t));
+    size_t cf_start[CF_COUNT+1] = {0}, cf_filled[CF_COUNT] = {0};
 
-    x = 0;
+    /* keys are grouped by cf and multiget cf by cf, so that block cache
+     * hit/miss of each multiget could be attributed to its own cf. pos_list
+     * maps keys in rio order to their position in cf order. */
     for (size_t i = 0; i < rios->count; i++) {
         rio = rios->rios+i;
         serverAssert(rio->action == rios->action);
+        for (int j = 0; j < rio->get.numkeys; j++)
+            cf_start[rio->get.cfs[j]+1]++;
+    }
+    for (int cf = 0; cf < CF_COUNT; cf++) cf_start[cf+1] += cf_start[cf];
+
+    x = 0;
+    for (size_t i = 0; i < rios->count; i++) {
+        rio = rios->rios+i;
         for (int j = 0; j < rio->get.numkeys; j++) {
-            cfs_list[x] = swapGetCF(rio->get.cfs[j]);
-            keys_list[x] = rio->get.rawkeys[j];
-            keys_list_sizes[x] = sdslen(rio->get.rawkeys[j]);
-            x++;
+            int cf = rio->get.cfs[j];
+            size_t pos = cf_start[cf] + cf_filled[cf]++;
+            cfs_list[pos] = cf;
+            keys_list[pos] = rio->get.rawkeys[j];
+            keys_list_sizes[pos] = sdslen(rio->get.rawkeys[j]);
+            pos_list[x++] = pos;
         }
     }
     serverAssert(x == count);
 
-    rocksdb_multi_get_cf(server.rocks->db, server.rocks->ropts,
-            (const rocksdb_column_family_handle_t *const *)cfs_list,count,
-            (const char**)keys_list, (const size_t*)keys_list_sizes,
-            values_list, values_list_sizes, errs);
+    for (int cf = 0; cf < CF_COUNT; cf++) {
+        size_t start = cf_start[cf], num = cf_start[cf+1] - start;
+        if (num == 0) continue;
+        RIOMultiGetPinned(num,cfs_list+start,keys_list+start,
+                keys_list_sizes+start,values_list+start,errs+start);
+    }
 
     x = 0;
     for (size_t i = 0; i < rios->count; i++) {
@@ -601,32 +823,35 @@ void RIOBatchDoGet(RIOBatch *rios) {
         if (rio->oom_check) {
             size_t payload_size = 0, tmpx = x;
             for (int j = 0; j < rio->get.numkeys; j++)
-                payload_size += values_list_sizes[tmpx++];
+                payload_size += RIOPinnedValueSize(values_list[pos_list[tmpx++]]);
             if (rioMayOOM(payload_size)) {
                 RIOSetError(rio,SWAP_ERR_RIO_OOM,sdsnew("rio batch get oom"));
                 serverLog(LL_WARNING,"[rocks] do rocksdb batch get failed: may OOM");
-                for (int j = 0; j < rio->get.numkeys; j++) zlibc_free(values_list[x++]);
+                for (int j = 0; j < rio->get.numkeys; j++, x++) {
+                    size_t pos = pos_list[x];
+                    RIOPinnedValueRelease(values_list[pos]);
+                    if (errs[pos]) zlibc_free(errs[pos]);
+                }
                 continue;
             }
         }
 
         rio->get.rawvals = zmalloc(rio->get.numkeys*sizeof(sds));
         for (int j = 0; j < rio->get.numkeys; j++) {
-            if (values_list[x] == NULL) {
+            size_t pos = pos_list[x];
+            if (values_list[pos] == NULL) {
                 rio->get.rawvals[j] = NULL;
                 rio->get.notfound++;
             } else {
-                rio->get.rawvals[j] = sdsnewlen(values_list[x],
-                        values_list_sizes[x]);
-                zlibc_free(values_list[x]);
+                rio->get.rawvals[j] = RIOPinnedValueCopy(cfs_list[pos],values_list[pos]);
             }
-            if (errs[x]) {
+            if (errs[pos]) {
                 if (!RIOGetError(rio)) {
-                    RIOSetError(rio,SWAP_ERR_RIO_GET_FAIL,sdsnew(errs[x]));
+                    RIOSetError(rio,SWAP_ERR_RIO_GET_FAIL,sdsnew(errs[pos]));
                     serverLog(LL_WARNING,"[rocks] do batch rocksdb get failed: %s",
                             rio->err);
                 }
-                zlibc_free(errs[x]);
+                zlibc_free(errs[pos]);
             }
             x++;
         }
@@ -637,8 +862,8 @@ void RIOBatchDoGet(RIOBatch *rios) {
     zfree(keys_list);
     zfree(values_list);
     zfree(keys_list_sizes);
-    zfree(values_list_sizes);
     zfree(errs);
+    zfree(pos_list);
 }
 
 static void RIOBatchSetError(RIOBatch *rios, int errcode, const char *err) {
@@ -752,6 +977,8 @@ void RIOBatchDo(RIOBatch *rios) {
         serverPanic("[RIOBatch] Unknown io action %d", rios->action);
         break;
     }
+    /* block cache hit/miss counted per cf by RIOBatchDoGet, writes don't
+     * read through block cache. */
 #ifdef ROCKS_DEBUG
     RIOBatchDump(rios);
 #endif
@@ -1013,6 +1240,45 @@ int swapRIOTest(int argc, char *argv[], int accurate) {
         sdsfree(hello), sdsfree(world);
     }
 
+    TEST("RIO: get across cfs") {
+        RIO _rio, *rio = &_rio;
+        sds foo = sdsnew("foo"), bar = sdsnew("bar"),
+            hello = sdsnew("hello"), world = sdsnew("world");
+        sds *rawkeys, *rawvals;
+        int *cfs;
+
+        resetRIOStats();
+
+        cfs = genIntArray(2,DATA_CF,SCORE_CF);
+        rawkeys = genSdsArray(2,foo,hello);
+        rawvals = genSdsArray(2,bar,world);
+        RIOInitPut(rio,2,cfs,rawkeys,rawvals);
+        RIODo(rio);
+        RIODeinit(rio);
+
+        /* keys interleaved across cfs must map back to their own slot. */
+        cfs = genIntArray(4,SCORE_CF,DATA_CF,DATA_CF,SCORE_CF);
+        rawkeys = genSdsArray(4,hello,foo,hello,foo);
+        RIOInitGet(rio,4,cfs,rawkeys);
+        RIODo(rio);
+        test_assert(!RIOGetError(rio));
+        test_assert(sdscmp(rio->get.rawvals[0],world) == 0);
+        test_assert(sdscmp(rio->get.rawvals[1],bar) == 0);
+        test_assert(rio->get.rawvals[2] == NULL);
+        test_assert(rio->get.rawvals[3] == NULL);
+        test_assert(rio->get.notfound == 2);
+        RIODeinit(rio);
+
+        cfs = genIntArray(2,DATA_CF,SCORE_CF);
+        rawkeys = genSdsArray(2,foo,hello);
+        RIOInitDel(rio,2,cfs,rawkeys);
+        RIODo(rio);
+        RIODeinit(rio);
+
+        sdsfree(foo), sdsfree(bar);
+        sdsfree(hello), sdsfree(world);
+    }
+
     return error;
 }
 #endif
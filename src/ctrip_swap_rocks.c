@@ -40,9 +40,27 @@
 #define KB 1024
 #define MB (1024*1024)
 
-const char *swap_cf_names[CF_COUNT] = {data_cf_name, meta_cf_name, score_cf_name};
-
-int rmdirRecursive(const char *path);
+const char *swap_cf_names[CF_COUNT] = {data_cf_name, meta_cf_name, score_cf_name, expire_cf_name};
+
+#define ROCKS_COMPRESSION_DEFAULT_WINDOW_BITS -14
+#define ROCKS_COMPRESSION_DEFAULT_LEVEL 32767
+#define ROCKS_COMPRESSION_DEFAULT_STRATEGY 0
+
+/* Dictionary sampled from data blocks buffered while building each sst
+ * (flush/compaction output), saved in sst and shared by all its blocks:
+ * small subkey values compress poorly on their own. Snappy has no
+ * dictionary support, only zlib (and zstd/lz4 if linked) benefit, so it's
+ * disabled (max_dict_bytes 0) by default. Buffering is bounded by
+ * max_dict_buffer_bytes (0 means buffer whole sst). */
+static inline void rocks_init_option_compression_dict(rocksdb_options_t *opts,
+        int max_dict_bytes, unsigned long long max_dict_buffer_bytes) {
+    rocksdb_options_set_compression_options(opts,
+            ROCKS_COMPRESSION_DEFAULT_WINDOW_BITS,
+            ROCKS_COMPRESSION_DEFAULT_LEVEL,
+            ROCKS_COMPRESSION_DEFAULT_STRATEGY, max_dict_bytes);
+    rocksdb_options_set_compression_options_max_dict_buffer_bytes(opts,
+            max_dict_buffer_bytes);
+}
 
 static inline void rocks_init_option_compression(rocksdb_options_t *opts, int compression) {
     if (compression >= 0) {
@@ -61,11 +79,411 @@ static inline void rocks_init_option_compression(rocksdb_options_t *opts, int co
     }
 }
 
+/* Data & score keys of one object version share dbid|keylen|key|version
+ * prefix, prefix bloom filters range swaps (hash/set/list/zset subkeys) of
+ * cold or not existing objects without touching every level. */
+#define ROCKS_MEMTABLE_PREFIX_BLOOM_RATIO 0.1
+
+static void rocksDataKeyPrefixDestroy(void *state) {
+    UNUSED(state);
+}
+
+static char *rocksDataKeyPrefixTransform(void *state, const char *key,
+        size_t length, size_t *dst_length) {
+    UNUSED(state);
+    *dst_length = rocksDecodeDataKeyPrefixLen(key,length);
+    return (char*)key;
+}
+
+static unsigned char rocksDataKeyPrefixInDomain(void *state, const char *key,
+        size_t length) {
+    UNUSED(state);
+    return rocksDecodeDataKeyPrefixLen(key,length) > 0;
+}
+
+static unsigned char rocksDataKeyPrefixInRange(void *state, const char *key,
+        size_t length) {
+    UNUSED(state), UNUSED(key), UNUSED(length);
+    return 0;
+}
+
+static const char *rocksDataKeyPrefixName(void *state) {
+    UNUSED(state);
+    return "ror.DataKeyPrefix";
+}
+
+static void rocksInitPrefixBloom(rocksdb_options_t *cf_opts) {
+    /* options takes ownership of slice transform. */
+    rocksdb_slicetransform_t *prefix_extractor = rocksdb_slicetransform_create(
+            NULL, rocksDataKeyPrefixDestroy, rocksDataKeyPrefixTransform,
+            rocksDataKeyPrefixInDomain, rocksDataKeyPrefixInRange,
+            rocksDataKeyPrefixName);
+    rocksdb_options_set_prefix_extractor(cf_opts, prefix_extractor);
+    rocksdb_options_set_memtable_prefix_bloom_size_ratio(cf_opts,
+            ROCKS_MEMTABLE_PREFIX_BLOOM_RATIO);
+}
+
+/* Score cf shares data cf cache (they used to own one data sized cache
+ * each). Meta cf owns a separate cache unless block cache type is shared or
+ * hyper-clock, in which case one cache sized to data+meta serves all cfs. */
+static void rocksInitBlockCache(rocks *rocks) {
+    size_t data_size = server.rocksdb_data_block_cache_size,
+           meta_size = server.rocksdb_meta_block_cache_size;
+
+    switch (server.rocksdb_block_cache_type) {
+    case ROCKSDB_BLOCK_CACHE_SHARED:
+        rocks->data_block_cache = rocksdb_cache_create_lru(data_size+meta_size);
+        rocks->meta_block_cache = NULL;
+        break;
+    case ROCKSDB_BLOCK_CACHE_HYPER_CLOCK:
+        /* lock free lookup, shards contend much less among swap threads. */
+        rocks->data_block_cache = rocksdb_cache_create_hyper_clock(
+                data_size+meta_size,server.rocksdb_data_block_size);
+        rocks->meta_block_cache = NULL;
+        break;
+    case ROCKSDB_BLOCK_CACHE_SEPARATE:
+    default:
+        rocks->data_block_cache = rocksdb_cache_create_lru(data_size);
+        rocks->meta_block_cache = rocksdb_cache_create_lru(meta_size);
+        break;
+    }
+}
+
+static void rocksReleaseBlockCache(rocks *rocks) {
+    if (rocks->data_block_cache) {
+        rocksdb_cache_destroy(rocks->data_block_cache);
+        rocks->data_block_cache = NULL;
+    }
+    if (rocks->meta_block_cache) {
+        rocksdb_cache_destroy(rocks->meta_block_cache);
+        rocks->meta_block_cache = NULL;
+    }
+}
+
+static inline rocksdb_cache_t *rocksGetBlockCache(rocks *rocks, int cf) {
+    if ((cf == META_CF || cf == EXPIRE_CF) && rocks->meta_block_cache)
+        return rocks->meta_block_cache;
+    return rocks->data_block_cache;
+}
+
+static size_t rocksGetBlockCacheUsage(rocks *rocks) {
+    size_t usage = 0;
+    if (rocks->data_block_cache)
+        usage += rocksdb_cache_get_usage(rocks->data_block_cache);
+    if (rocks->meta_block_cache)
+        usage += rocksdb_cache_get_usage(rocks->meta_block_cache);
+    return usage;
+}
+
+static int rocksOpenDb(rocks *rocks, const char *dir) {
+    char *errs[CF_COUNT] = {NULL};
+    rocks->db = rocksdb_open_column_families(rocks->db_opts, dir, CF_COUNT,
+            swap_cf_names, (const rocksdb_options_t *const *)rocks->cf_opts,
+            rocks->cf_handles, errs);
+    if (errs[0] != NULL || errs[1] != NULL || errs[2] != NULL || errs[3] != NULL) {
+        serverLog(LL_WARNING, "[ROCKS] rocksdb open failed: default_cf=%s, meta_cf=%s, score_cf=%s, expire_cf=%s", errs[0], errs[1], errs[2], errs[3]);
+        return -1;
+    }
+    serverLog(LL_NOTICE, "[ROCKS] opened rocks data in (%s).", dir);
+    return 0;
+}
+
+static void rocksCloseDb(rocks *rocks) {
+    for (int i = 0; i < CF_COUNT; i++) {
+        rocksdb_column_family_handle_destroy(rocks->cf_handles[i]);
+        rocks->cf_handles[i] = NULL;
+    }
+    rocksdb_close(rocks->db);
+    rocks->db = NULL;
+}
+
+/* Returns key format saved in marker, SWAP_KEY_FORMAT_NONE if marker not
+ * found, SWAP_KEY_FORMAT_ERR if read failed. */
+static int rocksReadKeyFormat(rocksdb_t *db,
+        rocksdb_column_family_handle_t *meta_cf, rocksdb_readoptions_t *ropts) {
+    char *err = NULL, *val;
+    size_t vlen;
+    int format = SWAP_KEY_FORMAT_NONE;
+
+    val = rocksdb_get_cf(db, ropts, meta_cf, SWAP_KEY_FORMAT_MARKER,
+            SWAP_KEY_FORMAT_MARKER_LEN, &vlen, &err);
+    if (err != NULL) {
+        serverLog(LL_WARNING, "[ROCKS] read key format failed: %s", err);
+        zlibc_free(err);
+        return SWAP_KEY_FORMAT_ERR;
+    }
+    if (val != NULL && vlen == 1 && val[0] < SWAP_KEY_FORMAT_TYPES)
+        format = val[0];
+    if (val) zlibc_free(val);
+    return format;
+}
+
+static int rocksWriteKeyFormat(rocksdb_t *db,
+        rocksdb_column_family_handle_t *meta_cf, int format) {
+    char *err = NULL, val = (char)format;
+    rocksdb_writeoptions_t *wopts = rocksdb_writeoptions_create();
+    rocksdb_put_cf(db, wopts, meta_cf, SWAP_KEY_FORMAT_MARKER,
+            SWAP_KEY_FORMAT_MARKER_LEN, &val, 1, &err);
+    rocksdb_writeoptions_destroy(wopts);
+    if (err != NULL) {
+        serverLog(LL_WARNING, "[ROCKS] write key format failed: %s", err);
+        zlibc_free(err);
+        return -1;
+    }
+    return 0;
+}
+
+static int rocksIsEmpty(rocksdb_t *db, int num_cfs,
+        rocksdb_column_family_handle_t **cf_handles,
+        rocksdb_readoptions_t *ropts) {
+    int empty = 1;
+    for (int cf = 0; cf < num_cfs && empty; cf++) {
+        rocksdb_iterator_t *iter = rocksdb_create_iterator_cf(db,
+                ropts, cf_handles[cf]);
+        rocksdb_iter_seek_to_first(iter);
+        if (rocksdb_iter_valid(iter)) empty = 0;
+        rocksdb_iter_destroy(iter);
+    }
+    return empty;
+}
+
+/* Key format must be known before db opened: flush and compaction (which
+ * might run while opening, e.g. recovering WAL) build prefix bloom with
+ * prefix extractor, which decodes keys with active key format. So detect
+ * it with a plain read-only open first, returns format saved in marker,
+ * legacy if db has keys but no marker, SWAP_KEY_FORMAT_NONE if db not exists
+ * or is empty, SWAP_KEY_FORMAT_ERR if db exists but can't be opened or read
+ * (guessing format then might write marker of wrong format into db). */
+static int rocksDetectKeyFormat(rocks *rocks, const char *dir) {
+    char **names, *err = NULL, current[ROCKS_DIR_MAX_LEN];
+    size_t num_cfs;
+    int i, meta_cf = -1, format = SWAP_KEY_FORMAT_NONE;
+    rocksdb_options_t *opts, **cf_opts;
+    rocksdb_column_family_handle_t **cf_handles;
+    rocksdb_t *db;
+    struct stat statbuf;
+
+    opts = rocksdb_options_create_copy(rocks->db_opts);
+    rocksdb_options_set_create_if_missing(opts, 0);
+    names = rocksdb_list_column_families(opts, dir, &num_cfs, &err);
+    if (err != NULL) {
+        snprintf(current, ROCKS_DIR_MAX_LEN, "%s/CURRENT", dir);
+        if (stat(current, &statbuf) == 0) {
+            serverLog(LL_WARNING, "[ROCKS] list column families of %s failed: %s",
+                    dir, err);
+            format = SWAP_KEY_FORMAT_ERR;
+        } /* else db not exists yet. */
+        zlibc_free(err);
+        rocksdb_options_destroy(opts);
+        return format;
+    }
+
+    cf_opts = zmalloc(num_cfs*sizeof(rocksdb_options_t*));
+    cf_handles = zmalloc(num_cfs*sizeof(rocksdb_column_family_handle_t*));
+    for (i = 0; i < (int)num_cfs; i++) {
+        cf_opts[i] = opts;
+        if (!strcmp(names[i],swap_cf_names[META_CF])) meta_cf = i;
+    }
+
+    db = rocksdb_open_for_read_only_column_families(opts, dir, num_cfs,
+            (const char *const *)names, (const rocksdb_options_t *const *)cf_opts,
+            cf_handles, 0, &err);
+    if (err != NULL) {
+        serverLog(LL_WARNING, "[ROCKS] open %s read-only to detect key format failed: %s",
+                dir, err);
+        zlibc_free(err);
+        format = SWAP_KEY_FORMAT_ERR;
+    } else {
+        if (meta_cf >= 0)
+            format = rocksReadKeyFormat(db,cf_handles[meta_cf],rocks->ropts);
+        if (format == SWAP_KEY_FORMAT_NONE &&
+                !rocksIsEmpty(db,num_cfs,cf_handles,rocks->ropts))
+            format = SWAP_KEY_FORMAT_LEGACY;
+        for (i = 0; i < (int)num_cfs; i++)
+            rocksdb_column_family_handle_destroy(cf_handles[i]);
+        rocksdb_close(db);
+    }
+
+    rocksdb_list_column_families_destroy(names, num_cfs);
+    zfree(cf_handles);
+    zfree(cf_opts);
+    rocksdb_options_destroy(opts);
+    return format;
+}
+
+#define ROCKS_KEY_FORMAT_MIGRATE_BATCH 1024
+
+static int rocksMigrateCf(rocks *rocks, int cf, rocksdb_t *target,
+        rocksdb_column_family_handle_t *target_cf, int from, int to,
+        long long *migrated) {
+    rocksdb_iterator_t *iter;
+    rocksdb_writebatch_t *wb = rocksdb_writebatch_create();
+    rocksdb_writeoptions_t *wopts = rocksdb_writeoptions_create();
+    const char *rawkey, *rawval;
+    size_t klen, vlen;
+    char *err = NULL;
+
+    rocksdb_writeoptions_disable_WAL(wopts, 1);
+    iter = rocksdb_create_iterator_cf(rocks->db,rocks->ropts,rocks->cf_handles[cf]);
+    for (rocksdb_iter_seek_to_first(iter); rocksdb_iter_valid(iter) && err == NULL;
+            rocksdb_iter_next(iter)) {
+        sds transcoded;
+        rawkey = rocksdb_iter_key(iter, &klen);
+        if (cf == META_CF && klen == SWAP_KEY_FORMAT_MARKER_LEN &&
+                !memcmp(rawkey,SWAP_KEY_FORMAT_MARKER,klen))
+            continue;
+        if ((transcoded = rocksTranscodeKey(from,to,rawkey,klen)) == NULL) {
+            serverLog(LL_WARNING, "[ROCKS] skip malformed key in %s cf while migrating.",
+                    swap_cf_names[cf]);
+            continue;
+        }
+        rawval = rocksdb_iter_value(iter, &vlen);
+        rocksdb_writebatch_put_cf(wb,target_cf,transcoded,sdslen(transcoded),
+                rawval,vlen);
+        sdsfree(transcoded);
+        (*migrated)++;
+        if (rocksdb_writebatch_count(wb) >= ROCKS_KEY_FORMAT_MIGRATE_BATCH) {
+            rocksdb_write(target,wopts,wb,&err);
+            rocksdb_writebatch_clear(wb);
+        }
+    }
+    if (err == NULL) rocksdb_iter_get_error(iter, &err);
+    if (err == NULL && rocksdb_writebatch_count(wb))
+        rocksdb_write(target,wopts,wb,&err);
+    rocksdb_iter_destroy(iter);
+    rocksdb_writebatch_destroy(wb);
+    rocksdb_writeoptions_destroy(wopts);
+
+    if (err != NULL) {
+        serverLog(LL_WARNING, "[ROCKS] migrate %s cf failed: %s",
+                swap_cf_names[cf], err);
+        zlibc_free(err);
+        return -1;
+    }
+    return 0;
+}
+
+/* Offline migration: rewrite every key into a new db in dir.migrate with
+ * target format, then replace dir with it, which is left closed for caller
+ * to reopen with target format active. Values are format independent, only
+ * dbid|keylen|key prefix of keys is transcoded. */
+static int rocksMigrateKeyFormat(rocks *rocks, const char *dir, int from, int to) {
+    char tmpdir[ROCKS_DIR_MAX_LEN], olddir[ROCKS_DIR_MAX_LEN], *err = NULL;
+    char *errs[CF_COUNT] = {NULL};
+    rocksdb_options_t *cf_opts[CF_COUNT];
+    rocksdb_column_family_handle_t *cf_handles[CF_COUNT];
+    rocksdb_flushoptions_t *fopts;
+    rocksdb_t *target;
+    struct stat statbuf;
+    long long migrated = 0, start = ustime();
+    int i, retval = -1;
+
+    snprintf(tmpdir, ROCKS_DIR_MAX_LEN, "%s.migrate", dir);
+    snprintf(olddir, ROCKS_DIR_MAX_LEN, "%s.old", dir);
+    if (!stat(tmpdir, &statbuf)) rmdirRecursive(tmpdir);
+    if (!stat(olddir, &statbuf)) rmdirRecursive(olddir);
+
+    serverLog(LL_NOTICE, "[ROCKS] migrating key format from %s to %s (%s => %s).",
+            swapKeyFormatName(from), swapKeyFormatName(to), dir, tmpdir);
+
+    /* plain cf options: compaction filters must not run against target. */
+    for (i = 0; i < CF_COUNT; i++)
+        cf_opts[i] = rocksdb_options_create_copy(rocks->db_opts);
+    target = rocksdb_open_column_families(rocks->db_opts, tmpdir, CF_COUNT,
+            swap_cf_names, (const rocksdb_options_t *const *)cf_opts,
+            cf_handles, errs);
+    for (i = 0; i < CF_COUNT; i++) rocksdb_options_destroy(cf_opts[i]);
+    if (errs[0] != NULL || errs[1] != NULL || errs[2] != NULL || errs[3] != NULL) {
+        serverLog(LL_WARNING, "[ROCKS] open migrate target failed: default_cf=%s, meta_cf=%s, score_cf=%s, expire_cf=%s", errs[0], errs[1], errs[2], errs[3]);
+        return -1;
+    }
+
+    for (i = 0; i < CF_COUNT; i++) {
+        if (rocksMigrateCf(rocks,i,target,cf_handles[i],from,to,&migrated))
+            goto end;
+    }
+    if (rocksWriteKeyFormat(target,cf_handles[META_CF],to)) goto end;
+
+    fopts = rocksdb_flushoptions_create();
+    rocksdb_flushoptions_set_wait(fopts, 1);
+    for (i = 0; i < CF_COUNT && err == NULL; i++)
+        rocksdb_flush_cf(target, fopts, cf_handles[i], &err);
+    rocksdb_flushoptions_destroy(fopts);
+    if (err != NULL) {
+        serverLog(LL_WARNING, "[ROCKS] flush migrate target failed: %s", err);
+        zlibc_free(err);
+        goto end;
+    }
+    retval = 0;
+
+end:
+    for (i = 0; i < CF_COUNT; i++) rocksdb_column_family_handle_destroy(cf_handles[i]);
+    rocksdb_close(target);
+    if (retval) {
+        rmdirRecursive(tmpdir);
+        return retval;
+    }
+
+    rocksCloseDb(rocks);
+    if (rename(dir, olddir) || rename(tmpdir, dir)) {
+        serverLog(LL_WARNING, "[ROCKS] replace %s with %s failed: %s",
+                dir, tmpdir, strerror(errno));
+        return -1;
+    }
+    rmdirRecursive(olddir);
+    serverLog(LL_NOTICE, "[ROCKS] migrated %lld keys to %s key format in %lld ms.",
+            migrated, swapKeyFormatName(to), (ustime()-start)/1000);
+    return 0;
+}
+
+/* Open db with its key format active: format from marker if saved; db
+ * without marker but with keys was created before key format introduced
+ * (legacy); new or empty db adopts configured format. Existing db migrates
+ * to configured format only if swap-key-format-migrate enabled, otherwise
+ * keeps its format. */
+static int rocksOpenDbWithKeyFormat(rocks *rocks, const char *dir) {
+    int format = rocksDetectKeyFormat(rocks, dir);
+
+    if (format == SWAP_KEY_FORMAT_ERR) {
+        serverLog(LL_WARNING, "[ROCKS] detect key format of %s failed.", dir);
+        return -1;
+    }
+
+    server.swap_key_format_active = format == SWAP_KEY_FORMAT_NONE ?
+        server.swap_key_format : format;
+    if (rocksOpenDb(rocks, dir)) return -1;
+
+    if (format == SWAP_KEY_FORMAT_NONE) {
+        format = server.swap_key_format;
+        if (rocksWriteKeyFormat(rocks->db,rocks->cf_handles[META_CF],format))
+            return -1;
+    }
+
+    if (format != server.swap_key_format) {
+        if (server.swap_key_format_migrate) {
+            if (rocksMigrateKeyFormat(rocks,dir,format,server.swap_key_format))
+                return -1;
+            format = server.swap_key_format;
+            server.swap_key_format_active = format;
+            if (rocksOpenDb(rocks, dir)) return -1;
+        } else {
+            serverLog(LL_NOTICE, "[ROCKS] keep %s key format of existing rocksdb, "
+                    "enable swap-key-format-migrate to migrate to %s.",
+                    swapKeyFormatName(format),
+                    swapKeyFormatName(server.swap_key_format));
+        }
+    }
+
+    server.swap_key_format_active = format;
+    serverLog(LL_NOTICE, "[ROCKS] key format: %s.", swapKeyFormatName(format));
+    return 0;
+}
+
 int rocksInit() {
     if (server.swap_debug_init_rocksdb_delay_micro)
         usleep(server.swap_debug_init_rocksdb_delay_micro);
     rocks *rocks = zcalloc(sizeof(struct rocks));
-    char *errs[3] = {NULL}, dir[ROCKS_DIR_MAX_LEN], *err = NULL, longlong_str[20];
+    char dir[ROCKS_DIR_MAX_LEN], *err = NULL, longlong_str[20];
 
     rocks->snapshot = NULL;
     rocks->checkpoint = NULL;
@@ -96,6 +514,9 @@ int rocksInit() {
     rocks->ropts = rocksdb_readoptions_create();
     rocksdb_readoptions_set_verify_checksums(rocks->ropts, 0);
     rocksdb_readoptions_set_fill_cache(rocks->ropts, 1);
+    /* ropts scans across objects (e.g. rdb save), prefix bloom must be
+     * bypassed. */
+    rocksdb_readoptions_set_total_order_seek(rocks->ropts, 1);
 
     rocks->wopts = rocksdb_writeoptions_create();
     if (server.swap_persist_enabled) {
@@ -131,9 +552,12 @@ int rocksInit() {
     rocksdb_readoptions_set_verify_checksums(rocks->filter_meta_ropts, 0);
     rocksdb_readoptions_set_fill_cache(rocks->filter_meta_ropts, 0);
 
+    rocksInitBlockCache(rocks);
+
     /* data cf */
     rocks->cf_opts[DATA_CF] = rocksdb_options_create_copy(rocks->db_opts);
     rocks_init_option_compression(rocks->cf_opts[DATA_CF],server.rocksdb_data_compression);
+    rocks_init_option_compression_dict(rocks->cf_opts[DATA_CF],server.rocksdb_data_compression_max_dict_bytes,server.rocksdb_data_compression_max_dict_buffer_bytes);
     rocksdb_options_set_level0_slowdown_writes_trigger(rocks->cf_opts[DATA_CF],server.rocksdb_data_level0_slowdown_writes_trigger);
     rocksdb_options_set_disable_auto_compactions(rocks->cf_opts[DATA_CF],server.rocksdb_data_disable_auto_compactions);
     rocksdb_options_set_enable_blob_files(rocks->cf_opts[DATA_CF],server.rocksdb_data_enable_blob_files);
@@ -162,16 +586,16 @@ int rocksInit() {
     rocksdb_block_based_options_set_cache_index_and_filter_blocks(rocks->block_opts[DATA_CF], server.rocksdb_data_cache_index_and_filter_blocks);
     rocksdb_block_based_options_set_filter_policy(rocks->block_opts[DATA_CF], rocksdb_filterpolicy_create_bloom(10));
 
-    rocksdb_cache_t *data_cache = rocksdb_cache_create_lru(server.rocksdb_data_block_cache_size);
-    rocksdb_block_based_options_set_block_cache(rocks->block_opts[DATA_CF], data_cache);
-    rocksdb_cache_destroy(data_cache);
+    rocksdb_block_based_options_set_block_cache(rocks->block_opts[DATA_CF], rocksGetBlockCache(rocks,DATA_CF));
 
     rocksdb_options_set_block_based_table_factory(rocks->cf_opts[DATA_CF], rocks->block_opts[DATA_CF]);
+    if (server.rocksdb_data_prefix_bloom) rocksInitPrefixBloom(rocks->cf_opts[DATA_CF]);
     rocksdb_options_set_compaction_filter_factory(rocks->cf_opts[DATA_CF], rocks->cf_compactionfilterfatorys[DATA_CF]);
 
     /* score cf */
     rocks->cf_opts[SCORE_CF] = rocksdb_options_create_copy(rocks->db_opts);
     rocks_init_option_compression(rocks->cf_opts[SCORE_CF],server.rocksdb_data_compression);
+    rocks_init_option_compression_dict(rocks->cf_opts[SCORE_CF],server.rocksdb_data_compression_max_dict_bytes,server.rocksdb_data_compression_max_dict_buffer_bytes);
     rocksdb_options_set_level0_slowdown_writes_trigger(rocks->cf_opts[SCORE_CF],server.rocksdb_data_level0_slowdown_writes_trigger);
     rocksdb_options_set_disable_auto_compactions(rocks->cf_opts[SCORE_CF],server.rocksdb_data_disable_auto_compactions);
     rocksdb_options_set_enable_blob_files(rocks->cf_opts[SCORE_CF],server.rocksdb_data_enable_blob_files);
@@ -200,16 +624,16 @@ int rocksInit() {
     rocksdb_block_based_options_set_cache_index_and_filter_blocks(rocks->block_opts[SCORE_CF], server.rocksdb_data_cache_index_and_filter_blocks);
     rocksdb_block_based_options_set_filter_policy(rocks->block_opts[SCORE_CF], rocksdb_filterpolicy_create_bloom(10));
 
-    rocksdb_cache_t *score_cache = rocksdb_cache_create_lru(server.rocksdb_data_block_cache_size);
-    rocksdb_block_based_options_set_block_cache(rocks->block_opts[SCORE_CF], score_cache);
-    rocksdb_cache_destroy(score_cache);
+    rocksdb_block_based_options_set_block_cache(rocks->block_opts[SCORE_CF], rocksGetBlockCache(rocks,SCORE_CF));
 
     rocksdb_options_set_block_based_table_factory(rocks->cf_opts[SCORE_CF], rocks->block_opts[SCORE_CF]);
+    if (server.rocksdb_data_prefix_bloom) rocksInitPrefixBloom(rocks->cf_opts[SCORE_CF]);
     rocksdb_options_set_compaction_filter_factory(rocks->cf_opts[SCORE_CF], rocks->cf_compactionfilterfatorys[SCORE_CF]);
 
     /* meta cf */
     rocks->cf_opts[META_CF] = rocksdb_options_create_copy(rocks->db_opts);
     rocks_init_option_compression(rocks->cf_opts[META_CF],server.rocksdb_meta_compression);
+    rocks_init_option_compression_dict(rocks->cf_opts[META_CF],server.rocksdb_meta_compression_max_dict_bytes,server.rocksdb_meta_compression_max_dict_buffer_bytes);
     rocksdb_options_set_level0_slowdown_writes_trigger(rocks->cf_opts[META_CF],server.rocksdb_meta_level0_slowdown_writes_trigger);
     rocksdb_options_set_disable_auto_compactions(rocks->cf_opts[META_CF],server.rocksdb_meta_disable_auto_compactions);
     rocksdb_options_set_enable_blob_files(rocks->cf_opts[META_CF],server.rocksdb_meta_enable_blob_files);
@@ -237,22 +661,45 @@ int rocksInit() {
     rocksdb_block_based_options_set_block_size(rocks->block_opts[META_CF], server.rocksdb_meta_block_size);
     rocksdb_block_based_options_set_cache_index_and_filter_blocks(rocks->block_opts[META_CF], server.rocksdb_meta_cache_index_and_filter_blocks);
     rocksdb_block_based_options_set_filter_policy(rocks->block_opts[META_CF], rocksdb_filterpolicy_create_bloom(10));
+    /* meta blocks compete with data blocks in shared cache, keep meta L0
+     * index & filter (touched by every swap) pinned. */
+    if (rocks->meta_block_cache == NULL)
+        rocksdb_block_based_options_set_pin_l0_filter_and_index_blocks_in_cache(rocks->block_opts[META_CF], 1);
 
-    rocksdb_cache_t *meta_cache = rocksdb_cache_create_lru(server.rocksdb_meta_block_cache_size);
-    rocksdb_block_based_options_set_block_cache(rocks->block_opts[META_CF], meta_cache);
-    rocksdb_cache_destroy(meta_cache);
+    rocksdb_block_based_options_set_block_cache(rocks->block_opts[META_CF], rocksGetBlockCache(rocks,META_CF));
 
     rocksdb_options_set_block_based_table_factory(rocks->cf_opts[META_CF], rocks->block_opts[META_CF]);
     rocksdb_options_set_compaction_filter_factory(rocks->cf_opts[META_CF], rocks->cf_compactionfilterfatorys[META_CF]);
 
-    rocks->db = rocksdb_open_column_families(rocks->db_opts, dir, CF_COUNT,
-            swap_cf_names, (const rocksdb_options_t *const *)rocks->cf_opts,
-            rocks->cf_handles, errs);
-    if (errs[0] != NULL || errs[1] != NULL) {
-        serverLog(LL_WARNING, "[ROCKS] rocksdb open failed: default_cf=%s, meta_cf=%s, score_cf=%s", errs[0], errs[1], errs[2]);
-        return -1;
+    /* expire cf: small keys only, shares meta options & cache. Stale index
+     * entries are cleaned by scan expire, so no compaction filter needed. */
+    rocks->cf_opts[EXPIRE_CF] = rocksdb_options_create_copy(rocks->db_opts);
+    rocks_init_option_compression(rocks->cf_opts[EXPIRE_CF],server.rocksdb_meta_compression);
+    rocksdb_options_set_level0_slowdown_writes_trigger(rocks->cf_opts[EXPIRE_CF],server.rocksdb_meta_level0_slowdown_writes_trigger);
+    rocksdb_options_set_disable_auto_compactions(rocks->cf_opts[EXPIRE_CF],server.rocksdb_meta_disable_auto_compactions);
+    rocksdb_options_set_max_write_buffer_number(rocks->cf_opts[EXPIRE_CF], server.rocksdb_meta_max_write_buffer_number);
+    rocksdb_options_set_target_file_size_base(rocks->cf_opts[EXPIRE_CF], server.rocksdb_meta_target_file_size_base);
+    rocksdb_options_set_write_buffer_size(rocks->cf_opts[EXPIRE_CF],server.rocksdb_meta_write_buffer_size);
+    rocksdb_options_set_max_bytes_for_level_base(rocks->cf_opts[EXPIRE_CF],server.rocksdb_meta_max_bytes_for_level_base);
+    rocksdb_options_set_max_bytes_for_level_multiplier(rocks->cf_opts[EXPIRE_CF], server.rocksdb_meta_max_bytes_for_level_multiplier);
+    rocksdb_options_set_level_compaction_dynamic_level_bytes(rocks->cf_opts[EXPIRE_CF], server.rocksdb_meta_compaction_dynamic_level_bytes);
+    if (server.rocksdb_meta_suggest_compact_deletion_percentage) {
+        double deletion_ratio = (double)server.rocksdb_meta_suggest_compact_deletion_percentage / 100;
+        rocksdb_options_add_compact_on_deletion_collector_factory(rocks->cf_opts[EXPIRE_CF],
+                server.rocksdb_meta_suggest_compact_sliding_window_size,
+                server.rocksdb_meta_suggest_compact_num_dels_trigger,
+                deletion_ratio);
     }
-    serverLog(LL_NOTICE, "[ROCKS] opened rocks data in (%s).", dir);
+
+    rocks->block_opts[EXPIRE_CF] = rocksdb_block_based_options_create();
+    rocks->cf_compactionfilterfatorys[EXPIRE_CF] = createExpireCfCompactionFilterFactory();
+    rocksdb_block_based_options_set_block_size(rocks->block_opts[EXPIRE_CF], server.rocksdb_meta_block_size);
+    rocksdb_block_based_options_set_cache_index_and_filter_blocks(rocks->block_opts[EXPIRE_CF], server.rocksdb_meta_cache_index_and_filter_blocks);
+    rocksdb_block_based_options_set_block_cache(rocks->block_opts[EXPIRE_CF], rocksGetBlockCache(rocks,EXPIRE_CF));
+    rocksdb_options_set_block_based_table_factory(rocks->cf_opts[EXPIRE_CF], rocks->block_opts[EXPIRE_CF]);
+    rocksdb_options_set_compaction_filter_factory(rocks->cf_opts[EXPIRE_CF], rocks->cf_compactionfilterfatorys[EXPIRE_CF]);
+
+    if (rocksOpenDbWithKeyFormat(rocks, dir)) return -1;
 
     /* init advanced options */
     const char* opt_comp_sec = "periodic_compaction_seconds";
@@ -295,6 +742,7 @@ void rocksRelease() {
     setFilterState(FILTER_STATE_CLOSE);
     for (i = 0; i < CF_COUNT; i++)
         rocksdb_block_based_options_destroy(rocks->block_opts[i]);
+    rocksReleaseBlockCache(rocks);
     for (i = 0; i < CF_COUNT; i++)
         rocksdb_options_destroy(rocks->cf_opts[i]);
     for (i = 0; i < CF_COUNT; i++)
@@ -413,6 +861,83 @@ int rmdirRecursive(const char *path) {
 	return r;
 }
 
+/* Dir receiving rocks checkpoint files shipped by master, it is installed
+ * as rocks data dir once all files received. */
+sds rocksCheckpointStageDir(void) {
+    return sdscatprintf(sdsempty(), "%s/%d%s", ROCKS_DATA,
+            server.rocksdb_epoch, ROCKS_CHECKPOINT_STAGE_SUFFIX);
+}
+
+int rocksCheckpointStageInit(void) {
+    struct stat statbuf;
+    sds stagedir = rocksCheckpointStageDir();
+    int retval = 0;
+
+    if (!stat(stagedir, &statbuf)) rmdirRecursive(stagedir);
+    if (mkdir(stagedir, 0755)) {
+        serverLog(LL_WARNING, "[rocks] mkdir checkpoint stage %s failed: %s",
+                stagedir, strerror(errno));
+        retval = -1;
+    }
+    sdsfree(stagedir);
+    return retval;
+}
+
+/* Replace rocks data with received checkpoint: close db, swap stage dir in
+ * as data dir and reopen. Key format marker travels with meta cf, so key
+ * format is detected (and migrated if configured) same as startup. Returns
+ * -1 with old data reopened if checkpoint can't be installed, panics if
+ * neither could be opened (rocks->db must never be left closed). */
+int rocksInstallCheckpoint(void) {
+    rocks *rocks = server.rocks;
+    char dir[ROCKS_DIR_MAX_LEN], olddir[ROCKS_DIR_MAX_LEN];
+    struct stat statbuf;
+    sds stagedir = rocksCheckpointStageDir();
+    int retval = -1;
+
+    /* quiesce every user of rocks->db before closing it: rios and util
+     * tasks (stats, flush, checkpoint submitted by rocksCron) in swap
+     * threads, and parallel sync. */
+    asyncCompleteQueueDrain(-1);
+    parallelSyncDrain();
+    serverAssert(swapThreadsDrained());
+
+    snprintf(dir, ROCKS_DIR_MAX_LEN, "%s/%d", ROCKS_DATA, server.rocksdb_epoch);
+    snprintf(olddir, ROCKS_DIR_MAX_LEN, "%s.old", dir);
+    if (!stat(olddir, &statbuf)) rmdirRecursive(olddir);
+
+    rocksReleaseSnapshot();
+    rocksReleaseCheckpoint();
+    rocksCloseDb(rocks);
+
+    if (rename(dir, olddir)) {
+        serverLog(LL_WARNING, "[rocks] move %s to %s failed: %s",
+                dir, olddir, strerror(errno));
+        goto reopen;
+    }
+    if (rename(stagedir, dir)) {
+        serverLog(LL_WARNING, "[rocks] install checkpoint %s as %s failed: %s",
+                stagedir, dir, strerror(errno));
+        if (rename(olddir, dir)) {
+            serverPanic("[rocks] restore %s as %s failed: %s",
+                    olddir, dir, strerror(errno));
+        }
+        goto reopen;
+    }
+    rmdirRecursive(olddir);
+    retval = 0;
+
+reopen:
+    if (rocksOpenDbWithKeyFormat(rocks, dir)) {
+        serverPanic("[rocks] reopen rocks data %s failed after %s checkpoint.",
+                dir, retval ? "failing to install" : "installing");
+    }
+    if (retval == 0)
+        serverLog(LL_NOTICE, "[rocks] installed checkpoint from %s.", stagedir);
+    sdsfree(stagedir);
+    return retval;
+}
+
 int rocksFlushDB(int dbid) {
     int startdb, enddb, retval = 0, i;
     sds startkey = NULL, endkey = NULL;
@@ -555,12 +1080,9 @@ struct rocksdbMemOverhead *rocksGetMemoryOverhead() {
         mh->memtable = -1;
     }
 
-    if (!rocksdbPropertyInt(NULL, "rocksdb.block-cache-usage", &mem)) {
-        mh->block_cache = mem;
-        total += mem;
-    } else {
-        mh->block_cache = -1;
-    }
+    mem = rocksGetBlockCacheUsage(server.rocks);
+    mh->block_cache = mem;
+    total += mem;
 
     if (!rocksdbPropertyInt(NULL, "rocksdb.estimate-table-readers-mem", &mem)) {
         mh->index_and_filter = mem;
@@ -1109,12 +1631,53 @@ sds genSwapStorageInfoString(sds info) {
     return info;
 }
 
+static sds genRocksdbBlockCacheInfoString(sds info) {
+    rocks *rocks = server.rocks;
+    size_t capacity = 0;
+
+    if (rocks->data_block_cache)
+        capacity += rocksdb_cache_get_capacity(rocks->data_block_cache);
+    if (rocks->meta_block_cache)
+        capacity += rocksdb_cache_get_capacity(rocks->meta_block_cache);
+    info = sdscatprintf(info,
+            "rocksdb_block_cache_type:%s\r\n"
+            "rocksdb_block_cache_capacity:%lu\r\n"
+            "rocksdb_block_cache_usage:%lu\r\n",
+            rocksdbBlockCacheTypeName(server.rocksdb_block_cache_type),
+            capacity, rocksGetBlockCacheUsage(rocks));
+
+    for (int cf = 0; cf < CF_COUNT; cf++) {
+        rocksdbBlockCacheStat *stat = server.ror_stats->block_cache_stats+cf;
+        long long hit, miss;
+        atomicGet(stat->hit,hit);
+        atomicGet(stat->miss,miss);
+        info = sdscatprintf(info,
+                "rocksdb_block_cache_%s:hit=%lld,miss=%lld,hit_rate=%.2f%%\r\n",
+                swap_cf_names[cf],hit,miss,
+                hit+miss ? (double)hit*100/(hit+miss) : 0);
+    }
+
+    for (int cf = 0; cf < CF_COUNT; cf++) {
+        rocksdbPinnedGetStat *stat = server.ror_stats->pinned_get_stats+cf;
+        long long count, bytes;
+        atomicGet(stat->count,count);
+        atomicGet(stat->bytes,bytes);
+        info = sdscatprintf(info,
+                "rocksdb_pinned_get_%s:count=%lld,copied_bytes=%lld\r\n",
+                swap_cf_names[cf],count,bytes);
+    }
+    return info;
+}
+
 sds genRocksdbInfoString(sds info) {
 	size_t sequence = 0;
 	rocksdb_t *db = server.rocks->db;
 
 	if (db) sequence = rocksdb_get_latest_sequence_number(db);
 	info = sdscatprintf(info,"rocksdb_sequence:%lu\r\n",sequence);
+    info = sdscatprintf(info,"rocksdb_key_format:%s\r\n",
+            swapKeyFormatName(server.swap_key_format_active));
+    info = genRocksdbBlockCacheInfoString(info);
 
     char* rocksdb_stats = server.rocks->internal_stats? server.rocks->internal_stats->cfs[DATA_CF].rocksdb_stats_cache: NULL;
     info = compactLevelsInfo(info, rocksdb_stats);
@@ -1142,7 +1705,7 @@ sds genRocksdbStatsString(sds section, sds info) {
     if (count == 0) {
         info = infoCfStats(DATA_CF, info);
     }
-    int handled_cf[CF_COUNT] = {0,0,0};
+    int handled_cf[CF_COUNT] = {0};
 
     for(int i = 0; i < count; i++) {
         sds type = section_splits[i];
@@ -80,7 +80,9 @@ static int setSwapAnaOutSelectSubkeys(swapData *data, setDataCtx *datactx,
     *may_keep_data = 1;
     if (select_type == SELECT_MAIN) {
         sds vstr;
+        evictKeptSubkeys kept;
         setTypeIterator *si = setTypeInitIterator(subkeys);
+        evictKeptSubkeysInit(&kept,setTypeSize(subkeys),count);
         while (NULL != (vstr = setTypeNextObject(si))) {
             size_t vlen = sdslen(vstr);
             robj* subkey;
@@ -94,16 +96,24 @@ static int setSwapAnaOutSelectSubkeys(swapData *data, setDataCtx *datactx,
             }
 
             subkey = createObject(OBJ_STRING, vstr);
+            /* Recently accessed members are evicted only if not enough
+             * cold members found. */
+            if (evictKeptSubkeysKeep(&kept,data,subkey,vlen)) continue;
             evict_memory += vlen;
             datactx->ctx.subkeys[datactx->ctx.num++] = subkey;
         }
         setTypeReleaseIterator(si);
+        if (evictKeptSubkeysDeinit(&kept,datactx->ctx.subkeys,
+                    &datactx->ctx.num,count,&evict_memory) && !noswap)
+            *may_keep_data = 0;
     } else {
         robj *subkey;
         size_t sublen;
         dirtySubkeysIterator dss_iter;
         list *redundent_subkeys = listCreate();
+        evictKeptSubkeys kept;
 
+        evictKeptSubkeysInit(&kept,dirtySubkeysLength(subkeys),count);
         dirtySubkeysIteratorInit(&dss_iter, subkeys);
         while ((subkey = dirtySubkeysIteratorNext(&dss_iter,&sublen)) != NULL) {
             if ((size_t)datactx->ctx.num >= count ||
@@ -118,6 +128,7 @@ static int setSwapAnaOutSelectSubkeys(swapData *data, setDataCtx *datactx,
 
             /* check with lock hold so that evicting subkeys must exist. */
             if (setTypeIsMember(data->value,subkey->ptr)) {
+                if (evictKeptSubkeysKeep(&kept,data,subkey,sublen)) continue;
                 datactx->ctx.subkeys[datactx->ctx.num++] = subkey;
                 evict_memory += sublen;
             } else {
@@ -125,6 +136,9 @@ static int setSwapAnaOutSelectSubkeys(swapData *data, setDataCtx *datactx,
             }
         }
         dirtySubkeysIteratorDeinit(&dss_iter);
+        if (evictKeptSubkeysDeinit(&kept,datactx->ctx.subkeys,
+                    &datactx->ctx.num,count,&evict_memory) && !noswap)
+            *may_keep_data = 0;
 
         listIter li;
         listNode *ln;
@@ -155,6 +169,8 @@ int setSwapAna(swapData *data, int thd, struct keyRequest *req,
             *intention_flags = 0;
             break;
         case SWAP_IN:
+            if (thd == SWAP_ANA_THD_MAIN)
+                swapDataTouchSubkeys(data,req,setTypeSize,setTypeIsMember);
             if (!swapDataPersisted(data)) {
                 /* No need to swap for pure hot key */
                 *intention = SWAP_NOP;
@@ -191,6 +207,12 @@ int setSwapAna(swapData *data, int thd, struct keyRequest *req,
                     datactx->ctx.subkeys[datactx->ctx.num++] = createStringObject("foo",3);
                     *intention = SWAP_IN;
                     *intention_flags = 0;
+                } else if (swapDataSetupStream(data,cmd_intention_flags)) {
+                    /* SMEMBERS of big set: reply chunk by chunk. */
+                    datactx->ctx.num = 0;
+                    datactx->ctx.subkeys = NULL;
+                    *intention = SWAP_IN;
+                    *intention_flags = 0;
                 } else {
                     /* SMEMBERS,SINTER..., swap in all fields */
                     datactx->ctx.num = 0;
@@ -559,6 +581,42 @@ void freeSetSwapData(swapData *data_, void *datactx_) {
     zfree(datactx);
 }
 
+/* Reply members of o, members that also exists in hot are skipped. */
+static void setStreamReplyMembers(client *c, swapStream *stream, robj *o,
+        robj *hot) {
+    setTypeIterator *si = setTypeInitIterator(o);
+    sds member;
+    while (stream->replied < stream->total &&
+            (member = setTypeNextObject(si)) != NULL) {
+        if (hot == NULL || !setTypeIsMember(hot,member)) {
+            addReplyBulkSds(c,member);
+            stream->replied++;
+        } else {
+            sdsfree(member);
+        }
+    }
+    setTypeReleaseIterator(si);
+}
+
+/* SMEMBERS: reply header and hot members with the first chunk, then
+ * members in rocksdb chunk by chunk. */
+int setStreamReply(swapData *data, client *c) {
+    swapStream *stream = data->stream;
+
+    if (!swapStreamReplyStarted(stream)) {
+        stream->total = swapDataObjectMeta(data)->len;
+        if (data->value) stream->total += setTypeSize(data->value);
+        addReplySetLen(c,stream->total);
+        if (data->value)
+            setStreamReplyMembers(c,stream,data->value,NULL);
+    }
+
+    if (stream->chunk)
+        setStreamReplyMembers(c,stream,stream->chunk,data->value);
+
+    return !stream->eof;
+}
+
 void *setGetObjectMetaAux(swapData *data, void *datactx) {
     UNUSED(datactx);
     size_t hotlen = data->value ? setTypeSize(data->value) : 0;
@@ -584,6 +642,7 @@ swapDataType setSwapDataType = {
     .rocksDel = NULL,
     .mergedIsHot = setMergedIsHot,
     .getObjectMetaAux = setGetObjectMetaAux,
+    .streamReply = setStreamReply,
 };
 
 int swapDataSetupSet(swapData *d, OUT void **pdatactx) {
@@ -78,6 +78,12 @@ void initStatsSwap() {
         server.ror_stats->compaction_filter_stats[i].stats_metric_idx_scan = metric_offset+COMPACTION_FILTER_METRIC_SCAN;
         server.ror_stats->compaction_filter_stats[i].stats_metric_idx_rio = metric_offset+COMPACTION_FILTER_METRIC_RIO;
     }
+    server.ror_stats->priority_stats = zcalloc(SWAP_PRIORITY_TYPES*sizeof(swapPriorityStat));
+    server.ror_stats->block_cache_stats = zcalloc(CF_COUNT*sizeof(rocksdbBlockCacheStat));
+    server.ror_stats->pinned_get_stats = zcalloc(CF_COUNT*sizeof(rocksdbPinnedGetStat));
+    server.swap_rdb_save_ranges_stat = rdbSaveRangesStatCreate();
+    server.swap_checkpoint_send_stat = rocksCheckpointShipStatCreate(1);
+    server.swap_checkpoint_recv_stat = rocksCheckpointShipStatCreate(0);
     server.swap_debug_info = zmalloc(SWAP_DEBUG_INFO_TYPE*sizeof(swapDebugInfo));
     for (i = 0; i < SWAP_DEBUG_INFO_TYPE; i++) {
         metric_offset = SWAP_DEBUG_STATS_METRIC_OFFSET + i*SWAP_DEBUG_SIZE;
@@ -349,6 +355,7 @@ sds genSwapInfoString(sds info) {
     info = genSwapUnblockInfoString(info);
     info = genSwapRateLimitInfoString(info);
     info = genSwapPersistInfoString(info);
+    info = genSwapRdbSaveInfoString(info);
     return info;
 }
 
@@ -363,13 +370,17 @@ sds genSwapExecInfoString(sds info) {
             "swap_inprogress_memory:%ld\r\n"
             "swap_inprogress_load_count:%d\r\n"
             "swap_load_paused:%d\r\n"
-            "swap_load_error_count:%lu\r\n",
+            "swap_load_error_count:%lu\r\n"
+            "swap_stream_reply_paused:%lu\r\n"
+            "swap_stream_reply_paused_count:%lld\r\n",
             server.swap_inprogress_batch,
             server.swap_inprogress_count,
             server.swap_inprogress_memory,
             server.swap_load_inprogress_count,
             server.swap_load_paused,
-            server.swap_load_err_cnt);
+            server.swap_load_err_cnt,
+            listLength(server.swap_stream_paused_ctxs),
+            server.stat_swap_stream_reply_paused_count);
 
     for (j = 1; j < SWAP_TYPES; j++) {
         swapStat *s = &server.ror_stats->swap_stats[j];
@@ -462,6 +473,18 @@ void resetStatsSwap() {
         server.ror_stats->compaction_filter_stats[i].scan_count = 0;
         server.ror_stats->compaction_filter_stats[i].rio_count = 0;
     }
+    for (i = 0; i < CF_COUNT; i++) {
+        atomicSet(server.ror_stats->block_cache_stats[i].hit,0);
+        atomicSet(server.ror_stats->block_cache_stats[i].miss,0);
+        atomicSet(server.ror_stats->pinned_get_stats[i].count,0);
+        atomicSet(server.ror_stats->pinned_get_stats[i].bytes,0);
+    }
+    for (i = 0; i < SWAP_PRIORITY_TYPES; i++) {
+        atomicSet(server.ror_stats->priority_stats[i].processed,0);
+        atomicSet(server.ror_stats->priority_stats[i].queue_us,0);
+    }
+    server.stat_swap_repl_apply_ahead_count = 0;
+    server.stat_swap_repl_apply_ahead_skipped_count = 0;
     resetSwapLockInstantaneousMetrics();
     resetSwapBatchInstantaneousMetrics();
     resetSwapCukooFilterInstantaneousMetrics();
@@ -476,13 +499,19 @@ void resetSwapHitStat() {
     atomicSet(server.swap_hit_stats->stat_swapin_data_not_found_count,0);
     atomicSet(server.swap_hit_stats->stat_absent_subkey_query_count,0);
     atomicSet(server.swap_hit_stats->stat_absent_subkey_filt_count,0);
+    atomicSet(server.swap_hit_stats->stat_pipeline_prefetch_cmd_count,0);
+    atomicSet(server.swap_hit_stats->stat_pipeline_prefetch_key_count,0);
+    atomicSet(server.swap_hit_stats->stat_evict_subkey_kept_count,0);
+    atomicSet(server.swap_hit_stats->stat_evict_subkey_swapin_avoided_count,0);
 }
 
 sds genSwapHitInfoString(sds info) {
     double memory_hit_perc = 0, keyspace_hit_perc = 0, notfound_coldfilter_filt_perc = 0;
     long long attempt, noio, notfound_coldfilter_miss, notfound_absentcache_filt,
          notfound_cuckoofilter_filt, notfound, data_notfound,
-         absent_subkey_query, absent_subkey_filt;
+         absent_subkey_query, absent_subkey_filt,
+         pipeline_prefetch_cmd, pipeline_prefetch_key,
+         evict_subkey_kept, evict_subkey_swapin_avoided;
 
     atomicGet(server.swap_hit_stats->stat_swapin_attempt_count,attempt);
     atomicGet(server.swap_hit_stats->stat_swapin_no_io_count,noio);
@@ -492,6 +521,10 @@ sds genSwapHitInfoString(sds info) {
     atomicGet(server.swap_hit_stats->stat_swapin_data_not_found_count,data_notfound);
     atomicGet(server.swap_hit_stats->stat_absent_subkey_query_count,absent_subkey_query);
     atomicGet(server.swap_hit_stats->stat_absent_subkey_filt_count,absent_subkey_filt);
+    atomicGet(server.swap_hit_stats->stat_pipeline_prefetch_cmd_count,pipeline_prefetch_cmd);
+    atomicGet(server.swap_hit_stats->stat_pipeline_prefetch_key_count,pipeline_prefetch_key);
+    atomicGet(server.swap_hit_stats->stat_evict_subkey_kept_count,evict_subkey_kept);
+    atomicGet(server.swap_hit_stats->stat_evict_subkey_swapin_avoided_count,evict_subkey_swapin_avoided);
 
     notfound = notfound_absentcache_filt + notfound_cuckoofilter_filt + notfound_coldfilter_miss;
 
@@ -515,11 +548,17 @@ sds genSwapHitInfoString(sds info) {
             "swap_swapin_not_found_coldfilter_filt_perc:%.2f%%\r\n"
             "swap_swapin_data_not_found_count:%lld\r\n"
             "swap_absent_subkey_query_count:%lld\r\n"
-            "swap_absent_subkey_filt_count:%lld\r\n",
+            "swap_absent_subkey_filt_count:%lld\r\n"
+            "swap_pipeline_prefetch_cmd_count:%lld\r\n"
+            "swap_pipeline_prefetch_key_count:%lld\r\n"
+            "swap_evict_subkey_kept_count:%lld\r\n"
+            "swap_evict_subkey_swapin_avoided_count:%lld\r\n",
             attempt,notfound,noio,memory_hit_perc,keyspace_hit_perc,
             notfound_cuckoofilter_filt, notfound_absentcache_filt,
             notfound_coldfilter_miss, notfound_coldfilter_filt_perc,
-            data_notfound,absent_subkey_query,absent_subkey_filt);
+            data_notfound,absent_subkey_query,absent_subkey_filt,
+            pipeline_prefetch_cmd,pipeline_prefetch_key,
+            evict_subkey_kept,evict_subkey_swapin_avoided);
 
     return info;
 }
@@ -0,0 +1,1317 @@
+/* Copyright (c) 2021, ctrip.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "ctrip_swap.h"
+
+/* Stream meta */
+
+/* Stream is swapped at the granularity of listpack nodes of s->rax: each
+ * node is a data key (subkey is the 16 bytes big endian master ID, subval
+ * is the listpack blob), nodes are either in memory or in rocksdb (never
+ * both), similar to list. Everything else of a stream (length, last_id and
+ * consumer groups) is small and is always kept in memory for hot/warm key,
+ * it's encoded into rocks meta together with master ID of cold nodes. */
+typedef struct streamMeta {
+    rax *cold_nodes; /* master ID of nodes in rocksdb, data is NULL. */
+    robj *header; /* stream without nodes, only for meta decoded from rocks. */
+} streamMeta;
+
+streamMeta *streamMetaCreate() {
+    streamMeta *stream_meta = zmalloc(sizeof(streamMeta));
+    stream_meta->cold_nodes = raxNew();
+    stream_meta->header = NULL;
+    return stream_meta;
+}
+
+void streamMetaFree(streamMeta *stream_meta) {
+    if (stream_meta == NULL) return;
+    raxFree(stream_meta->cold_nodes);
+    if (stream_meta->header) decrRefCount(stream_meta->header);
+    zfree(stream_meta);
+}
+
+streamMeta *streamMetaDup(streamMeta *stream_meta) {
+    raxIterator ri;
+    streamMeta *dup = streamMetaCreate();
+    raxStart(&ri,stream_meta->cold_nodes);
+    raxSeek(&ri,"^",NULL,0);
+    while (raxNext(&ri)) raxInsert(dup->cold_nodes,ri.key,ri.key_len,NULL,NULL);
+    raxStop(&ri);
+    if (stream_meta->header) dup->header = streamDup(stream_meta->header);
+    return dup;
+}
+
+sds streamMetaDump(sds result, streamMeta *stream_meta) {
+    stream *s = stream_meta->header ? stream_meta->header->ptr : NULL;
+    result = sdscatprintf(result,"(cold_nodes=%llu",
+            (unsigned long long)raxSize(stream_meta->cold_nodes));
+    if (s) {
+        result = sdscatprintf(result,",length=%llu,last_id=%llu-%llu",
+                (unsigned long long)s->length,
+                (unsigned long long)s->last_id.ms,
+                (unsigned long long)s->last_id.seq);
+    }
+    return sdscat(result,")");
+}
+
+/* Header can't be rebuilt from nodes, persist load fix carries header over
+ * from cold meta. */
+streamMeta *streamRebuildMetaCreate(objectMeta *cold_meta) {
+    streamMeta *stream_meta = streamMetaCreate(), *cold;
+    if (cold_meta == NULL) return stream_meta;
+    cold = objectMetaGetPtr(cold_meta);
+    if (cold && cold->header) stream_meta->header = streamDup(cold->header);
+    return stream_meta;
+}
+
+objectMeta *createStreamObjectMeta(uint64_t version, streamMeta *stream_meta) {
+    objectMeta *object_meta = createObjectMeta(OBJ_STREAM,version);
+    objectMetaSetPtr(object_meta,stream_meta);
+    return object_meta;
+}
+
+/* num (# of cold nodes) | master ID ... | header (rdb format) */
+static sds encodeStreamMeta(streamMeta *stream_meta, stream *header) {
+    rio sdsrdb;
+    raxIterator ri;
+    stream *empty = NULL;
+
+    if (header == NULL) header = empty = streamNew();
+
+    rioInitWithBuffer(&sdsrdb,sdsempty());
+    rdbSaveLen(&sdsrdb,raxSize(stream_meta->cold_nodes));
+    raxStart(&ri,stream_meta->cold_nodes);
+    raxSeek(&ri,"^",NULL,0);
+    while (raxNext(&ri)) rioWrite(&sdsrdb,ri.key,ri.key_len);
+    raxStop(&ri);
+    rdbSaveStreamMeta(&sdsrdb,header);
+
+    if (empty) freeStream(empty);
+    return sdsrdb.io.buffer.ptr;
+}
+
+/* aux is value of warm key, header in memory is the latest. */
+sds encodeStreamObjectMeta(struct objectMeta *object_meta, void *aux) {
+    robj *value = aux;
+    streamMeta *stream_meta;
+    stream *header = NULL;
+
+    if (object_meta == NULL) return NULL;
+    serverAssert(object_meta->object_type == OBJ_STREAM);
+    stream_meta = objectMetaGetPtr(object_meta);
+    if (value) {
+        header = value->ptr;
+    } else if (stream_meta->header) {
+        header = stream_meta->header->ptr;
+    }
+    return encodeStreamMeta(stream_meta,header);
+}
+
+static streamMeta *decodeStreamMeta(const char *extend, size_t extlen) {
+    rio sdsrdb;
+    uint64_t num;
+    unsigned char rawid[sizeof(streamID)];
+    sds buf = sdsnewlen(extend,extlen);
+    streamMeta *stream_meta = streamMetaCreate();
+
+    rioInitWithBuffer(&sdsrdb,buf);
+    if ((num = rdbLoadLen(&sdsrdb,NULL)) == RDB_LENERR) goto err;
+    while (num--) {
+        if (rioRead(&sdsrdb,rawid,sizeof(rawid)) == 0) goto err;
+        raxInsert(stream_meta->cold_nodes,rawid,sizeof(rawid),NULL,NULL);
+    }
+    stream_meta->header = createStreamObject();
+    if (rdbLoadStreamMeta(&sdsrdb,stream_meta->header->ptr,0) == C_ERR)
+        goto err;
+
+    sdsfree(buf);
+    return stream_meta;
+
+err:
+    sdsfree(buf);
+    streamMetaFree(stream_meta);
+    return NULL;
+}
+
+int decodeStreamObjectMeta(struct objectMeta *object_meta, const char *extend, size_t extlen) {
+    streamMeta *stream_meta;
+    serverAssert(object_meta->object_type == OBJ_STREAM);
+    serverAssert(objectMetaGetPtr(object_meta) == NULL);
+    if ((stream_meta = decodeStreamMeta(extend,extlen)) == NULL) return -1;
+    objectMetaSetPtr(object_meta,stream_meta);
+    return 0;
+}
+
+int streamObjectMetaIsHot(objectMeta *object_meta, robj *value) {
+    serverAssert(value && object_meta && object_meta->object_type == OBJ_STREAM);
+    streamMeta *stream_meta = objectMetaGetPtr(object_meta);
+    return stream_meta == NULL || raxSize(stream_meta->cold_nodes) == 0;
+}
+
+void streamObjectMetaFree(objectMeta *object_meta) {
+    if (object_meta == NULL) return;
+    streamMetaFree(objectMetaGetPtr(object_meta));
+}
+
+void streamObjectMetaDup(struct objectMeta *dup_meta, struct objectMeta *object_meta) {
+    if (object_meta == NULL) return;
+    serverAssert(dup_meta->object_type == OBJ_STREAM);
+    serverAssert(objectMetaGetPtr(dup_meta) == NULL);
+    if (objectMetaGetPtr(object_meta) == NULL) return;
+    objectMetaSetPtr(dup_meta,streamMetaDup(objectMetaGetPtr(object_meta)));
+}
+
+int streamObjectMetaEqual(struct objectMeta *oma, struct objectMeta *omb) {
+    streamMeta *sma = objectMetaGetPtr(oma), *smb = objectMetaGetPtr(omb);
+    raxIterator ria, rib;
+    int equal = 1;
+
+    if (raxSize(sma->cold_nodes) != raxSize(smb->cold_nodes)) return 0;
+
+    raxStart(&ria,sma->cold_nodes);
+    raxStart(&rib,smb->cold_nodes);
+    raxSeek(&ria,"^",NULL,0);
+    raxSeek(&rib,"^",NULL,0);
+    while (raxNext(&ria) && raxNext(&rib)) {
+        if (ria.key_len != rib.key_len ||
+                memcmp(ria.key,rib.key,ria.key_len)) {
+            equal = 0;
+            break;
+        }
+    }
+    raxStop(&ria);
+    raxStop(&rib);
+
+    return equal;
+}
+
+int streamObjectMetaRebuildFeed(struct objectMeta *rebuild_meta,
+        uint64_t version, const char *subkey, size_t sublen) {
+    streamMeta *stream_meta = objectMetaGetPtr(rebuild_meta);
+    UNUSED(version);
+    if (sublen != sizeof(streamID)) return -1;
+    raxInsert(stream_meta->cold_nodes,(unsigned char*)subkey,sublen,NULL,NULL);
+    return 0;
+}
+
+objectMetaType streamObjectMetaType = {
+    .encodeObjectMeta = encodeStreamObjectMeta,
+    .decodeObjectMeta = decodeStreamObjectMeta,
+    .objectIsHot = streamObjectMetaIsHot,
+    .free = streamObjectMetaFree,
+    .duplicate = streamObjectMetaDup,
+    .equal = streamObjectMetaEqual,
+    .rebuildFeed = streamObjectMetaRebuildFeed,
+};
+
+/* Stream swap data */
+static void mockStreamForDeleteIfCold(swapData *data) {
+    if (swapDataIsCold(data)) {
+        /* empty stream allowed */
+        dbAdd(data->db,data->key,createStreamObject());
+    }
+}
+
+static streamMeta *swapDataGetStreamMeta(swapData *data) {
+    objectMeta *object_meta = swapDataObjectMeta(data);
+    return object_meta ? objectMetaGetPtr(object_meta) : NULL;
+}
+
+static void streamDataCtxAppendNode(streamDataCtx *datactx, unsigned char *rawid) {
+    if (datactx->num == datactx->capacity) {
+        datactx->capacity = datactx->capacity ? datactx->capacity*2 : 4;
+        datactx->nodes = zrealloc(datactx->nodes,
+                datactx->capacity*sizeof(streamID));
+    }
+    streamDecodeID(rawid,datactx->nodes+datactx->num);
+    datactx->num++;
+}
+
+/* Select cold nodes that might contain entries in [start,end]: the node
+ * containing start (greatest node with master ID <= start) if it is cold,
+ * and cold nodes with master ID in (start,end]. */
+static void streamSwapAnaInSelectNodes(swapData *data,
+        streamDataCtx *datactx, streamID *start, streamID *end) {
+    unsigned char startkey[sizeof(streamID)], endkey[sizeof(streamID)];
+    streamMeta *stream_meta = swapDataGetStreamMeta(data);
+    raxIterator ri;
+
+    if (streamCompareID(start,end) > 0) return;
+    streamEncodeID(startkey,start);
+    streamEncodeID(endkey,end);
+
+    raxStart(&ri,stream_meta->cold_nodes);
+    raxSeek(&ri,"<=",startkey,sizeof(startkey));
+    if (raxNext(&ri)) {
+        int covered = 0;
+        if (!swapDataIsCold(data)) {
+            stream *s = data->value->ptr;
+            raxIterator hi;
+            raxStart(&hi,s->rax);
+            raxSeek(&hi,"<=",startkey,sizeof(startkey));
+            /* start falls into hot node if it follows the cold one. */
+            if (raxNext(&hi) && memcmp(hi.key,ri.key,sizeof(streamID)) > 0)
+                covered = 1;
+            raxStop(&hi);
+        }
+        if (!covered) streamDataCtxAppendNode(datactx,ri.key);
+    }
+
+    raxSeek(&ri,">",startkey,sizeof(startkey));
+    while (raxNext(&ri)) {
+        if (memcmp(ri.key,endkey,sizeof(endkey)) > 0) break;
+        streamDataCtxAppendNode(datactx,ri.key);
+    }
+    raxStop(&ri);
+}
+
+/* Swap out oldest nodes first, recently appended tail node most likely
+ * to be accessed by XADD/XREAD. */
+static void streamSwapAnaOutSelectNodes(swapData *data,
+        streamDataCtx *datactx) {
+    stream *s = data->value->ptr;
+    unsigned long long evict_memory = 0;
+    raxIterator ri;
+
+    raxStart(&ri,s->rax);
+    raxSeek(&ri,"^",NULL,0);
+    while (raxNext(&ri)) {
+        unsigned char *lp = ri.data;
+        streamDataCtxAppendNode(datactx,ri.key);
+        evict_memory += lpBytes(lp);
+        if (datactx->num >= server.swap_evict_step_max_subkeys ||
+                evict_memory >= server.swap_evict_step_max_memory) {
+            /* Evict big stream in small steps. */
+            break;
+        }
+    }
+    raxStop(&ri);
+}
+
+/* like list, nodes are either in memory or in rocksdb. if a stream is hot,
+ * there are no nodes in rocksdb. */
+int streamSwapAna(swapData *data, int thd, struct keyRequest *req,
+        int *intention, uint32_t *intention_flags, void *datactx_) {
+    streamDataCtx *datactx = datactx_;
+    int cmd_intention = req->cmd_intention;
+    uint32_t cmd_intention_flags = req->cmd_intention_flags;
+    UNUSED(thd);
+
+    switch (cmd_intention) {
+    case SWAP_NOP:
+        *intention = SWAP_NOP;
+        *intention_flags = 0;
+        break;
+    case SWAP_IN:
+        if (!swapDataPersisted(data)) {
+            /* No need to swap for pure hot key */
+            *intention = SWAP_NOP;
+            *intention_flags = 0;
+        } else if (swapDataIsHot(data)) {
+            /* If key is hot, swapAna must be executing in main-thread,
+             * we can safely delete meta and turn hot key into pure hot
+             * key, commands that don't maintain stream meta (XDEL/XTRIM)
+             * then work on it as usual. */
+            dbDeleteMeta(data->db,data->key);
+            *intention = SWAP_NOP;
+            *intention_flags = 0;
+        } else if (req->type == KEYREQUEST_TYPE_STREAM) {
+            /* XRANGE/XREAD/XADD: swap in nodes overlapping id range, header
+             * are swapped in along with nodes if key is cold. */
+            streamSwapAnaInSelectNodes(data,datactx,&req->x.start,&req->x.end);
+            if (datactx->num == 0 && !swapDataIsCold(data)) {
+                *intention = SWAP_NOP;
+                *intention_flags = 0;
+            } else {
+                *intention = SWAP_IN;
+                *intention_flags = SWAP_EXEC_IN_DEL;
+            }
+        } else if (cmd_intention_flags == SWAP_IN_DEL_MOCK_VALUE) {
+            datactx->ctx_flag |= BIG_DATA_CTX_FLAG_MOCK_VALUE;
+            *intention = SWAP_DEL;
+            *intention_flags = SWAP_FIN_DEL_SKIP;
+        } else if (cmd_intention_flags == SWAP_IN_META) {
+            /* XLEN/XACK/XPENDING/XGROUP: header only, which is swapped in
+             * with the meta if key is cold. */
+            if (!swapDataIsCold(data)) {
+                *intention = SWAP_NOP;
+                *intention_flags = 0;
+            } else {
+                *intention = SWAP_IN;
+                *intention_flags = SWAP_EXEC_IN_DEL;
+            }
+        } else {
+            /* XREADGROUP/XINFO/XDEL/XTRIM..., swap in all nodes */
+            datactx->swap_all = 1;
+            *intention = SWAP_IN;
+            *intention_flags = SWAP_EXEC_IN_DEL;
+            if (cmd_intention_flags & SWAP_IN_FORCE_HOT) {
+                *intention_flags |= SWAP_EXEC_FORCE_HOT;
+            }
+        }
+        if (cmd_intention_flags & SWAP_OOM_CHECK) {
+            *intention_flags |= SWAP_EXEC_OOM_CHECK;
+        }
+        break;
+    case SWAP_OUT:
+        if (swapDataIsCold(data)) {
+            *intention = SWAP_NOP;
+            *intention_flags = 0;
+        } else {
+            if (!swapDataPersisted(data)) {
+                /* create new meta if this is a pure hot key */
+                data->new_meta = createStreamObjectMeta(
+                        swapGetAndIncrVersion(),streamMetaCreate());
+            }
+            streamSwapAnaOutSelectNodes(data,datactx);
+            *intention = SWAP_OUT;
+            *intention_flags = 0;
+        }
+        break;
+    case SWAP_DEL:
+        if (!swapDataPersisted(data)) {
+            *intention = SWAP_NOP;
+            *intention_flags = 0;
+        } else if (swapDataIsHot(data)) {
+            /* If key is hot, swapAna must be executing in main-thread,
+             * we can safely delete meta. */
+            dbDeleteMeta(data->db,data->key);
+            *intention = SWAP_NOP;
+            *intention_flags = 0;
+        } else {
+            *intention = SWAP_DEL;
+            *intention_flags = 0;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+int streamSwapAnaAction(swapData *data, int intention, void *datactx_, int *action) {
+    UNUSED(data);
+    streamDataCtx *datactx = datactx_;
+
+    switch (intention) {
+        case SWAP_IN:
+            if (datactx->swap_all) {
+                *action = ROCKS_ITERATE;
+            } else {
+                *action = ROCKS_GET;
+            }
+            break;
+        case SWAP_DEL:
+            *action = ROCKS_NOP;
+            break;
+        case SWAP_OUT:
+            *action = ROCKS_PUT;
+            break;
+        default:
+            /* Should not happen .*/
+            *action = ROCKS_NOP;
+            return SWAP_ERR_DATA_FAIL;
+    }
+
+    return 0;
+}
+
+static inline sds streamEncodeSubkey(redisDb *db, sds key, uint64_t version,
+        unsigned char *rawid) {
+    sds subkey = sdsnewlen(rawid,sizeof(streamID));
+    sds rawkey = rocksEncodeDataKey(db,key,version,subkey);
+    sdsfree(subkey);
+    return rawkey;
+}
+
+/* listpack node saved as rdb string, so that it could be written into rdb
+ * verbatim by rdb save. */
+static inline sds streamEncodeSubval(unsigned char *lp) {
+    rio sdsrdb;
+    rioInitWithBuffer(&sdsrdb,sdsempty());
+    rdbSaveType(&sdsrdb,RDB_TYPE_STRING);
+    rdbSaveRawString(&sdsrdb,lp,lpBytes(lp));
+    return sdsrdb.io.buffer.ptr;
+}
+
+static unsigned char *streamDecodeSubval(sds rawval) {
+    rio sdsrdb;
+    size_t lp_size;
+    unsigned char *lp;
+
+    rioInitWithBuffer(&sdsrdb,rawval);
+    if (rdbLoadObjectType(&sdsrdb) != RDB_TYPE_STRING) return NULL;
+    lp = rdbGenericLoadStringObject(&sdsrdb,RDB_LOAD_PLAIN,&lp_size);
+    if (lp == NULL) return NULL;
+    if (!streamValidateListpackIntegrity(lp,lp_size,0) ||
+            lpFirst(lp) == NULL) {
+        zfree(lp);
+        return NULL;
+    }
+    return lp;
+}
+
+int streamEncodeKeys(swapData *data, int intention, void *datactx_,
+        int *numkeys, int **pcfs, sds **prawkeys) {
+    streamDataCtx *datactx = datactx_;
+    uint64_t version = swapDataObjectVersion(data);
+    unsigned char rawid[sizeof(streamID)];
+    int *cfs, num = datactx->num;
+    sds *rawkeys;
+
+    serverAssert(SWAP_IN == intention);
+
+    if (num == 0) {
+        /* Cold key with no node requested (e.g. XLEN) still needs a swap
+         * to bring in header, get an absent node (0-0 is never a valid
+         * entry id). */
+        streamID placeholder = {0,0};
+        cfs = zmalloc(sizeof(int));
+        rawkeys = zmalloc(sizeof(sds));
+        streamEncodeID(rawid,&placeholder);
+        cfs[0] = DATA_CF;
+        rawkeys[0] = streamEncodeSubkey(data->db,data->key->ptr,version,rawid);
+        num = 1;
+    } else {
+        cfs = zmalloc(sizeof(int)*num);
+        rawkeys = zmalloc(sizeof(sds)*num);
+        for (int i = 0; i < num; i++) {
+            streamEncodeID(rawid,datactx->nodes+i);
+            cfs[i] = DATA_CF;
+            rawkeys[i] = streamEncodeSubkey(data->db,data->key->ptr,
+                    version,rawid);
+        }
+    }
+
+    *numkeys = num;
+    *pcfs = cfs;
+    *prawkeys = rawkeys;
+    return 0;
+}
+
+int streamEncodeData(swapData *data, int intention, void *datactx_,
+        int *numkeys, int **pcfs, sds **prawkeys, sds **prawvals) {
+    streamDataCtx *datactx = datactx_;
+    uint64_t version = swapDataObjectVersion(data);
+    stream *s = data->value->ptr;
+    unsigned char rawid[sizeof(streamID)];
+    int *cfs, num = 0;
+    sds *rawkeys, *rawvals;
+
+    serverAssert(intention == SWAP_OUT);
+    serverAssert(!swapDataIsCold(data));
+
+    cfs = zmalloc(datactx->num*sizeof(int));
+    rawkeys = zmalloc(datactx->num*sizeof(sds));
+    rawvals = zmalloc(datactx->num*sizeof(sds));
+
+    for (int i = 0; i < datactx->num; i++) {
+        unsigned char *lp;
+        streamEncodeID(rawid,datactx->nodes+i);
+        lp = raxFind(s->rax,rawid,sizeof(rawid));
+        if (lp == raxNotFound) continue;
+        cfs[num] = DATA_CF;
+        rawkeys[num] = streamEncodeSubkey(data->db,data->key->ptr,
+                version,rawid);
+        rawvals[num] = streamEncodeSubval(lp);
+        num++;
+    }
+
+    *numkeys = num;
+    *pcfs = cfs;
+    *prawkeys = rawkeys;
+    *prawvals = rawvals;
+    return 0;
+}
+
+int streamEncodeRange(struct swapData *data, int intention, void *datactx_, int *limit,
+        uint32_t *flags, int *pcf, sds *start, sds *end) {
+    streamDataCtx *datactx = datactx_;
+    uint64_t version = swapDataObjectVersion(data);
+    serverAssert(SWAP_IN == intention);
+    serverAssert(datactx->swap_all);
+
+    *flags = 0;
+    *pcf = DATA_CF;
+    *start = rocksEncodeDataRangeStartKey(data->db,data->key->ptr,version);
+    *end = rocksEncodeDataRangeEndKey(data->db,data->key->ptr,version);
+    *limit = ROCKS_ITERATE_NO_LIMIT;
+    return 0;
+}
+
+/* decoded is a stream without header, containing only swapped in nodes. */
+int streamDecodeData(swapData *data, int num, int *cfs, sds *rawkeys,
+        sds *rawvals, void **pdecoded) {
+    robj *decoded = createStreamObject();
+    stream *s = decoded->ptr;
+    uint64_t version = swapDataObjectVersion(data);
+
+    serverAssert(num >= 0);
+    UNUSED(cfs);
+
+    for (int i = 0; i < num; i++) {
+        int dbid;
+        const char *keystr, *subkeystr;
+        size_t klen, slen;
+        uint64_t subkey_version;
+        unsigned char *lp;
+
+        if (rawvals[i] == NULL)
+            continue;
+        if (rocksDecodeDataKey(rawkeys[i],sdslen(rawkeys[i]),
+                &dbid,&keystr,&klen,&subkey_version,&subkeystr,&slen) < 0)
+            goto err;
+        if (!swapDataPersisted(data))
+            continue;
+        if (version != subkey_version)
+            continue;
+        if (slen != sizeof(streamID))
+            goto err;
+        /* node keys are deleted once swapped in (SWAP_EXEC_IN_DEL), skipping
+         * a corrupted node would lose it for good. */
+        if ((lp = streamDecodeSubval(rawvals[i])) == NULL)
+            goto err;
+        if (!raxTryInsert(s->rax,(unsigned char*)subkeystr,slen,lp,NULL))
+            lpFree(lp);
+    }
+
+    *pdecoded = decoded;
+    return 0;
+
+err:
+    decrRefCount(decoded);
+    *pdecoded = NULL;
+    return SWAP_ERR_DATA_DECODE_FAIL;
+}
+
+void *streamCreateOrMergeObject(swapData *data, MOVE void *decoded_, void *datactx) {
+    robj *decoded = decoded_;
+    streamMeta *stream_meta = swapDataGetStreamMeta(data);
+    stream *ds;
+    raxIterator ri;
+    UNUSED(datactx);
+
+    if (decoded == NULL) return NULL;
+    ds = decoded->ptr;
+
+    /* swapped in nodes are no longer cold. */
+    raxStart(&ri,ds->rax);
+    raxSeek(&ri,"^",NULL,0);
+    while (raxNext(&ri)) {
+        raxRemove(stream_meta->cold_nodes,ri.key,ri.key_len,NULL);
+        if (!swapDataIsCold(data)) {
+            stream *s = data->value->ptr;
+            if (!raxTryInsert(s->rax,ri.key,ri.key_len,ri.data,NULL))
+                lpFree(ri.data);
+        }
+    }
+    raxStop(&ri);
+
+    if (swapDataIsCold(data)) {
+        /* decoded moved back to swap framework again (result will later be
+         * pass as swapIn param). */
+        return decoded;
+    } else {
+        /* nodes moved to value, release decoded without them. */
+        raxFree(ds->rax);
+        ds->rax = raxNew();
+        decrRefCount(decoded);
+        return NULL;
+    }
+}
+
+int streamSwapIn(swapData *data, MOVE void *result, void *datactx) {
+    UNUSED(datactx);
+    /* hot key no need to swap in, this must be a warm or cold key. */
+    serverAssert(swapDataPersisted(data));
+    if (swapDataIsCold(data) && result != NULL /* may be empty */) {
+        robj *swapin = result;
+        stream *s = swapin->ptr;
+        streamMeta *stream_meta = swapDataGetStreamMeta(data);
+        serverAssert(data->cold_meta && stream_meta->header);
+        /* header moved from cold meta to value, which keeps it ever
+         * since (until key turns cold again). */
+        stream *header = stream_meta->header->ptr;
+        serverAssert(s->cgroups == NULL);
+        s->length = header->length;
+        s->last_id = header->last_id;
+        s->cgroups = header->cgroups;
+        header->cgroups = NULL;
+        decrRefCount(stream_meta->header);
+        stream_meta->header = NULL;
+        /* mark persistent after data swap in without
+         * persistence deleted, or mark non-persistent else */
+        overwriteObjectPersistent(swapin,!data->persistence_deleted);
+        /* cold key swapped in result (may be empty). */
+        dbAdd(data->db,data->key,swapin);
+        /* expire will be swapped in later by swap framework. */
+        dbAddMeta(data->db,data->key,data->cold_meta);
+        data->cold_meta = NULL; /* moved */
+    } else {
+        if (result) decrRefCount(result);
+        if (data->value) overwriteObjectPersistent(data->value,!data->persistence_deleted);
+    }
+
+    return 0;
+}
+
+int streamCleanObject(swapData *data, void *datactx_, int keep_data) {
+    streamDataCtx *datactx = datactx_;
+    streamMeta *stream_meta;
+    unsigned char rawid[sizeof(streamID)];
+    stream *s;
+    UNUSED(keep_data);
+
+    if (swapDataIsCold(data)) return 0;
+
+    s = data->value->ptr;
+    stream_meta = swapDataGetStreamMeta(data);
+    for (int i = 0; i < datactx->num; i++) {
+        void *lp;
+        streamEncodeID(rawid,datactx->nodes+i);
+        if (raxRemove(s->rax,rawid,sizeof(rawid),&lp)) {
+            lpFree(lp);
+            raxInsert(stream_meta->cold_nodes,rawid,sizeof(rawid),NULL,NULL);
+        }
+    }
+
+    return 0;
+}
+
+/* nodes already cleaned by cleanObject(to save cpu usage of main thread),
+ * swapout only updates db.dict keyspace, meta (db.meta/db.expire) swapped
+ * out by swap framework. */
+int streamSwapOut(swapData *data, void *datactx, int keep_data, int *totally_out) {
+    stream *s;
+    UNUSED(datactx), UNUSED(keep_data);
+    serverAssert(!swapDataIsCold(data));
+
+    s = data->value->ptr;
+    if (raxSize(s->rax) == 0) {
+        /* all nodes swapped out, key turnning into cold:
+         * - rocks-meta (with header) should have already persisted.
+         * - object_meta and value will be deleted by dbDelete, expire already
+         *   deleted by swap framework. */
+        dbDelete(data->db,data->key);
+        /* new_meta exists if hot key turns cold directly, in which case
+         * new_meta not moved to db.meta nor updated but abandonded. */
+        if (data->new_meta) {
+            freeObjectMeta(data->new_meta);
+            data->new_meta = NULL;
+        }
+        if (totally_out) *totally_out = 1;
+    } else { /* not all nodes swapped out. */
+        if (data->new_meta) {
+            dbAddMeta(data->db,data->key,data->new_meta);
+            data->new_meta = NULL; /* moved to db.meta */
+            setObjectPersistent(data->value); /* loss pure hot and persistent data exist. */
+        }
+        if (totally_out) *totally_out = 0;
+    }
+
+    return 0;
+}
+
+int streamSwapDel(swapData *data, void *datactx_, int del_skip) {
+    streamDataCtx *datactx = datactx_;
+    if (datactx->ctx_flag & BIG_DATA_CTX_FLAG_MOCK_VALUE) {
+        mockStreamForDeleteIfCold(data);
+    }
+    if (del_skip) {
+        if (!swapDataIsCold(data))
+            dbDeleteMeta(data->db,data->key);
+        return 0;
+    } else {
+        if (!swapDataIsCold(data))
+            /* both value/object_meta/expire are deleted */
+            dbDelete(data->db,data->key);
+        return 0;
+    }
+}
+
+/* header in memory is encoded into rocks meta, see encodeStreamObjectMeta */
+void *streamGetObjectMetaAux(swapData *data, void *datactx) {
+    UNUSED(datactx);
+    return data->value;
+}
+
+/* Only free extend fields here, base fields (key/value/object_meta) freed
+ * in swapDataFree */
+void freeStreamSwapData(swapData *data, void *datactx_) {
+    streamDataCtx *datactx = datactx_;
+    UNUSED(data);
+    if (datactx->nodes) {
+        zfree(datactx->nodes);
+        datactx->nodes = NULL;
+    }
+    zfree(datactx);
+}
+
+swapDataType streamSwapDataType = {
+    .name = "stream",
+    .cmd_swap_flags = CMD_SWAP_DATATYPE_STREAM,
+    .swapAna = streamSwapAna,
+    .swapAnaAction = streamSwapAnaAction,
+    .encodeKeys = streamEncodeKeys,
+    .encodeData = streamEncodeData,
+    .encodeRange = streamEncodeRange,
+    .decodeData = streamDecodeData,
+    .swapIn = streamSwapIn,
+    .swapOut = streamSwapOut,
+    .swapDel = streamSwapDel,
+    .createOrMergeObject = streamCreateOrMergeObject,
+    .cleanObject = streamCleanObject,
+    .beforeCall = NULL,
+    .free = freeStreamSwapData,
+    .rocksDel = NULL,
+    .mergedIsHot = streamMergedIsHot,
+    .getObjectMetaAux = streamGetObjectMetaAux,
+};
+
+int swapDataSetupStreamType(swapData *d, void **pdatactx) {
+    d->type = &streamSwapDataType;
+    d->omtype = &streamObjectMetaType;
+    streamDataCtx *datactx = zmalloc(sizeof(streamDataCtx));
+    datactx->num = 0;
+    datactx->capacity = 0;
+    datactx->nodes = NULL;
+    datactx->swap_all = 0;
+    datactx->ctx_flag = BIG_DATA_CTX_FLAG_NONE;
+    *pdatactx = datactx;
+    return 0;
+}
+
+/* Stream rdb save: same layout as RDB_TYPE_STREAM_LISTPACKS, hot nodes are
+ * interleaved with cold ones in master ID order, header saved at last. */
+typedef struct streamSaveIter {
+    raxIterator ri;
+    int valid; /* ri points to a hot node not saved yet. */
+} streamSaveIter;
+
+static inline size_t streamSaveNodesCount(rdbKeySaveData *save) {
+    streamMeta *stream_meta = objectMetaGetPtr(save->object_meta);
+    size_t count = raxSize(stream_meta->cold_nodes);
+    if (save->value) count += raxSize(((stream*)save->value->ptr)->rax);
+    return count;
+}
+
+void *streamSaveIterCreate(robj *value) {
+    streamSaveIter *iter = zmalloc(sizeof(streamSaveIter));
+    stream *s = value->ptr;
+    raxStart(&iter->ri,s->rax);
+    raxSeek(&iter->ri,"^",NULL,0);
+    iter->valid = raxNext(&iter->ri);
+    return iter;
+}
+
+void streamSaveIterFree(void *iter_) {
+    streamSaveIter *iter = iter_;
+    raxStop(&iter->ri);
+    zfree(iter);
+}
+
+int streamSaveStart(rdbKeySaveData *save, rio *rdb) {
+    robj *key = save->key;
+
+    /* save header */
+    if (rdbSaveKeyHeader(rdb,key,key,RDB_TYPE_STREAM_LISTPACKS,
+                save->expire) == -1)
+        return -1;
+
+    /* nnodes */
+    if (rdbSaveLen(rdb,streamSaveNodesCount(save)) == -1)
+        return -1;
+
+    return 0;
+}
+
+/* save nodes in memory untill rawid(not included), all if rawid is NULL */
+int streamSaveHotNodesUntill(rdbKeySaveData *save, rio *rdb,
+        const char *rawid) {
+    streamSaveIter *iter = save->iter;
+
+    if (iter == NULL) return 0;
+
+    while (iter->valid) {
+        unsigned char *lp = iter->ri.data;
+        if (rawid && memcmp(iter->ri.key,rawid,sizeof(streamID)) >= 0)
+            break;
+        if (rdbSaveRawString(rdb,iter->ri.key,iter->ri.key_len) == -1 ||
+                rdbSaveRawString(rdb,lp,lpBytes(lp)) == -1)
+            return -1;
+        save->saved++;
+        iter->valid = raxNext(&iter->ri);
+    }
+
+    return 0;
+}
+
+int streamSave(rdbKeySaveData *save, rio *rdb, decodedData *decoded) {
+    robj *key = save->key;
+    streamMeta *stream_meta = objectMetaGetPtr(save->object_meta);
+    serverAssert(!sdscmp(decoded->key, key->ptr));
+
+    if (decoded->rdbtype != RDB_TYPE_STRING ||
+            decoded->subkey == NULL ||
+            sdslen(decoded->subkey) != sizeof(streamID)) {
+        /* check failed, skip this key */
+        return 0;
+    }
+
+    /* skip nodes not indexed by meta. */
+    if (raxFind(stream_meta->cold_nodes,(unsigned char*)decoded->subkey,
+                sizeof(streamID)) == raxNotFound) {
+        return 0;
+    }
+
+    /* save nodes in prior to current saving node in memory */
+    if (streamSaveHotNodesUntill(save,rdb,decoded->subkey) == -1)
+        return -1;
+
+    if (rdbSaveRawString(rdb,(unsigned char*)decoded->subkey,
+                sizeof(streamID)) == -1)
+        return -1;
+
+    if (rdbWriteRaw(rdb,(unsigned char*)decoded->rdbraw,
+                sdslen(decoded->rdbraw)) == -1) {
+        return -1;
+    }
+
+    save->saved++;
+    return 0;
+}
+
+int streamSaveEnd(rdbKeySaveData *save, rio *rdb, int save_result) {
+    streamMeta *stream_meta = objectMetaGetPtr(save->object_meta);
+    long expected = streamSaveNodesCount(save) +
+        server.swap_debug_bgsave_metalen_addition;
+    stream *header;
+
+    if (save_result != -1) {
+        /* save tail hot nodes */
+        if (streamSaveHotNodesUntill(save,rdb,NULL) == -1)
+            save_result = -1;
+    }
+
+    if (save->saved != expected) {
+        sds key  = save->key->ptr;
+        sds repr = sdscatrepr(sdsempty(), key, sdslen(key));
+        serverLog(LL_WARNING,
+                "streamSave %s: saved(%d) != nodes(%ld)",
+                repr, save->saved, expected);
+        sdsfree(repr);
+        return SAVE_ERR_META_LEN_MISMATCH;
+    }
+
+    if (save_result != -1) {
+        /* length, last_id and consumer groups */
+        header = save->value ? save->value->ptr : stream_meta->header->ptr;
+        if (rdbSaveStreamMeta(rdb,header) == -1) return -1;
+    }
+
+    return save_result;
+}
+
+void streamSaveDeinit(rdbKeySaveData *save) {
+    if (save->iter) {
+        streamSaveIterFree(save->iter);
+        save->iter = NULL;
+    }
+}
+
+rdbKeySaveType streamSaveType = {
+    .save_start = streamSaveStart,
+    .save = streamSave,
+    .save_end = streamSaveEnd,
+    .save_deinit = streamSaveDeinit,
+};
+
+int streamSaveInit(rdbKeySaveData *save, uint64_t version, const char *extend, size_t extlen) {
+    int retval = 0;
+    save->type = &streamSaveType;
+    save->omtype = &streamObjectMetaType;
+    if (extend) { /* cold */
+        serverAssert(save->object_meta == NULL && save->value == NULL);
+        retval = buildObjectMeta(OBJ_STREAM,version,extend,extlen,&save->object_meta);
+    } else { /* warm */
+        serverAssert(save->object_meta && save->value);
+        save->iter = streamSaveIterCreate(save->value);
+    }
+    return retval;
+}
+
+/* Stream rdb load */
+void streamLoadStart(struct rdbKeyLoadData *load, rio *rdb, int *cf,
+        sds *rawkey, sds *rawval, int *error) {
+    streamMeta *stream_meta;
+    raxIterator *iter;
+    stream *s;
+    sds extend;
+
+    load->value = rdbLoadObject(load->rdbtype,rdb,load->key,error);
+    if (load->value == NULL) return;
+
+    if (load->value->type != OBJ_STREAM) {
+        serverLog(LL_WARNING,"Load rdb with rdbtype(%d) got (%d)",
+                load->rdbtype, load->value->type);
+        *error = RDB_LOAD_ERR_OTHER;
+        return;
+    }
+
+    /* all nodes loaded into rocksdb as cold nodes, note that stream without
+     * nodes is allowed (e.g. XTRIM to 0 or XGROUP CREATE MKSTREAM). */
+    s = load->value->ptr;
+    stream_meta = streamMetaCreate();
+    iter = zmalloc(sizeof(raxIterator));
+    raxStart(iter,s->rax);
+    raxSeek(iter,"^",NULL,0);
+    while (raxNext(iter))
+        raxInsert(stream_meta->cold_nodes,iter->key,iter->key_len,NULL,NULL);
+    raxSeek(iter,"^",NULL,0);
+    load->iter = iter;
+    load->total_fields = raxSize(s->rax);
+
+    extend = encodeStreamMeta(stream_meta,s);
+    streamMetaFree(stream_meta);
+
+    *cf = META_CF;
+    *rawkey = rocksEncodeMetaKey(load->db,load->key);
+    *rawval = rocksEncodeMetaVal(load->object_type,load->expire,load->version,extend);
+    *error = 0;
+
+    sdsfree(extend);
+}
+
+int streamLoad(struct rdbKeyLoadData *load, rio *rdb, int *cf,
+        sds *rawkey, sds *rawval, int *error) {
+    raxIterator *iter = load->iter;
+    UNUSED(rdb);
+
+    if (iter == NULL || !raxNext(iter)) {
+        /* no nodes, only meta loaded. */
+        *rawkey = NULL;
+        *rawval = NULL;
+        *error = 0;
+        return 0;
+    }
+
+    *cf = DATA_CF;
+    *rawkey = streamEncodeSubkey(load->db,load->key,load->version,iter->key);
+    *rawval = streamEncodeSubval(iter->data);
+    *error = 0;
+
+    load->loaded_fields++;
+    return load->loaded_fields < load->total_fields;
+}
+
+void streamLoadDeinit(struct rdbKeyLoadData *load) {
+    if (load->iter) {
+        raxStop(load->iter);
+        zfree(load->iter);
+        load->iter = NULL;
+    }
+
+    if (load->value) {
+        decrRefCount(load->value);
+        load->value = NULL;
+    }
+}
+
+rdbKeyLoadType streamLoadType = {
+    .load_start = streamLoadStart,
+    .load = streamLoad,
+    .load_end = NULL,
+    .load_deinit = streamLoadDeinit,
+};
+
+void streamLoadInit(rdbKeyLoadData *load) {
+    load->type = &streamLoadType;
+    load->omtype = &streamObjectMetaType;
+    load->object_type = OBJ_STREAM;
+}
+
+#ifdef REDIS_TEST
+
+void initServerConfig(void);
+
+static robj *streamTestCreate(int nentries) {
+    robj *o = createStreamObject();
+    robj *argv[2];
+    argv[0] = createStringObject("f",1);
+    argv[1] = createStringObject("v",1);
+    for (int i = 0; i < nentries; i++) {
+        streamID id = {i+1,0};
+        streamAppendItem(o->ptr,argv,1,NULL,&id);
+    }
+    decrRefCount(argv[0]), decrRefCount(argv[1]);
+    return o;
+}
+
+static void streamTestInsertNode(rax *nodes, uint64_t ms) {
+    unsigned char rawid[sizeof(streamID)];
+    streamID id = {ms,0};
+    streamEncodeID(rawid,&id);
+    raxInsert(nodes,rawid,sizeof(rawid),NULL,NULL);
+}
+
+int swapDataStreamTest(int argc, char *argv[], int accurate) {
+    UNUSED(argc), UNUSED(argv), UNUSED(accurate);
+    int error = 0;
+    redisDb *db;
+    robj *key;
+
+    TEST("stream: init") {
+        initServerConfig();
+        ACLInit();
+        server.hz = 10;
+        initTestRedisServer();
+        db = server.db;
+        /* 6 entries in 3 nodes: 1-0, 3-0, 5-0 */
+        server.stream_node_max_entries = 2;
+        server.swap_evict_step_max_memory = 1*1024*1024;
+        server.swap_evict_step_max_subkeys = 1024;
+        key = createStringObject("mystream",8);
+    }
+
+    TEST("stream: meta encode/decode") {
+        robj *value = streamTestCreate(6);
+        streamMeta *stream_meta = streamMetaCreate(), *decoded;
+        objectMeta *oma, *omb;
+        sds extend;
+
+        streamTestInsertNode(stream_meta->cold_nodes,1);
+        streamTestInsertNode(stream_meta->cold_nodes,3);
+        extend = encodeStreamMeta(stream_meta,value->ptr);
+        decoded = decodeStreamMeta(extend,sdslen(extend));
+        test_assert(decoded != NULL);
+        test_assert(raxSize(decoded->cold_nodes) == 2);
+        test_assert(((stream*)decoded->header->ptr)->length == 6);
+        test_assert(((stream*)decoded->header->ptr)->last_id.ms == 6);
+        test_assert(raxSize(((stream*)decoded->header->ptr)->rax) == 0);
+        test_assert(decodeStreamMeta(extend,sdslen(extend)-1) == NULL);
+
+        oma = createStreamObjectMeta(0,stream_meta);
+        omb = createStreamObjectMeta(0,decoded);
+        test_assert(streamObjectMetaEqual(oma,omb));
+        streamTestInsertNode(decoded->cold_nodes,5);
+        test_assert(!streamObjectMetaEqual(oma,omb));
+
+        freeObjectMeta(oma), freeObjectMeta(omb);
+        decrRefCount(value);
+        sdsfree(extend);
+    }
+
+    TEST("stream: swap out & in") {
+        int intention, numkeys, *cfs, totally_out, action;
+        uint32_t intention_flags;
+        sds *rawkeys, *rawvals;
+        keyRequest kr[1];
+        robj *value = streamTestCreate(6), *decoded;
+        stream *s = value->ptr;
+        streamMeta *stream_meta;
+        swapData *data;
+        streamDataCtx *datactx;
+
+        dbAdd(db,key,value);
+
+        /* out: oldest 2 nodes evicted */
+        server.swap_evict_step_max_subkeys = 2;
+        data = createSwapData(db,key,value,NULL);
+        swapDataSetupMeta(data,OBJ_STREAM,-1,(void**)&datactx);
+        kr->level = REQUEST_LEVEL_KEY, kr->dbid = 0, kr->key = key;
+        kr->cmd_flags = CMD_SWAP_DATATYPE_STREAM, kr->type = KEYREQUEST_TYPE_KEY;
+        kr->cmd_intention = SWAP_OUT, kr->cmd_intention_flags = 0;
+        swapDataAna(data,0,kr,&intention,&intention_flags,datactx);
+        test_assert(intention == SWAP_OUT && datactx->num == 2);
+        test_assert(datactx->nodes[0].ms == 1 && datactx->nodes[1].ms == 3);
+        streamSwapAnaAction(data,intention,datactx,&action);
+        test_assert(action == ROCKS_PUT);
+        streamEncodeData(data,intention,datactx,&numkeys,&cfs,&rawkeys,&rawvals);
+        test_assert(numkeys == 2 && cfs[0] == DATA_CF);
+        streamCleanObject(data,datactx,0);
+        test_assert(raxSize(s->rax) == 1);
+        streamSwapOut(data,datactx,0,&totally_out);
+        test_assert(!totally_out && lookupMeta(db,key) != NULL);
+        stream_meta = objectMetaGetPtr(lookupMeta(db,key));
+        test_assert(raxSize(stream_meta->cold_nodes) == 2);
+        test_assert(s->length == 6);
+        swapDataFree(data,datactx);
+        server.swap_evict_step_max_subkeys = 1024;
+
+        /* in: tail is hot, XADD no need to swap */
+        data = createSwapData(db,key,value,NULL);
+        swapDataSetupMeta(data,OBJ_STREAM,-1,(void**)&datactx);
+        swapDataSetObjectMeta(data,lookupMeta(db,key));
+        kr->cmd_intention = SWAP_IN, kr->cmd_intention_flags = 0;
+        kr->type = KEYREQUEST_TYPE_STREAM;
+        kr->x.start.ms = UINT64_MAX, kr->x.start.seq = UINT64_MAX;
+        kr->x.end = kr->x.start;
+        swapDataAna(data,0,kr,&intention,&intention_flags,datactx);
+        test_assert(intention == SWAP_NOP);
+
+        /* in: XRANGE 2 4 overlaps with node 1-0 and 3-0 */
+        kr->x.start.ms = 2, kr->x.start.seq = 0;
+        kr->x.end.ms = 4, kr->x.end.seq = 0;
+        swapDataAna(data,0,kr,&intention,&intention_flags,datactx);
+        test_assert(intention == SWAP_IN && intention_flags == SWAP_EXEC_IN_DEL);
+        test_assert(datactx->num == 2);
+        streamSwapAnaAction(data,intention,datactx,&action);
+        test_assert(action == ROCKS_GET);
+
+        /* in: XRANGE 5 + all in memory */
+        datactx->num = 0;
+        kr->x.start.ms = 5, kr->x.end.ms = UINT64_MAX;
+        swapDataAna(data,0,kr,&intention,&intention_flags,datactx);
+        test_assert(intention == SWAP_NOP && datactx->num == 0);
+
+        /* corrupted node fails decode instead of being skipped. */
+        sds rawval = rawvals[0];
+        rawvals[0] = sdsnew("corrupted");
+        test_assert(streamDecodeData(data,numkeys,cfs,rawkeys,rawvals,
+                    (void**)&decoded) == SWAP_ERR_DATA_DECODE_FAIL);
+        test_assert(decoded == NULL);
+        sdsfree(rawvals[0]);
+        rawvals[0] = rawval;
+
+        streamDecodeData(data,numkeys,cfs,rawkeys,rawvals,(void**)&decoded);
+        test_assert(raxSize(((stream*)decoded->ptr)->rax) == 2);
+        test_assert(streamCreateOrMergeObject(data,decoded,datactx) == NULL);
+        test_assert(raxSize(s->rax) == 3);
+        test_assert(raxSize(stream_meta->cold_nodes) == 0);
+        test_assert(streamMergedIsHot(data,NULL,datactx));
+        swapDataFree(data,datactx);
+
+        for (int i = 0; i < numkeys; i++) {
+            sdsfree(rawkeys[i]), sdsfree(rawvals[i]);
+        }
+        zfree(cfs), zfree(rawkeys), zfree(rawvals);
+        dbDelete(db,key);
+    }
+
+    TEST("stream: rdb save & load") {
+        int err, cont, cf;
+        uint64_t V = 1;
+        robj *hot = streamTestCreate(6), *warm = streamTestCreate(6);
+        stream *s = warm->ptr;
+        streamMeta *stream_meta = streamMetaCreate();
+        objectMeta *object_meta;
+        sds rawval, metakey, metaval, subkey, subraw, extend, rdbraw[2],
+            hotraw, warmraw, coldraw;
+        rio sdsrdb, rdbhot, rdbwarm, rdbcold;
+        rdbKeyLoadData _load, *load = &_load;
+        rdbKeySaveData _save, *save = &_save;
+        decodedMeta _dm, *dm = &_dm;
+        decodedData _dd, *dd = &_dd;
+        unsigned char rawid[2][sizeof(streamID)];
+
+        /* load: meta and 3 nodes */
+        rawval = rocksEncodeValRdb(hot);
+        rioInitWithBuffer(&sdsrdb,sdsnewlen(rawval+1,sdslen(rawval)-1));
+        rdbKeyLoadDataInit(load,rawval[0],db,key->ptr,-1,1662552125000);
+        streamLoadStart(load,&sdsrdb,&cf,&metakey,&metaval,&err);
+        test_assert(cf == META_CF && err == 0);
+        sdsfree(metakey), sdsfree(metaval);
+        for (int i = 0; i < 3; i++) {
+            cont = streamLoad(load,&sdsrdb,&cf,&subkey,&subraw,&err);
+            test_assert(cf == DATA_CF && err == 0 && cont == (i < 2));
+            sdsfree(subkey), sdsfree(subraw);
+        }
+        test_assert(load->loaded_fields == 3);
+        rdbKeyLoadDataDeinit(load);
+        sdsfree(sdsrdb.io.buffer.ptr), sdsfree(rawval);
+
+        /* warm: node 1-0 and 3-0 in rocksdb */
+        for (int i = 0; i < 2; i++) {
+            streamID id = {i*2+1,0};
+            void *lp;
+            streamEncodeID(rawid[i],&id);
+            raxRemove(s->rax,rawid[i],sizeof(streamID),&lp);
+            subraw = streamEncodeSubval(lp);
+            rdbraw[i] = sdsnewlen(subraw+1,sdslen(subraw)-1);
+            sdsfree(subraw), lpFree(lp);
+            raxInsert(stream_meta->cold_nodes,rawid[i],sizeof(streamID),NULL,NULL);
+        }
+        extend = encodeStreamMeta(stream_meta,s);
+        object_meta = createStreamObjectMeta(V,stream_meta);
+        dbAdd(db,key,warm);
+        dbAddMeta(db,key,object_meta);
+
+        dm->cf = META_CF, dm->dbid = db->id, dm->key = key->ptr;
+        dm->version = V, dm->object_type = OBJ_STREAM, dm->expire = -1;
+        dm->extend = extend;
+        dd->cf = DATA_CF, dd->dbid = db->id, dd->key = key->ptr;
+        dd->version = V, dd->rdbtype = RDB_TYPE_STRING;
+
+        rioInitWithBuffer(&rdbwarm,sdsempty());
+        test_assert(!rdbKeySaveDataInit(save,db,(decodedResult*)dm));
+        test_assert(rdbKeySaveStart(save,&rdbwarm) == 0);
+        for (int i = 0; i < 2; i++) {
+            dd->subkey = sdsnewlen(rawid[i],sizeof(streamID));
+            dd->rdbraw = rdbraw[i];
+            test_assert(rdbKeySave(save,&rdbwarm,dd) == 0);
+            sdsfree(dd->subkey);
+        }
+        test_assert(rdbKeySaveEnd(save,&rdbwarm,0) == 0);
+        rdbKeySaveDataDeinit(save);
+        warmraw = rdbwarm.io.buffer.ptr;
+        dbDelete(db,key);
+
+        /* cold: all nodes in rocksdb */
+        rioInitWithBuffer(&rdbcold,sdsempty());
+        test_assert(!rdbKeySaveDataInit(save,db,(decodedResult*)dm));
+        test_assert(rdbKeySaveStart(save,&rdbcold) == 0);
+        /* node 3-0 missing in rocksdb */
+        dd->subkey = sdsnewlen(rawid[0],sizeof(streamID));
+        dd->rdbraw = rdbraw[0];
+        test_assert(rdbKeySave(save,&rdbcold,dd) == 0);
+        sdsfree(dd->subkey);
+        test_assert(rdbKeySaveEnd(save,&rdbcold,0) == SAVE_ERR_META_LEN_MISMATCH);
+        rdbKeySaveDataDeinit(save);
+        coldraw = rdbcold.io.buffer.ptr;
+
+        /* hot */
+        rioInitWithBuffer(&rdbhot,sdsempty());
+        test_assert(rdbSaveKeyValuePair(&rdbhot,key,hot,-1) != -1);
+        hotraw = rdbhot.io.buffer.ptr;
+        test_assert(!sdscmp(hotraw,warmraw));
+
+        sdsfree(hotraw), sdsfree(warmraw), sdsfree(coldraw);
+        sdsfree(rdbraw[0]), sdsfree(rdbraw[1]), sdsfree(extend);
+        decrRefCount(hot);
+    }
+
+    TEST("stream: deinit") {
+        decrRefCount(key);
+    }
+
+    return error;
+}
+
+#endif
@@ -30,23 +30,212 @@
 #include "server.h"
 
 /* ------------------- whole key object meta ----------------------------- */
+/* Only chunked string has object meta (string length), object meta of
+ * plain whole key string is NULL. */
+sds encodeWholeKeyObjectMeta(struct objectMeta *object_meta, void *aux) {
+    UNUSED(aux);
+    if (object_meta == NULL) return NULL;
+    return rocksEncodeObjectMetaLen(object_meta->len);
+}
+
+int decodeWholeKeyObjectMeta(struct objectMeta *object_meta, const char *extend, size_t extlen) {
+    long len = rocksDecodeObjectMetaLen(extend,extlen);
+    if (len <= 0) return -1;
+    object_meta->len = len;
+    return 0;
+}
+
 int wholeKeyIsHot(objectMeta *om, robj *value) {
     UNUSED(om);
     return value != NULL;
 }
 
+static inline int wholeKeyObjectMetaEqual(struct objectMeta *oma, struct objectMeta *omb) {
+    return stringChunkCount(oma->len) == stringChunkCount(omb->len);
+}
+
+/* Rebuilt len is rounded up to chunk size, chunks must be contiguous. */
+static inline int wholeKeyObjectMetaRebuildFeed(struct objectMeta *rebuild_meta,
+        uint64_t version, const char *subkey, size_t sublen) {
+    uint64_t idx;
+    UNUSED(version);
+    if (subkey == NULL || sublen != sizeof(idx)) return -1;
+    memcpy(&idx,subkey,sizeof(idx));
+    if (ntohu64(idx) != (uint64_t)stringChunkCount(rebuild_meta->len)) return -1;
+    rebuild_meta->len += SWAP_STRING_CHUNK_SIZE;
+    return 0;
+}
+
 objectMetaType wholekeyObjectMetaType = {
-    .encodeObjectMeta = NULL,
-    .decodeObjectMeta = NULL,
+    .encodeObjectMeta = encodeWholeKeyObjectMeta,
+    .decodeObjectMeta = decodeWholeKeyObjectMeta,
     .objectIsHot = wholeKeyIsHot,
+    .free = NULL,
+    .duplicate = NULL,
+    .equal = wholeKeyObjectMetaEqual,
+    .rebuildFeed = wholeKeyObjectMetaRebuildFeed,
 };
 
+/* ------------------- string chunk ----------------------------- */
+static inline sds stringEncodeChunkSubkey(long long idx) {
+    uint64_t be = htonu64((uint64_t)idx);
+    return sdsnewlen(&be,sizeof(be));
+}
+
+static inline sds stringEncodeChunkKey(swapData *data, uint64_t version,
+        long long idx) {
+    sds subkey = stringEncodeChunkSubkey(idx);
+    sds rawkey = rocksEncodeDataKey(data->db,data->key->ptr,version,subkey);
+    sdsfree(subkey);
+    return rawkey;
+}
+
+static inline long long stringDecodeChunkIdx(const char *subkey, size_t sublen) {
+    uint64_t idx;
+    if (subkey == NULL || sublen != sizeof(idx)) return -1;
+    memcpy(&idx,subkey,sizeof(idx));
+    return (long long)ntohu64(idx);
+}
+
+static sds stringEncodeChunkVal(const char *buf, size_t len) {
+    rio sdsrdb;
+    rioInitWithBuffer(&sdsrdb,sdsempty());
+    rdbSaveType(&sdsrdb,RDB_TYPE_STRING);
+    rdbSaveRawString(&sdsrdb,(unsigned char*)buf,len);
+    return sdsrdb.io.buffer.ptr;
+}
+
+/* rdbraw: chunk value without leading rdbtype. */
+static sds stringDecodeChunkRdbraw(sds rdbraw) {
+    rio sdsrdb;
+    rioInitWithBuffer(&sdsrdb,rdbraw);
+    return rdbGenericLoadStringObject(&sdsrdb,RDB_LOAD_SDS,NULL);
+}
+
+static sds stringDecodeChunkVal(sds rawval) {
+    rio sdsrdb;
+    if (rawval == NULL || sdslen(rawval) == 0) return NULL;
+    rioInitWithBuffer(&sdsrdb,rawval);
+    if (rdbLoadType(&sdsrdb) != RDB_TYPE_STRING) return NULL;
+    return rdbGenericLoadStringObject(&sdsrdb,RDB_LOAD_SDS,NULL);
+}
+
+static inline size_t stringChunkLen(long long len, long long idx) {
+    long long remaining = len - idx*SWAP_STRING_CHUNK_SIZE;
+    return remaining > SWAP_STRING_CHUNK_SIZE ? SWAP_STRING_CHUNK_SIZE : remaining;
+}
+
+/* Chunks decoded from rocksdb, vals[i] is NULL if chunk idxs[i] not found. */
+typedef struct stringChunks {
+    int num;
+    long long *idxs;
+    sds *vals;
+} stringChunks;
+
+static void stringChunksFree(stringChunks *chunks) {
+    if (chunks == NULL) return;
+    for (int i = 0; i < chunks->num; i++) {
+        if (chunks->vals[i]) sdsfree(chunks->vals[i]);
+    }
+    zfree(chunks->idxs);
+    zfree(chunks->vals);
+    zfree(chunks);
+}
+
+/* SETRANGE/APPEND only reads the first and the last existing chunk touched,
+ * chunks in between are overwritten entirely. */
+static int stringPartialWriteReadIdxs(long long len, wholeKeyDataCtx *datactx,
+        long long idxs[2]) {
+    int num = 0;
+    long long first = MIN(datactx->start,len)/SWAP_STRING_CHUNK_SIZE;
+    long long last = MIN(datactx->end,len-1)/SWAP_STRING_CHUNK_SIZE;
+    if (first*SWAP_STRING_CHUNK_SIZE < len) idxs[num++] = first;
+    if (last > first) idxs[num++] = last;
+    return num;
+}
+
 /* ------------------- whole key swap data ----------------------------- */
+static inline int wholeKeyIsChunked(swapData *data) {
+    return swapDataObjectMeta(data) != NULL;
+}
+
+/* Returns 1 if command could be served by chunks of cold string, in which
+ * case only chunks touched are read (or written) and string stays cold. */
+static int wholeKeySwapAnaPartial(swapData *data, struct keyRequest *req,
+        wholeKeyDataCtx *datactx, int *intention) {
+    long long len = swapDataObjectMeta(data)->len;
+
+    if (req->type == KEYREQUEST_TYPE_RANGE) {
+        long long start, end;
+        if (req->l.num_ranges != 1) return 0;
+        start = req->l.ranges[0].start;
+        end = req->l.ranges[0].end;
+        datactx->partial = STRING_PARTIAL_GETRANGE;
+        /* Convert negative indexes, same as getrangeCommand. */
+        if (start < 0 && end < 0 && start > end) {
+            datactx->range = sdsempty();
+            *intention = SWAP_NOP;
+            return 1;
+        }
+        if (start < 0) start = len+start;
+        if (end < 0) end = len+end;
+        if (start < 0) start = 0;
+        if (end < 0) end = 0;
+        if (end >= len) end = len-1;
+        if (start > end) {
+            datactx->range = sdsempty();
+            *intention = SWAP_NOP;
+            return 1;
+        }
+        datactx->start = start;
+        datactx->end = end;
+        *intention = SWAP_IN;
+    } else if (req->type == KEYREQUEST_TYPE_SUBKEY &&
+            (req->b.num_subkeys == 1 || req->b.num_subkeys == 2)) {
+        /* SETRANGE: [offset value], APPEND: [value] */
+        long long offset = len;
+        robj *value = req->b.subkeys[req->b.num_subkeys-1];
+        size_t vlen;
+
+        if (req->b.num_subkeys == 2 &&
+                (getLongLongFromObject(req->b.subkeys[0],&offset) != C_OK ||
+                 offset < 0)) {
+            return 0;
+        }
+        if (!sdsEncodedObject(value)) return 0;
+        vlen = sdslen(value->ptr);
+        /* let command reply error after string swapped in */
+        if (offset+(long long)vlen > server.proto_max_bulk_len) return 0;
+
+        if (vlen == 0) {
+            datactx->partial = STRING_PARTIAL_STRLEN;
+            datactx->strlen = len;
+            *intention = SWAP_NOP;
+            return 1;
+        }
+        datactx->partial = STRING_PARTIAL_SETRANGE;
+        datactx->start = offset;
+        datactx->end = offset+vlen-1;
+        datactx->strlen = MAX(len,datactx->end+1);
+        incrRefCount(value);
+        datactx->value = value;
+        *intention = SWAP_IN;
+    } else if (req->type == KEYREQUEST_TYPE_KEY) {
+        datactx->partial = STRING_PARTIAL_STRLEN;
+        datactx->strlen = len;
+        *intention = SWAP_NOP;
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
 int wholeKeySwapAna(swapData *data, int thd, struct keyRequest *req,
-        int *intention, uint32_t *intention_flags, void *datactx) {
+        int *intention, uint32_t *intention_flags, void *datactx_) {
+    wholeKeyDataCtx *datactx = datactx_;
     int cmd_intention = req->cmd_intention;
     uint32_t cmd_intention_flags = req->cmd_intention_flags;
-    UNUSED(datactx);
 
     switch(cmd_intention) {
     case SWAP_NOP:
@@ -61,6 +250,10 @@ int wholeKeySwapAna(swapData *data, int thd, struct keyRequest *req,
                 *intention_flags = SWAP_EXEC_IN_DEL;
             } else {
                 *intention_flags = 0;
+                if ((cmd_intention_flags & SWAP_IN_PARTIAL) && datactx &&
+                        wholeKeyIsChunked(data)) {
+                    wholeKeySwapAnaPartial(data,req,datactx,intention);
+                }
             }
         } else if (data->value) {
             if ((cmd_intention_flags & SWAP_IN_DEL) ||
@@ -83,6 +276,15 @@ int wholeKeySwapAna(swapData *data, int thd, struct keyRequest *req,
             int keep_data = swapDataPersistKeepData(data,cmd_intention_flags,1);
 
             if (objectIsDirty(data->value)) {
+                size_t len = stringObjectLen(data->value);
+                /* Big string persisted as chunks of a new version, chunks
+                 * of previous version are left to compaction filter. */
+                if (server.swap_string_chunk_threshold > 0 &&
+                        len >= server.swap_string_chunk_threshold &&
+                        data->new_meta == NULL) {
+                    swapDataSetNewObjectMeta(data,
+                            createStringObjectMeta(swapGetAndIncrVersion(),len));
+                }
                 *intention = SWAP_OUT;
                 *intention_flags = keep_data ? SWAP_EXEC_OUT_KEEP_DATA : 0;
             } else {
@@ -109,11 +311,18 @@ int wholeKeySwapAna(swapData *data, int thd, struct keyRequest *req,
     return 0;
 }
 
+static inline int wholeKeyIsPartial(void *datactx_) {
+    wholeKeyDataCtx *datactx = datactx_;
+    return datactx && datactx->partial != STRING_PARTIAL_NONE;
+}
+
 int wholeKeySwapAnaAction(swapData *data, int intention, void *datactx_, int *action) {
-    UNUSED(data), UNUSED(datactx_);
     switch (intention) {
         case SWAP_IN:
-            *action = ROCKS_GET;
+            if (!wholeKeyIsPartial(datactx_) && wholeKeyIsChunked(data))
+                *action = ROCKS_ITERATE;
+            else
+                *action = ROCKS_GET;
             break;
         case SWAP_DEL:
             *action = ROCKS_DEL;
@@ -128,13 +337,49 @@ int wholeKeySwapAnaAction(swapData *data, int intention, void *datactx_, int *ac
     return 0;
 }
 
+static int wholeKeyEncodeChunkKeys(swapData *data, wholeKeyDataCtx *datactx,
+        int *numkeys, int **pcfs, sds **prawkeys) {
+    objectMeta *object_meta = swapDataObjectMeta(data);
+    long long idxs[2], first, last;
+    int num;
+    sds *rawkeys;
+    int *cfs;
+
+    if (datactx->partial == STRING_PARTIAL_GETRANGE) {
+        first = datactx->start/SWAP_STRING_CHUNK_SIZE;
+        last = datactx->end/SWAP_STRING_CHUNK_SIZE;
+        num = last-first+1;
+        rawkeys = zmalloc(sizeof(sds)*num);
+        cfs = zmalloc(sizeof(int)*num);
+        for (int i = 0; i < num; i++) {
+            cfs[i] = DATA_CF;
+            rawkeys[i] = stringEncodeChunkKey(data,object_meta->version,first+i);
+        }
+    } else {
+        serverAssert(datactx->partial == STRING_PARTIAL_SETRANGE);
+        num = stringPartialWriteReadIdxs(object_meta->len,datactx,idxs);
+        rawkeys = num ? zmalloc(sizeof(sds)*num) : NULL;
+        cfs = num ? zmalloc(sizeof(int)*num) : NULL;
+        for (int i = 0; i < num; i++) {
+            cfs[i] = DATA_CF;
+            rawkeys[i] = stringEncodeChunkKey(data,object_meta->version,idxs[i]);
+        }
+    }
+
+    *numkeys = num;
+    *prawkeys = rawkeys;
+    *pcfs = cfs;
+    return 0;
+}
+
 int wholeKeyEncodeKeys(swapData *data, int intention, void *datactx,
         int *numkeys, int **pcfs, sds **prawkeys) {
+    serverAssert(intention == SWAP_IN || intention == SWAP_DEL);
+    if (intention == SWAP_IN && wholeKeyIsPartial(datactx))
+        return wholeKeyEncodeChunkKeys(data,datactx,numkeys,pcfs,prawkeys);
+
     sds *rawkeys = zmalloc(sizeof(sds));
     int *cfs = zmalloc(sizeof(int));
-
-    UNUSED(datactx);
-    serverAssert(intention == SWAP_IN || intention == SWAP_DEL);
     rawkeys[0] = rocksEncodeDataKey(data->db,data->key->ptr,SWAP_VERSION_ZERO,NULL);
     cfs[0] = DATA_CF;
     *numkeys = 1;
@@ -144,6 +389,19 @@ int wholeKeyEncodeKeys(swapData *data, int intention, void *datactx,
     return 0;
 }
 
+int wholeKeyEncodeRange(struct swapData *data, int intention, void *datactx,
+        int *limit, uint32_t *flags, int *pcf, sds *start, sds *end) {
+    UNUSED(intention), UNUSED(datactx);
+    uint64_t version = swapDataObjectVersion(data);
+
+    *pcf = DATA_CF;
+    *flags = 0;
+    *start = rocksEncodeDataRangeStartKey(data->db,data->key->ptr,version);
+    *end = rocksEncodeDataRangeEndKey(data->db,data->key->ptr,version);
+    *limit = ROCKS_ITERATE_NO_LIMIT;
+    return 0;
+}
+
 static sds wholeKeyEncodeDataKey(swapData *data) {
     return data->key ? rocksEncodeDataKey(data->db,data->key->ptr,SWAP_VERSION_ZERO,NULL) : NULL;
 }
@@ -152,10 +410,44 @@ static sds wholeKeyEncodeDataVal(swapData *data) {
     return data->value ? rocksEncodeValRdb(data->value) : NULL;
 }
 
+/* Chunks of new version, whole key (if any) overwritten as empty so that
+ * it won't be mistaken as string value (filtered by compaction later). */
+static int wholeKeyEncodeChunkData(swapData *data, int *numkeys, int **pcfs,
+        sds **prawkeys, sds **prawvals) {
+    objectMeta *object_meta = swapDataObjectMeta(data);
+    long long len = object_meta->len, nchunks = stringChunkCount(len);
+    int num = nchunks+1;
+    int *cfs = zmalloc(num*sizeof(int));
+    sds *rawkeys = zmalloc(num*sizeof(sds));
+    sds *rawvals = zmalloc(num*sizeof(sds));
+    robj *decoded = getDecodedObject(data->value);
+
+    serverAssert((long long)sdslen(decoded->ptr) == len);
+    for (long long i = 0; i < nchunks; i++) {
+        cfs[i] = DATA_CF;
+        rawkeys[i] = stringEncodeChunkKey(data,object_meta->version,i);
+        rawvals[i] = stringEncodeChunkVal((char*)decoded->ptr+i*SWAP_STRING_CHUNK_SIZE,
+                stringChunkLen(len,i));
+    }
+    cfs[nchunks] = DATA_CF;
+    rawkeys[nchunks] = wholeKeyEncodeDataKey(data);
+    rawvals[nchunks] = sdsempty();
+    decrRefCount(decoded);
+
+    *numkeys = num;
+    *prawkeys = rawkeys;
+    *prawvals = rawvals;
+    *pcfs = cfs;
+    return 0;
+}
+
 int wholeKeyEncodeData(swapData *data, int intention, void *datactx,
         int *numkeys, int **pcfs, sds **prawkeys, sds **prawvals) {
     UNUSED(datactx);
     serverAssert(intention == SWAP_OUT);
+    if (wholeKeyIsChunked(data))
+        return wholeKeyEncodeChunkData(data,numkeys,pcfs,prawkeys,prawvals);
+
     sds *rawkeys = zmalloc(sizeof(sds));
     sds *rawvals = zmalloc(sizeof(sds));
     int *cfs = zmalloc(sizeof(int));
@@ -169,11 +461,55 @@ int wholeKeyEncodeData(swapData *data, int intention, void *datactx,
     return 0;
 }
 
+static int wholeKeyDecodeChunks(swapData *data, int num, int *cfs,
+        sds *rawkeys, sds *rawvals, void **pdecoded) {
+    uint64_t version = swapDataObjectVersion(data);
+    stringChunks *chunks = zmalloc(sizeof(stringChunks));
+
+    chunks->num = 0;
+    chunks->idxs = zmalloc(sizeof(long long)*(num > 0 ? num : 1));
+    chunks->vals = zmalloc(sizeof(sds)*(num > 0 ? num : 1));
+
+    for (int i = 0; i < num; i++) {
+        int dbid;
+        const char *keystr, *subkeystr;
+        size_t klen, slen;
+        uint64_t subkey_version;
+        long long idx;
+
+        if (cfs[i] != DATA_CF) continue;
+        if (rocksDecodeDataKey(rawkeys[i],sdslen(rawkeys[i]),
+                    &dbid,&keystr,&klen,&subkey_version,&subkeystr,&slen) < 0) {
+            goto err;
+        }
+        if (subkey_version != version) continue;
+        if ((idx = stringDecodeChunkIdx(subkeystr,slen)) < 0) goto err;
+
+        chunks->idxs[chunks->num] = idx;
+        if (rawvals[i] == NULL) {
+            chunks->vals[chunks->num] = NULL;
+        } else if ((chunks->vals[chunks->num] = stringDecodeChunkVal(rawvals[i])) == NULL) {
+            goto err;
+        }
+        chunks->num++;
+    }
+
+    *pdecoded = chunks;
+    return 0;
+
+err:
+    stringChunksFree(chunks);
+    *pdecoded = NULL;
+    return SWAP_ERR_DATA_DECODE_FAIL;
+}
+
 /* decoded move to exec module */
 int wholeKeyDecodeData(swapData *data, int num, int *cfs, sds *rawkeys,
         sds *rawvals, void **pdecoded) {
+    if (wholeKeyIsChunked(data))
+        return wholeKeyDecodeChunks(data,num,cfs,rawkeys,rawvals,pdecoded);
+
     serverAssert(num == 1);
-    UNUSED(data);
     UNUSED(rawkeys);
     UNUSED(cfs);
     sds rawval = rawvals[0];
@@ -207,9 +543,13 @@ static robj *createSwapInObject(MOVE robj *newval) {
     return swapin;
 }
 
-int wholeKeySwapIn(swapData *data, MOVE void *result, void *datactx) {
-    UNUSED(datactx);
+int wholeKeySwapIn(swapData *data, MOVE void *result, void *datactx_) {
+    wholeKeyDataCtx *datactx = datactx_;
     robj *swapin;
+    /* partial swap in: string stays cold. */
+    if (wholeKeyIsPartial(datactx)) return datactx->errcode;
+    /* chunks corrupted */
+    if (result == NULL) return SWAP_ERR_DATA_DECODE_FAIL;
     serverAssert(data->value == NULL);
     swapin = createSwapInObject(result);
     /* mark persistent after data swap in without
@@ -243,14 +583,162 @@ int wholeKeySwapDel(swapData *data, void *datactx, int async) {
     return 0;
 }
 
+/* Concat all chunks, returns NULL if any chunk missing. */
+static robj *stringChunksCreateObject(stringChunks *chunks, long long len) {
+    sds buf;
+    if (chunks->num != stringChunkCount(len)) return NULL;
+    buf = sdsnewlen(SDS_NOINIT,len);
+    for (int i = 0; i < chunks->num; i++) {
+        sds val = chunks->vals[i];
+        if (chunks->idxs[i] != i || val == NULL ||
+                sdslen(val) != stringChunkLen(len,i)) {
+            sdsfree(buf);
+            return NULL;
+        }
+        memcpy(buf+i*SWAP_STRING_CHUNK_SIZE,val,sdslen(val));
+    }
+    return createObject(OBJ_STRING,buf);
+}
+
+/* Copy bytes in range of string from chunks, returns NULL if any chunk
+ * missing. */
+static sds stringChunksGetRange(stringChunks *chunks, long long len,
+        long long start, long long end) {
+    long long first = start/SWAP_STRING_CHUNK_SIZE;
+    sds range = sdsnewlen(SDS_NOINIT,end-start+1);
+
+    if (chunks->num != end/SWAP_STRING_CHUNK_SIZE-first+1) goto err;
+    for (int i = 0; i < chunks->num; i++) {
+        long long idx = chunks->idxs[i], from, to;
+        sds val = chunks->vals[i];
+        if (idx != first+i || val == NULL ||
+                sdslen(val) != stringChunkLen(len,idx)) goto err;
+        from = MAX(start,idx*SWAP_STRING_CHUNK_SIZE);
+        to = MIN(end,idx*SWAP_STRING_CHUNK_SIZE+(long long)sdslen(val)-1);
+        memcpy(range+from-start,val+from-idx*SWAP_STRING_CHUNK_SIZE,to-from+1);
+    }
+    return range;
+
+err:
+    sdsfree(range);
+    return NULL;
+}
+
+/* Write chunks touched by SETRANGE/APPEND (and meta if string length
+ * changed) directly to rocksdb, string stays cold. */
+static int stringChunksSetRange(swapData *data, wholeKeyDataCtx *datactx,
+        stringChunks *chunks) {
+    objectMeta *object_meta = swapDataObjectMeta(data);
+    uint64_t version = object_meta->version;
+    long long len = object_meta->len, newlen = datactx->strlen;
+    long long first = MIN(datactx->start,len)/SWAP_STRING_CHUNK_SIZE;
+    long long last = datactx->end/SWAP_STRING_CHUNK_SIZE;
+    long long bufstart = first*SWAP_STRING_CHUNK_SIZE;
+    long long buflen = MIN((last+1)*SWAP_STRING_CHUNK_SIZE,newlen)-bufstart;
+    long long idxs[2];
+    int num, numkeys, *cfs, errcode;
+    sds buf, *rawkeys, *rawvals;
+    RIO _rio = {0}, *rio = &_rio;
+
+    /* gap between old end and offset is zero-padded. */
+    buf = sdsnewlen(NULL,buflen);
+    num = stringPartialWriteReadIdxs(len,datactx,idxs);
+    if (chunks->num != num) goto decode_err;
+    for (int i = 0; i < num; i++) {
+        sds val = chunks->vals[i];
+        if (chunks->idxs[i] != idxs[i] || val == NULL ||
+                sdslen(val) != stringChunkLen(len,idxs[i])) goto decode_err;
+        memcpy(buf+idxs[i]*SWAP_STRING_CHUNK_SIZE-bufstart,val,sdslen(val));
+    }
+    memcpy(buf+datactx->start-bufstart,datactx->value->ptr,
+            sdslen(datactx->value->ptr));
+
+    numkeys = last-first+1+(newlen != len);
+    cfs = zmalloc(sizeof(int)*numkeys);
+    rawkeys = zmalloc(sizeof(sds)*numkeys);
+    rawvals = zmalloc(sizeof(sds)*numkeys);
+    for (long long idx = first; idx <= last; idx++) {
+        int i = idx-first;
+        cfs[i] = DATA_CF;
+        rawkeys[i] = stringEncodeChunkKey(data,version,idx);
+        rawvals[i] = stringEncodeChunkVal(buf+idx*SWAP_STRING_CHUNK_SIZE-bufstart,
+                stringChunkLen(newlen,idx));
+    }
+    if (newlen != len) {
+        sds extend = rocksEncodeObjectMetaLen(newlen);
+        cfs[numkeys-1] = META_CF;
+        rawkeys[numkeys-1] = swapDataEncodeMetaKey(data);
+        rawvals[numkeys-1] = rocksEncodeMetaVal(OBJ_STRING,data->expire,
+                version,extend);
+        sdsfree(extend);
+    }
+    sdsfree(buf);
+
+    RIOInitPut(rio,numkeys,cfs,rawkeys,rawvals);
+    RIODo(rio);
+    errcode = RIOGetError(rio);
+    RIODeinit(rio);
+    if (errcode == 0) object_meta->len = newlen;
+    return errcode;
+
+decode_err:
+    sdsfree(buf);
+    return SWAP_ERR_DATA_DECODE_FAIL;
+}
+
+static void *wholeKeyCreateOrMergeChunks(swapData *data, stringChunks *chunks,
+        wholeKeyDataCtx *datactx) {
+    objectMeta *object_meta = swapDataObjectMeta(data);
+    robj *result = NULL;
+
+    if (datactx == NULL || datactx->partial == STRING_PARTIAL_NONE) {
+        if ((result = stringChunksCreateObject(chunks,object_meta->len)) == NULL) {
+            sds repr = sdscatrepr(sdsempty(),data->key->ptr,sdslen(data->key->ptr));
+            serverLog(LL_WARNING,"Chunks of string %s corrupted.",repr);
+            sdsfree(repr);
+        }
+    } else if (datactx->partial == STRING_PARTIAL_GETRANGE) {
+        datactx->range = stringChunksGetRange(chunks,object_meta->len,
+                datactx->start,datactx->end);
+        if (datactx->range == NULL) datactx->errcode = SWAP_ERR_DATA_DECODE_FAIL;
+    } else {
+        datactx->errcode = stringChunksSetRange(data,datactx,chunks);
+    }
+
+    stringChunksFree(chunks);
+    return result;
+}
+
 /* decoded moved back by exec to wholekey then moved to exec again. */
 void *wholeKeyCreateOrMergeObject(swapData *data, void *decoded, void *datactx) {
-    UNUSED(data);
-    UNUSED(datactx);
+    if (wholeKeyIsChunked(data))
+        return wholeKeyCreateOrMergeChunks(data,decoded,datactx);
     serverAssert(decoded);
     return decoded;
 }
 
+int wholeKeyBeforeCall(swapData *data, client *c, void *datactx_) {
+    wholeKeyDataCtx *datactx = datactx_;
+    UNUSED(data);
+    if (!wholeKeyIsPartial(datactx) || datactx->errcode) return 0;
+    if (datactx->partial == STRING_PARTIAL_GETRANGE) {
+        c->swap_getrange = datactx->range;
+        datactx->range = NULL;
+    } else {
+        c->swap_strlen = datactx->strlen;
+    }
+    return 0;
+}
+
+void freeWholeKeySwapData(swapData *data, void *datactx_) {
+    wholeKeyDataCtx *datactx = datactx_;
+    UNUSED(data);
+    if (datactx == NULL) return;
+    if (datactx->value) decrRefCount(datactx->value);
+    if (datactx->range) sdsfree(datactx->range);
+    zfree(datactx);
+}
+
 swapDataType wholeKeySwapDataType = {
     .name = "wholekey",
     .cmd_swap_flags = CMD_SWAP_DATATYPE_STRING,
@@ -259,22 +747,27 @@ swapDataType wholeKeySwapDataType = {
     .encodeKeys = wholeKeyEncodeKeys,
     .encodeData = wholeKeyEncodeData,
     .decodeData = wholeKeyDecodeData,
-    .encodeRange = NULL,
+    .encodeRange = wholeKeyEncodeRange,
     .swapIn = wholeKeySwapIn,
     .swapOut = wholeKeySwapOut,
     .swapDel = wholeKeySwapDel,
     .createOrMergeObject = wholeKeyCreateOrMergeObject,
     .cleanObject = NULL,
-    .beforeCall = NULL,
-    .free = NULL,
+    .beforeCall = wholeKeyBeforeCall,
+    .free = freeWholeKeySwapData,
     .rocksDel = NULL,
     .mergedIsHot = wholeKeyMergedIsHot,
 };
 
-int swapDataSetupWholeKey(swapData *d, void **datactx) {
+int swapDataSetupWholeKey(swapData *d, void **pdatactx) {
     d->type = &wholeKeySwapDataType;
     d->omtype = &wholekeyObjectMetaType;
-    if (datactx) *datactx = NULL;
+    if (pdatactx) {
+        wholeKeyDataCtx *datactx = zcalloc(sizeof(wholeKeyDataCtx));
+        datactx->partial = STRING_PARTIAL_NONE;
+        datactx->strlen = -1;
+        *pdatactx = datactx;
+    }
     return 0;
 }
 
@@ -312,6 +805,74 @@ void wholeKeySaveInit(rdbKeySaveData *keydata) {
     keydata->omtype = &wholekeyObjectMetaType;
 }
 
+/* ------------------- chunked string rdb save --------------------------- */
+/* Chunks are concatenated into plain rdb string, so that rdb could be
+ * loaded by any redis. */
+int chunkedStringSaveStart(rdbKeySaveData *save, rio *rdb) {
+    if (rdbSaveKeyHeader(rdb,save->key,save->key,RDB_TYPE_STRING,
+                save->expire) == -1)
+        return -1;
+    if (rdbSaveLen(rdb,save->object_meta->len) == -1)
+        return -1;
+    return 0;
+}
+
+/* chunk missing or corrupted can't be skipped, string length already saved. */
+int chunkedStringSave(rdbKeySaveData *save, rio *rdb, decodedData *decoded) {
+    long long len = save->object_meta->len, idx;
+    size_t sublen = decoded->subkey ? sdslen(decoded->subkey) : 0;
+    sds val;
+
+    idx = stringDecodeChunkIdx(decoded->subkey,sublen);
+    if (decoded->rdbtype != RDB_TYPE_STRING || idx != save->saved)
+        return -1;
+
+    val = stringDecodeChunkRdbraw(decoded->rdbraw);
+    if (val == NULL || sdslen(val) != stringChunkLen(len,idx)) {
+        if (val) sdsfree(val);
+        return -1;
+    }
+
+    if (rdbWriteRaw(rdb,val,sdslen(val)) == -1) {
+        sdsfree(val);
+        return -1;
+    }
+
+    sdsfree(val);
+    save->saved++;
+    return 0;
+}
+
+int chunkedStringSaveEnd(rdbKeySaveData *save, rio *rdb, int save_result) {
+    UNUSED(rdb);
+    long long expected = stringChunkCount(save->object_meta->len);
+    if (save->saved != expected) {
+        sds key  = save->key->ptr;
+        sds repr = sdscatrepr(sdsempty(), key, sdslen(key));
+        serverLog(LL_WARNING,
+                "chunkedStringSave %s: saved(%d) != chunks(%lld)",
+                repr, save->saved, expected);
+        sdsfree(repr);
+        return -1;
+    }
+    return save_result;
+}
+
+rdbKeySaveType chunkedStringRdbSaveType = {
+    .save_start = chunkedStringSaveStart,
+    .save = chunkedStringSave,
+    .save_end = chunkedStringSaveEnd,
+    .save_deinit = NULL,
+};
+
+int chunkedStringSaveInit(rdbKeySaveData *save, uint64_t version,
+        const char *extend, size_t extlen) {
+    save->type = &chunkedStringRdbSaveType;
+    save->omtype = &wholekeyObjectMetaType;
+    serverAssert(save->object_meta == NULL);
+    return buildObjectMeta(OBJ_STRING,version,extend,extlen,&save->object_meta);
+}
+
 /* ------------------- whole key rdb load -------------------------------- */
 void wholekeyLoadStart(struct rdbKeyLoadData *keydata, rio *rdb, int *cf,
         sds *rawkey, sds *rawval, int *error) {
@@ -384,6 +945,7 @@ int wholeKeySwapAna_(swapData *data_,
     int retval;
     struct keyRequest req_, *req = &req_;
     req->level = REQUEST_LEVEL_KEY;
+    req->type = KEYREQUEST_TYPE_KEY;
     req->b.num_subkeys = 0;
     req->key = createStringObject("key1",4);
     req->b.subkeys = NULL;
@@ -395,6 +957,44 @@ int wholeKeySwapAna_(swapData *data_,
     return retval;
 }
 
+static void wholeKeySwapAnaRange_(swapData *data, long start, long end,
+        int *intention, void *datactx) {
+    uint32_t intention_flags;
+    struct keyRequest req_, *req = &req_;
+    req->level = REQUEST_LEVEL_KEY;
+    req->type = KEYREQUEST_TYPE_RANGE;
+    req->key = createStringObject("key1",4);
+    req->l.num_ranges = 1;
+    req->l.ranges = zmalloc(sizeof(range));
+    req->l.ranges[0].start = start;
+    req->l.ranges[0].end = end;
+    req->cmd_flags = CMD_SWAP_DATATYPE_STRING;
+    req->cmd_intention = SWAP_IN;
+    req->cmd_intention_flags = SWAP_IN_PARTIAL;
+    wholeKeySwapAna(data,0,req,intention,&intention_flags,datactx);
+    zfree(req->l.ranges);
+    decrRefCount(req->key);
+}
+
+static void wholeKeySwapAnaSubkeys_(swapData *data, robj *offset, robj *value,
+        int *intention, void *datactx) {
+    uint32_t intention_flags;
+    robj *subkeys[2];
+    struct keyRequest req_, *req = &req_;
+    req->level = REQUEST_LEVEL_KEY;
+    req->type = KEYREQUEST_TYPE_SUBKEY;
+    req->key = createStringObject("key1",4);
+    req->b.num_subkeys = 0;
+    if (offset) subkeys[req->b.num_subkeys++] = offset;
+    subkeys[req->b.num_subkeys++] = value;
+    req->b.subkeys = subkeys;
+    req->cmd_flags = CMD_SWAP_DATATYPE_STRING;
+    req->cmd_intention = SWAP_IN;
+    req->cmd_intention_flags = SWAP_IN_PARTIAL;
+    wholeKeySwapAna(data,0,req,intention,&intention_flags,datactx);
+    decrRefCount(req->key);
+}
+
 int swapDataWholeKeyTest(int argc, char **argv, int accurate) {
     UNUSED(argc);
     UNUSED(argv);
@@ -641,6 +1241,136 @@ int swapDataWholeKeyTest(int argc, char **argv, int accurate) {
         clearTestRedisDb();
     }
 
+    TEST("wholeKey - chunked object meta") {
+        long long len = 2*SWAP_STRING_CHUNK_SIZE+1;
+        objectMeta *om = createStringObjectMeta(1,len), *decoded = NULL, *rebuild;
+        sds extend = wholekeyObjectMetaType.encodeObjectMeta(om,NULL);
+        test_assert(wholekeyObjectMetaType.encodeObjectMeta(NULL,NULL) == NULL);
+        test_assert(!buildObjectMeta(OBJ_STRING,1,extend,sdslen(extend),&decoded));
+        test_assert(decoded->len == len && decoded->version == 1);
+        sdsfree(extend);
+
+        rebuild = createObjectMeta(OBJ_STRING,1);
+        for (long long i = 0; i < 3; i++) {
+            sds subkey = stringEncodeChunkSubkey(i);
+            test_assert(stringDecodeChunkIdx(subkey,sdslen(subkey)) == i);
+            test_assert(!objectMetaRebuildFeed(rebuild,1,subkey,sdslen(subkey)));
+            sdsfree(subkey);
+        }
+        test_assert(objectMetaEqual(rebuild,om));
+        sds hole = stringEncodeChunkSubkey(4);
+        test_assert(objectMetaRebuildFeed(rebuild,1,hole,sdslen(hole)));
+        sdsfree(hole);
+
+        freeObjectMeta(om), freeObjectMeta(decoded), freeObjectMeta(rebuild);
+    }
+
+    TEST("wholeKey - chunked swap out & swap in") {
+        void *ctx = NULL;
+        long long len = 2*SWAP_STRING_CHUNK_SIZE+10;
+        int numkeys, action, *cfs, intention;
+        uint32_t intention_flags;
+        sds *rawkeys = NULL, *rawvals = NULL, str = sdsnewlen(NULL,len);
+        robj *key = createStringObject("key",3), *value, *result;
+        void *decoded;
+
+        for (long long i = 0; i < len; i++) str[i] = 'a' + i%26;
+        value = createObject(OBJ_STRING,sdsdup(str));
+        setObjectDirty(value);
+
+        server.swap_string_chunk_threshold = SWAP_STRING_CHUNK_SIZE;
+        swapData *data = createWholeKeySwapData(db,key,value,&ctx);
+        wholeKeySwapAna_(data,SWAP_OUT,0,&intention,&intention_flags,ctx);
+        test_assert(intention == SWAP_OUT);
+        test_assert(data->new_meta && data->new_meta->len == len);
+        uint64_t version = data->new_meta->version;
+        wholeKeySwapAnaAction(data,SWAP_OUT,ctx,&action);
+        test_assert(action == ROCKS_PUT);
+        wholeKeyEncodeData(data,SWAP_OUT,ctx,&numkeys,&cfs,&rawkeys,&rawvals);
+        test_assert(numkeys == 4);
+        test_assert(sdslen(rawvals[3]) == 0);
+        swapDataFree(data,ctx);
+        server.swap_string_chunk_threshold = 0;
+
+        /* cold: swap in whole string from chunks */
+        data = createWholeKeySwapData(db,key,NULL,&ctx);
+        swapDataSetColdObjectMeta(data,createStringObjectMeta(version,len));
+        wholeKeySwapAna_(data,SWAP_IN,SWAP_IN_PARTIAL,&intention,&intention_flags,ctx);
+        test_assert(intention == SWAP_NOP);
+        test_assert(((wholeKeyDataCtx*)ctx)->strlen == len);
+        swapDataFree(data,ctx);
+
+        data = createWholeKeySwapData(db,key,NULL,&ctx);
+        swapDataSetColdObjectMeta(data,createStringObjectMeta(version,len));
+        wholeKeySwapAna_(data,SWAP_IN,0,&intention,&intention_flags,ctx);
+        test_assert(intention == SWAP_IN);
+        wholeKeySwapAnaAction(data,SWAP_IN,ctx,&action);
+        test_assert(action == ROCKS_ITERATE);
+        test_assert(!wholeKeyDecodeData(data,numkeys,cfs,rawkeys,rawvals,&decoded));
+        test_assert(((stringChunks*)decoded)->num == 3);
+        result = wholeKeyCreateOrMergeObject(data,decoded,ctx);
+        test_assert(result && !sdscmp(result->ptr,str));
+        decrRefCount(result);
+        swapDataFree(data,ctx);
+
+        /* cold: getrange only reads chunks in range */
+        data = createWholeKeySwapData(db,key,NULL,&ctx);
+        swapDataSetColdObjectMeta(data,createStringObjectMeta(version,len));
+        wholeKeySwapAnaRange_(data,-20,-1,&intention,ctx);
+        test_assert(intention == SWAP_IN);
+        wholeKeySwapAnaAction(data,SWAP_IN,ctx,&action);
+        test_assert(action == ROCKS_GET);
+        int getnum, *getcfs;
+        sds *getkeys;
+        wholeKeyEncodeKeys(data,SWAP_IN,ctx,&getnum,&getcfs,&getkeys);
+        test_assert(getnum == 2);
+        test_assert(!sdscmp(getkeys[0],rawkeys[1]) && !sdscmp(getkeys[1],rawkeys[2]));
+        test_assert(!wholeKeyDecodeData(data,2,cfs+1,rawkeys+1,rawvals+1,&decoded));
+        test_assert(wholeKeyCreateOrMergeObject(data,decoded,ctx) == NULL);
+        test_assert(!memcmp(((wholeKeyDataCtx*)ctx)->range,str+len-20,20));
+        FREE_SDSARRAY(getkeys,getnum);
+        zfree(getcfs);
+        swapDataFree(data,ctx);
+
+        data = createWholeKeySwapData(db,key,NULL,&ctx);
+        swapDataSetColdObjectMeta(data,createStringObjectMeta(version,len));
+        wholeKeySwapAnaRange_(data,5,1,&intention,ctx);
+        test_assert(intention == SWAP_NOP);
+        test_assert(sdslen(((wholeKeyDataCtx*)ctx)->range) == 0);
+        swapDataFree(data,ctx);
+
+        /* cold: setrange/append only reads first and last chunk touched */
+        robj *offset = createStringObject("10",2), *val = createStringObject("xyz",3);
+        data = createWholeKeySwapData(db,key,NULL,&ctx);
+        swapDataSetColdObjectMeta(data,createStringObjectMeta(version,len));
+        wholeKeySwapAnaSubkeys_(data,offset,val,&intention,ctx);
+        test_assert(intention == SWAP_IN);
+        test_assert(((wholeKeyDataCtx*)ctx)->strlen == len);
+        wholeKeyEncodeKeys(data,SWAP_IN,ctx,&getnum,&getcfs,&getkeys);
+        test_assert(getnum == 1 && !sdscmp(getkeys[0],rawkeys[0]));
+        FREE_SDSARRAY(getkeys,getnum);
+        zfree(getcfs);
+        swapDataFree(data,ctx);
+
+        data = createWholeKeySwapData(db,key,NULL,&ctx);
+        swapDataSetColdObjectMeta(data,createStringObjectMeta(version,len));
+        wholeKeySwapAnaSubkeys_(data,NULL,val,&intention,ctx);
+        test_assert(intention == SWAP_IN);
+        test_assert(((wholeKeyDataCtx*)ctx)->strlen == len+3);
+        wholeKeyEncodeKeys(data,SWAP_IN,ctx,&getnum,&getcfs,&getkeys);
+        test_assert(getnum == 1 && !sdscmp(getkeys[0],rawkeys[2]));
+        FREE_SDSARRAY(getkeys,getnum);
+        zfree(getcfs);
+        swapDataFree(data,ctx);
+
+        decrRefCount(offset), decrRefCount(val);
+        FREE_SDSARRAY(rawkeys,numkeys);
+        FREE_SDSARRAY(rawvals,numkeys);
+        zfree(cfs);
+        decrRefCount(key), decrRefCount(value);
+        sdsfree(str);
+    }
+
     int rocksDecodeMetaCF(sds rawkey, sds rawval, decodedMeta *decoded);
     int rocksDecodeDataCF(sds rawkey, unsigned char rdbtype, sds rdbraw, decodedData *decoded);
 
@@ -660,13 +1390,13 @@ int swapDataWholeKeyTest(int argc, char **argv, int accurate) {
         sds data_rawkey = rocksEncodeDataKey(db,key,0,NULL);
         sds data_rawval = rocksEncodeValRdb(val);
 
-        test_assert(!rocksDecodeMetaCF(sdsdup(meta_rawkey),sdsdup(meta_rawval),dm));
+        test_assert(!rocksDecodeMetaCF(meta_rawkey,sdsdup(meta_rawval),dm));
         test_assert(dm->expire == -1);
         test_assert(dm->extend == NULL);
         test_assert(!sdscmp(dm->key,key));
 
         rdbraw = sdsnewlen(data_rawval+1,sdslen(data_rawval)-1);
-        test_assert(!rocksDecodeDataCF(sdsdup(data_rawkey),data_rawval[0],rdbraw,dd));
+        test_assert(!rocksDecodeDataCF(data_rawkey,data_rawval[0],rdbraw,dd));
         test_assert(!sdscmp(dd->key,key));
         test_assert(dd->subkey == NULL);
         test_assert(!memcmp(dd->rdbraw,data_rawval+1,sdslen(dd->rdbraw)));
@@ -27,41 +27,168 @@
 
 #include "ctrip_swap.h"
 
+static inline int swapThreadStealable(swapThread *thread) {
+    return thread->id < server.swap_threads_num;
+}
+
+int swapPriorityShare(int priority) {
+    switch (priority) {
+    case SWAP_PRIORITY_EXPIRE: return server.swap_priority_expire_share;
+    case SWAP_PRIORITY_EVICT: return server.swap_priority_evict_share;
+    case SWAP_PRIORITY_PERSIST: return server.swap_priority_persist_share;
+    default: return 100;
+    }
+}
+
+static inline long swapThreadPendingLocked(swapThread *thread) {
+    long pending = 0;
+    for (int p = 0; p < SWAP_PRIORITY_TYPES; p++)
+        pending += listLength(thread->pending_reqs[p]);
+    return pending;
+}
+
+/* Choose priority to pop: foreground first, but each background class
+ * contending with foreground earns its share of credits per pop, and gets
+ * popped once it earned 100 (i.e. share percent of pops). Without
+ * foreground, background class with most credits popped. */
+static int swapThreadChoosePriorityLocked(swapThread *thread) {
+    int p, chosen = -1;
+
+    if (listLength(thread->pending_reqs[SWAP_PRIORITY_FOREGROUND])) {
+        for (p = SWAP_PRIORITY_FOREGROUND+1; p < SWAP_PRIORITY_TYPES; p++) {
+            if (listLength(thread->pending_reqs[p]) == 0) {
+                thread->credits[p] = 0;
+                continue;
+            }
+            thread->credits[p] += swapPriorityShare(p);
+            if (chosen < 0 && thread->credits[p] >= 100) chosen = p;
+        }
+        if (chosen < 0) return SWAP_PRIORITY_FOREGROUND;
+        thread->credits[chosen] -= 100;
+    } else {
+        for (p = SWAP_PRIORITY_FOREGROUND+1; p < SWAP_PRIORITY_TYPES; p++) {
+            if (listLength(thread->pending_reqs[p]) == 0) continue;
+            if (chosen < 0 || thread->credits[p] > thread->credits[chosen])
+                chosen = p;
+        }
+    }
+
+    return chosen;
+}
+
+/* Pop batch from head of thread pending_reqs, must be called with lock. */
+static swapRequestBatch *swapThreadPopLocked(swapThread *thread) {
+    listNode *ln;
+    swapRequestBatch *reqs;
+    int priority;
+
+    if ((priority = swapThreadChoosePriorityLocked(thread)) < 0) return NULL;
+    ln = listFirst(thread->pending_reqs[priority]);
+    reqs = listNodeValue(ln);
+    listDelNode(thread->pending_reqs[priority],ln);
+    atomicSetWithSync(thread->pending_count,swapThreadPendingLocked(thread));
+    return reqs;
+}
+
+static void swapThreadUpdatePriorityStat(swapRequestBatch *reqs) {
+    swapPriorityStat *stat = server.ror_stats->priority_stats+reqs->priority;
+    atomicDecr(stat->pending,1);
+    atomicIncr(stat->processed,1);
+    atomicIncr(stat->queue_us,(long long)(getMonotonicUs()-reqs->dispatch_time));
+}
+
+/* Steal oldest batch from the most loaded sibling. */
+static swapRequestBatch *swapThreadSteal(swapThread *thread) {
+    int i, victim_idx = -1;
+    long pending, max_pending = 0;
+    swapRequestBatch *reqs = NULL;
+
+    if (!swapThreadStealable(thread)) return NULL;
+
+    for (i = 0; i < server.swap_threads_num; i++) {
+        if (i == thread->id) continue;
+        atomicGetWithSync(server.swap_threads[i].pending_count,pending);
+        if (pending > max_pending) {
+            max_pending = pending;
+            victim_idx = i;
+        }
+    }
+    if (victim_idx < 0) return NULL;
+
+    swapThread *victim = server.swap_threads+victim_idx;
+    pthread_mutex_lock(&victim->lock);
+    reqs = swapThreadPopLocked(victim);
+    pthread_mutex_unlock(&victim->lock);
+
+    if (reqs) atomicIncr(thread->steal_count,1);
+    return reqs;
+}
+
+static int swapThreadHasStealable(swapThread *thread) {
+    long pending;
+    if (!swapThreadStealable(thread)) return 0;
+    for (int i = 0; i < server.swap_threads_num; i++) {
+        if (i == thread->id) continue;
+        atomicGetWithSync(server.swap_threads[i].pending_count,pending);
+        if (pending > 0) return 1;
+    }
+    return 0;
+}
+
+static swapRequestBatch *swapThreadNext(swapThread *thread) {
+    swapRequestBatch *reqs;
+    long long idle_start;
+
+    while (1) {
+        /* mark running before pop so that swapThreadsDrained won't miss
+         * reqs popped but not yet processed. */
+        atomicSetWithSync(thread->is_running_rio, 1);
+
+        pthread_mutex_lock(&thread->lock);
+        reqs = swapThreadPopLocked(thread);
+        pthread_mutex_unlock(&thread->lock);
+        if (reqs) return reqs;
+
+        if ((reqs = swapThreadSteal(thread))) return reqs;
+
+        atomicSetWithSync(thread->is_running_rio, 0);
+
+        /* park untill reqs dispatched to this thread, or dispatcher found
+         * sibling busy and asked us to steal. idle flag set before checking
+         * siblings, so that dispatcher either see us idle or we see its
+         * reqs. */
+        idle_start = ustime();
+        pthread_mutex_lock(&thread->lock);
+        atomicSetWithSync(thread->idle,1);
+        if (swapThreadPendingLocked(thread) == 0 &&
+                !swapThreadHasStealable(thread)) {
+            pthread_cond_wait(&thread->cond, &thread->lock);
+        }
+        atomicSetWithSync(thread->idle,0);
+        pthread_mutex_unlock(&thread->lock);
+        atomicIncr(thread->idle_us,ustime()-idle_start);
+    }
+}
+
 void *swapThreadMain (void *arg) {
     char thdname[16];
     swapThread *thread = arg;
+    long long busy_start;
 
     snprintf(thdname, sizeof(thdname), "swap_thd_%d", thread->id);
     redis_set_thread_title(thdname);
 #ifndef __APPLE__
     atomicIncr(server.swap_threads_initialized, 1);
 #endif
-    listIter li;
-    listNode *ln;
-    list *processing_reqs;
     while (1) {
-        pthread_mutex_lock(&thread->lock);
-        while (listLength(thread->pending_reqs) == 0)
-            pthread_cond_wait(&thread->cond, &thread->lock);
-
-        listRewind(thread->pending_reqs, &li);
-        processing_reqs = listCreate();
-        while ((ln = listNext(&li))) {
-            swapRequest *req = listNodeValue(ln);
-            listAddNodeHead(processing_reqs, req);
-            listDelNode(thread->pending_reqs, ln);
-        }
-        pthread_mutex_unlock(&thread->lock);
-
-        listRewind(processing_reqs, &li);
-        atomicSetWithSync(thread->is_running_rio, 1);
-        while ((ln = listNext(&li))) {
-            swapRequestBatch *reqs = listNodeValue(ln);
-            swapRequestBatchProcess(reqs);
-        }
+        swapRequestBatch *reqs = swapThreadNext(thread);
 
+        swapThreadUpdatePriorityStat(reqs);
+        busy_start = ustime();
+        swapRequestBatchProcess(reqs);
         atomicSetWithSync(thread->is_running_rio, 0);
-        listRelease(processing_reqs);
+        atomicIncr(thread->busy_us,ustime()-busy_start);
+        atomicIncr(thread->processed_count,1);
     }
 
     return NULL;
@@ -76,8 +203,13 @@ int swapThreadsInit() {
     for (i = 0; i < server.total_swap_threads_num; i++) {
         swapThread *thread = server.swap_threads+i;
         thread->id = i;
-        thread->pending_reqs = listCreate();
+        for (int p = 0; p < SWAP_PRIORITY_TYPES; p++) {
+            thread->pending_reqs[p] = listCreate();
+            thread->credits[p] = 0;
+        }
         atomicSetWithSync(thread->is_running_rio, 0);
+        atomicSetWithSync(thread->pending_count, 0);
+        atomicSetWithSync(thread->idle, 0);
         pthread_mutex_init(&thread->lock, NULL);
         pthread_cond_init(&thread->cond, NULL);
         if (pthread_create(&thread->thread_id, NULL, swapThreadMain, thread)) {
@@ -93,7 +225,8 @@ void swapThreadsDeinit() {
     int i, err;
     for (i = 0; i < server.total_swap_threads_num; i++) {
         swapThread *thread = server.swap_threads+i;
-        listRelease(thread->pending_reqs);
+        for (int p = 0; p < SWAP_PRIORITY_TYPES; p++)
+            listRelease(thread->pending_reqs[p]);
         if (thread->thread_id == pthread_self()) continue;
         if (thread->thread_id && pthread_cancel(thread->thread_id) == 0) {
             if ((err = pthread_join(thread->thread_id, NULL)) != 0) {
@@ -113,6 +246,26 @@ static inline int swapThreadsDistNext() {
     return dist;
 }
 
+/* Wake one idle sibling to steal from t if t is busy. */
+static void swapThreadsWakeThief(swapThread *t) {
+    unsigned long running;
+    int i, idle;
+
+    atomicGetWithSync(t->is_running_rio,running);
+    if (!running) return;
+
+    for (i = 0; i < server.swap_threads_num; i++) {
+        swapThread *thief = server.swap_threads+i;
+        if (thief == t) continue;
+        atomicGetWithSync(thief->idle,idle);
+        if (!idle) continue;
+        pthread_mutex_lock(&thief->lock);
+        pthread_cond_signal(&thief->cond);
+        pthread_mutex_unlock(&thief->lock);
+        break;
+    }
+}
+
 void swapThreadsDispatch(swapRequestBatch *reqs, int idx) {
     if (idx == -1) {
         idx = swapThreadsDistNext() % server.swap_threads_num;
@@ -120,11 +273,15 @@ void swapThreadsDispatch(swapRequestBatch *reqs, int idx) {
         serverAssert(idx < server.total_swap_threads_num);
     }
     swapRequestBatchDispatched(reqs);
+    reqs->dispatch_time = getMonotonicUs();
+    atomicIncr(server.ror_stats->priority_stats[reqs->priority].pending,1);
     swapThread *t = server.swap_threads+idx;
     pthread_mutex_lock(&t->lock);
-    listAddNodeTail(t->pending_reqs,reqs);
+    listAddNodeTail(t->pending_reqs[reqs->priority],reqs);
+    atomicSetWithSync(t->pending_count,swapThreadPendingLocked(t));
     pthread_cond_signal(&t->cond);
     pthread_mutex_unlock(&t->lock);
+    if (swapThreadStealable(t)) swapThreadsWakeThief(t);
 }
 
 int swapThreadsDrained() {
@@ -136,7 +293,7 @@ int swapThreadsDrained() {
         pthread_mutex_lock(&rt->lock);
         unsigned long count = 0;
         atomicGetWithSync(rt->is_running_rio, count);
-        if (listLength(rt->pending_reqs) || count) drained = 0;
+        if (swapThreadPendingLocked(rt) || count) drained = 0;
         pthread_mutex_unlock(&rt->lock);
     }
     return drained;
@@ -311,7 +468,7 @@ sds genSwapThreadInfoString(sds info) {
     for (int i = 0; i < server.swap_threads_num; i++) {
         swapThread *thread = server.swap_threads+i;
         pthread_mutex_lock(&thread->lock);
-        thread_depth += listLength(thread->pending_reqs);
+        thread_depth += swapThreadPendingLocked(thread);
         pthread_mutex_unlock(&thread->lock);
     }
     thread_depth /= server.swap_threads_num;
@@ -321,5 +478,35 @@ sds genSwapThreadInfoString(sds info) {
             "swap_async_queue_depth:%lu\r\n",
             thread_depth, async_depth);
 
+    for (int i = 0; i < server.total_swap_threads_num; i++) {
+        swapThread *thread = server.swap_threads+i;
+        long pending;
+        long long busy_us, idle_us, processed, steal;
+        atomicGet(thread->pending_count,pending);
+        atomicGet(thread->busy_us,busy_us);
+        atomicGet(thread->idle_us,idle_us);
+        atomicGet(thread->processed_count,processed);
+        atomicGet(thread->steal_count,steal);
+        info = sdscatprintf(info,
+                "swap_thread%d:pending=%ld,processed=%lld,steal=%lld,"
+                "busy_us=%lld,idle_us=%lld,busy_ratio=%.2f\r\n",
+                i,pending,processed,steal,busy_us,idle_us,
+                busy_us+idle_us ? (double)busy_us/(busy_us+idle_us) : 0);
+    }
+
+    for (int p = 0; p < SWAP_PRIORITY_TYPES; p++) {
+        swapPriorityStat *stat = server.ror_stats->priority_stats+p;
+        long pending;
+        long long processed, queue_us;
+        atomicGet(stat->pending,pending);
+        atomicGet(stat->processed,processed);
+        atomicGet(stat->queue_us,queue_us);
+        info = sdscatprintf(info,
+                "swap_priority_%s:share=%d,pending=%ld,processed=%lld,"
+                "avg_queue_us=%lld\r\n",
+                swapPriorityName(p),swapPriorityShare(p),pending,processed,
+                processed ? queue_us/processed : 0);
+    }
+
     return info;
 }
@@ -148,17 +148,134 @@ int rocksDecodeMetaVal(const char *raw, size_t rawlen, int *pobject_type,
 
 typedef unsigned int keylen_t;
 
+/* Compact key format encodes dbid & keylen as order preserving varint:
+ * length tagged by leading bits of the first byte, the rest big-endian, so
+ * that memcmp order equals numeric order regardless of host endianness.
+ *   0xxxxxxx                                  < 2^7
+ *   10xxxxxx xxxxxxxx                         < 2^14
+ *   110xxxxx xxxxxxxx xxxxxxxx                < 2^21
+ *   1110xxxx xxxxxxxx xxxxxxxx xxxxxxxx       < 2^28
+ *   11110000 xxxxxxxx xxxxxxxx xxxxxxxx xxxxxxxx
+ * First byte never exceeds 0xf0, 0xff prefixed keys are reserved. */
+static inline size_t rocksVarintLen(uint32_t v) {
+    if (v < (1U<<7)) return 1;
+    if (v < (1U<<14)) return 2;
+    if (v < (1U<<21)) return 3;
+    if (v < (1U<<28)) return 4;
+    return 5;
+}
+
+static inline size_t rocksEncodeVarint(char *buf, uint32_t v) {
+    unsigned char *p = (unsigned char*)buf;
+    size_t len = rocksVarintLen(v);
+    switch (len) {
+    case 1: p[0] = v; break;
+    case 2: p[0] = 0x80|(v>>8); break;
+    case 3: p[0] = 0xc0|(v>>16); break;
+    case 4: p[0] = 0xe0|(v>>24); break;
+    default: p[0] = 0xf0; break;
+    }
+    for (size_t i = 1; i < len; i++) p[i] = v >> (8*(len-1-i));
+    return len;
+}
+
+static inline size_t rocksDecodeVarint(const char *buf, size_t buflen,
+        uint32_t *pv) {
+    const unsigned char *p = (const unsigned char*)buf;
+    size_t len;
+    uint32_t v;
+
+    if (buflen == 0) return 0;
+    if (p[0] < 0x80) len = 1, v = p[0];
+    else if (p[0] < 0xc0) len = 2, v = p[0] & 0x3f;
+    else if (p[0] < 0xe0) len = 3, v = p[0] & 0x1f;
+    else if (p[0] < 0xf0) len = 4, v = p[0] & 0x0f;
+    else if (p[0] == 0xf0) len = 5, v = 0;
+    else return 0;
+
+    if (buflen < len) return 0;
+    for (size_t i = 1; i < len; i++) v = (v << 8) | p[i];
+    *pv = v;
+    return len;
+}
+
+static inline size_t rocksKeyPrefixLen(int format, int dbid, size_t keylen) {
+    if (format == SWAP_KEY_FORMAT_COMPACT)
+        return rocksVarintLen(dbid)+rocksVarintLen(keylen)+keylen;
+    else
+        return sizeof(int)+sizeof(keylen_t)+keylen;
+}
+
+/* Encode dbid|keylen|key shared by meta/data/score keys, returns ptr past
+ * encoded prefix. */
+static inline char *rocksEncodeKeyPrefix(int format, char *ptr, int dbid,
+        const char *key, size_t keylen_) {
+    keylen_t keylen = keylen_;
+    if (format == SWAP_KEY_FORMAT_COMPACT) {
+        ptr += rocksEncodeVarint(ptr, dbid);
+        ptr += rocksEncodeVarint(ptr, keylen);
+    } else {
+        memcpy(ptr, &dbid, sizeof(dbid)), ptr += sizeof(dbid);
+        memcpy(ptr, &keylen, sizeof(keylen_t)), ptr += sizeof(keylen_t);
+    }
+    if (keylen) memcpy(ptr, key, keylen);
+    return ptr + keylen;
+}
+
+/* Decode dbid|keylen|key, returns encoded prefix length, 0 if malformed. */
+static size_t rocksDecodeKeyPrefix(int format, const char *raw, size_t rawlen,
+        int *dbid, const char **key, size_t *keylen) {
+    size_t hdrlen;
+    uint32_t dbid_, keylen_;
+
+    if (raw == NULL) return 0;
+    if (format == SWAP_KEY_FORMAT_COMPACT) {
+        size_t n;
+        if ((n = rocksDecodeVarint(raw, rawlen, &dbid_)) == 0) return 0;
+        hdrlen = n;
+        if ((n = rocksDecodeVarint(raw+hdrlen, rawlen-hdrlen, &keylen_)) == 0) return 0;
+        hdrlen += n;
+    } else {
+        if (rawlen < sizeof(int)+sizeof(keylen_t)) return 0;
+        dbid_ = *(int*)raw;
+        keylen_ = *(keylen_t*)(raw+sizeof(int));
+        hdrlen = sizeof(int)+sizeof(keylen_t);
+    }
+    if (dbid) *dbid = (int)dbid_;
+    if (keylen) *keylen = keylen_;
+    if (key) *key = raw + hdrlen;
+    if (rawlen - hdrlen < keylen_) return 0;
+    return hdrlen + keylen_;
+}
+
+/* Re-encode dbid|keylen|key prefix of meta/data/score rawkey from one key
+ * format to another, rest of rawkey is format independent. */
+sds rocksTranscodeKey(int from, int to, const char *raw, size_t rawlen) {
+    int dbid;
+    const char *key;
+    size_t keylen, prefixlen;
+    sds transcoded;
+    char *ptr;
+
+    if ((prefixlen = rocksDecodeKeyPrefix(from,raw,rawlen,&dbid,&key,&keylen)) == 0)
+        return NULL;
+    transcoded = sdsnewlen(SDS_NOINIT,
+            rocksKeyPrefixLen(to,dbid,keylen)+rawlen-prefixlen);
+    ptr = rocksEncodeKeyPrefix(to,transcoded,dbid,key,keylen);
+    memcpy(ptr,raw+prefixlen,rawlen-prefixlen);
+    return transcoded;
+}
+
 static sds _rocksEncodeDataKey(int dbid, sds key, uint64_t version,
         uint8_t subkeyflag, sds subkey) {
+    int format = server.swap_key_format_active;
     keylen_t keylen = key ? sdslen(key) : 0;
     keylen_t subkeylen = subkey ? sdslen(subkey) : 0;
     uint64_t encoded_version = rocksEncodeVersion(version);
-    size_t rawkeylen = sizeof(dbid)+sizeof(keylen)+keylen+
+    size_t rawkeylen = rocksKeyPrefixLen(format,dbid,keylen)+
         sizeof(encoded_version)+1+subkeylen;
     sds rawkey = sdsnewlen(SDS_NOINIT,rawkeylen), ptr = rawkey;
-    memcpy(ptr, &dbid, sizeof(dbid)), ptr += sizeof(dbid);
-    memcpy(ptr, &keylen, sizeof(keylen_t)), ptr += sizeof(keylen_t);
-    memcpy(ptr, key, keylen), ptr += keylen;
+    ptr = rocksEncodeKeyPrefix(format,ptr,dbid,key,keylen);
     memcpy(ptr, &encoded_version, sizeof(encoded_version));
     ptr += sizeof(encoded_version);
     ptr[0] = subkeyflag, ptr++;
@@ -185,30 +302,63 @@ sds rocksEncodeDataRangeEndKey(redisDb *db, sds key, uint64_t version) {
 }
 
 sds rocksEncodeDbRangeStartKey(int dbid) {
-    sds rawkey = sdsnewlen(SDS_NOINIT,sizeof(dbid));
-    memcpy(rawkey, &dbid, sizeof(dbid));
-    return rawkey;
+    if (server.swap_key_format_active == SWAP_KEY_FORMAT_COMPACT) {
+        sds rawkey = sdsnewlen(SDS_NOINIT,rocksVarintLen(dbid));
+        rocksEncodeVarint(rawkey, dbid);
+        return rawkey;
+    } else {
+        sds rawkey = sdsnewlen(SDS_NOINIT,sizeof(dbid));
+        memcpy(rawkey, &dbid, sizeof(dbid));
+        return rawkey;
+    }
 }
 
 sds rocksEncodeDbRangeEndKey(int dbid) {
     return rocksEncodeDbRangeStartKey(dbid+1);
 }
 
+/* Expire index key: dbid|0|expire|key, expire encoded in big endian so that
+ * keys of one db are ordered by expire. Empty keylen keeps it transcodable
+ * and flushable as meta/data keys. */
+sds rocksEncodeExpireKey(int dbid, long long expire, sds key) {
+    int format = server.swap_key_format_active;
+    size_t keylen = key ? sdslen(key) : 0;
+    uint64_t encoded_expire = htonu64((uint64_t)expire);
+    sds rawkey = sdsnewlen(SDS_NOINIT,rocksKeyPrefixLen(format,dbid,0)+
+            sizeof(encoded_expire)+keylen), ptr = rawkey;
+    ptr = rocksEncodeKeyPrefix(format,ptr,dbid,NULL,0);
+    memcpy(ptr, &encoded_expire, sizeof(encoded_expire));
+    ptr += sizeof(encoded_expire);
+    if (keylen) memcpy(ptr, key, keylen);
+    return rawkey;
+}
+
+int rocksDecodeExpireKey(const char *raw, size_t rawlen, int *dbid,
+        long long *expire, const char **key, size_t *keylen) {
+    uint64_t encoded_expire;
+    size_t prefixlen, keylen_;
+    prefixlen = rocksDecodeKeyPrefix(server.swap_key_format_active,
+            raw,rawlen,dbid,NULL,&keylen_);
+    if (prefixlen == 0 || keylen_ != 0) return -1;
+    raw += prefixlen, rawlen -= prefixlen;
+    if (rawlen < sizeof(encoded_expire)) return -1;
+    memcpy(&encoded_expire, raw, sizeof(encoded_expire));
+    if (expire) *expire = (long long)ntohu64(encoded_expire);
+    raw += sizeof(encoded_expire), rawlen -= sizeof(encoded_expire);
+    if (key) *key = raw;
+    if (keylen) *keylen = rawlen;
+    return 0;
+}
+
 int rocksDecodeDataKey(const char *raw, size_t rawlen, int *dbid,
         const char **key, size_t *keylen, uint64_t *version,
         const char **subkey, size_t *subkeylen) {
-    keylen_t keylen_;
     uint64_t encoded_version;
-    if (raw == NULL || rawlen < sizeof(int)+sizeof(keylen_t)+sizeof(encoded_version)+1) return -1;
-    if (dbid) *dbid = *(int*)raw;
-    raw += sizeof(int), rawlen -= sizeof(int);
-    keylen_ = *(keylen_t*)raw;
-    if (keylen) *keylen = keylen_;
-    raw += sizeof(keylen_t), rawlen -= sizeof(keylen_t);
-    if (key) *key = raw;
-    if (rawlen < keylen_) return -1;
-    raw += keylen_, rawlen -= keylen_;
-    if (rawlen < sizeof(encoded_version)) return -1;
+    size_t prefixlen = rocksDecodeKeyPrefix(server.swap_key_format_active,
+            raw,rawlen,dbid,key,keylen);
+    if (prefixlen == 0) return -1;
+    raw += prefixlen, rawlen -= prefixlen;
+    if (rawlen < sizeof(encoded_version)+1) return -1;
     if (version) {
         encoded_version = *(uint64_t*)raw;
         *version = rocksDecodeVersion(encoded_version);
@@ -221,15 +371,21 @@ int rocksDecodeDataKey(const char *raw, size_t rawlen, int *dbid,
     return 0;
 }
 
+/* Length of dbid|keylen|key|version prefix shared by data (and score) keys
+ * of one object version, 0 if raw is not a data key. */
+size_t rocksDecodeDataKeyPrefixLen(const char *raw, size_t rawlen) {
+    size_t prefixlen = rocksDecodeKeyPrefix(server.swap_key_format_active,
+            raw,rawlen,NULL,NULL,NULL);
+    if (prefixlen == 0 || rawlen - prefixlen < sizeof(uint64_t)) return 0;
+    return prefixlen + sizeof(uint64_t);
+}
+
 /* Note that metakey MUST be prefix of datakeys, rdb save key switch detection
  * relay on that assumption. */
-sds encodeMetaKey(int dbid, const char* key, size_t keylen_) {
-    keylen_t keylen = keylen_;
-    size_t rawkeylen = sizeof(dbid)+sizeof(keylen)+keylen;
-    sds rawkey = sdsnewlen(SDS_NOINIT,rawkeylen), ptr = rawkey;
-    memcpy(ptr, &dbid, sizeof(dbid)), ptr += sizeof(dbid);
-    memcpy(ptr, &keylen, sizeof(keylen_t)), ptr += sizeof(keylen_t);
-    memcpy(ptr, key, keylen), ptr += keylen;
+sds encodeMetaKey(int dbid, const char* key, size_t keylen) {
+    int format = server.swap_key_format_active;
+    sds rawkey = sdsnewlen(SDS_NOINIT,rocksKeyPrefixLen(format,dbid,keylen));
+    rocksEncodeKeyPrefix(format,rawkey,dbid,key,keylen);
     return rawkey;
 }
 
@@ -239,15 +395,8 @@ sds rocksEncodeMetaKey(redisDb *db, sds key) {
 
 int rocksDecodeMetaKey(const char *raw, size_t rawlen, int *dbid,
         const char **key, size_t *keylen) {
-    keylen_t keylen_;
-    if (raw == NULL || rawlen < sizeof(int)+sizeof(keylen_t)) return -1;
-    if (dbid) *dbid = *(int*)raw;
-    raw += sizeof(int), rawlen -= sizeof(int);
-    keylen_ = *(keylen_t*)raw;
-    if (keylen) *keylen = keylen_;
-    raw += sizeof(keylen_t), rawlen -= sizeof(keylen_t);
-    if (key) *key = raw;
-    if (rawlen < keylen_) return -1;
+    if (rocksDecodeKeyPrefix(server.swap_key_format_active,raw,rawlen,
+                dbid,key,keylen) == 0) return -1;
     return 0;
 }
 
@@ -375,6 +524,7 @@ int decodeDouble(const char* val, double* score) {
 
 sds _encodeScoreKey(int dbid, sds key, uint64_t version, uint8_t subkeyflag,
         double score, sds subkey) {
+    int format = server.swap_key_format_active;
     uint64_t encoded_version = rocksEncodeVersion(version);
     keylen_t keylen = key ? sdslen(key) : 0;
     keylen_t scoresubkeylen, rawkeylen;
@@ -388,12 +538,10 @@ sds _encodeScoreKey(int dbid, sds key, uint64_t version, uint8_t subkeyflag,
         scoresubkeylen = 0;
     }
 
-    rawkeylen = sizeof(dbid)+sizeof(keylen)+keylen+sizeof(version)+1+scoresubkeylen;
+    rawkeylen = rocksKeyPrefixLen(format,dbid,keylen)+sizeof(version)+1+scoresubkeylen;
     rawkey = sdsnewlen(SDS_NOINIT,rawkeylen), ptr = rawkey;
 
-    memcpy(ptr, &dbid, sizeof(dbid)), ptr += sizeof(dbid);
-    memcpy(ptr, &keylen, sizeof(keylen_t)), ptr += sizeof(keylen_t);
-    memcpy(ptr, key, keylen), ptr += keylen;
+    ptr = rocksEncodeKeyPrefix(format,ptr,dbid,key,keylen);
     memcpy(ptr, &encoded_version, sizeof(encoded_version));
     ptr += sizeof(encoded_version);
     ptr[0] = subkeyflag, ptr++;
@@ -425,16 +573,13 @@ sds encodeScoreKey(redisDb* db, sds key, uint64_t version, double score, sds sub
 int decodeScoreKey(const char* raw, int rawlen, int* dbid, const char** key,
         size_t* keylen, uint64_t *version, double* score, const char** subkey,
         size_t* subkeylen) {
-    keylen_t keylen_;
-    if (raw == NULL || rawlen < (int)(sizeof(int)+sizeof(keylen_t)+sizeof(uint64_t)+1+sizeOfDouble)) return -1;
-    if (dbid) *dbid = *(int*)raw;
-    raw += sizeof(int), rawlen -= sizeof(int);
-    keylen_ = *(keylen_t*)raw;
-    if (keylen) *keylen = keylen_;
-    raw += sizeof(keylen_t), rawlen -= sizeof(keylen_t);
-    if (key) *key = raw;
-    if (rawlen < (int)keylen_) return -1;
-    raw += keylen_, rawlen -= keylen_;
+    size_t prefixlen;
+    if (raw == NULL || rawlen < 0) return -1;
+    prefixlen = rocksDecodeKeyPrefix(server.swap_key_format_active,raw,
+            rawlen,dbid,key,keylen);
+    if (prefixlen == 0) return -1;
+    raw += prefixlen, rawlen -= prefixlen;
+    if (rawlen < (int)(sizeof(uint64_t)+1)) return -1;
     if (version) {
         uint64_t encoded_version = *(uint64_t*)raw;
         *version = rocksDecodeVersion(encoded_version);
@@ -443,6 +588,7 @@ int decodeScoreKey(const char* raw, int rawlen, int* dbid, const char** key,
     uint8_t subkeyflag = raw[0];
     raw++, rawlen--;
     if (subkeyflag == ROCKS_KEY_FLAG_SUBKEY) {
+        if (rawlen < (int)sizeOfDouble) return -1;
         int double_offset = decodeDouble(raw, score);
         raw += double_offset;
         rawlen -= double_offset;
@@ -710,6 +856,136 @@ int swapUtilTest(int argc, char **argv, int accurate) {
         sdsfree(key), sdsfree(empty), sdsfree(subkey);
     }
 
+    TEST("util - key format") {
+        int saved_format = server.swap_key_format_active;
+        sds key = sdsnew("key"), subkey = sdsnew("subkey");
+        int dbids[] = {0, 1, 127, 128, 16383, 16384, 2097152, 268435456, INT_MAX};
+        size_t ndbids = sizeof(dbids)/sizeof(int);
+
+        for (int format = 0; format < SWAP_KEY_FORMAT_TYPES; format++) {
+            server.swap_key_format_active = format;
+            for (size_t i = 0; i < ndbids; i++) {
+                int dbid;
+                const char *k, *sk;
+                size_t klen, sklen;
+                uint64_t version;
+                sds metaKey = encodeMetaKey(dbids[i],key,sdslen(key));
+                sds dataKey = _rocksEncodeDataKey(dbids[i],key,7,ROCKS_KEY_FLAG_SUBKEY,subkey);
+                sds start = rocksEncodeDbRangeStartKey(dbids[i]);
+
+                test_assert(!rocksDecodeMetaKey(metaKey,sdslen(metaKey),&dbid,&k,&klen));
+                test_assert(dbid == dbids[i] && klen == 3 && !memcmp(k,"key",3));
+                test_assert(!rocksDecodeDataKey(dataKey,sdslen(dataKey),&dbid,&k,&klen,&version,&sk,&sklen));
+                test_assert(dbid == dbids[i] && klen == 3 && version == 7);
+                test_assert(sklen == 6 && !memcmp(sk,"subkey",6));
+                test_assert(!memcmp(metaKey,dataKey,sdslen(metaKey)));
+                test_assert(!memcmp(start,metaKey,sdslen(start)));
+
+                for (int to = 0; to < SWAP_KEY_FORMAT_TYPES; to++) {
+                    sds transcoded = rocksTranscodeKey(format,to,dataKey,sdslen(dataKey));
+                    sds back = rocksTranscodeKey(to,format,transcoded,sdslen(transcoded));
+                    test_assert(!sdscmp(back,dataKey));
+                    sdsfree(transcoded), sdsfree(back);
+                }
+
+                /* compact format orders dbs numerically. */
+                if (format == SWAP_KEY_FORMAT_COMPACT && dbids[i] != INT_MAX) {
+                    sds end = rocksEncodeDbRangeEndKey(dbids[i]);
+                    test_assert(sdscmp(start,metaKey) < 0);
+                    test_assert(sdscmp(dataKey,end) < 0);
+                    if (i > 0) {
+                        sds prev = rocksEncodeDbRangeStartKey(dbids[i-1]);
+                        test_assert(sdscmp(prev,start) < 0);
+                        sdsfree(prev);
+                    }
+                    sdsfree(end);
+                }
+                sdsfree(metaKey), sdsfree(dataKey), sdsfree(start);
+            }
+        }
+
+        server.swap_key_format_active = SWAP_KEY_FORMAT_COMPACT;
+        sds compactKey = rocksEncodeDataKey(db,key,7,subkey);
+        server.swap_key_format_active = SWAP_KEY_FORMAT_LEGACY;
+        sds legacyKey = rocksEncodeDataKey(db,key,7,subkey);
+        test_assert(sdslen(legacyKey) - sdslen(compactKey) == 6);
+        sdsfree(compactKey), sdsfree(legacyKey);
+
+        server.swap_key_format_active = saved_format;
+        sdsfree(key), sdsfree(subkey);
+    }
+
+    TEST("util - data key prefix") {
+        int saved_format = server.swap_key_format_active;
+        sds key = sdsnew("key"), subkey = sdsnew("subkey");
+        sds start, end, dataKey, scoreKey, metaKey;
+        size_t prefixlen;
+
+        for (int format = 0; format < SWAP_KEY_FORMAT_TYPES; format++) {
+            server.swap_key_format_active = format;
+            start = rocksEncodeDataRangeStartKey(db,key,12345678);
+            end = rocksEncodeDataRangeEndKey(db,key,12345678);
+            dataKey = rocksEncodeDataKey(db,key,12345678,subkey);
+            scoreKey = encodeScoreKey(db,key,12345678,1.0,subkey);
+            metaKey = rocksEncodeMetaKey(db,key);
+
+            prefixlen = rocksDecodeDataKeyPrefixLen(start,sdslen(start));
+            test_assert(prefixlen == rocksKeyPrefixLen(format,db->id,sdslen(key))+sizeof(uint64_t));
+            test_assert(rocksDecodeDataKeyPrefixLen(end,sdslen(end)) == prefixlen);
+            test_assert(rocksDecodeDataKeyPrefixLen(dataKey,sdslen(dataKey)) == prefixlen);
+            test_assert(rocksDecodeDataKeyPrefixLen(scoreKey,sdslen(scoreKey)) == prefixlen);
+            test_assert(!memcmp(start,dataKey,prefixlen) && !memcmp(start,scoreKey,prefixlen));
+            test_assert(rocksDecodeDataKeyPrefixLen(metaKey,sdslen(metaKey)) == 0);
+            test_assert(rocksDecodeDataKeyPrefixLen(start,prefixlen) == prefixlen);
+            test_assert(rocksDecodeDataKeyPrefixLen(start,prefixlen-1) == 0);
+
+            sdsfree(start), sdsfree(end), sdsfree(dataKey), sdsfree(scoreKey), sdsfree(metaKey);
+        }
+
+        server.swap_key_format_active = saved_format;
+        sdsfree(key), sdsfree(subkey);
+    }
+
+    TEST("util - encode & decode expire key") {
+        int saved_format = server.swap_key_format_active;
+        sds key = sdsnew("key"), empty = sdsempty();
+
+        for (int format = 0; format < SWAP_KEY_FORMAT_TYPES; format++) {
+            int dbid;
+            long long expire;
+            const char *k;
+            size_t klen;
+            sds early, late, bound, start, transcoded;
+
+            server.swap_key_format_active = format;
+            early = rocksEncodeExpireKey(3,255,key);
+            late = rocksEncodeExpireKey(3,256,empty);
+            bound = rocksEncodeExpireKey(3,255,NULL);
+            start = rocksEncodeDbRangeStartKey(3);
+
+            test_assert(!rocksDecodeExpireKey(early,sdslen(early),&dbid,&expire,&k,&klen));
+            test_assert(dbid == 3 && expire == 255 && klen == 3 && !memcmp(k,"key",3));
+            test_assert(!rocksDecodeExpireKey(late,sdslen(late),&dbid,&expire,&k,&klen));
+            test_assert(dbid == 3 && expire == 256 && klen == 0);
+            test_assert(rocksDecodeExpireKey(bound,sdslen(bound)-1,NULL,NULL,NULL,NULL));
+            /* ordered by expire inside db, prefixed by db range start */
+            test_assert(sdscmp(early,late) < 0);
+            test_assert(!memcmp(early,bound,sdslen(bound)));
+            test_assert(!memcmp(early,start,sdslen(start)));
+
+            transcoded = rocksTranscodeKey(format,!format,early,sdslen(early));
+            server.swap_key_format_active = !format;
+            test_assert(!rocksDecodeExpireKey(transcoded,sdslen(transcoded),&dbid,&expire,&k,&klen));
+            test_assert(dbid == 3 && expire == 255 && klen == 3 && !memcmp(k,"key",3));
+
+            sdsfree(early), sdsfree(late), sdsfree(bound), sdsfree(start);
+            sdsfree(transcoded);
+        }
+
+        server.swap_key_format_active = saved_format;
+        sdsfree(key), sdsfree(empty);
+    }
+
     return error;
 }
 
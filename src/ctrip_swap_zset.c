@@ -80,7 +80,9 @@ static int zsetSwapAnaOutSelectSubkeys(swapData *data, zsetDataCtx *datactx,
     *may_keep_data = 1;
     if (select_type == SELECT_MAIN) {
         robj *subkey;
+        evictKeptSubkeys kept;
         int len = zsetLength(subkeys);
+        evictKeptSubkeysInit(&kept,len,count);
         if (len > 0) {
             if (subkeys->encoding == OBJ_ENCODING_ZIPLIST) {
                 unsigned char *zl = subkeys->ptr;
@@ -100,19 +102,24 @@ static int zsetSwapAnaOutSelectSubkeys(swapData *data, zsetDataCtx *datactx,
                         break;
                     }
 
+                    size_t memory;
                     vlong = 0;
                     ziplistGet(eptr, &vstr, &vlen, &vlong);
-                    evict_memory += vlen;
+                    memory = vlen;
                     if (vstr != NULL) {
                         subkey = createStringObject((const char*)vstr, vlen);
                     } else {
                         subkey = createObject(OBJ_STRING,sdsfromlonglong(vlong));
                     }
-                    datactx->bdc.subkeys[datactx->bdc.num++] = subkey;
                     ziplistGet(sptr, &vstr, &vlen, &vlong);
-                    evict_memory += vlen;
-
+                    memory += vlen;
                     zzlNext(zl, &eptr, &sptr);
+
+                    /* Recently accessed members are evicted only if not
+                     * enough cold members found. */
+                    if (evictKeptSubkeysKeep(&kept,data,subkey,memory)) continue;
+                    datactx->bdc.subkeys[datactx->bdc.num++] = subkey;
+                    evict_memory += memory;
                 }
             } else if (subkeys->encoding == OBJ_ENCODING_SKIPLIST) {
                 zset *zs = subkeys->ptr;
@@ -128,6 +135,8 @@ static int zsetSwapAnaOutSelectSubkeys(swapData *data, zsetDataCtx *datactx,
                     }
                     sds skey = dictGetKey(de);
                     subkey = createStringObject(skey, sdslen(skey));
+                    if (evictKeptSubkeysKeep(&kept,data,subkey,
+                                sizeof(zset) + sizeof(dictEntry))) continue;
                     datactx->bdc.subkeys[datactx->bdc.num++] = subkey;
                     evict_memory += sizeof(zset) + sizeof(dictEntry);
                 }
@@ -136,12 +145,17 @@ static int zsetSwapAnaOutSelectSubkeys(swapData *data, zsetDataCtx *datactx,
                 serverPanic("unknown zset encoding");
             }
         }
+        if (evictKeptSubkeysDeinit(&kept,datactx->bdc.subkeys,
+                    &datactx->bdc.num,count,&evict_memory) && !noswap)
+            *may_keep_data = 0;
     } else {
         robj *subkey;
         size_t sublen;
         dirtySubkeysIterator dss_iter;
         list *redundent_subkeys = listCreate();
+        evictKeptSubkeys kept;
 
+        evictKeptSubkeysInit(&kept,dirtySubkeysLength(subkeys),count);
         dirtySubkeysIteratorInit(&dss_iter, subkeys);
         while ((subkey = dirtySubkeysIteratorNext(&dss_iter,&sublen)) != NULL) {
             if ((size_t)datactx->bdc.num >= count ||
@@ -155,6 +169,7 @@ static int zsetSwapAnaOutSelectSubkeys(swapData *data, zsetDataCtx *datactx,
             /* check with lock hold so that evicting subkeys must exist. */
             double score;
             if (zsetScore(data->value,subkey->ptr, &score) == C_OK) {
+                if (evictKeptSubkeysKeep(&kept,data,subkey,sublen)) continue;
                 datactx->bdc.subkeys[datactx->bdc.num++] = subkey;
                 evict_memory += sublen;
             } else {
@@ -162,6 +177,9 @@ static int zsetSwapAnaOutSelectSubkeys(swapData *data, zsetDataCtx *datactx,
             }
         }
         dirtySubkeysIteratorDeinit(&dss_iter);
+        if (evictKeptSubkeysDeinit(&kept,datactx->bdc.subkeys,
+                    &datactx->bdc.num,count,&evict_memory) && !noswap)
+            *may_keep_data = 0;
 
         listIter li;
         listNode *ln;
@@ -178,6 +196,11 @@ static int zsetSwapAnaOutSelectSubkeys(swapData *data, zsetDataCtx *datactx,
 }
 
 
+static int zsetContainsMember(robj *zobj, sds member) {
+    double score;
+    return zsetScore(zobj,member,&score) == C_OK;
+}
+
 int zsetSwapAna(swapData *data, int thd, struct keyRequest *req,
         int *intention, uint32_t *intention_flags, void *datactx_) {
     zsetDataCtx *datactx = datactx_;
@@ -190,6 +213,8 @@ int zsetSwapAna(swapData *data, int thd, struct keyRequest *req,
         *intention_flags = 0;
         break;
     case SWAP_IN:
+        if (thd == SWAP_ANA_THD_MAIN)
+            swapDataTouchSubkeys(data,req,zsetLength,zsetContainsMember);
         if (!swapDataPersisted(data)) {
             /* No need to swap for pure hot key */
             *intention = SWAP_NOP;
@@ -272,6 +297,13 @@ int zsetSwapAna(swapData *data, int thd, struct keyRequest *req,
             } else if (meta->len == 0) {
                 *intention = SWAP_NOP;
                 *intention_flags = 0;
+            } else if ((cmd_intention_flags & SWAP_IN_RANK) && data->value) {
+                /* ZRANK on warm zset: rank depends on both hot and cold
+                 * members, swap in entire zset. */
+                datactx->bdc.num = 0;
+                datactx->bdc.subkeys = NULL;
+                *intention = SWAP_IN;
+                *intention_flags = 0;
             } else {
                 datactx->bdc.num = 0;
                 datactx->bdc.subkeys = zmalloc(req->b.num_subkeys * sizeof(robj *));
@@ -287,6 +319,12 @@ int zsetSwapAna(swapData *data, int thd, struct keyRequest *req,
                 }
                 *intention = datactx->bdc.num > 0 ? SWAP_IN : SWAP_NOP;
                 *intention_flags = 0;
+                if ((cmd_intention_flags & SWAP_IN_RANK) && datactx->bdc.num) {
+                    /* ZRANK on cold zset: swap in member only, rank
+                     * counted in score cf. */
+                    datactx->type = TYPE_ZR;
+                    datactx->zr.rank = -1;
+                }
             }
         }
 
@@ -340,7 +378,7 @@ int zsetSwapAnaAction(swapData *data, int intention, void *datactx_, int *action
     zsetDataCtx *datactx = datactx_;
     switch (intention) {
         case SWAP_IN:
-            if (datactx->type != TYPE_NONE) {
+            if (datactx->type == TYPE_ZS) {
                 *action = ROCKS_ITERATE;
             } else if (datactx->bdc.num) { /* Swap in specific fields */
                 *action = ROCKS_GET;
@@ -404,7 +442,7 @@ int zsetEncodeKeys(swapData *data, int intention, void *datactx_,
     uint64_t version = swapDataObjectVersion(data);
 
     serverAssert(intention == SWAP_IN);
-    serverAssert(datactx->type == TYPE_NONE);
+    serverAssert(datactx->type == TYPE_NONE || datactx->type == TYPE_ZR);
     serverAssert(datactx->bdc.num);
 
     cfs = zmalloc(sizeof(int)*datactx->bdc.num);
@@ -715,12 +753,41 @@ int zsetSwapDel(swapData *data, void *datactx_, int del_skip) {
     }
 }
 
+/* Count members ordered before the swapped in member in score cf (which
+ * is sorted by score then member), so that ZRANK of cold zset could be
+ * served without swapping in all members. */
+static void zsetSwapInCountRank(swapData *data, zsetDataCtx *datactx,
+        robj *decoded) {
+    RIO _rio, *rio = &_rio;
+    sds subkey = datactx->bdc.subkeys[0]->ptr;
+    uint64_t version = swapDataObjectVersion(data);
+    double score;
+
+    datactx->zr.rank = -1;
+    if (decoded == NULL || zsetScore(decoded,subkey,&score) == C_ERR)
+        return;
+
+    RIOInitIterate(rio,SCORE_CF,
+            ROCKS_ITERATE_COUNT_ONLY|ROCKS_ITERATE_HIGH_BOUND_EXCLUDE,
+            rocksEncodeDataRangeStartKey(data->db,data->key->ptr,version),
+            zsetEncodeScoreKey(data->db,data->key->ptr,version,subkey,score),
+            ROCKS_ITERATE_NO_LIMIT);
+    RIODo(rio);
+    if (!RIOGetError(rio)) datactx->zr.rank = rio->iterate.count;
+    RIODeinit(rio);
+}
+
 /* Decoded moved back by exec to zsetSwapData */
-void *zsetCreateOrMergeObject(swapData *data, void *decoded_, void *datactx) {
+void *zsetCreateOrMergeObject(swapData *data, void *decoded_, void *datactx_) {
     robj *result, *decoded = (robj*)decoded_;
-    UNUSED(datactx);
+    zsetDataCtx *datactx = datactx_;
     serverAssert(decoded == NULL || decoded->type == OBJ_ZSET);
 
+    if (datactx->type == TYPE_ZR) {
+        serverAssert(swapDataIsCold(data));
+        zsetSwapInCountRank(data,datactx,decoded);
+    }
+
     if (swapDataIsCold(data) || decoded == NULL) {
         /* decoded moved back to swap framework again (result will later be
          * pass as swapIn param). */
@@ -895,6 +962,13 @@ int zsetRocksDel(struct swapData *data_,  void *datactx_, int inaction,
     return 0;
 }
 
+int zsetBeforeCall(swapData *data, client *c, void *datactx_) {
+    zsetDataCtx *datactx = datactx_;
+    UNUSED(data);
+    if (datactx->type == TYPE_ZR) c->swap_zrank = datactx->zr.rank;
+    return 0;
+}
+
 void *zsetGetObjectMetaAux(swapData *data, void *datactx) {
     UNUSED(datactx);
     size_t hotlen = data->value ? zsetLength(data->value) : 0;
@@ -915,6 +989,7 @@ swapDataType zsetSwapDataType = {
     .swapDel = zsetSwapDel,
     .createOrMergeObject = zsetCreateOrMergeObject,
     .cleanObject = zsetCleanObject,
+    .beforeCall = zsetBeforeCall,
     .rocksDel = zsetRocksDel,
     .free = freeZsetSwapData,
     .mergedIsHot = zsetMergedIsHot,
@@ -842,6 +842,18 @@ void keysCommand(client *c) {
         }
     }
     dictReleaseIterator(di);
+
+    /* Cold keys are scanned (and matched) from rocksdb meta chunk by chunk
+     * before call, keys in db.dict are already replied above. */
+    if (server.swap_mode != SWAP_MODE_MEMORY && !server.in_exec &&
+            c->swap_keys_reply != NULL) {
+        addReplyProto(c,c->swap_keys_reply,sdslen(c->swap_keys_reply));
+        numkeys += c->swap_keys_count;
+        sdsfree(c->swap_keys_reply);
+        c->swap_keys_reply = NULL;
+        c->swap_keys_count = 0;
+    }
+
     setDeferredArrayLen(c,replylen,numkeys);
 }
 
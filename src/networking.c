@@ -205,10 +205,21 @@ client *createClient(connection *conn) {
     c->CLIENT_DEFERED_CLOSING = 0;
     c->CLIENT_REPL_SWAPPING = 0;
     c->CLIENT_REPL_CMD_DISCARDED = 0;
+    c->CLIENT_REPL_CMD_APPLIED = 0;
+    c->CLIENT_REPL_CMD_BARRIER = 0;
+    c->repl_dispatch_time = 0;
+    c->repl_applied_ahead = NULL;
     c->swap_locks = listCreate();
     c->swap_metas = NULL;
     c->swap_errcode = 0;
     c->swap_arg_rewrites = argRewritesCreate();
+    c->swap_zrank = -1;
+    c->swap_stream_replied = 0;
+    c->swap_strlen = -1;
+    c->swap_getrange = NULL;
+    c->swap_keys_reply = NULL;
+    c->swap_keys_count = 0;
+    c->swap_prefetched = 0;
     c->gtid_in_merge = 0;
     c->rate_limit_event_id = -1;
     c->duration = 0;
@@ -1536,6 +1547,9 @@ void freeClient(client *c) {
         c->swap_metas = NULL;
     }
     argRewritesFree(c->swap_arg_rewrites);
+    if (c->swap_getrange) sdsfree(c->swap_getrange);
+    if (c->swap_keys_reply) sdsfree(c->swap_keys_reply);
+    if (c->repl_applied_ahead) zfree(c->repl_applied_ahead);
     zfree(c);
 }
 
@@ -2239,6 +2253,9 @@ void processInputBuffer(client *c) {
             serverPanic("Unknown request type");
         }
 
+        /* One queued command consumed, see swapPrefetchPipeline. */
+        if (c->swap_prefetched) c->swap_prefetched--;
+
         /* Multibulk processing could see a <= 0 length. */
         if (c->argc == 0) {
             resetClient(c);
@@ -801,6 +801,78 @@ size_t rdbSaveStreamConsumers(rio *rdb, streamCG *cg) {
     return nwritten;
 }
 
+/* Serialize everything of a stream except the listpacks: number of items,
+ * last entry ID and the consumer groups. Split out of rdbSaveObject so that
+ * swap could keep stream metadata apart from the (possibly swapped out)
+ * listpack nodes. Returns -1 on error, number of bytes written on success. */
+ssize_t rdbSaveStreamMeta(rio *rdb, stream *s) {
+    ssize_t n, nwritten = 0;
+    raxIterator ri;
+
+    /* Save the number of elements inside the stream. We cannot obtain
+     * this easily later, since our macro nodes should be checked for
+     * number of items: not a great CPU / space tradeoff. */
+    if ((n = rdbSaveLen(rdb,s->length)) == -1) return -1;
+    nwritten += n;
+    /* Save the last entry ID. */
+    if ((n = rdbSaveLen(rdb,s->last_id.ms)) == -1) return -1;
+    nwritten += n;
+    if ((n = rdbSaveLen(rdb,s->last_id.seq)) == -1) return -1;
+    nwritten += n;
+
+    /* The consumer groups and their clients are part of the stream
+     * type, so serialize every consumer group. */
+
+    /* Save the number of groups. */
+    size_t num_cgroups = s->cgroups ? raxSize(s->cgroups) : 0;
+    if ((n = rdbSaveLen(rdb,num_cgroups)) == -1) return -1;
+    nwritten += n;
+
+    if (num_cgroups) {
+        /* Serialize each consumer group. */
+        raxStart(&ri,s->cgroups);
+        raxSeek(&ri,"^",NULL,0);
+        while(raxNext(&ri)) {
+            streamCG *cg = ri.data;
+
+            /* Save the group name. */
+            if ((n = rdbSaveRawString(rdb,ri.key,ri.key_len)) == -1) {
+                raxStop(&ri);
+                return -1;
+            }
+            nwritten += n;
+
+            /* Last ID. */
+            if ((n = rdbSaveLen(rdb,cg->last_id.ms)) == -1) {
+                raxStop(&ri);
+                return -1;
+            }
+            nwritten += n;
+            if ((n = rdbSaveLen(rdb,cg->last_id.seq)) == -1) {
+                raxStop(&ri);
+                return -1;
+            }
+            nwritten += n;
+
+            /* Save the global PEL. */
+            if ((n = rdbSaveStreamPEL(rdb,cg->pel,1)) == -1) {
+                raxStop(&ri);
+                return -1;
+            }
+            nwritten += n;
+
+            /* Save the consumers of this group. */
+            if ((n = rdbSaveStreamConsumers(rdb,cg)) == -1) {
+                raxStop(&ri);
+                return -1;
+            }
+            nwritten += n;
+        }
+        raxStop(&ri);
+    }
+    return nwritten;
+}
+
 /* Save a Redis object.
  * Returns -1 on error, number of bytes written on success. */
 ssize_t rdbSaveObject(rio *rdb, robj *o, robj *key) {
@@ -972,67 +1044,9 @@ ssize_t rdbSaveObject(rio *rdb, robj *o, robj *key) {
         }
         raxStop(&ri);
 
-        /* Save the number of elements inside the stream. We cannot obtain
-         * this easily later, since our macro nodes should be checked for
-         * number of items: not a great CPU / space tradeoff. */
-        if ((n = rdbSaveLen(rdb,s->length)) == -1) return -1;
-        nwritten += n;
-        /* Save the last entry ID. */
-        if ((n = rdbSaveLen(rdb,s->last_id.ms)) == -1) return -1;
+        /* Save length, last ID and consumer groups. */
+        if ((n = rdbSaveStreamMeta(rdb,s)) == -1) return -1;
         nwritten += n;
-        if ((n = rdbSaveLen(rdb,s->last_id.seq)) == -1) return -1;
-        nwritten += n;
-
-        /* The consumer groups and their clients are part of the stream
-         * type, so serialize every consumer group. */
-
-        /* Save the number of groups. */
-        size_t num_cgroups = s->cgroups ? raxSize(s->cgroups) : 0;
-        if ((n = rdbSaveLen(rdb,num_cgroups)) == -1) return -1;
-        nwritten += n;
-
-        if (num_cgroups) {
-            /* Serialize each consumer group. */
-            raxStart(&ri,s->cgroups);
-            raxSeek(&ri,"^",NULL,0);
-            while(raxNext(&ri)) {
-                streamCG *cg = ri.data;
-
-                /* Save the group name. */
-                if ((n = rdbSaveRawString(rdb,ri.key,ri.key_len)) == -1) {
-                    raxStop(&ri);
-                    return -1;
-                }
-                nwritten += n;
-
-                /* Last ID. */
-                if ((n = rdbSaveLen(rdb,cg->last_id.ms)) == -1) {
-                    raxStop(&ri);
-                    return -1;
-                }
-                nwritten += n;
-                if ((n = rdbSaveLen(rdb,cg->last_id.seq)) == -1) {
-                    raxStop(&ri);
-                    return -1;
-                }
-                nwritten += n;
-
-                /* Save the global PEL. */
-                if ((n = rdbSaveStreamPEL(rdb,cg->pel,1)) == -1) {
-                    raxStop(&ri);
-                    return -1;
-                }
-                nwritten += n;
-
-                /* Save the consumers of this group. */
-                if ((n = rdbSaveStreamConsumers(rdb,cg)) == -1) {
-                    raxStop(&ri);
-                    return -1;
-                }
-                nwritten += n;
-            }
-            raxStop(&ri);
-        }
     } else if (o->type == OBJ_MODULE) {
         /* Save a module-specific value. */
         RedisModuleIO io;
@@ -1266,8 +1280,16 @@ int rdbSaveRio(rio *rdb, int *error, int rdbflags, rdbSaveInfo *rsi) {
     if (rdbSaveInfoAuxFields(rdb,rdbflags,rsi) == -1) goto werr;
     if (rdbSaveModulesAux(rdb, REDISMODULE_AUX_BEFORE_RDB) == -1) goto werr;
 
+    /* Ship cold keys as rocks checkpoint files before keyspace, so that
+     * replica installs checkpoint before loading hot & warm keys. */
+    if (rsi && rsi->rocks_checkpoint) {
+        rdbflags |= RDBFLAGS_ROCKS_CHECKPOINT;
+        if (rdbSaveRocksCheckpoint(rdb) == -1) goto werr;
+    }
+
     for (j = 0; j < server.dbnum; j++) {
         redisDb *db = server.db+j;
+        long long warm_keys = 0;
         if (ctripDbSize(db) == 0) continue;
 
         /* Write the SELECT DB opcode */
@@ -1301,6 +1323,7 @@ int rdbSaveRio(rio *rdb, int *error, int rdbflags, rdbSaveInfo *rsi) {
 #ifdef ROCKS_DEBUG
                 serverLog(LL_NOTICE, "[rdbSaveRio] key(%s) not hot: skipped.",keystr);
 #endif
+                warm_keys++;
                 continue;
             } else {
 #ifdef ROCKS_DEBUG
@@ -1316,8 +1339,11 @@ int rdbSaveRio(rio *rdb, int *error, int rdbflags, rdbSaveInfo *rsi) {
         dictReleaseIterator(di);
         di = NULL;
 
-        /* Iterate DB.rocks writing every entry */
-        if (rdbSaveRocks(rdb, error, db, rdbflags)) goto werr;
+        /* Iterate DB.rocks writing every entry, only warm keys are saved
+         * if cold keys shipped within rocks checkpoint. */
+        if (!(rdbflags & RDBFLAGS_ROCKS_CHECKPOINT) || warm_keys) {
+            if (rdbSaveRocks(rdb, error, db, rdbflags)) goto werr;
+        }
 
         dbResumeRehash(db);
     }
@@ -1585,6 +1611,167 @@ robj *rdbLoadCheckModuleValue(rio *rdb, char *modulename) {
     return createStringObject("module-dummy-value",18);
 }
 
+/* Load everything of a stream saved by rdbSaveStreamMeta() into 's'.
+ * Returns C_OK on success, C_ERR on error (the stream is left for the caller
+ * to release). */
+int rdbLoadStreamMeta(rio *rdb, stream *s, int deep_integrity_validation) {
+    /* Load total number of items inside the stream. */
+    s->length = rdbLoadLen(rdb,NULL);
+
+    /* Load the last entry ID. */
+    s->last_id.ms = rdbLoadLen(rdb,NULL);
+    s->last_id.seq = rdbLoadLen(rdb,NULL);
+
+    if (rioGetReadError(rdb)) {
+        rdbReportReadError("Stream object metadata loading failed.");
+        return C_ERR;
+    }
+
+    /* Consumer groups loading */
+    uint64_t cgroups_count = rdbLoadLen(rdb,NULL);
+    if (cgroups_count == RDB_LENERR) {
+        rdbReportReadError("Stream cgroup count loading failed.");
+        return C_ERR;
+    }
+    while(cgroups_count--) {
+        /* Get the consumer group name and ID. We can then create the
+         * consumer group ASAP and populate its structure as
+         * we read more data. */
+        streamID cg_id;
+        sds cgname = rdbGenericLoadStringObject(rdb,RDB_LOAD_SDS,NULL);
+        if (cgname == NULL) {
+            rdbReportReadError(
+                "Error reading the consumer group name from Stream");
+            return C_ERR;
+        }
+
+        cg_id.ms = rdbLoadLen(rdb,NULL);
+        cg_id.seq = rdbLoadLen(rdb,NULL);
+        if (rioGetReadError(rdb)) {
+            rdbReportReadError("Stream cgroup ID loading failed.");
+            sdsfree(cgname);
+            return C_ERR;
+        }
+
+        streamCG *cgroup = streamCreateCG(s,cgname,sdslen(cgname),&cg_id);
+        if (cgroup == NULL) {
+            rdbReportCorruptRDB("Duplicated consumer group name %s",
+                                     cgname);
+            sdsfree(cgname);
+            return C_ERR;
+        }
+        sdsfree(cgname);
+
+        /* Load the global PEL for this consumer group, however we'll
+         * not yet populate the NACK structures with the message
+         * owner, since consumers for this group and their messages will
+         * be read as a next step. So for now leave them not resolved
+         * and later populate it. */
+        uint64_t pel_size = rdbLoadLen(rdb,NULL);
+        if (pel_size == RDB_LENERR) {
+            rdbReportReadError("Stream PEL size loading failed.");
+            return C_ERR;
+        }
+        while(pel_size--) {
+            unsigned char rawid[sizeof(streamID)];
+            if (rioRead(rdb,rawid,sizeof(rawid)) == 0) {
+                rdbReportReadError("Stream PEL ID loading failed.");
+                return C_ERR;
+            }
+            streamNACK *nack = streamCreateNACK(NULL);
+            nack->delivery_time = rdbLoadMillisecondTime(rdb,RDB_VERSION);
+            nack->delivery_count = rdbLoadLen(rdb,NULL);
+            if (rioGetReadError(rdb)) {
+                rdbReportReadError("Stream PEL NACK loading failed.");
+                streamFreeNACK(nack);
+                return C_ERR;
+            }
+            if (!raxTryInsert(cgroup->pel,rawid,sizeof(rawid),nack,NULL)) {
+                rdbReportCorruptRDB("Duplicated global PEL entry "
+                                        "loading stream consumer group");
+                streamFreeNACK(nack);
+                return C_ERR;
+            }
+        }
+
+        /* Now that we loaded our global PEL, we need to load the
+         * consumers and their local PELs. */
+        uint64_t consumers_num = rdbLoadLen(rdb,NULL);
+        if (consumers_num == RDB_LENERR) {
+            rdbReportReadError("Stream consumers num loading failed.");
+            return C_ERR;
+        }
+        while(consumers_num--) {
+            sds cname = rdbGenericLoadStringObject(rdb,RDB_LOAD_SDS,NULL);
+            if (cname == NULL) {
+                rdbReportReadError(
+                    "Error reading the consumer name from Stream group.");
+                return C_ERR;
+            }
+            streamConsumer *consumer =
+                streamLookupConsumer(cgroup,cname,SLC_NONE,NULL);
+            sdsfree(cname);
+            consumer->seen_time = rdbLoadMillisecondTime(rdb,RDB_VERSION);
+            if (rioGetReadError(rdb)) {
+                rdbReportReadError("Stream short read reading seen time.");
+                return C_ERR;
+            }
+
+            /* Load the PEL about entries owned by this specific
+             * consumer. */
+            pel_size = rdbLoadLen(rdb,NULL);
+            if (pel_size == RDB_LENERR) {
+                rdbReportReadError(
+                    "Stream consumer PEL num loading failed.");
+                return C_ERR;
+            }
+            while(pel_size--) {
+                unsigned char rawid[sizeof(streamID)];
+                if (rioRead(rdb,rawid,sizeof(rawid)) == 0) {
+                    rdbReportReadError(
+                        "Stream short read reading PEL streamID.");
+                    return C_ERR;
+                }
+                streamNACK *nack = raxFind(cgroup->pel,rawid,sizeof(rawid));
+                if (nack == raxNotFound) {
+                    rdbReportCorruptRDB("Consumer entry not found in "
+                                            "group global PEL");
+                    return C_ERR;
+                }
+
+                /* Set the NACK consumer, that was left to NULL when
+                 * loading the global PEL. Then set the same shared
+                 * NACK structure also in the consumer-specific PEL. */
+                nack->consumer = consumer;
+                if (!raxTryInsert(consumer->pel,rawid,sizeof(rawid),nack,NULL)) {
+                    rdbReportCorruptRDB("Duplicated consumer PEL entry "
+                                            " loading a stream consumer "
+                                            "group");
+                    streamFreeNACK(nack);
+                    return C_ERR;
+                }
+            }
+        }
+
+        /* Verify that each PEL eventually got a consumer assigned to it. */
+        if (deep_integrity_validation) {
+            raxIterator ri_cg_pel;
+            raxStart(&ri_cg_pel,cgroup->pel);
+            raxSeek(&ri_cg_pel,"^",NULL,0);
+            while(raxNext(&ri_cg_pel)) {
+                streamNACK *nack = ri_cg_pel.data;
+                if (!nack->consumer) {
+                    raxStop(&ri_cg_pel);
+                    rdbReportCorruptRDB("Stream CG PEL entry without consumer");
+                    return C_ERR;
+                }
+            }
+            raxStop(&ri_cg_pel);
+        }
+    }
+    return C_OK;
+}
+
 /* Load a Redis object of the specified type from the specified file.
  * On success a newly allocated object is returned, otherwise NULL.
  * When the function returns NULL and if 'error' is not NULL, the
@@ -2149,177 +2336,11 @@ robj *rdbLoadObject(int rdbtype, rio *rdb, sds key, int *error) {
                 return NULL;
             }
         }
-        /* Load total number of items inside the stream. */
-        s->length = rdbLoadLen(rdb,NULL);
-
-        /* Load the last entry ID. */
-        s->last_id.ms = rdbLoadLen(rdb,NULL);
-        s->last_id.seq = rdbLoadLen(rdb,NULL);
-
-        if (rioGetReadError(rdb)) {
-            rdbReportReadError("Stream object metadata loading failed.");
-            decrRefCount(o);
-            return NULL;
-        }
-
-        /* Consumer groups loading */
-        uint64_t cgroups_count = rdbLoadLen(rdb,NULL);
-        if (cgroups_count == RDB_LENERR) {
-            rdbReportReadError("Stream cgroup count loading failed.");
+        /* Load length, last ID and consumer groups. */
+        if (rdbLoadStreamMeta(rdb,s,deep_integrity_validation) == C_ERR) {
             decrRefCount(o);
             return NULL;
         }
-        while(cgroups_count--) {
-            /* Get the consumer group name and ID. We can then create the
-             * consumer group ASAP and populate its structure as
-             * we read more data. */
-            streamID cg_id;
-            sds cgname = rdbGenericLoadStringObject(rdb,RDB_LOAD_SDS,NULL);
-            if (cgname == NULL) {
-                rdbReportReadError(
-                    "Error reading the consumer group name from Stream");
-                decrRefCount(o);
-                return NULL;
-            }
-
-            cg_id.ms = rdbLoadLen(rdb,NULL);
-            cg_id.seq = rdbLoadLen(rdb,NULL);
-            if (rioGetReadError(rdb)) {
-                rdbReportReadError("Stream cgroup ID loading failed.");
-                sdsfree(cgname);
-                decrRefCount(o);
-                return NULL;
-            }
-
-            streamCG *cgroup = streamCreateCG(s,cgname,sdslen(cgname),&cg_id);
-            if (cgroup == NULL) {
-                rdbReportCorruptRDB("Duplicated consumer group name %s",
-                                         cgname);
-                decrRefCount(o);
-                sdsfree(cgname);
-                return NULL;
-            }
-            sdsfree(cgname);
-
-            /* Load the global PEL for this consumer group, however we'll
-             * not yet populate the NACK structures with the message
-             * owner, since consumers for this group and their messages will
-             * be read as a next step. So for now leave them not resolved
-             * and later populate it. */
-            uint64_t pel_size = rdbLoadLen(rdb,NULL);
-            if (pel_size == RDB_LENERR) {
-                rdbReportReadError("Stream PEL size loading failed.");
-                decrRefCount(o);
-                return NULL;
-            }
-            while(pel_size--) {
-                unsigned char rawid[sizeof(streamID)];
-                if (rioRead(rdb,rawid,sizeof(rawid)) == 0) {
-                    rdbReportReadError("Stream PEL ID loading failed.");
-                    decrRefCount(o);
-                    return NULL;
-                }
-                streamNACK *nack = streamCreateNACK(NULL);
-                nack->delivery_time = rdbLoadMillisecondTime(rdb,RDB_VERSION);
-                nack->delivery_count = rdbLoadLen(rdb,NULL);
-                if (rioGetReadError(rdb)) {
-                    rdbReportReadError("Stream PEL NACK loading failed.");
-                    decrRefCount(o);
-                    streamFreeNACK(nack);
-                    return NULL;
-                }
-                if (!raxTryInsert(cgroup->pel,rawid,sizeof(rawid),nack,NULL)) {
-                    rdbReportCorruptRDB("Duplicated global PEL entry "
-                                            "loading stream consumer group");
-                    decrRefCount(o);
-                    streamFreeNACK(nack);
-                    return NULL;
-                }
-            }
-
-            /* Now that we loaded our global PEL, we need to load the
-             * consumers and their local PELs. */
-            uint64_t consumers_num = rdbLoadLen(rdb,NULL);
-            if (consumers_num == RDB_LENERR) {
-                rdbReportReadError("Stream consumers num loading failed.");
-                decrRefCount(o);
-                return NULL;
-            }
-            while(consumers_num--) {
-                sds cname = rdbGenericLoadStringObject(rdb,RDB_LOAD_SDS,NULL);
-                if (cname == NULL) {
-                    rdbReportReadError(
-                        "Error reading the consumer name from Stream group.");
-                    decrRefCount(o);
-                    return NULL;
-                }
-                streamConsumer *consumer =
-                    streamLookupConsumer(cgroup,cname,SLC_NONE,NULL);
-                sdsfree(cname);
-                consumer->seen_time = rdbLoadMillisecondTime(rdb,RDB_VERSION);
-                if (rioGetReadError(rdb)) {
-                    rdbReportReadError("Stream short read reading seen time.");
-                    decrRefCount(o);
-                    return NULL;
-                }
-
-                /* Load the PEL about entries owned by this specific
-                 * consumer. */
-                pel_size = rdbLoadLen(rdb,NULL);
-                if (pel_size == RDB_LENERR) {
-                    rdbReportReadError(
-                        "Stream consumer PEL num loading failed.");
-                    decrRefCount(o);
-                    return NULL;
-                }
-                while(pel_size--) {
-                    unsigned char rawid[sizeof(streamID)];
-                    if (rioRead(rdb,rawid,sizeof(rawid)) == 0) {
-                        rdbReportReadError(
-                            "Stream short read reading PEL streamID.");
-                        decrRefCount(o);
-                        return NULL;
-                    }
-                    streamNACK *nack = raxFind(cgroup->pel,rawid,sizeof(rawid));
-                    if (nack == raxNotFound) {
-                        rdbReportCorruptRDB("Consumer entry not found in "
-                                                "group global PEL");
-                        decrRefCount(o);
-                        return NULL;
-                    }
-
-                    /* Set the NACK consumer, that was left to NULL when
-                     * loading the global PEL. Then set the same shared
-                     * NACK structure also in the consumer-specific PEL. */
-                    nack->consumer = consumer;
-                    if (!raxTryInsert(consumer->pel,rawid,sizeof(rawid),nack,NULL)) {
-                        rdbReportCorruptRDB("Duplicated consumer PEL entry "
-                                                " loading a stream consumer "
-                                                "group");
-                        decrRefCount(o);
-                        streamFreeNACK(nack);
-                        return NULL;
-                    }
-                }
-            }
-
-            /* Verify that each PEL eventually got a consumer assigned to it. */
-            if (deep_integrity_validation) {
-                raxIterator ri_cg_pel;
-                raxStart(&ri_cg_pel,cgroup->pel);
-                raxSeek(&ri_cg_pel,"^",NULL,0);
-                while(raxNext(&ri_cg_pel)) {
-                    streamNACK *nack = ri_cg_pel.data;
-                    if (!nack->consumer) {
-                        raxStop(&ri_cg_pel);
-                        rdbReportCorruptRDB("Stream CG PEL entry without consumer");
-                        decrRefCount(o);
-                        return NULL;
-                    }
-                }
-                raxStop(&ri_cg_pel);
-            }
-        }
     } else if (rdbtype == RDB_TYPE_MODULE || rdbtype == RDB_TYPE_MODULE_2) {
         uint64_t moduleid = rdbLoadLen(rdb,NULL);
         if (rioGetReadError(rdb)) {
@@ -2578,6 +2599,10 @@ int rdbLoadRio(rio *rdb, int rdbflags, rdbSaveInfo *rsi) {
         } else if (type == RDB_OPCODE_EOF) {
             /* EOF: End of file, exit the main loop. */
             break;
+        } else if (type == RDB_OPCODE_ROCKS_FILE) {
+            /* ROCKS_FILE: rocks checkpoint file shipped by master. */
+            if (rdbLoadRocksCheckpointFile(rdb) == -1) goto eoferr;
+            continue; /* Read next opcode. */
         } else if (type == RDB_OPCODE_SELECTDB) {
             /* SELECTDB: Select the specified database. */
             if ((dbid = rdbLoadLen(rdb,NULL)) == RDB_LENERR) goto eoferr;
@@ -2855,6 +2880,12 @@ int rdbLoadRio(rio *rdb, int rdbflags, rdbSaveInfo *rsi) {
         }
     }
 
+    if (server.swap_mode != SWAP_MODE_MEMORY &&
+            ctripRdbLoadIngest() != C_OK) {
+        serverLog(LL_WARNING,"Ingest sst files of loaded RDB failed.");
+        return C_ERR;
+    }
+
     if (empty_keys_skipped) {
         serverLog(LL_WARNING,
             "Done loading RDB, keys loaded: %lld, keys expired: %lld, empty keys skipped: %lld.",
@@ -293,6 +293,31 @@ int redis_check_rdb(char *rdbfilename, FILE *fp) {
             robj *o = rdbLoadCheckModuleValue(&rdb,name);
             decrRefCount(o);
             continue; /* Read type again. */
+        } else if (type == RDB_OPCODE_ROCKS_FILE) {
+            /* ROCKS_FILE: rocks checkpoint file, name followed by chunks
+             * terminated by zero length, or end marker with key version. */
+            sds name;
+            uint64_t len;
+            rdbstate.doing = RDB_CHECK_DOING_READ_LEN;
+            if ((name = rdbGenericLoadStringObject(&rdb,RDB_LOAD_SDS,NULL)) == NULL)
+                goto eoferr;
+            if (sdslen(name) == 0) {
+                sdsfree(name);
+                if (rdbLoadLen(&rdb,NULL) == RDB_LENERR) goto eoferr;
+                continue; /* Read type again. */
+            }
+            rdbCheckInfo("ROCKS FILE %s", name);
+            sdsfree(name);
+            while ((len = rdbLoadLen(&rdb,NULL)) != 0) {
+                if (len == RDB_LENERR) goto eoferr;
+                while (len) {
+                    char buf[4096];
+                    size_t n = len > sizeof(buf) ? sizeof(buf) : len;
+                    if (rioRead(&rdb,buf,n) == 0) goto eoferr;
+                    len -= n;
+                }
+            }
+            continue; /* Read type again. */
         } else {
             if (!rdbIsObjectType(type)) {
                 rdbCheckError("Invalid object type: %d", type);
@@ -660,6 +660,15 @@ int startBgsaveForReplication(int mincapa) {
     /* Only do rdbSave* when rsiptr is not NULL,
      * otherwise slave will miss repl-stream-db. */
     if (rsiptr) {
+        /* Ship cold keys as rocks checkpoint files if all replicas are
+         * able to install them. */
+        if (server.swap_mode != SWAP_MODE_MEMORY &&
+                server.swap_repl_rocks_checkpoint_sync &&
+                (mincapa & SLAVE_CAPA_ROCKS_CHECKPOINT)) {
+            rsiptr->rocks_checkpoint = 1;
+            serverLog(LL_NOTICE,"Cold keys will be shipped as rocks checkpoint.");
+        }
+
         if (socket_target)
             retval = rdbSaveToSlavesSockets(rsiptr);
         else
@@ -959,6 +968,8 @@ void replconfCommand(client *c) {
                 c->slave_capa |= SLAVE_CAPA_EOF;
             else if (!strcasecmp(c->argv[j+1]->ptr,"psync2"))
                 c->slave_capa |= SLAVE_CAPA_PSYNC2;
+            else if (!strcasecmp(c->argv[j+1]->ptr,"rocks-checkpoint"))
+                c->slave_capa |= SLAVE_CAPA_ROCKS_CHECKPOINT;
         } else if (!strcasecmp(c->argv[j]->ptr,"ack")) {
             /* REPLCONF ACK is used by slave to inform the master the amount
              * of replication stream that it processed so far. It is an
@@ -2175,6 +2186,16 @@ int slaveTryPartialResynchronization(connection *conn, int read_reply) {
                 /* Master ID changed. */
                 serverLog(LL_WARNING,"Master replication ID changed to %s",new);
 
+                /* Commands applied ahead of our offset might be unknown to
+                 * the new master, full resync is needed to be consistent. */
+                if (replClientAppliedAheadCount(server.cached_master)) {
+                    serverLog(LL_WARNING,
+                        "Commands applied ahead of offset before master link lost, full resync needed.");
+                    replicationDiscardCachedMaster();
+                    sdsfree(reply);
+                    return PSYNC_TRY_LATER;
+                }
+
                 /* Set the old ID as our ID2, up to the current offset+1. */
                 memcpy(server.replid2,server.cached_master->replid,
                     sizeof(server.replid2));
@@ -2350,10 +2371,18 @@ void syncWithMaster(connection *conn) {
          *
          * EOF: supports EOF-style RDB transfer for diskless replication.
          * PSYNC2: supports PSYNC v2, so understands +CONTINUE <new repl ID>.
+         * ROCKS-CHECKPOINT: can install rocks checkpoint files shipped
+         * within RDB (swap mode only).
          *
          * The master will ignore capabilities it does not understand. */
-        err = sendCommand(conn,"REPLCONF",
-                "capa","eof","capa","psync2",NULL);
+        if (server.swap_mode != SWAP_MODE_MEMORY) {
+            err = sendCommand(conn,"REPLCONF",
+                    "capa","eof","capa","psync2",
+                    "capa","rocks-checkpoint",NULL);
+        } else {
+            err = sendCommand(conn,"REPLCONF",
+                    "capa","eof","capa","psync2",NULL);
+        }
         if (err) goto write_error;
 
         server.repl_state = REPL_STATE_RECEIVE_AUTH_REPLY;
@@ -2715,8 +2744,18 @@ void replicationSetMaster(char *ip, int port) {
 
 /* Cancel replication, setting the instance as a master itself. */
 void replicationUnsetMaster(void) {
+    int applied_ahead;
+
     if (server.masterhost == NULL) return; /* Nothing to do. */
 
+    /* Replicated commands might be applied ahead of reploff, finish the
+     * dispatched ones so that our offset covers them. Commands applied
+     * ahead before master link lost (recorded in cached master) can't be
+     * finished, sub-replicas have to full resync to get them. */
+    replClientFinishDispatchedCommands(server.master);
+    applied_ahead = (server.master && replClientAppliedAheadCount(server.master)) ||
+        (server.cached_master && replClientAppliedAheadCount(server.cached_master));
+
     /* Fire the master link modules event. */
     if (server.repl_state == REPL_STATE_CONNECTED)
         moduleFireServerEvent(REDISMODULE_EVENT_MASTER_LINK_CHANGE,
@@ -2740,6 +2779,11 @@ void replicationUnsetMaster(void) {
      * freeClient(server.master), since there we adjust the replication
      * offset trimming the final PINGs. See Github issue #7320. */
     shiftReplicationId();
+    if (applied_ahead) {
+        serverLog(LL_WARNING,
+            "Commands applied ahead of offset before promoted, sub-replicas need full resync.");
+        clearReplicationId2();
+    }
     /* Disconnecting all the slaves is required: we need to inform slaves
      * of the replication ID change (see shiftReplicationId() call). However
      * the slaves will be able to partially resync with us, so it will be
@@ -228,11 +228,11 @@ struct redisCommand redisCommandTable[] = {
 
     {"append",appendCommand,3,
      "write use-memory fast @string @swap_string",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,getKeyRequestsAppend,SWAP_IN,SWAP_IN_PARTIAL,1,1,1,0,0,0},
 
     {"strlen",strlenCommand,2,
      "read-only fast @string @swap_string",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,NULL,SWAP_IN,SWAP_IN_PARTIAL,1,1,1,0,0,0},
 
     {"del",delCommand,-2,
      "write @keyspace @swap_keyspace",
@@ -264,15 +264,15 @@ struct redisCommand redisCommandTable[] = {
 
     {"setrange",setrangeCommand,4,
      "write use-memory @string @swap_string",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,getKeyRequestsSetrange,SWAP_IN,SWAP_IN_PARTIAL,1,1,1,0,0,0},
 
     {"getrange",getrangeCommand,4,
      "read-only @string @swap_string",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,getKeyRequestsGetrange,SWAP_IN,SWAP_IN_PARTIAL,1,1,1,0,0,0},
 
     {"substr",getrangeCommand,4,
      "read-only @string @swap_string",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,getKeyRequestsGetrange,SWAP_IN,SWAP_IN_PARTIAL,1,1,1,0,0,0},
 
     {"incr",incrCommand,2,
      "write use-memory fast @string @swap_string",
@@ -425,7 +425,7 @@ struct redisCommand redisCommandTable[] = {
 
     {"smembers",sinterCommand,2,
      "read-only to-sort @set @swap_set",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,NULL,SWAP_IN,SWAP_IN_STREAM,1,1,1,0,0,0},
 
     {"sscan",sscanCommand,-3,
      "read-only random @set @swap_set",
@@ -517,7 +517,7 @@ struct redisCommand redisCommandTable[] = {
 
     {"zcard",zcardCommand,2,
      "read-only fast @sortedset @swap_zset",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,NULL,SWAP_IN,SWAP_IN_META,1,1,1,0,0,0},
 
     {"zscore",zscoreCommand,3,
      "read-only fast @sortedset @swap_zset",
@@ -529,11 +529,11 @@ struct redisCommand redisCommandTable[] = {
 
     {"zrank",zrankCommand,3,
      "read-only fast @sortedset @swap_zset",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,getKeyRequestsZrank,SWAP_IN,SWAP_IN_RANK,1,1,1,0,0,0},
 
     {"zrevrank",zrevrankCommand,3,
      "read-only fast @sortedset @swap_zset",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,getKeyRequestsZrank,SWAP_IN,SWAP_IN_RANK,1,1,1,0,0,0},
 
     {"zscan",zscanCommand,-3,
      "read-only random @sortedset @swap_zset",
@@ -601,15 +601,15 @@ struct redisCommand redisCommandTable[] = {
 
     {"hkeys",hkeysCommand,2,
      "read-only to-sort @hash @swap_hash",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,NULL,SWAP_IN,SWAP_IN_STREAM,1,1,1,0,0,0},
 
     {"hvals",hvalsCommand,2,
      "read-only to-sort @hash @swap_hash",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,NULL,SWAP_IN,SWAP_IN_STREAM,1,1,1,0,0,0},
 
     {"hgetall",hgetallCommand,2,
      "read-only random @hash @swap_hash",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,NULL,SWAP_IN,SWAP_IN_STREAM,1,1,1,0,0,0},
 
     {"hexists",hexistsCommand,3,
      "read-only fast @hash @swap_hash",
@@ -695,7 +695,7 @@ struct redisCommand redisCommandTable[] = {
 
     {"keys",keysCommand,2,
      "read-only to-sort @keyspace @dangerous @swap_keyspace",
-     0,NULL,NULL,SWAP_NOP,0,0,0,0,0,0,0},
+     0,NULL,getKeyRequestsMetaScan,SWAP_IN,SWAP_METASCAN_KEYS,0,0,0,0,0,0},
 
     {"scan",scanCommand,-2,
      "read-only random @keyspace @swap_keyspace",
@@ -1027,63 +1027,63 @@ struct redisCommand redisCommandTable[] = {
      0,NULL,NULL,SWAP_IN,0,2,2,1,0,0,0},
 
     {"xadd",xaddCommand,-5,
-     "write use-memory fast random @stream",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     "write use-memory fast random @stream @swap_stream",
+     0,NULL,getKeyRequestsXadd,SWAP_IN,0,1,1,1,0,0,0},
 
     {"xrange",xrangeCommand,-4,
-     "read-only @stream",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     "read-only @stream @swap_stream",
+     0,NULL,getKeyRequestsXrange,SWAP_IN,0,1,1,1,0,0,0},
 
     {"xrevrange",xrevrangeCommand,-4,
-     "read-only @stream",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     "read-only @stream @swap_stream",
+     0,NULL,getKeyRequestsXrevrange,SWAP_IN,0,1,1,1,0,0,0},
 
     {"xlen",xlenCommand,2,
-     "read-only fast @stream",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     "read-only fast @stream @swap_stream",
+     0,NULL,NULL,SWAP_IN,SWAP_IN_META,1,1,1,0,0,0},
 
     {"xread",xreadCommand,-4,
-     "read-only @stream @blocking",
-     0,xreadGetKeys,NULL,SWAP_IN,0,0,0,0,0,0,0},
+     "read-only @stream @blocking @swap_stream",
+     0,xreadGetKeys,getKeyRequestsXread,SWAP_IN,0,0,0,0,0,0,0},
 
     {"xreadgroup",xreadCommand,-7,
-     "write @stream @blocking",
+     "write @stream @blocking @swap_stream",
      0,xreadGetKeys,NULL,SWAP_IN,0,0,0,0,0,0,0},
 
     {"xgroup",xgroupCommand,-2,
-     "write use-memory @stream",
-     0,NULL,NULL,SWAP_NOP,0,2,2,1,0,0,0},
+     "write use-memory @stream @swap_stream",
+     0,NULL,NULL,SWAP_IN,SWAP_IN_META,2,2,1,0,0,0},
 
     {"xsetid",xsetidCommand,3,
-     "write use-memory fast @stream",
-     0,NULL,NULL,SWAP_NOP,0,1,1,1,0,0,0},
+     "write use-memory fast @stream @swap_stream",
+     0,NULL,getKeyRequestsXsetid,SWAP_IN,0,1,1,1,0,0,0},
 
     {"xack",xackCommand,-4,
-     "write fast random @stream",
-     0,NULL,NULL,SWAP_NOP,0,1,1,1,0,0,0},
+     "write fast random @stream @swap_stream",
+     0,NULL,NULL,SWAP_IN,SWAP_IN_META,1,1,1,0,0,0},
 
     {"xpending",xpendingCommand,-3,
-     "read-only random @stream",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     "read-only random @stream @swap_stream",
+     0,NULL,NULL,SWAP_IN,SWAP_IN_META,1,1,1,0,0,0},
 
     {"xclaim",xclaimCommand,-6,
-     "write random fast @stream",
+     "write random fast @stream @swap_stream",
      0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
 
     {"xautoclaim",xautoclaimCommand,-6,
-     "write random fast @stream",
+     "write random fast @stream @swap_stream",
      0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
 
     {"xinfo",xinfoCommand,-2,
-     "read-only random @stream",
+     "read-only random @stream @swap_stream",
      0,NULL,NULL,SWAP_IN,0,2,2,1,0,0,0},
 
     {"xdel",xdelCommand,-3,
-     "write fast @stream",
+     "write fast @stream @swap_stream",
      0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
 
     {"xtrim",xtrimCommand,-4,
-     "write random @stream",
+     "write random @stream @swap_stream",
      0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
 
     {"post",securityWarningCommand,-1,
@@ -2533,6 +2533,9 @@ void beforeSleep(struct aeEventLoop *eventLoop) {
 
     if (server.swap_mode != SWAP_MODE_MEMORY) swapEvictionFreedInrowReset(server.swap_eviction_ctx);
 
+    /* resume streamed replies paused by slow readers. */
+    if (server.swap_mode != SWAP_MODE_MEMORY) swapStreamResumePausedReplies();
+
     /* submit buffered swap request in current batch */
     swapBatchCtxFlush(server.swap_batch_ctx,SWAP_BATCH_FLUSH_BEFORE_SLEEP);
 
@@ -3671,7 +3674,10 @@ void InitServerLast() {
     server.swap_pause_type = CLIENT_PAUSE_OFF;
     server.swap_paused_keyrequests = listCreate();
     server.swap_resumed_keyrequests = listCreate();
-    rocksInit();
+    if (rocksInit()) {
+        serverLog(LL_WARNING, "Failed to init rocksdb, exiting.");
+        exit(1);
+    }
     server.util_task_manager = createRocksdbUtilTaskManager();
     asyncCompleteQueueInit();
     parallelSyncInit(server.ps_parallism_rdb);
@@ -4046,8 +4052,16 @@ void call(client *c, int flags) {
     dirty = server.dirty-dirty;
     if (dirty < 0) dirty = 0;
 
-    if (server.swap_mode != SWAP_MODE_MEMORY)
+    if (server.swap_mode != SWAP_MODE_MEMORY) {
         clientArgRewritesRestore(c);
+        c->swap_zrank = -1;
+        c->swap_stream_replied = 0;
+        c->swap_strlen = -1;
+        if (c->swap_getrange) {
+            sdsfree(c->swap_getrange);
+            c->swap_getrange = NULL;
+        }
+    }
 
     /* Update failed command calls if required.
      * We leverage a static variable (prev_err_count) to retain
@@ -4713,6 +4727,11 @@ int prepareForShutdown(int flags) {
         }
     }
 
+    /* Save cold filter snapshot so that restart needs not scan rocksdb. */
+    if (server.swap_mode != SWAP_MODE_MEMORY && server.swap_persist_enabled &&
+            !server.loading)
+        coldFiltersSaveSnapshot();
+
     /* Fire the shutdown modules event. */
     moduleFireServerEvent(REDISMODULE_EVENT_SHUTDOWN,0,NULL);
 
@@ -5592,6 +5611,8 @@ sds genRedisInfoString(const char *section) {
             server.repl_backlog_size,
             server.repl_backlog_off,
             server.repl_backlog_histlen);
+        if (server.swap_mode != SWAP_MODE_MEMORY)
+            info = genSwapCheckpointInfoString(info);
     }
 
     /* CPU */
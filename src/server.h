@@ -143,7 +143,7 @@ typedef long long ustime_t; /* microsecond time type. */
 #define STATS_METRIC_NET_INPUT 1    /* Bytes read to network .*/
 #define STATS_METRIC_NET_OUTPUT 2   /* Bytes written to network. */
 #define STATS_METRIC_COUNT_MEM 3
-#define STATS_METRIC_COUNT_SWAP 77 /* define directly here to avoid dependcy cycle, will be checked later. */
+#define STATS_METRIC_COUNT_SWAP 80 /* define directly here to avoid dependcy cycle, will be checked later. */
 #define STATS_METRIC_COUNT (STATS_METRIC_COUNT_SWAP + STATS_METRIC_COUNT_MEM)
 
 /* Protocol and I/O related defines */
@@ -233,6 +233,7 @@ extern int configOOMScoreAdjValuesDefaults[CONFIG_OOM_COUNT];
 #define CMD_SWAP_DATATYPE_SET (1ULL<<43)
 #define CMD_SWAP_DATATYPE_ZSET (1ULL<<44)
 #define CMD_SWAP_DATATYPE_LIST (1ULL<<45)
+#define CMD_SWAP_DATATYPE_STREAM (1ULL<<46)
 
 
 /* AOF states */
@@ -369,6 +370,7 @@ typedef enum {
 #define SLAVE_CAPA_NONE 0
 #define SLAVE_CAPA_EOF (1<<0)    /* Can parse the RDB EOF streaming format. */
 #define SLAVE_CAPA_PSYNC2 (1<<1) /* Supports PSYNC2 protocol. */
+#define SLAVE_CAPA_ROCKS_CHECKPOINT (1<<2) /* Can install rocks checkpoint files. */
 
 /* Synchronous read timeout - slave side */
 #define CONFIG_REPL_SYNCIO_TIMEOUT 5
@@ -1018,12 +1020,23 @@ typedef struct client {
     int CLIENT_DEFERED_CLOSING;
     int CLIENT_REPL_SWAPPING;
     int CLIENT_REPL_CMD_DISCARDED;
+    int CLIENT_REPL_CMD_APPLIED; /* applied before preceding cmds (repl worker) */
+    int CLIENT_REPL_CMD_BARRIER; /* cmd must be applied in order (repl worker) */
     long long cmd_reploff; /* Command replication offset when dispatch if this is a repl worker */
+    long long repl_dispatch_time; /* Command dispatch time in ms if this is a repl worker */
+    intset *repl_applied_ahead; /* offsets of cmds applied ahead before master link lost */
     struct client *repl_client; /* Master or peer client if this is a repl worker */
     list *swap_locks; /* swap locks */
     struct metaScanResult *swap_metas;
     int swap_errcode;
     struct argRewrites *swap_arg_rewrites;
+    long swap_zrank; /* ZRANK counted in rocksdb when swap in, -1 if none */
+    int swap_stream_replied; /* reply already streamed when swap in */
+    long long swap_strlen; /* length of cold string got when swap in, -1 if none */
+    sds swap_getrange; /* GETRANGE of cold string read when swap in */
+    sds swap_keys_reply; /* KEYS: cold keys encoded chunk by chunk when swap in */
+    long swap_keys_count; /* KEYS: number of keys in swap_keys_reply */
+    int swap_prefetched; /* queued commands already looked at by prefetch */
     int gtid_in_merge; /* gtid full sync*/
     int rate_limit_event_id; /* add time event when rate limit */
 } client;
@@ -1188,9 +1201,12 @@ typedef struct rdbSaveInfo {
     int repl_id_is_set;  /* True if repl_id field is set. */
     char repl_id[CONFIG_RUN_ID_SIZE+1];     /* Replication ID. */
     long long repl_offset;                  /* Replication offset. */
+
+    /* Used only saving. */
+    int rocks_checkpoint;  /* Ship rocks checkpoint files instead of cold keys. */
 } rdbSaveInfo;
 
-#define RDB_SAVE_INFO_INIT {-1,0,"0000000000000000000000000000000000000000",-1}
+#define RDB_SAVE_INFO_INIT {-1,0,"0000000000000000000000000000000000000000",-1,0}
 
 struct malloc_stats {
     size_t zmalloc_used;
@@ -1751,6 +1767,9 @@ struct redisServer {
     int swap_util_thread_idx;
     int total_swap_threads_num; /* swap_threads_num + extra_swap_threads_num */
     struct swapThread *swap_threads;
+    int swap_priority_expire_share; /* percent of pops granted to expire */
+    int swap_priority_evict_share;
+    int swap_priority_persist_share;
     /* async */
     struct asyncCompleteQueue *CQ;
     /* parallel sync */
@@ -1763,6 +1782,7 @@ struct redisServer {
     client **ttl_clients; /* array of expire scan clients (one for each db). */
     client **load_clients;
     client *mutex_client; /* exec op needed global swap lock */
+    client *prefetch_client; /* swaps in keys of pipelined commands ahead */
     struct rorStat *ror_stats;
     struct swapHitStat *swap_hit_stats;
     struct swapDebugInfo *swap_debug_info;
@@ -1787,20 +1807,39 @@ struct redisServer {
     int swap_debug_rdb_key_save_delay_micro;
 
     /* repl swap */
-    int repl_workers;   /* num of repl worker clients */
+    int repl_workers;   /* max num of repl worker clients */
+    int swap_repl_apply_out_of_order; /* apply non-conflicting repl cmds before preceding ones. */
     list *repl_worker_clients_free; /* free clients for repl(slaveof & peerof) swap. */
     list *repl_worker_clients_used; /* used clients for repl swap. */
     list *repl_swapping_clients; /* list of repl swapping clients. */
+    int repl_apply_ahead_inflight; /* repl cmds applied but not reached by reploff. */
+    long long stat_swap_repl_apply_ahead_count;
+    long long stat_swap_repl_apply_ahead_skipped_count;
     /* rdb swap */
     int ps_parallism_rdb;  /* parallel swap parallelism for rdb save & load. */
     struct ctripRdbLoadCtx *rdb_load_ctx; /* parallel swap for rdb load */
     int swap_bgsave_fix_metalen_mismatch;
+    int swap_rdb_save_threads; /* num of threads saving rocks key ranges. */
+    int swap_rdb_load_ingest_enabled; /* bulk load rdb by ingesting sst files. */
+    unsigned long long swap_rdb_load_ingest_buffer_size; /* pairs per sst file */
+    int swap_rdb_load_ingest_threads; /* num of threads writing sst files. */
+    struct rdbSaveRangesStat *swap_rdb_save_ranges_stat; /* shared with bgsave child */
+    int swap_repl_rocks_checkpoint_sync; /* ship rocks checkpoint for full resync. */
+    struct rocksCheckpointShipStat *swap_checkpoint_send_stat; /* shared with bgsave child */
+    struct rocksCheckpointShipStat *swap_checkpoint_recv_stat;
+    int swap_checkpoint_installed; /* rocks checkpoint installed by current loading. */
     int swap_child_err_pipe[2];
     size_t swap_child_err_nread;
     /* request wait */
     struct swapLock *swap_lock;
     /* big object */
     int swap_evict_step_max_subkeys; /* max subkeys evict in one step. */
+    int swap_stream_chunk_subkeys; /* subkeys per chunk of streamed reply. */
+    unsigned long long swap_stream_reply_buffer_limit; /* pause streamed reply if client reply buffer exceeds. */
+    list *swap_stream_paused_ctxs; /* swapCtx of streamed replies paused. */
+    long long stat_swap_stream_reply_paused_count;
+    int swap_pipeline_prefetch_depth; /* max pipelined commands to prefetch. */
+    unsigned long long swap_string_chunk_threshold; /* persist string as chunks if not shorter. */
     unsigned long long swap_evict_step_max_memory; /* max memory evict in one step. */
     unsigned long long swap_repl_max_rocksdb_read_bps; /* max rocksdb iterator read bps. */ 
     int64_t swap_txid; /* swap txid. */
@@ -1812,10 +1851,13 @@ struct redisServer {
     /* swap eviction */
     int swap_evict_inprogress_limit;
     int swap_evict_inprogress_growth_rate;
+    int swap_evict_cost_aware; /* score evict candidates by size & swap cost. */
+    int swap_evict_track_subkey_access; /* evict cold subkeys of big object first. */
     int swap_evict_loop_check_interval;
     struct swapEvictionCtx *swap_eviction_ctx;
 
     int swap_load_inprogress_count;
+    int swap_prefetch_inprogress_count;
     int swap_load_paused;
     size_t swap_load_err_cnt;
 
@@ -1824,6 +1866,9 @@ struct redisServer {
     int swap_scan_session_bits;
     int swap_scan_session_max_idle_seconds;
 
+    /* swap scan expire */
+    int swap_scan_expire_index; /* seek due keys in expire cf. */
+
     /* rocksdb configs */
     unsigned long long rocksdb_meta_block_cache_size;
     unsigned long long rocksdb_data_block_cache_size;
@@ -1849,9 +1894,14 @@ struct redisServer {
     unsigned long long rocksdb_meta_min_blob_size;
     unsigned long long rocksdb_data_blob_file_size;
     unsigned long long rocksdb_meta_blob_file_size;
+    unsigned long long rocksdb_data_compression_max_dict_buffer_bytes;
+    unsigned long long rocksdb_meta_compression_max_dict_buffer_bytes;
+    int rocksdb_data_compression_max_dict_bytes;
+    int rocksdb_meta_compression_max_dict_bytes;
     int rocksdb_data_max_bytes_for_level_multiplier;
     int rocksdb_meta_max_bytes_for_level_multiplier;
     int rocksdb_data_compaction_dynamic_level_bytes;
+    int rocksdb_data_prefix_bloom; /* prefix extractor & bloom on data/score cf */
     int rocksdb_meta_compaction_dynamic_level_bytes;
     int rocksdb_data_suggest_compact_deletion_percentage;
     int rocksdb_meta_suggest_compact_deletion_percentage;
@@ -1872,6 +1922,10 @@ struct redisServer {
     int rocksdb_meta_disable_auto_compactions;
     int rocksdb_data_compression; /* rocksdb compresssion type: no/snappy/zlib. */
     int rocksdb_meta_compression;
+    int rocksdb_block_cache_type; /* separate/shared/hyper-clock */
+    int swap_key_format; /* key format of newly created rocksdb */
+    int swap_key_format_migrate; /* migrate existing rocksdb to swap_key_format on start */
+    int swap_key_format_active; /* key format of opened rocksdb */
     int rocksdb_data_enable_blob_files;
     int rocksdb_meta_enable_blob_files;
     int rocksdb_data_enable_blob_garbage_collection;
@@ -1905,6 +1959,7 @@ struct redisServer {
     int swap_cuckoo_filter_enabled;
     int swap_cuckoo_filter_bit_type;
     unsigned long long swap_cuckoo_filter_estimated_keys;
+    int swap_cuckoo_filter_snapshot_enabled;
 
 #ifndef __APPLE__
     /* swap_cpu_usage */
@@ -1914,6 +1969,7 @@ struct redisServer {
 
     /* swap batch */
     struct swapBatchCtx *swap_batch_ctx;
+    struct subkeyAccessTracker *swap_subkey_access_tracker;
     swapBatchLimitsConfig swap_batch_limits[SWAP_TYPES_FORWARD];
 
     /* swap ratelimit */
@@ -2632,6 +2688,7 @@ void hashTypeCurrentFromZiplist(hashTypeIterator *hi, int what,
 sds hashTypeCurrentFromHashTable(hashTypeIterator *hi, int what);
 void hashTypeCurrentObject(hashTypeIterator *hi, int what, unsigned char **vstr, unsigned int *vlen, long long *vll);
 sds hashTypeCurrentObjectNewSds(hashTypeIterator *hi, int what);
+void addHashIteratorCursorToReply(client *c, hashTypeIterator *hi, int what);
 robj *hashTypeLookupWriteOrCreate(client *c, robj *key);
 robj *hashTypeGetValueObject(robj *o, sds field);
 int hashTypeSet(robj *o, sds field, sds value, int flags);
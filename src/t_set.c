@@ -1036,6 +1036,8 @@ void sinterGenericCommand(client *c, robj **setkeys,
 
 /* SINTER key [key ...] */
 void sinterCommand(client *c) {
+    /* SMEMBERS of big set already replied chunk by chunk when swap in. */
+    if (c->swap_stream_replied) return;
     sinterGenericCommand(c,c->argv+1,c->argc-1,NULL);
 }
 
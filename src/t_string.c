@@ -435,6 +435,17 @@ void setrangeCommand(client *c) {
         return;
     }
 
+    if (c->swap_strlen >= 0) {
+        /* Chunks touched already written when swap in, string stays cold. */
+        if (sdslen(value) > 0) {
+            signalModifiedKey(c,c->db,c->argv[1]);
+            notifyKeyspaceEvent(NOTIFY_STRING,"setrange",c->argv[1],c->db->id);
+            server.dirty++;
+        }
+        addReplyLongLong(c,c->swap_strlen);
+        return;
+    }
+
     o = lookupKeyWrite(c->db,c->argv[1]);
     if (o == NULL) {
         /* Return 0 when setting nothing on a non-existing string */
@@ -492,6 +503,12 @@ void getrangeCommand(client *c) {
         return;
     if (getLongLongFromObjectOrReply(c,c->argv[3],&end,NULL) != C_OK)
         return;
+    if (c->swap_getrange) {
+        /* Only chunks in range read when swap in, string stays cold. */
+        addReplyBulkSds(c,c->swap_getrange);
+        c->swap_getrange = NULL;
+        return;
+    }
     if ((o = lookupKeyReadOrReply(c,c->argv[1],shared.emptybulk)) == NULL ||
         checkType(c,o,OBJ_STRING)) return;
 
@@ -678,6 +695,15 @@ void appendCommand(client *c) {
     size_t totlen;
     robj *o, *append;
 
+    if (c->swap_strlen >= 0) {
+        /* Appended to chunks when swap in, string stays cold. */
+        signalModifiedKey(c,c->db,c->argv[1]);
+        notifyKeyspaceEvent(NOTIFY_STRING,"append",c->argv[1],c->db->id);
+        server.dirty++;
+        addReplyLongLong(c,c->swap_strlen);
+        return;
+    }
+
     o = lookupKeyWrite(c->db,c->argv[1]);
     if (o == NULL) {
         /* Create the key */
@@ -709,6 +735,11 @@ void appendCommand(client *c) {
 
 void strlenCommand(client *c) {
     robj *o;
+    if (c->swap_strlen >= 0) {
+        /* Length kept in meta of cold chunked string. */
+        addReplyLongLong(c,c->swap_strlen);
+        return;
+    }
     if ((o = lookupKeyReadOrReply(c,c->argv[1],shared.czero)) == NULL ||
         checkType(c,o,OBJ_STRING)) return;
     addReplyLongLong(c,stringObjectLen(o));
@@ -3744,6 +3744,18 @@ cleanup:
 void zcardCommand(client *c) {
     robj *key = c->argv[1];
     robj *zobj;
+    objectMeta *om = lookupMeta(c->db,key);
+
+    if (om != NULL) {
+        size_t zset_len = om->len;
+        zobj = lookupKeyRead(c->db,key);
+        if (zobj != NULL) {
+            if (checkType(c,zobj,OBJ_ZSET)) return;
+            zset_len += zsetLength(zobj);
+        }
+        addReplyLongLong(c,zset_len);
+        return;
+    }
 
     if ((zobj = lookupKeyReadOrReply(c,key,shared.czero)) == NULL ||
         checkType(c,zobj,OBJ_ZSET)) return;
@@ -3789,12 +3801,20 @@ void zrankGenericCommand(client *c, int reverse) {
     robj *ele = c->argv[2];
     robj *zobj;
     long rank;
+    double score;
 
     if ((zobj = lookupKeyReadOrReply(c,key,shared.null[c->resp])) == NULL ||
         checkType(c,zobj,OBJ_ZSET)) return;
 
     serverAssertWithInfo(c,ele,sdsEncodedObject(ele));
-    rank = zsetRank(zobj,ele->ptr,reverse);
+    if (c->swap_zrank >= 0 && zsetScore(zobj,ele->ptr,&score) == C_OK) {
+        /* Only member swapped in, rank already counted in rocksdb. */
+        objectMeta *om = lookupMeta(c->db,key);
+        long len = zsetLength(zobj) + (om ? (long)om->len : 0);
+        rank = reverse ? len - 1 - c->swap_zrank : c->swap_zrank;
+    } else {
+        rank = zsetRank(zobj,ele->ptr,reverse);
+    }
     if (rank >= 0) {
         addReplyLongLong(c,rank);
     } else {
@@ -0,0 +1,57 @@
+start_server {tags {"repl"}} {
+    start_server {} {
+        set master [srv -1 client]
+        set master_host [srv -1 host]
+        set master_port [srv -1 port]
+        set slave [srv 0 client]
+
+        test {full resync ships cold keys as rocks checkpoint} {
+            $master config set swap-repl-rocks-checkpoint-sync yes
+            $master config set swap-evict-step-max-subkeys 2
+
+            for {set j 0} {$j < 100} {incr j} {
+                $master set str$j val$j
+                $master hmset hash$j a a$j b b$j c c$j
+            }
+            for {set j 0} {$j < 90} {incr j} {
+                $master swap.evict str$j
+                $master swap.evict hash$j
+                wait_key_cold $master str$j
+                wait_key_cold $master hash$j
+            }
+            # hash0 is warm: field a in memory, fields b & c in rocks
+            $master hget hash0 a
+            assert [object_is_warm $master hash0]
+
+            $slave slaveof $master_host $master_port
+            wait_for_condition 50 100 {
+                [s 0 master_link_status] eq {up}
+            } else {
+                fail "Replication not started."
+            }
+
+            assert_equal [get_info_property $master replication swap_checkpoint_send state] done
+            assert_equal [get_info_property $slave replication swap_checkpoint_recv state] done
+            assert {[get_info_property $slave replication swap_checkpoint_recv files] > 0}
+            assert {[get_info_property $slave replication swap_checkpoint_recv bytes] > 0}
+
+            assert_equal [$master dbsize] [$slave dbsize]
+            for {set j 0} {$j < 100} {incr j} {
+                assert_equal [$slave get str$j] val$j
+                assert_equal [$slave hmget hash$j a b c] "a$j b$j c$j"
+            }
+        }
+
+        test {replica applies writes to keys installed from checkpoint} {
+            $master hset hash1 d d1
+            $master hdel hash2 a
+            $master del str3
+            wait_for_ofs_sync $master $slave
+            assert_equal [$slave hlen hash1] 4
+            assert_equal [$slave hmget hash1 a b c d] {a1 b1 c1 d1}
+            assert_equal [$slave hmget hash2 a b] {{} b2}
+            assert_equal [$slave exists str3] 0
+            assert_equal [$master dbsize] [$slave dbsize]
+        }
+    }
+}
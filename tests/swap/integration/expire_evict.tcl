@@ -140,3 +140,26 @@ start_server {tags {"swap string"}} {
     }
 } 
 
+
+start_server {tags {"perform eviction"} overrides {maxmemory-samples 64}} {
+    r config set swap-debug-evict-keys 0
+    r config set swap-evict-cost-aware yes
+    r config set maxmemory-policy allkeys-lru
+
+    test {cost aware eviction prefers big keys} {
+        set small_keys 32
+        for {set i 0} {$i < $small_keys} {incr i} {
+            r set smallkey$i val$i
+        }
+        r set bigkey [string repeat x [expr 4*1024*1024]]
+
+        r config set maxmemory [expr [s used_memory] - 1024*1024]
+        wait_key_cold r bigkey
+        r config set maxmemory 0
+
+        assert_range [get_info_property r keyspace db0 keys] [expr $small_keys-8] $small_keys
+        assert {[s swap_evict_swapped_bytes] > 0}
+        assert {[s swap_evict_bytes_per_io] > 0}
+        assert_equal [string length [r get bigkey]] [expr 4*1024*1024]
+    }
+}
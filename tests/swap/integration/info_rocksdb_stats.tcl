@@ -17,4 +17,35 @@ start_server {tags {"swap string"}} {
     assert_equal [string match "*default rocksdb.stats*" [r info rocksdb.stats.meta.score.data]] 1
     assert_equal [string match "*meta rocksdb.stats*" [r info rocksdb.stats.meta.score.data]] 1
     assert_equal [string match "*score rocksdb.stats*" [r info rocksdb.stats.meta.score.data]] 1
-}
\ No newline at end of file
+}
+foreach cache_type {separate shared hyper-clock} {
+    start_server [list tags {"swap rocksdb"} overrides [list rocksdb.block_cache_type $cache_type]] {
+        test "rocksdb block cache hit & miss ($cache_type)" {
+            for {set i 0} {$i < 100} {incr i} {
+                r hset hash$i f1 v1 f2 v2
+                r swap.evict hash$i
+            }
+            wait_key_cold r hash99
+            r swap flush
+            after 1000
+            for {set i 0} {$i < 100} {incr i} {
+                assert_equal [r hget hash$i f1] v1
+            }
+            set info [r info rocksdb]
+            assert_equal [getInfoProperty $info rocksdb_block_cache_type] $cache_type
+            assert {[getInfoProperty $info rocksdb_block_cache_capacity] > 0}
+            foreach cf {default meta score} {
+                assert_match {hit=*,miss=*,hit_rate=*} [getInfoProperty $info rocksdb_block_cache_$cf]
+            }
+            # meta and data read in same batch are counted to their own cf.
+            foreach cf {default meta} {
+                set stat [getInfoProperty $info rocksdb_block_cache_$cf]
+                regexp {hit=([0-9]+),miss=([0-9]+)} $stat -> hit miss
+                assert {$hit + $miss > 0}
+            }
+            set pinned [getInfoProperty $info rocksdb_pinned_get_default]
+            regexp {count=([0-9]+),copied_bytes=([0-9]+)} $pinned -> count bytes
+            assert {$count >= 100 && $bytes > 0}
+        }
+    }
+}
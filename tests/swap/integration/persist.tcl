@@ -306,3 +306,77 @@ start_server {tags {persist} overrides {swap-persist-enabled yes swap-dirty-subk
     }
 }
 
+
+start_server {tags {persist} overrides {swap-persist-enabled yes swap-dirty-subkeys-enabled yes swap-key-format legacy}} {
+    r config set swap-debug-evict-keys 0
+    r config rewrite
+
+    test {persist migrate legacy key format to compact} {
+        assert_equal [getInfoProperty [r info rocksdb] rocksdb_key_format] legacy
+        r set mystring3 v3
+        r hmset myhash3 a a0 b b0 c c0
+        r zadd myzset3 10 a 20 b 30 c
+        wait_key_clean r mystring3
+        wait_key_clean r myhash3
+        wait_key_clean r myzset3
+
+        # restart without migrate keeps legacy format
+        set fd [open [srv 0 config_file] a]
+        puts $fd "swap-key-format compact"
+        close $fd
+        restart_server 0 true false
+        assert_equal [getInfoProperty [r info rocksdb] rocksdb_key_format] legacy
+        assert_equal [r hmget myhash3 a b c] {a0 b0 c0}
+
+        set fd [open [srv 0 config_file] a]
+        puts $fd "swap-key-format-migrate yes"
+        close $fd
+        restart_server 0 true false
+        assert_equal [getInfoProperty [r info rocksdb] rocksdb_key_format] compact
+        assert_equal [r dbsize] 3
+        assert_equal [r get mystring3] v3
+        assert_equal [r hmget myhash3 a b c] {a0 b0 c0}
+        assert_equal [r ZRANGEBYSCORE myzset3 -inf +inf WITHSCORES] {a 10 b 20 c 30}
+    }
+}
+
+start_server {tags {persist} overrides {swap-persist-enabled yes swap-dirty-subkeys-enabled yes}} {
+    r config set swap-debug-evict-keys 0
+    r config rewrite
+
+    test {persist restart loads cold filter snapshot} {
+        r set mystring0 v0
+        r hmset myhash0 a a0 b b0 c c0
+        r sadd myset0 a b c
+        wait_key_clean r mystring0
+        wait_key_clean r myhash0
+        wait_key_clean r myset0
+        r swap.evict myhash0
+        wait_key_cold r myhash0
+
+        set loaded [count_log_message 0 "Cold filter snapshot loaded"]
+        restart_server 0 true false
+        assert_equal [count_log_message 0 "Cold filter snapshot loaded"] [expr $loaded+1]
+
+        assert_equal [r dbsize] 3
+        assert_equal [r get mystring0] v0
+        assert_equal [r hmget myhash0 a b c] {a0 b0 c0}
+        assert_equal [lsort [r smembers myset0]] {a b c}
+        assert_equal [r get notexists0] {}
+    }
+
+    test {persist restart scans rocksdb if cold filter snapshot disabled} {
+        r config set swap-cuckoo-filter-snapshot-enabled no
+        r config rewrite
+        r set mystring1 v1
+        wait_key_clean r mystring1
+
+        set loaded [count_log_message 0 "Cold filter snapshot loaded"]
+        restart_server 0 true false
+        assert_equal [count_log_message 0 "Cold filter snapshot loaded"] $loaded
+
+        assert_equal [r dbsize] 4
+        assert_equal [r get mystring1] v1
+        assert_equal [r hmget myhash0 a b c] {a0 b0 c0}
+    }
+}
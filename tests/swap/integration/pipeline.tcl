@@ -137,3 +137,73 @@ start_server {tags {"swap hash"}} {
         r info keyspace
     }
 } 
+
+start_server {tags {"swap pipeline prefetch"}} {
+    proc format_command {args} {
+        set cmd "*[llength $args]\r\n"
+        foreach a $args {
+            append cmd "$[string length $a]\r\n$a\r\n"
+        }
+        set _ $cmd
+    }
+
+    proc pipeline_get_cold_keys {num} {
+        for {set i 0} {$i < $num} {incr i} {
+            r set key$i val$i
+            r swap.evict key$i
+            wait_key_cold r key$i
+        }
+        set rd [redis_deferring_client]
+        for {set i 0} {$i < $num} {incr i} {
+            $rd write [format_command get key$i]
+        }
+        $rd write [format_command get notexists]
+        $rd flush
+        for {set i 0} {$i < $num} {incr i} {
+            assert_equal val$i [$rd read]
+        }
+        assert_equal {} [$rd read]
+        $rd close
+    }
+
+    test {pipelined reads of cold keys are prefetched} {
+        r config set swap-debug-evict-keys 0
+        set old_cmds [status r swap_pipeline_prefetch_cmd_count]
+        set old_keys [status r swap_pipeline_prefetch_key_count]
+        pipeline_get_cold_keys 32
+        assert {[status r swap_pipeline_prefetch_cmd_count] > $old_cmds}
+        assert {[status r swap_pipeline_prefetch_key_count] > $old_keys}
+        for {set i 0} {$i < 32} {incr i} {
+            assert_equal val$i [r get key$i]
+        }
+    }
+
+    test {pipelined writes are not prefetched and execute in order} {
+        r flushdb
+        r set k v0
+        r swap.evict k
+        wait_key_cold r k
+        set rd [redis_deferring_client]
+        $rd write [format_command get k]
+        $rd write [format_command set k v1]
+        $rd write [format_command get k]
+        $rd write [format_command append k 2]
+        $rd write [format_command get k]
+        $rd flush
+        assert_equal v0 [$rd read]
+        assert_equal OK [$rd read]
+        assert_equal v1 [$rd read]
+        assert_equal 3 [$rd read]
+        assert_equal v12 [$rd read]
+        $rd close
+    }
+
+    test {pipeline prefetch disabled} {
+        r flushdb
+        r config set swap-pipeline-prefetch-depth 0
+        set old_cmds [status r swap_pipeline_prefetch_cmd_count]
+        pipeline_get_cold_keys 8
+        assert_equal $old_cmds [status r swap_pipeline_prefetch_cmd_count]
+        r config set swap-pipeline-prefetch-depth 16
+    }
+}
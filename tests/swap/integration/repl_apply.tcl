@@ -0,0 +1,178 @@
+start_server {tags {"repl"}} {
+    start_server {} {
+        set master [srv -1 client]
+        set master_host [srv -1 host]
+        set master_port [srv -1 port]
+        set slave [srv 0 client]
+
+        $slave config set swap-repl-apply-out-of-order yes
+        $slave slaveof $master_host $master_port
+        wait_for_condition 50 100 {
+            [s 0 master_link_status] eq {up}
+        } else {
+            fail "Replication not started."
+        }
+
+        test {replica applies commands on same key in order} {
+            for {set j 0} {$j < 1000} {incr j} {
+                $master incr counter
+                $master rpush list $j
+                $master set str[expr $j%10] $j
+            }
+            wait_for_ofs_sync $master $slave
+            assert_equal [$slave get counter] 1000
+            assert_equal [$slave lrange list 0 2] {0 1 2}
+            assert_equal [$slave llen list] 1000
+            assert_equal [$slave get str9] 999
+            assert_equal [status $slave swap_repl_apply_inflight] 0
+            assert_equal [status $slave swap_repl_apply_ahead] 0
+        }
+
+        test {replica applies commands ahead of slow cold key swap} {
+            $master set cold foo
+            $master set hot bar
+            wait_for_ofs_sync $master $slave
+            $slave swap.evict cold
+            wait_key_cold $slave cold
+
+            set old_ahead [status $slave swap_repl_apply_ahead_count]
+            $slave config set swap-debug-rio-delay-micro 1000000
+            $master append cold bar
+            $master set hot baz
+            # hot key applied before preceding command on cold key finished.
+            wait_for_condition 50 10 {
+                [$slave get hot] eq {baz}
+            } else {
+                fail "command not applied ahead"
+            }
+            assert {[status $slave swap_repl_apply_ahead_count] > $old_ahead}
+            assert {[status $master master_repl_offset] > [status $slave master_repl_offset]}
+
+            wait_for_ofs_sync $master $slave
+            $slave config set swap-debug-rio-delay-micro 0
+            assert_equal [$slave get cold] foobar
+            assert_equal [status $slave swap_repl_apply_ahead] 0
+        }
+
+        test {replica skips commands applied ahead when received again after psync} {
+            $slave swap.evict cold
+            wait_key_cold $slave cold
+
+            set old_skipped [status $slave swap_repl_apply_ahead_skipped_count]
+            set old_partial [status $master sync_partial_ok]
+            $slave config set swap-debug-rio-delay-micro 500000
+            $master append cold baz
+            $master incr ahead
+            wait_for_condition 50 10 {
+                [$slave get ahead] eq {1}
+            } else {
+                fail "command not applied ahead"
+            }
+
+            # master link lost before preceding command on cold key applied.
+            $slave client kill type master
+            $slave config set swap-debug-rio-delay-micro 0
+            wait_for_condition 50 100 {
+                [status $slave master_link_status] eq {up}
+            } else {
+                fail "Replication not reconnected."
+            }
+            wait_for_ofs_sync $master $slave
+
+            assert {[status $master sync_partial_ok] > $old_partial}
+            assert {[status $slave swap_repl_apply_ahead_skipped_count] > $old_skipped}
+            assert_equal [$slave get ahead] 1
+            assert_equal [$slave get cold] foobarbaz
+            assert_equal [status $slave swap_repl_apply_ahead] 0
+        }
+
+        test {replica applies commands in order if out of order disabled} {
+            $slave config set swap-repl-apply-out-of-order no
+            $slave swap.evict cold
+            wait_key_cold $slave cold
+
+            set old_ahead [status $slave swap_repl_apply_ahead_count]
+            $slave config set swap-debug-rio-delay-micro 200000
+            $master append cold bar
+            $master set hot qux
+            wait_for_ofs_sync $master $slave
+            $slave config set swap-debug-rio-delay-micro 0
+            assert_equal [$slave get cold] foobarbazbar
+            assert_equal [$slave get hot] qux
+            assert_equal [status $slave swap_repl_apply_ahead_count] $old_ahead
+            $slave config set swap-repl-apply-out-of-order yes
+        }
+
+        test {replica worker clients limited by swap-repl-workers} {
+            $slave config set swap-repl-workers 1
+            assert_equal [get_info_property $slave Swap swap_repl_workers max] 1
+            for {set j 0} {$j < 100} {incr j} {
+                $master incr counter
+            }
+            wait_for_ofs_sync $master $slave
+            assert_equal [$slave get counter] 1100
+            assert {[get_info_property $slave Swap swap_repl_workers free] <= 1}
+            $slave config set swap-repl-workers 256
+        }
+    }
+}
+
+start_server {tags {"repl"}} {
+    start_server {} {
+        start_server {} {
+            set master [srv -2 client]
+            set master_host [srv -2 host]
+            set master_port [srv -2 port]
+            set replica [srv -1 client]
+            set replica_host [srv -1 host]
+            set replica_port [srv -1 port]
+            set sub_replica [srv 0 client]
+
+            $replica config set swap-repl-apply-out-of-order yes
+            $replica slaveof $master_host $master_port
+            wait_for_condition 50 100 {
+                [status $replica master_link_status] eq {up}
+            } else {
+                fail "Replication not started."
+            }
+            $sub_replica slaveof $replica_host $replica_port
+            wait_for_condition 50 100 {
+                [status $sub_replica master_link_status] eq {up}
+            } else {
+                fail "Sub-replica replication not started."
+            }
+
+            test {promoted replica finishes commands dispatched before promotion} {
+                $master set cold foo
+                wait_for_ofs_sync $master $replica
+                $replica swap.evict cold
+                wait_key_cold $replica cold
+
+                $replica config set swap-debug-rio-delay-micro 500000
+                $master append cold bar
+                $master incr ahead
+                wait_for_condition 50 10 {
+                    [$replica get ahead] eq {1}
+                } else {
+                    fail "command not applied ahead"
+                }
+
+                $replica slaveof no one
+                $replica config set swap-debug-rio-delay-micro 0
+                assert_equal [status $replica swap_repl_apply_ahead] 0
+                assert_equal [$replica get cold] foobar
+                assert_equal [$replica get ahead] 1
+
+                # sub-replica psync from promoted replica gets all of them.
+                wait_for_condition 50 100 {
+                    [status $sub_replica master_link_status] eq {up}
+                } else {
+                    fail "Sub-replica replication not reconnected."
+                }
+                wait_for_ofs_sync $replica $sub_replica
+                assert_equal [$sub_replica get cold] foobar
+                assert_equal [$sub_replica get ahead] 1
+            }
+        }
+    }
+}
@@ -25,7 +25,8 @@ start_server {tags {"absent cache"} overrides {swap-cuckoo-filter-enabled no} }
             r get $i
         }
 
-        # not-existing-key is the last touched item that will reserved on trim.
+        # not-existing-key is the only referenced item that will reserved on trim.
+        r get not-existing-key
         r get not-existing-key
 
         r config set swap-absent-cache-capacity 1
@@ -889,3 +889,22 @@ start_server {
         }
     }
 }
+
+start_server {tags {"swap set"}} {
+    r config set swap-debug-evict-keys 0
+    r config set swap-stream-chunk-subkeys 16
+    test {smembers of big cold set replied by stream} {
+        set expected {}
+        for {set i 0} {$i < 100} {incr i} {
+            r sadd bigset member$i
+            lappend expected member$i
+        }
+        r swap.evict bigset
+        wait_key_cold r bigset
+        assert_equal [lsort [r smembers bigset]] [lsort $expected]
+        assert [object_is_cold r bigset]
+        r sadd bigset member0 member100
+        assert_equal [llength [r smembers bigset]] 101
+        assert_equal [object_meta_len r bigset] 99
+    }
+}
@@ -138,3 +138,72 @@ start_server {tags "expire"} {
         r debug set-active-expire 1
     }
 }
+
+start_server {tags "expire index"} {
+    r config set swap-debug-evict-keys 0
+
+    test {cold key indexed by expire} {
+        r psetex foo 100000 bar
+        r set nottl bar
+        r swap.evict foo nottl
+        wait_key_cold r foo
+        wait_key_cold r nottl
+        assert_equal [llength [r swap rio-scan expire {}]] 1
+        r flushdb
+        wait_for_condition 50 100 {
+            [llength [r swap rio-scan expire {}]] == 0
+        } else {
+            fail "expire index not flushed"
+        }
+    }
+
+    test {cold key active expire by expire index} {
+        r psetex foo 200 bar
+        r swap.evict foo
+        wait_key_cold r foo
+        wait_for_condition 50 100 {
+            [r dbsize] == 0
+        } else {
+            fail "cold key not expired by expire index"
+        }
+        assert {[rio_get_meta r foo] == ""}
+        # index entry of expired key is cleaned by next scan
+        wait_for_condition 50 100 {
+            [llength [r swap rio-scan expire {}]] == 0
+        } else {
+            fail "expire index entry not cleaned"
+        }
+        assert_match {*swap_scan_expire_index:1*} [r info swap.scanexpire]
+    }
+
+    test {stale expire index entry of persisted key} {
+        r psetex foo 200 bar
+        r swap.evict foo
+        wait_key_cold r foo
+        r persist foo
+        r swap.evict foo
+        wait_key_cold r foo
+        wait_for_condition 50 100 {
+            [llength [r swap rio-scan expire {}]] == 0
+        } else {
+            fail "stale expire index entry not cleaned"
+        }
+        assert_equal [r get foo] bar
+        r flushdb
+    }
+
+    test {scan expire falls back to meta scan if index disabled} {
+        r config set swap-scan-expire-index no
+        r psetex foo 200 bar
+        r swap.evict foo
+        wait_key_cold r foo
+        wait_for_condition 50 100 {
+            [r dbsize] == 0
+        } else {
+            fail "cold key not expired by meta scan"
+        }
+        assert_match {*swap_scan_expire_index:0*} [r info swap.scanexpire]
+        r config set swap-scan-expire-index yes
+        r flushdb
+    }
+}
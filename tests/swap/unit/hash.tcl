@@ -263,6 +263,33 @@ start_server {tags "bighash"} {
         catch {r swap object hash15} e
         assert_match {*no such key*} $e
     }
+
+    test {bighash evict step keeps recently accessed fields} {
+        set old_swap_max_subkeys [lindex [r config get swap-evict-step-max-subkeys] 1]
+        r config set swap-evict-track-subkey-access no
+        r hmset hash16 a a b b c c d d e e f f
+        r swap.evict hash16
+        wait_key_cold r hash16
+        assert_equal [r hlen hash16] 6
+        assert_equal [llength [r hgetall hash16]] 12
+        assert_equal [object_meta_len r hash16] 0
+
+        r config set swap-evict-track-subkey-access yes
+        r config set swap-evict-step-max-subkeys 2
+        set old_kept [status r swap_evict_subkey_kept_count]
+        set old_avoided [status r swap_evict_subkey_swapin_avoided_count]
+        assert_equal [r hget hash16 a] a
+        # clean bighash evicts 2 cold fields, a stays in memory
+        r swap.evict hash16
+        after 100
+        assert_equal [object_meta_len r hash16] 2
+        assert_equal [r hget hash16 a] a
+        assert_equal [status r swap_evict_subkey_kept_count] [incr old_kept]
+        assert_equal [status r swap_evict_subkey_swapin_avoided_count] [incr old_avoided]
+
+        r config set swap-evict-step-max-subkeys $old_swap_max_subkeys
+        r del hash16
+    }
 }
 
 start_server {tags {"evict big hash, check hlen"}} {
@@ -353,3 +380,104 @@ test {two big hash check reload1} {
     }
 }
 
+start_server {tags {"swap hash"} overrides {rocksdb.data.compression zlib rocksdb.data.compression_max_dict_bytes 4096}} {
+    test {hash subkeys survive dictionary compression} {
+        for {set i 0} {$i < 50} {incr i} {
+            for {set j 0} {$j < 20} {incr j} {
+                r hset dicthash$i field$j "value-of-field-$j-in-hash-$i"
+            }
+            r swap.evict dicthash$i
+        }
+        wait_key_cold r dicthash49
+        r swap flush
+        after 500
+        r swap compact
+        after 500
+        for {set i 0} {$i < 50} {incr i} {
+            assert_equal [r hget dicthash$i field7] "value-of-field-7-in-hash-$i"
+        }
+        r config set rocksdb.data.compression_max_dict_bytes 0
+        assert_equal [lindex [r config get rocksdb.data.compression_max_dict_bytes] 1] 0
+    }
+}
+
+start_server {tags {"swap hash"}} {
+    r config set swap-debug-evict-keys 0
+    r config set swap-stream-chunk-subkeys 16
+    test {hgetall/hkeys/hvals of big cold hash replied by stream} {
+        set expected {}
+        for {set i 0} {$i < 100} {incr i} {
+            r hset bighash field$i val$i
+            lappend expected field$i val$i
+        }
+        r swap.evict bighash
+        wait_key_cold r bighash
+        assert_equal [lsort [r hgetall bighash]] [lsort $expected]
+        assert_equal [llength [r hkeys bighash]] 100
+        assert_equal [lsort [r hvals bighash]] [lsort [dict values $expected]]
+        # streamed reply never swaps in big hash
+        assert [object_is_cold r bighash]
+        assert_equal [object_meta_len r bighash] 100
+    }
+
+    test {hgetall of big warm hash merges hot fields} {
+        r hset bighash field3 newval field100 val100
+        assert [object_is_warm r bighash]
+        set res [r hgetall bighash]
+        assert_equal [llength $res] 202
+        assert_equal [dict get $res field3] newval
+        assert_equal [dict get $res field100] val100
+        assert_equal [object_meta_len r bighash] 99
+    }
+
+    test {hgetall of big hash in multi swaps in entire hash} {
+        r swap.evict bighash
+        wait_key_cold r bighash
+        r multi
+        r hset bighash field101 val101
+        r hgetall bighash
+        set res [r exec]
+        assert_equal [llength [lindex $res 1]] 204
+        assert [object_is_hot r bighash]
+    }
+
+    test {streamed reply paused untill slow reader drains reply buffer} {
+        r config set swap-stream-reply-buffer-limit 64kb
+        set val [string repeat x 8192]
+        for {set i 0} {$i < 1024} {incr i} {
+            r hset slowhash field$i $val
+        }
+        r swap.evict slowhash
+        wait_key_cold r slowhash
+
+        set old_paused [status r swap_stream_reply_paused_count]
+        set rd [redis_deferring_client]
+        $rd hgetall slowhash
+        # reader not reading, reply piles up in socket then reply buffer.
+        wait_for_condition 50 100 {
+            [status r swap_stream_reply_paused] eq 1
+        } else {
+            fail "streamed reply not paused"
+        }
+        set omem 0
+        regexp {omem=([0-9]+)} [r client list] -> omem
+        assert {$omem < 1024*1024}
+
+        set res [$rd read]
+        assert_equal [llength $res] 2048
+        assert_equal [dict get $res field1023] $val
+        assert {[status r swap_stream_reply_paused_count] > $old_paused}
+        assert_equal [status r swap_stream_reply_paused] 0
+        assert [object_is_cold r slowhash]
+        $rd close
+        r config set swap-stream-reply-buffer-limit 1mb
+    }
+
+    test {small hash still swapped in by hgetall} {
+        r config set swap-stream-chunk-subkeys 1024
+        r swap.evict bighash
+        wait_key_cold r bighash
+        assert_equal [llength [r hgetall bighash]] 204
+        assert [object_is_hot r bighash]
+    }
+}
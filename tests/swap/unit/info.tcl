@@ -6,4 +6,40 @@ start_server {} {
         assert_equal [getInfoProperty [{*}r info swap] swap_inprogress_count] 0
     }
 
+    test {swap thread busy & idle stats} {
+        for {set i 0} {$i < 100} {incr i} {
+            r set key$i val$i
+            r swap.evict key$i
+        }
+        for {set i 0} {$i < 100} {incr i} {
+            assert_equal [r get key$i] val$i
+        }
+        set processed 0
+        set threads [lindex [r config get swap-threads] 1]
+        for {set i 0} {$i < $threads} {incr i} {
+            set stat [getInfoProperty [r info swap] swap_thread$i]
+            assert_match {pending=*,processed=*,steal=*,busy_us=*,idle_us=*,busy_ratio=*} $stat
+            regexp {processed=([0-9]+)} $stat -> n
+            incr processed $n
+        }
+        assert {$processed > 0}
+    }
+
+    test {swap priority class stats} {
+        r config set swap-priority-evict-share 50
+        for {set i 0} {$i < 100} {incr i} {
+            r set pkey$i val$i
+            r swap.evict pkey$i
+        }
+        for {set i 0} {$i < 100} {incr i} {
+            assert_equal [r get pkey$i] val$i
+        }
+        set fg [getInfoProperty [r info swap] swap_priority_foreground]
+        assert_match {share=100,pending=*,processed=*,avg_queue_us=*} $fg
+        regexp {processed=([0-9]+)} $fg -> n
+        assert {$n > 0}
+        set evict [getInfoProperty [r info swap] swap_priority_evict]
+        assert_match {share=50,pending=*,processed=*,avg_queue_us=*} $evict
+        r config set swap-priority-evict-share 20
+    }
 }
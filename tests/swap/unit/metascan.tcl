@@ -72,6 +72,96 @@ start_server {tags "metascan"} {
         assert_match {*EXECABORT*Swap fail*} $e
         r del key
     }
+
+    test {keys sees cold keys} {
+        r mset user:1 a user:2 b user:10 c item:1 d
+        r swap.evict user:1 user:10 item:1
+        wait_key_cold r user:1
+        wait_key_cold r user:10
+        wait_key_cold r item:1
+        assert_equal [lsort [r keys user:*]] {user:1 user:10 user:2}
+        assert_equal [lsort [r keys user:1*]] {user:1 user:10}
+        assert_equal [lsort [r keys *:1]] {item:1 user:1}
+        assert_equal [lsort [r keys *]] {item:1 user:1 user:10 user:2}
+        assert_equal [r keys nosuch*] {}
+        r del user:1 user:2 user:10 item:1
+    }
+
+    test {keys scans cold keys in chunks} {
+        # more cold keys than a chunk (METASCAN_KEYS_CHUNK_LIMIT)
+        set n 2500
+        for {set i 0} {$i < $n} {incr i} {
+            r set chunk:$i $i
+        }
+        for {set i 0} {$i < $n} {incr i} {
+            r swap.evict chunk:$i
+        }
+        for {set i 0} {$i < $n} {incr i} {
+            wait_key_cold r chunk:$i
+        }
+        r set chunk:hot v
+        assert_equal [llength [r keys chunk:*]] [expr $n+1]
+        assert_equal [lsort [r keys chunk:249*]] {chunk:249 chunk:2490 chunk:2491 chunk:2492 chunk:2493 chunk:2494 chunk:2495 chunk:2496 chunk:2497 chunk:2498 chunk:2499}
+        r flushdb
+    }
+
+    test {keys skips expired cold keys} {
+        r psetex user:1 100 a
+        r set user:2 b
+        r swap.evict user:1 user:2
+        wait_key_cold r user:1
+        wait_key_cold r user:2
+        after 200
+        assert_equal [r keys user:*] {user:2}
+        r del user:2
+    }
+
+    test {keys in multi only sees hot keys} {
+        r mset user:1 a user:2 b
+        r swap.evict user:1
+        wait_key_cold r user:1
+        r multi
+        r keys user:*
+        assert_equal [r exec] {user:2}
+        r del user:1 user:2
+    }
+
+    test {keys only sees cold keys of selected db} {
+        r mset user:1 a
+        r swap.evict user:1
+        wait_key_cold r user:1
+        r select 1
+        assert_equal [r keys user:*] {}
+        r select 9
+        assert_equal [r keys user:*] {user:1}
+        r del user:1
+    }
+
+    test {scan match prefix with cold keys} {
+        for {set i 0} {$i < 20} {incr i} {
+            r set user:$i $i
+            r set item:$i $i
+            r swap.evict user:$i item:$i
+        }
+        for {set i 0} {$i < 20} {incr i} {
+            wait_key_cold r user:$i
+            wait_key_cold r item:$i
+        }
+
+        set cursor [lindex [r scan 0 match user:1*] 0]
+        set keys {}
+        while {$cursor != 0} {
+            set res [r scan $cursor match user:1* count 3]
+            set cursor [lindex $res 0]
+            lappend keys {*}[lindex $res 1]
+            assert {[llength [lindex $res 1]] <= 3}
+        }
+        assert_equal [lsort $keys] [lsort {user:1 user:10 user:11 user:12 user:13 user:14 user:15 user:16 user:17 user:18 user:19}]
+
+        for {set i 0} {$i < 20} {incr i} {
+            r del user:$i item:$i
+        }
+    }
 }
 
 
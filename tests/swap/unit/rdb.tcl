@@ -134,4 +134,31 @@ start_server {overrides {save ""} tags {"swap" "rdb"}} {
         r debug reload
         assert_equal [r mget a aa aaa] {a aa aaa}
     }
+
+    test {rdbload by ingesting sst files} {
+        r flushdb
+        r config set swap-rdb-load-ingest-enabled yes
+        r config set swap-rdb-load-ingest-buffer-size 1mb
+        r config set swap-rdb-load-ingest-threads 2
+        set val [string repeat x 1024]
+        for {set i 0} {$i < 2000} {incr i} {
+            r set str_$i $val
+            r hmset hash_$i a a_$i b b_$i
+            r zadd zset_$i 1 a 2 b
+        }
+        r swap.evict str_0 hash_0 zset_0
+        wait_key_cold r hash_0
+        r debug reload
+        assert_equal [r dbsize] 6000
+        for {set i 0} {$i < 2000} {incr i 100} {
+            assert_equal [r get str_$i] $val
+            assert_equal [r hmget hash_$i a b] "a_$i b_$i"
+            assert_equal [r zrange zset_$i 0 -1 withscores] {a 1 b 2}
+        }
+        # keys loaded are writable and reload again overwrites them
+        r hset hash_1 c c_1
+        r debug reload
+        assert_equal [r hmget hash_1 a b c] {a_1 b_1 c_1}
+        r config set swap-rdb-load-ingest-enabled no
+    }
 }
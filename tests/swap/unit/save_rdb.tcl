@@ -14,3 +14,30 @@ start_server {tags {"swap string"} keep_persistence true} {
     }
 } 
 
+
+start_server {tags {"swap string"} keep_persistence true} {
+    r config set swap-debug-evict-keys 0
+    test {"parallel save + restart_server"} {
+        r config set swap-rdb-save-threads 4
+        for {set i 0} {$i < 1000} {incr i} {
+            r set key:$i val:$i
+            r hset hash:$i f1 v1 f2 v2
+        }
+        for {set i 0} {$i < 1000} {incr i} {
+            r swap.evict key:$i hash:$i
+        }
+        wait_key_cold r key:999
+        wait_key_cold r hash:999
+        r swap compact
+
+        assert_equal [r save] OK
+        assert_match {*swap_rdb_save_threads:4*} [r info swap]
+        r debug reload
+        assert_equal [r dbsize] 2000
+        for {set i 0} {$i < 1000} {incr i} {
+            assert_equal [r get key:$i] val:$i
+            assert_equal [r hget hash:$i f2] v2
+        }
+        r config set swap-rdb-save-threads 1
+    }
+}
@@ -0,0 +1,228 @@
+start_server {tags {"swap" "stream"} overrides {save "" stream-node-max-entries 4}} {
+    r config set swap-debug-evict-keys 0
+
+    proc stream_fill {key n} {
+        r del $key
+        for {set i 1} {$i <= $n} {incr i} {
+            r xadd $key $i-0 f $i
+        }
+    }
+
+    # cold: all nodes in rocksdb; warm: oldest nodes in rocksdb, tail in memory.
+    proc stream_swap_out {key state} {
+        if {$state eq "cold"} {
+            r swap.evict $key
+            wait_key_cold r $key
+        } else {
+            set bak_evict_step [lindex [r config get swap-evict-step-max-subkeys] 1]
+            r config set swap-evict-step-max-subkeys 2
+            r swap.evict $key
+            wait_for_condition 50 20 {
+                [object_is_warm r $key]
+            } else {
+                fail "wait $key warm failed."
+            }
+            r config set swap-evict-step-max-subkeys $bak_evict_step
+        }
+    }
+
+    foreach state {cold warm} {
+        test "XLEN/XRANGE/XREVRANGE - $state stream" {
+            stream_fill mystream 20
+            stream_swap_out mystream $state
+            assert_equal [r xlen mystream] 20
+            assert_equal [llength [r xrange mystream - +]] 20
+            assert_equal [r xrange mystream 5 6] {{5-0 {f 5}} {6-0 {f 6}}}
+            assert_equal [r xrevrange mystream + - COUNT 1] {{20-0 {f 20}}}
+            assert_equal [r xrange mystream 100 +] {}
+        }
+
+        test "XREAD - $state stream" {
+            stream_fill mystream 20
+            stream_swap_out mystream $state
+            assert_equal [r xread COUNT 2 STREAMS mystream 10-0] \
+                {{mystream {{11-0 {f 11}} {12-0 {f 12}}}}}
+            assert_equal [r xread STREAMS mystream 20-0] {}
+        }
+
+        test "XADD/XSETID - $state stream" {
+            stream_fill mystream 20
+            stream_swap_out mystream $state
+            assert_equal [r xadd mystream 21-0 f 21] 21-0
+            assert_error "*equal or smaller*" {r xadd mystream 1-0 f 1}
+            assert_equal [r xlen mystream] 21
+            assert_equal [r xrange mystream 20 +] {{20-0 {f 20}} {21-0 {f 21}}}
+
+            stream_swap_out mystream $state
+            r xsetid mystream 30-0
+            assert_equal [r xadd mystream 31-0 f 31] 31-0
+            assert_equal [lindex [r xrange mystream - +] 0] {1-0 {f 1}}
+        }
+
+        test "XDEL/XTRIM - $state stream" {
+            stream_fill mystream 20
+            stream_swap_out mystream $state
+            assert_equal [r xdel mystream 1-0 2-0 100-0] 2
+            assert_equal [r xlen mystream] 18
+
+            stream_swap_out mystream $state
+            assert_equal [r xtrim mystream MAXLEN 10] 8
+            assert_equal [r xlen mystream] 10
+            assert_equal [lindex [r xrange mystream - +] 0] {11-0 {f 11}}
+
+            stream_swap_out mystream $state
+            r xadd mystream MAXLEN 5 21-0 f 21
+            assert_equal [r xrange mystream - + COUNT 1] {{17-0 {f 17}}}
+        }
+
+        test "XINFO - $state stream" {
+            stream_fill mystream 20
+            stream_swap_out mystream $state
+            set info [r xinfo stream mystream]
+            assert_equal [dict get $info length] 20
+            assert_equal [dict get $info last-generated-id] 20-0
+            assert_equal [dict get $info first-entry] {1-0 {f 1}}
+            assert_equal [dict get $info last-entry] {20-0 {f 20}}
+        }
+
+        test "consumer groups and PEL kept across swap out - $state stream" {
+            stream_fill mystream 20
+            stream_swap_out mystream $state
+            r xgroup create mystream g1 0
+            r xgroup createconsumer mystream g1 c0
+            set res [r xreadgroup GROUP g1 c1 COUNT 5 STREAMS mystream >]
+            assert_equal [llength [lindex [lindex $res 0] 1]] 5
+
+            stream_swap_out mystream $state
+            assert_equal [r xpending mystream g1] {5 1-0 5-0 {{c1 5}}}
+            assert_equal [r xack mystream g1 1-0] 1
+
+            stream_swap_out mystream $state
+            assert_equal [lindex [r xpending mystream g1] 0] 4
+            assert_equal [r xclaim mystream g1 c2 0 2-0] {{2-0 {f 2}}}
+
+            stream_swap_out mystream $state
+            set res [r xautoclaim mystream g1 c3 0 0-0 COUNT 1]
+            assert_equal [lindex $res 1] {{2-0 {f 2}}}
+
+            stream_swap_out mystream $state
+            set group [lindex [r xinfo groups mystream] 0]
+            assert_equal [dict get $group name] g1
+            assert_equal [dict get $group consumers] 4
+            assert_equal [dict get $group pending] 4
+            assert_equal [dict get $group last-delivered-id] 5-0
+            assert_equal [r xreadgroup GROUP g1 c1 COUNT 1 STREAMS mystream >] \
+                {{mystream {{6-0 {f 6}}}}}
+
+            stream_swap_out mystream $state
+            assert_equal [r xgroup setid mystream g1 0] OK
+            assert_equal [r xgroup delconsumer mystream g1 c0] 0
+            assert_equal [r xgroup destroy mystream g1] 1
+            assert_equal [r xinfo groups mystream] {}
+        }
+    }
+
+    test {XADD on all-cold stream swaps in tail only} {
+        stream_fill mystream 20
+        stream_swap_out mystream cold
+        r xadd mystream 21-0 f 21
+        assert ![object_is_cold r mystream]
+        assert_equal [r xlen mystream] 21
+        assert_equal [llength [r xrange mystream - +]] 21
+    }
+
+    test {XADD on cold stream wakes up blocked XREAD} {
+        stream_fill mystream 20
+        stream_swap_out mystream cold
+        set rd [redis_deferring_client]
+        $rd xread BLOCK 0 STREAMS mystream $
+        wait_for_condition 50 100 {
+            [s blocked_clients] == 1
+        } else {
+            fail "xread not blocked."
+        }
+        r xadd mystream 21-0 f 21
+        assert_equal [$rd read] {{mystream {{21-0 {f 21}}}}}
+        $rd close
+    }
+
+    test {XADD on cold stream wakes up blocked XREADGROUP} {
+        stream_fill mystream 20
+        r xgroup create mystream g1 $
+        stream_swap_out mystream cold
+        set rd [redis_deferring_client]
+        $rd xreadgroup GROUP g1 c1 BLOCK 0 STREAMS mystream >
+        wait_for_condition 50 100 {
+            [s blocked_clients] == 1
+        } else {
+            fail "xreadgroup not blocked."
+        }
+        r xadd mystream 21-0 f 21
+        assert_equal [$rd read] {{mystream {{21-0 {f 21}}}}}
+        assert_equal [lindex [r xpending mystream g1] 0] 1
+        $rd close
+    }
+
+    proc stream_prepare_reload {} {
+        r flushdb
+        stream_fill stream_hot 20
+        stream_fill stream_warm 20
+        stream_fill stream_cold 20
+        foreach key {stream_hot stream_warm stream_cold} {
+            r xgroup create $key g1 0
+            r xreadgroup GROUP g1 c1 COUNT 3 STREAMS $key >
+        }
+        stream_swap_out stream_warm warm
+        stream_swap_out stream_cold cold
+    }
+
+    proc stream_check_reload {} {
+        assert_equal [r dbsize] 3
+        foreach key {stream_hot stream_warm stream_cold} {
+            assert_equal [r xlen $key] 20
+            assert_equal [llength [r xrange $key - +]] 20
+            assert_equal [r xrange $key 10 10] {{10-0 {f 10}}}
+            assert_equal [r xpending $key g1] {3 1-0 3-0 {{c1 3}}}
+            assert_equal [r xadd $key 21-0 f 21] 21-0
+        }
+    }
+
+    test {stream rdb save and load} {
+        stream_prepare_reload
+        r debug reload
+        stream_check_reload
+    }
+
+    test {stream bgsave and restart} {
+        stream_prepare_reload
+        r bgsave
+        waitForBgsave r
+        restart_server 0 true false
+        stream_check_reload
+    }
+}
+
+start_server {tags {"swap" "stream"} overrides {save "" stream-node-max-entries 4 swap-persist-enabled yes swap-dirty-subkeys-enabled yes}} {
+    r config set swap-debug-evict-keys 0
+
+    test {persist load stream} {
+        for {set i 1} {$i <= 20} {incr i} {
+            r xadd mystream $i-0 f $i
+        }
+        r xgroup create mystream g1 0
+        r xreadgroup GROUP g1 c1 COUNT 3 STREAMS mystream >
+        wait_key_clean r mystream
+
+        restart_server 0 true false
+        assert_equal [r xlen mystream] 20
+        assert_equal [r xrange mystream 19 +] {{19-0 {f 19}} {20-0 {f 20}}}
+        assert_equal [r xpending mystream g1] {3 1-0 3-0 {{c1 3}}}
+
+        r xadd mystream 21-0 f 21
+        r xack mystream g1 1-0
+        wait_key_clean r mystream
+        restart_server 0 true false
+        assert_equal [r xlen mystream] 21
+        assert_equal [lindex [r xpending mystream g1] 0] 2
+    }
+}
@@ -12,6 +12,44 @@ start_server {tags {"swap string"}} {
     }
 }
 
+start_server {tags {"swap string"}} {
+    r config set swap-debug-evict-keys 0
+    r config set swap-string-chunk-threshold 65536
+    test {range commands on chunked cold string keep it cold} {
+        set val [string repeat abcdefghij 20000]
+        r set bigstr $val
+        r swap.evict bigstr
+        wait_key_cold r bigstr
+        assert_equal [object_meta_len r bigstr] 200000
+
+        assert_equal [r strlen bigstr] 200000
+        assert_equal [r getrange bigstr 65530 65545] [string range $val 65530 65545]
+        assert_equal [r getrange bigstr -5 -1] fghij
+        assert_equal [r getrange bigstr 5 1] {}
+        assert [object_is_cold r bigstr]
+
+        assert_equal [r setrange bigstr 65534 XYZ] 200000
+        assert_equal [r append bigstr 12345] 200005
+        assert_equal [r setrange bigstr 200010 end] 200013
+        assert [object_is_cold r bigstr]
+        assert_equal [r strlen bigstr] 200013
+        assert_equal [object_meta_len r bigstr] 200013
+
+        set val [string replace $val 65534 65536 XYZ]
+        append val 12345 [string repeat "\x00" 5] end
+        assert_equal [r get bigstr] $val
+        assert ![object_is_cold r bigstr]
+    }
+
+    test {chunked string turns whole key after shrinking} {
+        r set bigstr small
+        r swap.evict bigstr
+        wait_key_cold r bigstr
+        assert_equal [r strlen bigstr] 5
+        assert_equal [r get bigstr] small
+    }
+}
+
 
 start_server {tags {"swap  small hash"}} {
     r config set swap-debug-evict-keys 0
@@ -2013,4 +2013,37 @@ start_server {} {
         wait_key_cold r myzset 
         assert_equal [r zremrangebyscore myzset "0" "17600000000000"] 1
     }
-}
\ No newline at end of file
+}
+start_server {tags {"swap zset"}} {
+    r config set swap-debug-evict-keys 0
+    test {zrank/zrevrank/zcard of cold zset swap in member only} {
+        for {set i 0} {$i < 200} {incr i} {
+            r zadd leaderboard [expr {$i % 50}] member$i
+        }
+        set rank [r zrank leaderboard member123]
+        set revrank [r zrevrank leaderboard member123]
+        r swap.evict leaderboard
+        wait_key_cold r leaderboard
+        assert_equal [r zcard leaderboard] 200
+        r swap.evict leaderboard
+        wait_key_cold r leaderboard
+        assert_equal [r zrank leaderboard member123] $rank
+        assert_equal [object_meta_len r leaderboard] 199
+        r swap.evict leaderboard
+        wait_key_cold r leaderboard
+        assert_equal [r zrevrank leaderboard member123] $revrank
+        assert_equal [r zrank leaderboard nosuchmember] {}
+        assert_equal [r zrank leaderboard member123] $rank
+        assert_equal [r zcard leaderboard] 200
+    }
+
+    test {zrank of cold zset in multi swaps in entire zset} {
+        set rank [r zrank leaderboard member123]
+        r swap.evict leaderboard
+        wait_key_cold r leaderboard
+        r multi
+        r zadd leaderboard -1 newmember
+        r zrank leaderboard member123
+        assert_equal [r exec] [list 1 [expr {$rank+1}]]
+    }
+}
@@ -28,6 +28,8 @@ set ::disk_tests {
     swap/integration/expire_evict
     swap/integration/swap_load
     swap/integration/persist
+    swap/integration/checkpoint_sync
+    swap/integration/repl_apply
     swap/ported/replication-psync
     swap/ported/replication
     swap/ported/other
@@ -45,6 +47,7 @@ set ::disk_tests {
     swap/unit/dbsize
     swap/unit/lock
     swap/unit/list
+    swap/unit/stream
     swap/unit/dirty
     swap/unit/expire
     swap/unit/rdb
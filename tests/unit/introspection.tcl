@@ -180,6 +180,10 @@ start_server {tags {"introspection"}} {
             rocksdb.block_cache_size
             rocksdb.data.block_cache_size
             rocksdb.meta.block_cache_size
+            rocksdb.block_cache_type
+            swap-key-format
+            swap-key-format-migrate
+            rocksdb.data.prefix_bloom
             rocksdb.ratelimiter.rate_per_sec
             rocksdb.bytes_per_sync
             rocksdb.max_background_jobs